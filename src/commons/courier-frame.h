@@ -0,0 +1,302 @@
+/*
+ * courier-frame.h
+ * Binary framing for Courier TX/RX (ctx/crx <-> tools/ctx.py, tools/crx.py).
+ * Include once per .c file — all functions are static.
+ *
+ * Requires:
+ *   - commons.h (rp6502.h, RIA registers, TX_READY_SPIN)
+ *   - the including program owns XRAM portal 1 (frm_load_xram/frm_store_xram)
+ *
+ * A frame is COBS encoded and ends with a 0x00 delimiter, so 0x00 never
+ * occurs inside a frame and the receiver resynchronises at every delimiter.
+ * Decoded frame:
+ *
+ *   [type 1B][seq 1B][len 2B LE][payload len B][crc16 2B LE]
+ *
+ * The crc16 is CRC-16/XMODEM (poly 0x1021, init 0) over type..payload, which
+ * is binascii.crc_hqx(data, 0) on the host. It is computed nibble-wise,
+ * with no table, one byte behind the decoder so the check at the delimiter
+ * costs nothing. The encoding is mirrored in tools/courier.py.
+ *
+ * Transfer:
+ *
+ *   H  ->            header, flags FRM_F_RESUME: the receiver may resume,
+ *                    FRM_F_DEFLATE: the sender may send deflated windows
+ *      <- A [off][crc32][flags]   receiver already holds off bytes with this
+ *                    CRC32; flags = the header flags it accepts
+ *   S [off] ->       sender's choice: resume at off, or 0 for a new file
+ *      <- A
+ *   D seq .. D seq+n-1, P seq [n] ->   one window of up to FRM_WINDOW blocks
+ *      <- A seq [bitmap]   blocks received; all bits set = written to file
+ *   P seq [n][raw 2B LE]   the same for a deflated window: its blocks are one
+ *                    raw DEFLATE stream (commons/deflate.h) of raw file bytes
+ *   ... missing blocks only, P again, until the window is complete
+ *   E [crc32] ->     CRC32 of the whole file
+ *      <- A
+ *
+ * The receiver writes only complete windows, so after an interruption the
+ * file on its side always ends at a window boundary and the next transfer
+ * of the same file continues from there. Each deflated window is a stream
+ * of its own, so resends and resume work the same way; a window that does
+ * not shrink goes out raw.
+ *
+ * Sync session (crx /sync): any number of the exchanges below, each file
+ * sent as a transfer above, then
+ *
+ *   L page ->        <- A page [entries]   the receiver's directory, as
+ *                    [size 4B LE][fdate 2B][ftime 2B][name\0] entries;
+ *                    pages 0, 1, 2 .. until an empty one
+ *   K [crc32][fdate][ftime][name\0] ->
+ *                    <- A [1] the file has this CRC32 and now this date, [0] not
+ *   B ->             <- A   session over
+ *
+ * With FRM_F_DATE the header carries [fdate 2B][ftime 2B] after the name
+ * and the receiver dates the file with them, so an unchanged file is known
+ * by its size and date alone the next time.
+ */
+
+#ifndef COURIER_FRAME_H
+#define COURIER_FRAME_H
+
+#define FRM_DATA_MAX    256u        // payload bytes per data frame
+#define FRM_HDR_LEN     4u
+#define FRM_BUF_SIZE    (FRM_HDR_LEN + FRM_DATA_MAX + 2u)
+
+/* frame types */
+#define FRM_HEADER      'H'         // [ver][flags][size 4B LE][name\0]
+#define FRM_DATA        'D'         // file bytes
+#define FRM_END         'E'         // [crc32 4B LE] of the whole file
+#define FRM_ACK         'A'         // seq received and committed
+#define FRM_NAK         'N'         // seq bad or missing, send it again
+#define FRM_CANCEL      'C'         // either side gives up
+#define FRM_POLL        'P'         // [count] or [count][raw 2B LE] blocks sent in the window at seq
+#define FRM_START       'S'         // [offset 4B LE] first byte of the data
+#define FRM_LIST        'L'         // page of the receiver's directory listing
+#define FRM_CHECK       'K'         // [crc32 4B LE][fdate][ftime][name\0] compare and date
+#define FRM_BYE         'B'         // sync session over
+
+#define FRM_VERSION     1
+#define FRM_CAPABLE     'F'         // "frames understood" reply to the probe
+#define FRM_RETRIES     8           // resend attempts per frame
+#define FRM_WINDOW      8           // data frames per window (bitmap is 1 byte)
+#define FRM_F_RESUME    0x01        // header flag: receiver may offer a resume
+#define FRM_F_DEFLATE   0x02        // header flag: windows may be deflated
+#define FRM_F_DATE      0x04        // header flag: [fdate][ftime] follow the name
+#define FRM_WIN_BYTES   (FRM_WINDOW * FRM_DATA_MAX)   // one window, one read_xram/write_xram
+#define FRM_RAW_MAX     (2u * FRM_WIN_BYTES)          // most bytes a deflated window holds
+#define FRM_MASK(n)     ((uint8_t)((1u << (n)) - 1u))  // bitmap of a window of n blocks
+
+/* frm_feed() results */
+#define FRM_NONE        0           // frame not complete yet
+#define FRM_OK          1           // frm_buf holds a valid frame
+#define FRM_BAD         2           // delimiter reached, frame corrupt
+
+#define FRM_TYPE        (frm_buf[0])
+#define FRM_SEQ         (frm_buf[1])
+#define FRM_LEN         ((uint16_t)frm_buf[2] | ((uint16_t)frm_buf[3] << 8))
+#define FRM_PAYLOAD     (frm_buf + FRM_HDR_LEN)
+
+static uint8_t  frm_buf[FRM_BUF_SIZE];
+static uint16_t frm_len;                // decoded bytes in frm_buf
+static uint8_t  frm_code;               // current COBS group code, 0 = none yet
+static uint8_t  frm_left;               // bytes left in the current group
+static uint8_t  frm_over;               // frame did not fit frm_buf
+static uint16_t frm_crc;                // crc16 of frm_buf[0 .. frm_len-3]
+
+static uint16_t crc16_upd(uint16_t crc, uint8_t b)
+{
+    uint8_t x = (uint8_t)(crc >> 8) ^ b;
+    x ^= (uint8_t)(x >> 4);
+    return (uint16_t)((crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x);
+}
+
+static void frm_put(uint8_t b)
+{
+    TX_READY_SPIN;
+    RIA.tx = b;
+}
+
+/* COBS encode n bytes straight to the UART */
+static void frm_cobs_send(const uint8_t *p, uint16_t n)
+{
+    uint16_t run, i;
+    for (;;) {
+        run = 0;
+        while (run < 254u && run < n && p[run]) run++;
+        frm_put((uint8_t)(run + 1u));
+        for (i = 0; i < run; i++) frm_put(p[i]);
+        p += run;
+        n -= run;
+        if (run == 254u) {
+            if (!n) { frm_put(1); break; }
+            continue;                   /* full group, no zero consumed */
+        }
+        if (!n) break;
+        p++;                            /* the zero that ended this group */
+        n--;
+    }
+    frm_put(0);
+}
+
+/* Build a frame in frm_buf and send it. payload may already be FRM_PAYLOAD. */
+static void frm_send(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint16_t crc = 0;
+    uint16_t i;
+    frm_buf[0] = type;
+    frm_buf[1] = seq;
+    frm_buf[2] = (uint8_t)len;
+    frm_buf[3] = (uint8_t)(len >> 8);
+    if (payload != FRM_PAYLOAD)
+        for (i = 0; i < len; i++) FRM_PAYLOAD[i] = payload[i];
+    len += FRM_HDR_LEN;
+    for (i = 0; i < len; i++) crc = crc16_upd(crc, frm_buf[i]);
+    frm_buf[len]      = (uint8_t)crc;
+    frm_buf[len + 1u] = (uint8_t)(crc >> 8);
+    frm_cobs_send(frm_buf, len + 2u);
+}
+
+static void frm_reset(void)
+{
+    frm_len  = 0;
+    frm_code = 0;
+    frm_left = 0;
+    frm_over = 0;
+    frm_crc  = 0;
+}
+
+/* Append a decoded byte; the last two are the crc16 so they stay out of it */
+static void frm_push(uint8_t b)
+{
+    if (frm_len >= FRM_BUF_SIZE) {
+        frm_over = 1;
+        return;
+    }
+    if (frm_len >= 2u) frm_crc = crc16_upd(frm_crc, frm_buf[frm_len - 2u]);
+    frm_buf[frm_len++] = b;
+}
+
+/* Feed one received byte to the COBS decoder. */
+static uint8_t frm_feed(uint8_t b)
+{
+    uint16_t crc, n;
+    if (b == 0) {
+        n   = frm_len;
+        crc = frm_crc;
+        if (!n && !frm_code) return FRM_NONE;   /* idle delimiter */
+        if (frm_over || frm_left || n < FRM_HDR_LEN + 2u) {
+            frm_reset();
+            return FRM_BAD;
+        }
+        frm_reset();
+        if (frm_buf[n - 2u] != (uint8_t)crc || frm_buf[n - 1u] != (uint8_t)(crc >> 8)
+            || FRM_LEN != n - FRM_HDR_LEN - 2u)
+            return FRM_BAD;
+        return FRM_OK;
+    }
+    if (!frm_left) {                    /* b is a group code */
+        if (frm_code && frm_code != 0xFFu) frm_push(0);
+        frm_code = b;
+        frm_left = (uint8_t)(b - 1u);
+        return FRM_NONE;
+    }
+    frm_push(b);
+    frm_left--;
+    return FRM_NONE;
+}
+
+/* Wait up to timeout ticks for a frame.
+ * Returns FRM_OK, FRM_BAD, or FRM_NONE on timeout. */
+static uint8_t frm_recv(clock_t timeout)
+{
+    clock_t t0 = clock();
+    uint8_t r;
+    for (;;) {
+        if (RIA.ready & RIA_READY_RX_BIT) {
+            r = frm_feed(RIA.rx);
+            if (r != FRM_NONE) return r;
+        } else if ((clock() - t0) >= timeout) {
+            break;
+        }
+    }
+    frm_reset();
+    return FRM_NONE;
+}
+
+/* ---- window slots in XRAM <-> FRM_PAYLOAD ---------------------------------
+ * Portal 1, so that drawing through portal 0 (courier-gfx.h) in between
+ * does not disturb these copies. */
+
+static void frm_load_xram(uint16_t addr, uint16_t n)
+{
+    uint8_t *p = FRM_PAYLOAD;
+    RIA.addr1 = addr;
+    RIA.step1 = 1;
+    for (; n; n--) *p++ = RIA.rw1;
+}
+
+static void frm_store_xram(uint16_t addr, uint16_t n)
+{
+    const uint8_t *p = FRM_PAYLOAD;
+    RIA.addr1 = addr;
+    RIA.step1 = 1;
+    for (; n; n--) RIA.rw1 = *p++;
+}
+
+/* ---- CRC32 (zlib.crc32 on the host) -------------------------------------
+ * Byte-wise with the table split into four byte planes, so the inner loop
+ * is 8-bit XORs and loads only. crc32_init() builds the planes once. */
+
+static uint8_t crc32_t0[256], crc32_t1[256], crc32_t2[256], crc32_t3[256];
+static unsigned long crc32_val;         // running value, pre-inverted
+
+static void crc32_init(void)
+{
+    unsigned long t;
+    uint16_t i;
+    uint8_t  k;
+    for (i = 0; i < 256u; i++) {
+        t = i;
+        for (k = 0; k < 8u; k++)
+            t = (t & 1UL) ? (t >> 1) ^ 0xEDB88320UL : (t >> 1);
+        crc32_t0[i] = ((const uint8_t *)&t)[0];
+        crc32_t1[i] = ((const uint8_t *)&t)[1];
+        crc32_t2[i] = ((const uint8_t *)&t)[2];
+        crc32_t3[i] = ((const uint8_t *)&t)[3];
+    }
+    crc32_val = 0xFFFFFFFFUL;
+}
+
+static void crc32_block(const uint8_t *p, uint16_t n)
+{
+    /* the 6502 is little endian: c[0] is the low byte */
+    uint8_t *c = (uint8_t *)&crc32_val;
+    uint8_t  i;
+    for (; n; n--) {
+        i    = c[0] ^ *p++;
+        c[0] = c[1] ^ crc32_t0[i];
+        c[1] = c[2] ^ crc32_t1[i];
+        c[2] = c[3] ^ crc32_t2[i];
+        c[3] = crc32_t3[i];
+    }
+}
+
+#define crc32_get()     (crc32_val ^ 0xFFFFFFFFUL)
+
+/* ---- little endian 32-bit fields in payloads ----------------------------- */
+
+static unsigned long frm_get32(const uint8_t *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8)
+         | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void frm_put32(uint8_t *p, unsigned long v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#endif /* COURIER_FRAME_H */
@@ -0,0 +1,495 @@
+/*
+ * deflate.h
+ * Raw DEFLATE (RFC 1951): LZ77 with a 4 KB window and the fixed Huffman
+ * code. Used by pack (ZIP), by ctx/crx for compressed transfer windows and
+ * by txt2pdf/printer for /FlateDecode PDF streams.
+ * Include once per .c file — all functions are static.
+ *
+ * Define _NEED_DEFLATE for dfl_deflate() and/or _NEED_INFLATE for
+ * dfl_inflate() before including; each side costs the 4 KB window.
+ *
+ * The including program supplies the byte source and the sink:
+ *   dfl_in()          next input byte, -1 at the end (and on every call after)
+ *   dfl_out(buf, n)   next n output bytes, n <= DFL_OBUF_SIZE
+ * dfl_total counts the bytes given to dfl_out.
+ *
+ * A program that produces its input as it goes pushes it instead:
+ * dfl_start(), dfl_put(b) for every byte, dfl_end(). dfl_in is not used
+ * then; the output is the same as dfl_deflate() gives for the same bytes.
+ * Such a program defines DFL_PUSH_ONLY to leave dfl_deflate() out.
+ *
+ * dfl_deflate() writes one final fixed Huffman block, so its output is
+ * zlib.decompress(data, -15) on the host. dfl_inflate() takes stored and
+ * fixed Huffman blocks with distances up to 4 KB: its own output, or zlib
+ * with wbits -12 and strategy Z_FIXED.
+ */
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#define LZ_WIN_SIZE    4096u
+#define LZ_WIN_MASK    0x0FFFu
+#define LZ_HASH_SIZE   256u
+#define LZ_MIN_MATCH   3u
+#define LZ_MAX_MATCH   32u           /* cap: keeps lookahead buffer small */
+#define LZ_AHEAD_SIZE  (LZ_MAX_MATCH + 3u) /* 35 bytes */
+#define LZ_AHEAD_MASK  63u           /* lookahead ring, no memmove per byte */
+
+#define DFL_OBUF_SIZE  128u
+
+/* dfl_inflate() results */
+#define DFL_OK          0
+#define DFL_ERR_DATA   -1            /* truncated or corrupt stream */
+#define DFL_ERR_DIST   -2            /* back-reference beyond the window */
+#define DFL_ERR_TYPE   -3            /* dynamic Huffman block (BTYPE=10) */
+
+#if !defined(DFL_PUSH_ONLY) || defined(_NEED_INFLATE)
+static int  (*dfl_in)(void);
+#endif
+static void (*dfl_out)(const unsigned char *buf, unsigned int len);
+static unsigned long  dfl_total;        /* bytes given to dfl_out */
+
+static unsigned char  lz_win[LZ_WIN_SIZE];
+static unsigned int   lz_wpos;
+
+static unsigned char  dfl_obuf[DFL_OBUF_SIZE];
+static unsigned char  dfl_opos;
+static unsigned char  dfl_bits;         /* bit accumulator */
+
+static void dfl_flush(void)
+{
+    if (dfl_opos > 0u) {
+        dfl_total += (unsigned long)dfl_opos;
+        dfl_out(dfl_obuf, dfl_opos);
+        dfl_opos = 0u;
+    }
+}
+
+#ifdef _NEED_DEFLATE
+
+static unsigned char  dfl_stop;         /* set by dfl_out: dfl_deflate() ends early */
+static unsigned char  dfl_mask;         /* next bit position in dfl_bits */
+
+static unsigned int   lz_ht[LZ_HASH_SIZE];
+static unsigned char  lz_ahead[LZ_AHEAD_MASK + 1u];
+static unsigned char  lz_ahead_pos;     /* ring index of lookahead byte 0 */
+static unsigned char  lz_ahead_len;
+static unsigned int   lz_wfill;
+
+#define LZ_AHEAD(i)    lz_ahead[(unsigned char)(lz_ahead_pos + (i)) & LZ_AHEAD_MASK]
+
+/* ---- bit output ------------------------------------------------------------ */
+
+static void dfl_byte_done(void)
+{
+    dfl_obuf[dfl_opos++] = dfl_bits;
+    dfl_bits = 0u;
+    dfl_mask = 1u;
+    if (dfl_opos >= DFL_OBUF_SIZE) dfl_flush();
+}
+
+/* Extra bits and block header: LSB first */
+static void emit_extra(unsigned int val, unsigned char nbits)
+{
+    for (; nbits; nbits--) {
+        if (val & 1u) dfl_bits |= dfl_mask;
+        val >>= 1;
+        dfl_mask <<= 1;
+        if (!dfl_mask) dfl_byte_done();
+    }
+}
+
+/* Huffman code: MSB first (per RFC 1951 §3.1.1) */
+static void emit_huff(unsigned int code, unsigned char nbits)
+{
+    unsigned int bit = 1u << (nbits - 1u);
+    for (; bit; bit >>= 1) {
+        if (code & bit) dfl_bits |= dfl_mask;
+        dfl_mask <<= 1;
+        if (!dfl_mask) dfl_byte_done();
+    }
+}
+
+static void dfl_literal(unsigned char b)
+{
+    if (b <= 143u) emit_huff((unsigned int)(0x30u + b), 8u);
+    else           emit_huff((unsigned int)(0x190u + b - 144u), 9u);
+}
+
+/* Emit length symbol + extra bits for match length 3-32 */
+static void dfl_length(unsigned int len)
+{
+    unsigned int  sym;   /* 257-285: must be unsigned int, not char */
+    unsigned char xb;
+    unsigned int  xv;
+
+    /* symbols 257-264: lengths 3-10, 0 extra bits */
+    if (len <= 10u) {
+        sym = 254u + len; /* 257..264 */
+        xb = 0u; xv = 0u;
+    } else if (len <= 12u) { sym = 265u; xb = 1u; xv = len - 11u; }
+    else if (len <= 14u)   { sym = 266u; xb = 1u; xv = len - 13u; }
+    else if (len <= 16u)   { sym = 267u; xb = 1u; xv = len - 15u; }
+    else if (len <= 18u)   { sym = 268u; xb = 1u; xv = len - 17u; }
+    else if (len <= 22u)   { sym = 269u; xb = 2u; xv = len - 19u; }
+    else if (len <= 26u)   { sym = 270u; xb = 2u; xv = len - 23u; }
+    else if (len <= 30u)   { sym = 271u; xb = 2u; xv = len - 27u; }
+    else                   { sym = 272u; xb = 2u; xv = len - 31u; } /* 31-34 */
+
+    /* fixed Huffman: sym 257-279 → 7-bit codes (sym-256); 280-287 → 8-bit 0xC0+ */
+    if (sym <= 279u) emit_huff((unsigned int)(sym - 256u), 7u);
+    else             emit_huff((unsigned int)(0xC0u + sym - 280u), 8u);
+    if (xb) emit_extra(xv, xb);
+}
+
+/* Emit distance code + extra bits for distance 1-4096 */
+static void dfl_distance(unsigned int dist)
+{
+    unsigned char xb;
+    unsigned int  xv;
+    unsigned char code;
+
+    dist--;  /* make 0-based */
+    if      (dist <    4u) { code = (unsigned char)dist; xb = 0u; xv = 0u;          }
+    else if (dist <    6u) { code =  4u; xb =  1u; xv = dist -    4u; }
+    else if (dist <    8u) { code =  5u; xb =  1u; xv = dist -    6u; }
+    else if (dist <   12u) { code =  6u; xb =  2u; xv = dist -    8u; }
+    else if (dist <   16u) { code =  7u; xb =  2u; xv = dist -   12u; }
+    else if (dist <   24u) { code =  8u; xb =  3u; xv = dist -   16u; }
+    else if (dist <   32u) { code =  9u; xb =  3u; xv = dist -   24u; }
+    else if (dist <   48u) { code = 10u; xb =  4u; xv = dist -   32u; }
+    else if (dist <   64u) { code = 11u; xb =  4u; xv = dist -   48u; }
+    else if (dist <   96u) { code = 12u; xb =  5u; xv = dist -   64u; }
+    else if (dist <  128u) { code = 13u; xb =  5u; xv = dist -   96u; }
+    else if (dist <  192u) { code = 14u; xb =  6u; xv = dist -  128u; }
+    else if (dist <  256u) { code = 15u; xb =  6u; xv = dist -  192u; }
+    else if (dist <  384u) { code = 16u; xb =  7u; xv = dist -  256u; }
+    else if (dist <  512u) { code = 17u; xb =  7u; xv = dist -  384u; }
+    else if (dist <  768u) { code = 18u; xb =  8u; xv = dist -  512u; }
+    else if (dist < 1024u) { code = 19u; xb =  8u; xv = dist -  768u; }
+    else if (dist < 1536u) { code = 20u; xb =  9u; xv = dist - 1024u; }
+    else if (dist < 2048u) { code = 21u; xb =  9u; xv = dist - 1536u; }
+    else if (dist < 3072u) { code = 22u; xb = 10u; xv = dist - 2048u; }
+    else                   { code = 23u; xb = 10u; xv = dist - 3072u; }
+
+    emit_huff((unsigned int)code, 5u);
+    if (xb) emit_extra(xv, xb);
+}
+
+/* ---- LZ77 helpers ------------------------------------------------------- */
+
+static unsigned char lz_hash3(unsigned char a, unsigned char b, unsigned char c)
+{
+    return (unsigned char)((((unsigned int)a * 5u) + ((unsigned int)b * 3u) + c) & 0xFFu);
+}
+
+/* Move lookahead byte 0 into the window (hashed) */
+static void lz_advance(void)
+{
+    unsigned char c = LZ_AHEAD(0);
+
+    if (lz_ahead_len >= LZ_MIN_MATCH)
+        lz_ht[lz_hash3(c, LZ_AHEAD(1), LZ_AHEAD(2))] = lz_wpos;
+    lz_win[lz_wpos] = c;
+    lz_wpos = (unsigned int)((lz_wpos + 1u) & LZ_WIN_MASK);
+    if (lz_wfill < LZ_WIN_SIZE) lz_wfill++;
+
+    lz_ahead_pos = (unsigned char)((lz_ahead_pos + 1u) & LZ_AHEAD_MASK);
+    lz_ahead_len--;
+}
+
+/* Find a match at current lookahead position.
+ * Returns match length (0 if < LZ_MIN_MATCH), sets *pdist. */
+static unsigned int lz_find_match(unsigned int *pdist)
+{
+    unsigned int   cand;
+    unsigned int   dist;
+    unsigned int   max_len;
+    unsigned int   len;
+    unsigned int   wp;
+
+    if (lz_ahead_len < LZ_MIN_MATCH) return 0u;
+
+    cand = lz_ht[lz_hash3(LZ_AHEAD(0), LZ_AHEAD(1), LZ_AHEAD(2))];
+    if (cand == 0xFFFFu || lz_wfill == 0u) return 0u;
+
+    /* compute distance (1-based) */
+    if (lz_wpos > cand) dist = lz_wpos - cand;
+    else                dist = LZ_WIN_SIZE - cand + lz_wpos;
+    if (dist == 0u || dist > lz_wfill) return 0u;
+
+    /* cap: respect window, ahead buffer, and max match */
+    max_len = lz_ahead_len;
+    if (max_len > LZ_MAX_MATCH) max_len = LZ_MAX_MATCH;
+    if (max_len > dist)         max_len = dist;   /* no run-length overlap */
+    if (max_len < LZ_MIN_MATCH) return 0u;
+
+    /* compare lookahead with window */
+    len = 0u;
+    wp  = cand;
+    while (len < max_len) {
+        if (lz_win[wp] != LZ_AHEAD(len)) break;
+        len++;
+        wp = (unsigned int)((wp + 1u) & LZ_WIN_MASK);
+    }
+    if (len < LZ_MIN_MATCH) return 0u;
+
+    *pdist = dist;
+    return len;
+}
+
+/* ---- compress into dfl_out as one final block --------------------------- */
+
+static void dfl_start(void)
+{
+    unsigned int   i;
+
+    lz_wpos = 0u; lz_wfill = 0u; lz_ahead_pos = 0u; lz_ahead_len = 0u;
+    dfl_bits = 0u; dfl_mask = 1u; dfl_opos = 0u; dfl_total = 0UL; dfl_stop = 0u;
+    for (i = 0u; i < LZ_HASH_SIZE; i++) lz_ht[i] = 0xFFFFu;
+
+    /* DEFLATE block header: BFINAL=1, BTYPE=01 (fixed Huffman), LSB first */
+    emit_extra(3u, 3u);
+}
+
+/* Code the match or literal at lookahead byte 0 */
+static void dfl_step(void)
+{
+    unsigned int   i;
+    unsigned int   match_len;
+    unsigned int   dist = 0u;
+
+    match_len = lz_find_match(&dist);
+    if (match_len >= LZ_MIN_MATCH) {
+        dfl_length(match_len);
+        dfl_distance(dist);
+        for (i = 0u; i < match_len; i++) lz_advance();
+    } else {
+        dfl_literal(LZ_AHEAD(0));
+        lz_advance();
+    }
+}
+
+static void dfl_put(unsigned char b)
+{
+    if (lz_ahead_len == LZ_AHEAD_SIZE) dfl_step();
+    LZ_AHEAD(lz_ahead_len) = b;
+    lz_ahead_len++;
+}
+
+static void dfl_end(void)
+{
+    while (lz_ahead_len > 0u && !dfl_stop) dfl_step();
+
+    emit_huff(0u, 7u);                  /* symbol 256: end of block */
+    if (dfl_mask != 1u) dfl_byte_done(); /* pad to byte boundary */
+    dfl_flush();
+}
+
+#ifndef DFL_PUSH_ONLY
+/* Compress dfl_in until it runs dry or dfl_out sets dfl_stop */
+static void dfl_deflate(void)
+{
+    int            b;
+
+    dfl_start();
+    for (;;) {
+        while (lz_ahead_len < LZ_AHEAD_SIZE) {
+            b = dfl_in();
+            if (b < 0) break;
+            LZ_AHEAD(lz_ahead_len) = (unsigned char)b;
+            lz_ahead_len++;
+        }
+        if (lz_ahead_len == 0u || dfl_stop) break;
+        dfl_step();
+    }
+    dfl_end();
+}
+#endif /* DFL_PUSH_ONLY */
+
+#endif /* _NEED_DEFLATE */
+
+#ifdef _NEED_INFLATE
+
+static unsigned char  infl_nbits;       /* bits left in dfl_bits */
+
+/* Distance codes 0-23 cover distances 1-4096 (matches 4KB LZ77 window)     */
+static const unsigned int dist_base[24] = {
+    1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,
+    257,385,513,769,1025,1537,2049,3073
+};
+static const unsigned char dist_xb[24] = {
+    0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10
+};
+
+/* Length symbols 257-285 (index = sym-257); sym 285 → len 258, 0 extra bits */
+static const unsigned int len_base[29] = {
+    3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,
+    35,43,51,59,67,83,99,115,131,163,195,227,258
+};
+static const unsigned char len_xb[29] = {
+    0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
+};
+
+static int infl_bit(void)
+{
+    int b;
+    if (infl_nbits == 0u) {
+        b = dfl_in();
+        if (b < 0) return -1;
+        dfl_bits   = (unsigned char)b;
+        infl_nbits = 8u;
+    }
+    b = (int)(dfl_bits & 1u);
+    dfl_bits >>= 1;
+    infl_nbits--;
+    return b;
+}
+
+/* Read n bits LSB-first (extra bits after Huffman code) */
+static int infl_read_lsb(unsigned char n)
+{
+    unsigned int  v = 0u;
+    unsigned char i;
+    int b;
+    for (i = 0u; i < n; i++) {
+        b = infl_bit();
+        if (b < 0) return -1;
+        v |= (unsigned int)(unsigned char)b << i;
+    }
+    return (int)v;
+}
+
+/* Decode fixed Huffman lit/len symbol: 7/8/9 bits, MSB-accumulated        */
+/* First bit read from stream = MSB of code (as emitted by emit_huff).      */
+static int infl_decode_litlen(void)
+{
+    unsigned int  code = 0u;
+    unsigned char i;
+    int b;
+
+    for (i = 0u; i < 7u; i++) {
+        b = infl_bit();
+        if (b < 0) return -1;
+        code = (code << 1) | (unsigned int)(unsigned char)b;
+    }
+    if (code <= 23u) return (int)(256u + code); /* 7-bit: EOB(256), 257-279 */
+
+    b = infl_bit(); if (b < 0) return -1;
+    code = (code << 1) | (unsigned int)(unsigned char)b;  /* 8 bits */
+    if (code >= 48u  && code <= 191u) return (int)(code - 48u);         /* lit 0-143   */
+    if (code >= 192u && code <= 199u) return (int)(280u + code - 192u); /* sym 280-287 */
+
+    b = infl_bit(); if (b < 0) return -1;
+    code = (code << 1) | (unsigned int)(unsigned char)b;  /* 9 bits */
+    if (code >= 400u && code <= 511u) return (int)(144u + code - 400u); /* lit 144-255 */
+
+    return -2; /* invalid code */
+}
+
+/* Decode 5-bit distance code, MSB-accumulated */
+static int infl_decode_dist(void)
+{
+    unsigned int  code = 0u;
+    unsigned char i;
+    int b;
+    for (i = 0u; i < 5u; i++) {
+        b = infl_bit();
+        if (b < 0) return -1;
+        code = (code << 1) | (unsigned int)(unsigned char)b;
+    }
+    return (int)code;
+}
+
+static void infl_emit(unsigned char b)
+{
+    lz_win[lz_wpos] = b;
+    lz_wpos = (lz_wpos + 1u) & LZ_WIN_MASK;
+    dfl_obuf[dfl_opos++] = b;
+    if (dfl_opos >= DFL_OBUF_SIZE) dfl_flush();
+}
+
+/* ---- Inflate one fixed-Huffman block (BTYPE=01) ------------------------- */
+
+static int inflate_fixed_block(void)
+{
+    int          sym, dc, xb, extra;
+    unsigned int length, dist, src, i;
+
+    while (1) {
+        sym = infl_decode_litlen();
+        if (sym < 0) return DFL_ERR_DATA;
+
+        if (sym == 256) return DFL_OK; /* end-of-block */
+
+        if (sym < 256) {
+            infl_emit((unsigned char)sym);
+        } else {
+            /* length/distance back-reference: sym 257-285 */
+            sym -= 257;
+            if (sym > 28) return DFL_ERR_DATA;
+            xb     = (int)len_xb[(unsigned char)sym];
+            extra  = xb ? infl_read_lsb((unsigned char)xb) : 0;
+            if (extra < 0) return DFL_ERR_DATA;
+            length = len_base[(unsigned char)sym] + (unsigned int)extra;
+
+            dc = infl_decode_dist();
+            if (dc < 0 || dc > 23) return DFL_ERR_DATA;
+            xb    = (int)dist_xb[(unsigned char)dc];
+            extra = xb ? infl_read_lsb((unsigned char)xb) : 0;
+            if (extra < 0) return DFL_ERR_DATA;
+            dist = dist_base[(unsigned char)dc] + (unsigned int)extra;
+            if (dist == 0u || dist > LZ_WIN_SIZE) return DFL_ERR_DIST;
+
+            src = (unsigned int)((lz_wpos + LZ_WIN_SIZE - dist) & LZ_WIN_MASK);
+            for (i = 0u; i < length; i++)
+                infl_emit(lz_win[(unsigned int)((src + i) & LZ_WIN_MASK)]);
+        }
+    }
+}
+
+/* ---- decompress dfl_in → dfl_out up to the final block ----------------- */
+
+static int dfl_inflate(void)
+{
+    int          bfinal, btype, rc, b;
+    unsigned int blen;
+
+    dfl_bits   = 0u;
+    infl_nbits = 0u;
+    dfl_opos   = 0u;
+    dfl_total  = 0UL;
+    lz_wpos    = 0u;
+
+    do {
+        bfinal = infl_bit();        if (bfinal < 0) return DFL_ERR_DATA;
+        btype  = infl_read_lsb(2u); if (btype  < 0) return DFL_ERR_DATA;
+
+        if (btype == 0) {
+            /* BTYPE=00: non-compressed block — align, copy LEN bytes */
+            infl_nbits = 0u; dfl_bits = 0u;
+            b = dfl_in(); if (b < 0) return DFL_ERR_DATA;
+            blen  = (unsigned int)(unsigned char)b;
+            b = dfl_in(); if (b < 0) return DFL_ERR_DATA;
+            blen |= (unsigned int)(unsigned char)b << 8;
+            dfl_in(); dfl_in();     /* NLEN — discard */
+            for (; blen; blen--) {
+                b = dfl_in(); if (b < 0) return DFL_ERR_DATA;
+                infl_emit((unsigned char)b);
+            }
+        } else if (btype == 1) {
+            /* BTYPE=01: fixed Huffman */
+            rc = inflate_fixed_block();
+            if (rc < 0) return rc;
+        } else {
+            return DFL_ERR_TYPE;
+        }
+    } while (!bfinal);
+
+    dfl_flush();
+    return DFL_OK;
+}
+
+#endif /* _NEED_INFLATE */
+
+#endif /* DEFLATE_H */
@@ -0,0 +1,104 @@
+/*
+ * linereader.h
+ * Block-buffered text line reader shared by txt2pdf and printer.
+ * Include once per .c file — all functions are static.
+ *
+ * Requires:
+ *   - rp6502.h (RIA registers, read_xram)
+ *   - unistd.h (lseek)
+ *
+ * The input file is read in LR_XRAM_SIZE blocks with read_xram() into an
+ * XRAM window and lines are served from there through RIA.rw0, so a block
+ * costs one OS call instead of one call per character. lr_tell() gives the
+ * file offset of the next line; lr_seek() back to such an offset stays in
+ * the window when it can and costs one lseek() and one read_xram() when not.
+ * RIA.addr0 is set again on every call, callers may use port 0 in between.
+ */
+
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#ifndef LR_XRAM_BUF
+#define LR_XRAM_BUF  0xB000u    // XRAM window for input blocks
+#endif
+#define LR_XRAM_SIZE 0x1000u    // bytes per read_xram() (max 0x7FFF)
+
+static int           lr_fd;
+static unsigned long lr_base;   // file offset of the first byte in the window
+static unsigned      lr_len;    // bytes in the window
+static unsigned      lr_pos;    // next byte in the window
+
+static void lr_open(int fd)
+{
+    lr_fd   = fd;
+    lr_base = (unsigned long)lseek(fd, 0, SEEK_CUR);
+    lr_len  = 0u;
+    lr_pos  = 0u;
+}
+
+// Next block after the window; 0 at end of file or on a read error.
+static uint8_t lr_fill(void)
+{
+    int r;
+
+    lr_base += lr_len;
+    lr_pos   = 0u;
+    r = read_xram(LR_XRAM_BUF, LR_XRAM_SIZE, lr_fd);
+    lr_len = r > 0 ? (unsigned)r : 0u;
+    RIA.addr0 = LR_XRAM_BUF;
+    RIA.step0 = 1;
+    return lr_len != 0u;
+}
+
+static unsigned long lr_tell(void)
+{
+    return lr_base + lr_pos;
+}
+
+static void lr_seek(unsigned long off)
+{
+    if (off >= lr_base && off <= lr_base + lr_len) {
+        lr_pos = (unsigned)(off - lr_base);
+        return;
+    }
+    lseek(lr_fd, (off_t)off, SEEK_SET);
+    lr_base = off;
+    lr_len  = 0u;
+    lr_pos  = 0u;
+}
+
+/*
+ * Read one text line into buf (at most maxlen chars, NUL-terminated).
+ * Consumes the line terminator (CR, LF, or CRLF); longer lines are cut.
+ * Returns: number of characters placed in buf (>= 0), or -1 on EOF/error.
+ * An empty line returns 0. EOF with no characters returns -1.
+ */
+static int lr_read_line(char *buf, unsigned maxlen)
+{
+    unsigned n = 0u;
+    uint8_t  got_char = 0u;
+    char     c;
+
+    RIA.addr0 = LR_XRAM_BUF + lr_pos;
+    RIA.step0 = 1;
+    for (;;) {
+        if (lr_pos == lr_len && !lr_fill()) {
+            if (!got_char) { buf[0] = 0; return -1; }
+            break;
+        }
+        c = (char)RIA.rw0;
+        lr_pos++;
+        got_char = 1u;
+        if (c == '\r') {
+            if (lr_pos == lr_len && !lr_fill()) break;
+            if (RIA.rw0 == '\n') lr_pos++;
+            break;
+        }
+        if (c == '\n') break;
+        if (n < maxlen) buf[n++] = c;
+    }
+    buf[n] = 0;
+    return (int)n;
+}
+
+#endif /* LINEREADER_H */
@@ -0,0 +1,52 @@
+/*
+ * redirect.h
+ * Output redirection and pipes shared by the shell and .com commands.
+ * Include once per .c file — all functions are static.
+ *
+ * Requires:
+ *   - rp6502.h (RIA registers, write_xram)
+ *
+ * The shell places a redir_t block in RAM right after the argc/argv block
+ * (RUN_ARGS_BASE + RUN_ARGS_BLOCK_SIZE in shell.h) before it calls a .com,
+ * .exe or run address, and takes it back when the program returns.
+ * Redirected output is staged in XRAM and written to out_fd with large
+ * write_xram() calls; the shell flushes the remainder and closes the file.
+ * For the right side of a pipe, stdin (fd 0) is served from in_fd.
+ */
+
+#ifndef REDIRECT_H
+#define REDIRECT_H
+
+#define REDIR_BLOCK     0x0251u    // RAM: 0x0200 + 1 + 8*2 + 64, must follow RUN_ARGS block
+#define REDIR_MAGIC     0x5244u    // "RD" - block written by a redirect aware shell
+#define REDIR_XRAM_BUF  0xC000u    // XRAM staging buffer for redirected output
+#define REDIR_XRAM_SIZE 0x2000u    // flushed to out_fd when full (write_xram max 0x7FFF)
+
+typedef struct {
+    uint16_t magic;     // REDIR_MAGIC
+    int8_t   out_fd;    // output file, -1 = console
+    int8_t   in_fd;     // stdin file, -1 = console
+    uint16_t out_len;   // bytes staged at REDIR_XRAM_BUF
+    uint8_t  error;     // non zero after a failed write_xram
+} redir_t;
+
+#define REDIR           ((redir_t *)REDIR_BLOCK)
+#define REDIR_OUT(r)    ((r)->magic == REDIR_MAGIC && (r)->out_fd >= 0)
+#define REDIR_IN(r)     ((r)->magic == REDIR_MAGIC && (r)->in_fd >= 0)
+
+static void redir_flush(redir_t *r)
+{
+    if (r->out_len && write_xram(REDIR_XRAM_BUF, r->out_len, r->out_fd) < 0)
+        r->error = 1;
+    r->out_len = 0;
+}
+
+static void redir_putc(redir_t *r, char c)
+{
+    RIA.addr1 = REDIR_XRAM_BUF + r->out_len;
+    RIA.step1 = 1;
+    RIA.rw1   = (uint8_t)c;
+    if (++r->out_len == REDIR_XRAM_SIZE) redir_flush(r);
+}
+
+#endif /* REDIRECT_H */
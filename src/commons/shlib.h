@@ -0,0 +1,102 @@
+/*
+ * shlib.h
+ * Shell helpers exported to .com commands through a jump table.
+ *
+ * The shell links a versioned table of JMP instructions at SHLIB_BASE.
+ * That is $0300, right after its startup code (see src/shell.cfg). A .com
+ * that includes this header calls the shell's console output, hexdump,
+ * wildcard, date and string routines through the table, so it does not
+ * carry its own copies. crt0_cmd.s checks the magic and version before
+ * main() runs, and refuses to start under an older shell.
+ *
+ * Rules for the table:
+ *   - entries are only ever appended, never reordered or removed
+ *   - every addition bumps SHLIB_VERSION (and SHLIB_VERSION in crt0_cmd.s)
+ *
+ * Include after commons.h: the libc names below are macros, so they must
+ * come after <string.h> and <stdlib.h>. The shell defines SHLIB_EXPORT and
+ * gets the table layout only.
+ */
+
+#ifndef SHLIB_H
+#define SHLIB_H
+
+#define SHLIB_BASE      0x0300u     // fixed: SHLIB memory area in src/shell.cfg
+#define SHLIB_MAGIC     0x4C52u     // "RL"
+#define SHLIB_VERSION   1           // crt0_cmd.s SHLIB_VERSION must match
+#define SHLIB_JMP       0x4C        // 65C02 JMP abs
+
+#define HEXDUMP_LINE_SIZE 16
+
+typedef void (*char_stream_func_t)(const char *buf, int size);
+typedef void (*read_data_func_t)(uint8_t *buf, uint16_t addr, uint16_t size);
+
+enum {
+    SHLIB_TX_CHAR,              // void tx_char(char c)
+    SHLIB_TX_CHARS,             // void tx_chars(const char *buf, int ct)
+    SHLIB_TX_STRING,            // void tx_string(const char *buf)
+    SHLIB_TX_DEC32,             // void tx_dec32(unsigned long val)
+    SHLIB_TX_HEX16,             // void tx_hex16(uint16_t val)
+    SHLIB_TX_HEX32,             // void tx_hex32(unsigned long val)
+    SHLIB_TX_FLUSH,             // void tx_flush(void)
+    SHLIB_HEXDUMP,              // void hexdump(addr, bytes, streamer, reader)
+    SHLIB_RAM_READER,           // read_data_func_t over CPU RAM
+    SHLIB_XRAM_READER,          // read_data_func_t over XRAM
+    SHLIB_MATCH_MASK,           // bool match_mask(const char *name, const char *mask)
+    SHLIB_FORMAT_FAT_DATETIME,  // const char *format_fat_datetime(unsigned fdate, unsigned ftime)
+    SHLIB_MEMCPY,
+    SHLIB_MEMSET,
+    SHLIB_STRLEN,
+    SHLIB_STRCPY,
+    SHLIB_STRNCPY,
+    SHLIB_STRCMP,
+    SHLIB_STRICMP,
+    SHLIB_STRCHR,
+    SHLIB_STRTOUL,
+    SHLIB_COUNT
+};
+
+typedef void (*shlib_fn_t)(void);
+
+typedef struct {
+    uint8_t    op;              // SHLIB_JMP
+    shlib_fn_t fn;
+} shlib_jmp_t;
+
+typedef struct {
+    uint16_t    magic;          // SHLIB_MAGIC
+    uint8_t     version;        // SHLIB_VERSION
+    uint8_t     count;          // SHLIB_COUNT
+    shlib_jmp_t jmp[SHLIB_COUNT];
+} shlib_table_t;
+
+#ifndef SHLIB_EXPORT
+
+#define SHLIB_FN(n)     (SHLIB_BASE + 4u + (n) * 3u)
+
+#define tx_char             ((void (*)(char))SHLIB_FN(SHLIB_TX_CHAR))
+#define tx_chars            ((void (*)(const char *, int))SHLIB_FN(SHLIB_TX_CHARS))
+#define tx_string           ((void (*)(const char *))SHLIB_FN(SHLIB_TX_STRING))
+#define tx_dec32            ((void (*)(unsigned long))SHLIB_FN(SHLIB_TX_DEC32))
+#define tx_hex16            ((void (*)(uint16_t))SHLIB_FN(SHLIB_TX_HEX16))
+#define tx_hex32            ((void (*)(unsigned long))SHLIB_FN(SHLIB_TX_HEX32))
+#define tx_flush            ((void (*)(void))SHLIB_FN(SHLIB_TX_FLUSH))
+#define hexdump             ((void (*)(uint16_t, uint16_t, char_stream_func_t, read_data_func_t))SHLIB_FN(SHLIB_HEXDUMP))
+#define ram_reader          ((read_data_func_t)SHLIB_FN(SHLIB_RAM_READER))
+#define xram_reader         ((read_data_func_t)SHLIB_FN(SHLIB_XRAM_READER))
+#define match_mask          ((bool (*)(const char *, const char *))SHLIB_FN(SHLIB_MATCH_MASK))
+#define format_fat_datetime ((const char *(*)(unsigned, unsigned))SHLIB_FN(SHLIB_FORMAT_FAT_DATETIME))
+
+#define memcpy              ((void *(*)(void *, const void *, size_t))SHLIB_FN(SHLIB_MEMCPY))
+#define memset              ((void *(*)(void *, int, size_t))SHLIB_FN(SHLIB_MEMSET))
+#define strlen              ((size_t (*)(const char *))SHLIB_FN(SHLIB_STRLEN))
+#define strcpy              ((char *(*)(char *, const char *))SHLIB_FN(SHLIB_STRCPY))
+#define strncpy             ((char *(*)(char *, const char *, size_t))SHLIB_FN(SHLIB_STRNCPY))
+#define strcmp              ((int (*)(const char *, const char *))SHLIB_FN(SHLIB_STRCMP))
+#define stricmp             ((int (*)(const char *, const char *))SHLIB_FN(SHLIB_STRICMP))
+#define strchr              ((char *(*)(const char *, int))SHLIB_FN(SHLIB_STRCHR))
+#define strtoul             ((unsigned long (*)(const char *, char **, int))SHLIB_FN(SHLIB_STRTOUL))
+
+#endif /* SHLIB_EXPORT */
+
+#endif /* SHLIB_H */
@@ -0,0 +1,143 @@
+/*
+ * txout.h
+ * Buffered console output and number formatters shared by the shell and
+ * .com commands.
+ * Include once per .c file — all functions are static.
+ *
+ * Requires:
+ *   - rp6502.h (RIA registers, write_xstack)
+ *   - commons/redirect.h
+ *
+ * Console bytes are collected in a small RAM buffer and handed to the RIA
+ * stdout in one write_xstack() call per line (or per TX_BUF_SIZE bytes).
+ * The 6502 no longer spins on TX_READY for every byte. Call tx_flush()
+ * before waiting for a key and before handing control to another program,
+ * so that a prompt without a trailing newline is visible.
+ * Redirected output (see redirect.h) skips this buffer. It goes straight
+ * to the XRAM staging area.
+ *
+ * TX_REDIR selects the redirect block. It defaults to REDIR, which is what
+ * a .com uses; the shell points it at its own redir_state.
+ * Define _NEED_TX_HEX to get tx_hex8/16/32.
+ */
+
+#ifndef TXOUT_H
+#define TXOUT_H
+
+#ifndef TX_REDIR
+#define TX_REDIR        REDIR
+#endif
+
+#define TX_BUF_SIZE     64u     // flushed on '\n' or when full (write_xstack max 512)
+#define TX_STDOUT       1
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+static char    tx_buf[TX_BUF_SIZE];
+static uint8_t tx_len;
+
+static void tx_flush(void)
+{
+    const char *p = tx_buf;
+    int n;
+    while (tx_len) {
+        n = write_xstack(p, tx_len, TX_STDOUT);
+        if (n <= 0) {
+            /* stdout refused the block, push the rest through the TX register */
+            for (; tx_len; tx_len--) {
+                TX_READY_SPIN;
+                RIA.tx = *p++;
+            }
+            break;
+        }
+        p      += n;
+        tx_len -= (uint8_t)n;
+    }
+}
+
+static void tx_char(char c)
+{
+    if (REDIR_OUT(TX_REDIR)) {
+        redir_putc(TX_REDIR, c);
+        return;
+    }
+    tx_buf[tx_len++] = c;
+    if (c == '\n' || tx_len == TX_BUF_SIZE) tx_flush();
+}
+
+static void tx_chars(const char *buf, int ct)
+{
+    uint8_t n;
+    if (REDIR_OUT(TX_REDIR)) {
+        for (; ct > 0; ct--) redir_putc(TX_REDIR, *buf++);
+        return;
+    }
+    while (ct > 0) {
+        n = (uint8_t)(TX_BUF_SIZE - tx_len);
+        if (ct < (int)n) n = (uint8_t)ct;
+        memcpy(tx_buf + tx_len, buf, n);
+        tx_len += n;
+        buf    += n;
+        ct     -= n;
+        if (tx_len == TX_BUF_SIZE) tx_flush();
+    }
+    if (tx_len && tx_buf[tx_len - 1] == '\n') tx_flush();
+}
+
+static void tx_string(const char *buf)
+{
+    tx_chars(buf, (int)strlen(buf));
+}
+
+/* Decimal by subtracting powers of ten: at most 9 compares and subtracts
+ * per digit instead of a 32-bit divide and modulo. */
+static const unsigned long tx_pow10[9] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL
+};
+
+static void tx_dec32(unsigned long val)
+{
+    char    out[10];
+    uint8_t i;
+    uint8_t n = 0;
+    char    d;
+    for (i = 0; i < 9; i++) {
+        d = '0';
+        while (val >= tx_pow10[i]) {
+            val -= tx_pow10[i];
+            d++;
+        }
+        if (n || d != '0') out[n++] = d;
+    }
+    out[n++] = (char)('0' + (uint8_t)val);
+    tx_chars(out, n);
+}
+
+#ifdef _NEED_TX_HEX
+static void tx_hex8(uint8_t val)
+{
+    char out[2];
+    out[0] = hexdigits[val >> 4];
+    out[1] = hexdigits[val & 0x0F];
+    tx_chars(out, 2);
+}
+
+static void tx_hex16(uint16_t val)
+{
+    tx_hex8((uint8_t)(val >> 8));
+    tx_hex8((uint8_t)val);
+}
+
+static void tx_hex32(unsigned long val)
+{
+    /* byte access instead of 32-bit shifts; the 6502 is little endian */
+    const uint8_t *b = (const uint8_t *)&val;
+    tx_hex8(b[3]);
+    tx_hex8(b[2]);
+    tx_hex8(b[1]);
+    tx_hex8(b[0]);
+}
+#endif /* _NEED_TX_HEX */
+
+#endif /* TXOUT_H */
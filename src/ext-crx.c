@@ -8,6 +8,9 @@
 
 #define _NEED_DRAWBAR
 #include "commons/courier-gfx.h"
+#include "commons/courier-frame.h"
+#define _NEED_INFLATE
+#include "commons/deflate.h"
 
 #define APPVER "20260509.1523"
 
@@ -49,11 +52,18 @@ typedef unsigned int u16;
 
 #define XRAM_DECODE_STAGE      0xF000u
 #define XRAM_DECODE_STAGE_SIZE 16u
+#define XRAM_WINDOW            0xA000u  /* framed mode: FRM_WINDOW slots of FRM_DATA_MAX */
+#define XRAM_RAW               0xA800u  /* framed mode: inflated window, FRM_RAW_MAX */
 
 /* ---- file name / path --------------------------------------------------- */
 
 #define RX_FILENAME_MAX 32u
 #define RX_OUTPATH_MAX  48u
+#define RX_CWD_MAX      128u
+
+#ifndef AM_DIR
+#define AM_DIR 0x10
+#endif
 
 /* ---- IHX state machine -------------------------------------------------- */
 
@@ -90,6 +100,14 @@ static unsigned long rx_decoded       = 0;
 static unsigned long rx_filesize      = 0;
 static unsigned long rx_checksum_exp  = 0;  /* CRC32 from header     */
 static unsigned long rx_checksum_calc = 0;  /* CRC32 of received data */
+static unsigned long rx_resume        = 0;  /* framed: bytes kept from an earlier transfer */
+static uint8_t       rx_flags         = 0;  /* framed: header flags */
+static uint16_t      rx_zleft         = 0;  /* framed: deflated bytes left to inflate */
+static uint16_t      rx_fdate         = 0;  /* framed: FAT date from the header (FRM_F_DATE) */
+static uint16_t      rx_ftime         = 0;
+static uint8_t       rx_sync          = 0;  /* /sync: one session, many files */
+static uint16_t      sync_files       = 0;  /* /sync: files received */
+static uint16_t      sync_same        = 0;  /* /sync: files found unchanged by CRC32 */
 static char rx_filename[RX_FILENAME_MAX];
 static char rx_outpath[RX_OUTPATH_MAX];
 
@@ -130,7 +148,8 @@ static void build_rx_outpath(void)
 
 /* ======================================================================
  * Protocol: receive header SOH + filename + EOH + 4B size + STX
- * Returns 1 on success, -1 if ESC received.
+ * Returns 1 on success, -1 if ESC received, 2 if the sender opened with
+ * a 0x00 sync byte (binary framed mode, see courier-frame.h).
  * ====================================================================== */
 
 static int receive_header(void)
@@ -150,6 +169,7 @@ static int receive_header(void)
         switch (state) {
         case 0:
             if (c == SOH) state = 1;
+            else if (c == NUL) return 2;   /* framed sender */
             else if (c == ESC) return -1;  /* cancel only before header starts */
             break;
         case 1:
@@ -228,6 +248,455 @@ static uint8_t ihx_feed(uint8_t ch)
     return 0;
 }
 
+/* ======================================================================
+ * Framed mode: wait for the 'H' frame and take name, size and flags from it.
+ * Returns 1 on success, -1 on cancel or timeout.
+ * ====================================================================== */
+
+static void take_frame_header(void)
+{
+    const uint8_t *p = FRM_PAYLOAD;
+    uint16_t n;
+    uint8_t  i;
+
+    rx_flags    = p[1];
+    rx_filesize = frm_get32(p + 2);
+    for (i = 0; p[6u + i] && i < (uint8_t)(RX_FILENAME_MAX - 1u)
+                && 6u + i < FRM_LEN; i++)
+        rx_filename[i] = (char)p[6u + i];
+    rx_filename[i] = '\0';
+
+    /* FRM_F_DATE: the FAT date and time follow the name's 0 */
+    for (n = 6u; n < FRM_LEN && p[n]; n++) { }
+    if ((rx_flags & FRM_F_DATE) && n + 5u <= FRM_LEN) {
+        rx_fdate = (uint16_t)p[n + 1u] | ((uint16_t)p[n + 2u] << 8);
+        rx_ftime = (uint16_t)p[n + 3u] | ((uint16_t)p[n + 4u] << 8);
+    } else {
+        rx_flags &= (uint8_t)~FRM_F_DATE;
+    }
+}
+
+static int receive_frame_header(clock_t timeout)
+{
+    uint8_t tries;
+
+    for (tries = 0; tries < FRM_RETRIES; tries++) {
+        switch (frm_recv(timeout)) {
+        case FRM_OK:
+            if (FRM_TYPE == FRM_CANCEL) return -1;
+            if (FRM_TYPE != FRM_HEADER || FRM_LEN < 7u) break;
+            take_frame_header();
+            return 1;
+        case FRM_NONE:
+            return -1;
+        }
+        frm_send(FRM_NAK, 0, NULL, 0);
+    }
+    return -1;
+}
+
+/* ======================================================================
+ * Framed mode: what an interrupted transfer left in rx_outpath.
+ * Sets rx_resume to its size and crc32_val to its CRC32 when it can be
+ * continued (sender allows it, file not longer than the new one).
+ * ====================================================================== */
+
+static f_stat_t rx_st;
+
+/* CRC32 the next left bytes of fd into crc32_val, FRM_PAYLOAD as buffer.
+ * Returns how many of them could not be read. */
+static unsigned long crc32_fd(int fd, unsigned long left)
+{
+    int n;
+    while (left) {
+        n = read(fd, FRM_PAYLOAD, (left > FRM_DATA_MAX) ? FRM_DATA_MAX : (unsigned)left);
+        if (n <= 0) break;
+        crc32_block(FRM_PAYLOAD, (uint16_t)n);
+        left -= (unsigned long)n;
+    }
+    return left;
+}
+
+static void resume_offer(void)
+{
+    unsigned long left;
+    int fd;
+
+    rx_resume = 0;
+    crc32_val = 0xFFFFFFFFUL;
+    if (!(rx_flags & FRM_F_RESUME)) return;
+    if (f_stat(rx_outpath, &rx_st) < 0 || rx_st.fsize == 0UL || rx_st.fsize > rx_filesize) return;
+    fd = open(rx_outpath, O_RDONLY);
+    if (fd < 0) return;
+    DrawText(4, 13, "Checking partial file...", DARK_GRAY, BLACK);
+    left = crc32_fd(fd, rx_st.fsize);
+    close(fd);
+    ClearLine(4, WHITE, BLACK);
+    if (left) {
+        crc32_val = 0xFFFFFFFFUL;
+        return;
+    }
+    rx_resume = rx_st.fsize;
+}
+
+/* ======================================================================
+ * Framed mode: answer the header with [offset][crc32] and wait for 'S'.
+ * The sender picks rx_resume (its CRC32 of that prefix matched) or 0.
+ * Returns the output fd opened at that offset, -1 on cancel or timeout,
+ * -2 if the file cannot be created.
+ * ====================================================================== */
+
+static int frame_start(clock_t timeout)
+{
+    uint8_t       offer[9];
+    unsigned long off;
+    uint8_t       tries;
+    uint8_t       r;
+    int           fd;
+
+    frm_put32(offer, rx_resume);
+    frm_put32(offer + 4, crc32_get());
+    offer[8] = rx_flags & (FRM_F_RESUME | FRM_F_DEFLATE);
+    for (tries = 0; ; tries++) {
+        if (tries == FRM_RETRIES) return -1;
+        frm_send(FRM_ACK, 0, offer, sizeof(offer));
+        r = frm_recv(timeout);
+        if (r == FRM_NONE) return -1;
+        if (r != FRM_OK) continue;
+        if (FRM_TYPE == FRM_CANCEL) return -1;
+        if (FRM_TYPE == FRM_START && FRM_LEN >= 4u) break;
+    }
+
+    off = frm_get32(FRM_PAYLOAD);
+    if (off != 0UL && off == rx_resume) {
+        fd = open(rx_outpath, O_WRONLY);
+        if (fd >= 0 && lseek(fd, (long)off, SEEK_SET) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        off       = 0UL;
+        crc32_val = 0xFFFFFFFFUL;
+        fd = open(rx_outpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
+    if (fd < 0) {
+        frm_send(FRM_CANCEL, 1, NULL, 0);
+        return -2;
+    }
+    rx_resume = off;
+    frm_send(FRM_ACK, 1, NULL, 0);
+    return fd;
+}
+
+/* ======================================================================
+ * Framed mode: a deflated window, from its slots at XRAM_WINDOW to
+ * XRAM_RAW. Input through portal 1, output through portal 0; the output
+ * is CRC32ed on its way. Returns 1 if it inflated to exactly raw bytes.
+ * ====================================================================== */
+
+static int win_in(void)
+{
+    if (!rx_zleft) return -1;
+    rx_zleft--;
+    return RIA.rw1;
+}
+
+static void win_out(const unsigned char *buf, unsigned int len)
+{
+    if (dfl_total > FRM_RAW_MAX) return;    /* already counted; caller rejects */
+    crc32_block(buf, len);
+    for (; len; len--) RIA.rw0 = *buf++;
+}
+
+static int inflate_window(uint16_t zlen, uint16_t raw)
+{
+    rx_zleft  = zlen;
+    RIA.addr1 = XRAM_WINDOW;
+    RIA.step1 = 1;
+    RIA.addr0 = XRAM_RAW;
+    RIA.step0 = 1;
+    dfl_in    = win_in;
+    dfl_out   = win_out;
+    return dfl_inflate() == DFL_OK && dfl_total == (unsigned long)raw;
+}
+
+/* ======================================================================
+ * Framed mode: receive windows of 'D' frames up to the 'E' frame.
+ * Blocks land in their XRAM slot in any order; a 'P' poll is answered
+ * with the bitmap of slots held. A complete window goes to the file with
+ * one write_xram() before its full bitmap is sent, so everything the
+ * sender sees acknowledged is committed. A deflated window is inflated
+ * first and its raw bytes are written instead.
+ * Returns 1 done, 0 write error or timeout, -1 cancelled by the sender.
+ * ====================================================================== */
+
+static int receive_windows(int fd_out, clock_t timeout)
+{
+    static uint16_t win_len[FRM_WINDOW];
+    uint8_t  base      = 0;
+    uint8_t  have      = 0;
+    uint8_t  prev_base = 0;
+    uint8_t  prev_mask = 0;
+    uint8_t  slot, count, mask;
+    uint16_t n, total, raw;
+    int      prev_pct  = -1;
+    int      cur_pct;
+    uint8_t *p;
+
+    for (;;) {
+        switch (frm_recv(timeout)) {
+        case FRM_NONE:
+            return 0;
+        case FRM_BAD:
+            continue;                   /* the next poll reports the gap */
+        }
+        p = FRM_PAYLOAD;
+        switch (FRM_TYPE) {
+        case FRM_DATA:
+            slot = (uint8_t)(FRM_SEQ - base);
+            if (slot >= FRM_WINDOW) break;      /* old window, already written */
+            n = FRM_LEN;
+            frm_store_xram(XRAM_WINDOW + ((uint16_t)slot << 8), n);
+            win_len[slot] = n;
+            have |= (uint8_t)(1u << slot);
+            break;
+        case FRM_POLL:
+            if (FRM_LEN < 1u) break;
+            if (prev_mask && FRM_SEQ == prev_base) {
+                frm_send(FRM_ACK, prev_base, &prev_mask, 1);  /* full ACK was lost */
+                break;
+            }
+            if (FRM_SEQ != base) break;
+            count = p[0];
+            raw   = (FRM_LEN >= 3u) ? ((uint16_t)p[1] | ((uint16_t)p[2] << 8)) : 0;
+            if (count > FRM_WINDOW) count = FRM_WINDOW;
+            mask = FRM_MASK(count);
+            if ((have & mask) != mask) {
+                have &= mask;
+                frm_send(FRM_ACK, base, &have, 1);
+                break;
+            }
+            /* window complete: CRC32 in order, then one write */
+            total = 0;
+            if (raw) {
+                for (slot = 0; slot < count; slot++) total += win_len[slot];
+                if (raw > FRM_RAW_MAX || !inflate_window(total, raw)) {
+                    frm_send(FRM_CANCEL, base, NULL, 0);
+                    return 0;
+                }
+                total = raw;
+            } else {
+                for (slot = 0; slot < count; slot++) {
+                    n = win_len[slot];
+                    frm_load_xram(XRAM_WINDOW + ((uint16_t)slot << 8), n);
+                    crc32_block(p, n);
+                    total += n;
+                }
+            }
+            if (write_xram(raw ? XRAM_RAW : XRAM_WINDOW, total, fd_out) < 0) {
+                frm_send(FRM_CANCEL, base, NULL, 0);
+                return 0;
+            }
+            rx_decoded += (unsigned long)total;
+            prev_base = base;
+            prev_mask = mask;
+            base     += count;
+            have      = 0;
+            frm_send(FRM_ACK, prev_base, &prev_mask, 1);
+            cur_pct = (rx_filesize > 0UL)
+                    ? (int)(rx_decoded * 100UL / rx_filesize) : 0;
+            if (cur_pct != prev_pct) {
+                prev_pct = cur_pct;
+                DrawBar(5, (long)rx_decoded, (long)rx_filesize);
+            }
+            break;
+        case FRM_END:
+            if (FRM_LEN >= 4u) rx_checksum_exp = frm_get32(p);
+            if (rx_sync && rx_checksum_exp != crc32_get()) {
+                frm_send(FRM_CANCEL, FRM_SEQ, NULL, 0);   /* no result screen to show it */
+                return 0;
+            }
+            frm_send(FRM_ACK, FRM_SEQ, NULL, 0);
+            return 1;
+        case FRM_CANCEL:
+            return -1;
+        case FRM_START:
+            frm_send(FRM_ACK, 1, NULL, 0);     /* start ACK was lost */
+            break;
+        }
+    }
+}
+
+/* ======================================================================
+ * Sync session: the directory listing, page by page. The entries of
+ * the page last sent stay in list_buf in case its ACK is lost; an entry
+ * read that did not fit waits in list_ent for the next page.
+ * ====================================================================== */
+
+static int      list_dir  = -1;
+static uint8_t  list_page = 0;
+static uint8_t  list_ok   = 0;          /* list_buf holds page list_page */
+static uint8_t  list_held = 0;          /* list_ent read, not yet in a page */
+static uint16_t list_len  = 0;
+static uint8_t  list_buf[FRM_DATA_MAX];
+static f_stat_t list_ent;
+static char     list_cwd[RX_CWD_MAX];
+
+static void list_fill(void)
+{
+    uint16_t n;
+
+    list_len = 0;
+    for (;;) {
+        if (!list_held) {
+            if (list_dir < 0 || f_readdir(&list_ent, list_dir) < 0 || !list_ent.fname[0])
+                break;
+            /* a longer name cannot come in a header, so it is never synced */
+            if ((list_ent.fattrib & AM_DIR) || strlen(list_ent.fname) >= RX_FILENAME_MAX)
+                continue;
+            list_held = 1;
+        }
+        n = (uint16_t)strlen(list_ent.fname) + 9u;
+        if (list_len + n > FRM_DATA_MAX) return;
+        frm_put32(list_buf + list_len, list_ent.fsize);
+        list_buf[list_len + 4u] = (uint8_t)list_ent.fdate;
+        list_buf[list_len + 5u] = (uint8_t)(list_ent.fdate >> 8);
+        list_buf[list_len + 6u] = (uint8_t)list_ent.ftime;
+        list_buf[list_len + 7u] = (uint8_t)(list_ent.ftime >> 8);
+        memcpy(list_buf + list_len + 8u, list_ent.fname, n - 8u);
+        list_len += n;
+        list_held = 0;
+    }
+    if (list_dir >= 0) {
+        f_closedir(list_dir);
+        list_dir = -1;
+    }
+}
+
+/* Page 0 starts the listing over, the next page continues it and the
+ * page last sent is sent again */
+static void send_list(uint8_t page)
+{
+    if (!list_ok || page != list_page) {
+        if (page == 0) {
+            if (list_dir >= 0) f_closedir(list_dir);
+            list_dir  = (f_getcwd(list_cwd, sizeof(list_cwd)) < 0) ? -1 : f_opendir(list_cwd);
+            list_held = 0;
+        } else if (!list_ok || page != (uint8_t)(list_page + 1u)) {
+            frm_send(FRM_NAK, page, NULL, 0);
+            return;
+        }
+        list_fill();
+        list_page = page;
+        list_ok   = 1;
+    }
+    frm_send(FRM_ACK, page, list_buf, list_len);
+}
+
+/* 'K': does the named file have this CRC32? If so it gets the sender's date. */
+static void check_file(void)
+{
+    const uint8_t *p = FRM_PAYLOAD;
+    unsigned long  want;
+    uint16_t       fdate, ftime;
+    uint8_t        i, same = 0;
+    int            fd;
+
+    if (FRM_LEN > 8u) {
+        want  = frm_get32(p);
+        fdate = (uint16_t)p[4] | ((uint16_t)p[5] << 8);
+        ftime = (uint16_t)p[6] | ((uint16_t)p[7] << 8);
+        for (i = 0; p[8u + i] && i < (uint8_t)(RX_OUTPATH_MAX - 1u) && 8u + i < FRM_LEN; i++)
+            rx_outpath[i] = (char)p[8u + i];
+        rx_outpath[i] = '\0';
+        ClearLine(3, WHITE, BLACK);
+        DrawText(3, 13, "Checking:  ", DARK_GRAY, BLACK);
+        DrawText(3, 24, rx_outpath,    WHITE,     BLACK);
+        if (f_stat(rx_outpath, &rx_st) >= 0 && (fd = open(rx_outpath, O_RDONLY)) >= 0) {
+            crc32_val = 0xFFFFFFFFUL;
+            if (!crc32_fd(fd, rx_st.fsize) && crc32_get() == want) same = 1;
+            close(fd);
+            if (same) {
+                f_utime(rx_outpath, fdate, ftime);
+                sync_same++;
+            }
+        }
+    }
+    frm_send(FRM_ACK, FRM_SEQ, &same, 1);
+}
+
+/* One file of the session, its 'H' frame in frm_buf.
+ * Returns 1 done, 0 link or write error, -1 cancelled by the sender. */
+static int sync_file(clock_t timeout)
+{
+    int fd, r;
+
+    take_frame_header();
+    build_rx_outpath();
+    ClearLine(3, WHITE, BLACK);
+    ClearLine(4, WHITE, BLACK);
+    DrawText(3, 13, "Receiving: ", DARK_GRAY, BLACK);
+    DrawText(3, 24, rx_outpath,    WHITE,     BLACK);
+    resume_offer();
+    fd = frame_start(timeout);
+    if (fd < 0) return (fd == -1) ? -1 : 0;
+    rx_decoded = rx_resume;
+    DrawBar(5, (long)rx_decoded, (long)rx_filesize);
+    r = receive_windows(fd, timeout);
+    close(fd);
+    if (r > 0) {
+        if (rx_flags & FRM_F_DATE) f_utime(rx_outpath, rx_fdate, rx_ftime);
+        sync_files++;
+    }
+    return r;
+}
+
+/* Listings, checks and files until the sender says 'B'.
+ * Returns 1 done, 0 link or write error, -1 cancelled by the sender. */
+static int sync_session(clock_t timeout)
+{
+    char sb[32];
+    int  r;
+
+    crc32_init();
+    for (;;) {
+        switch (frm_recv(timeout)) {
+        case FRM_NONE:
+            return 0;
+        case FRM_BAD:
+            frm_send(FRM_NAK, 0, NULL, 0);
+            continue;
+        }
+        switch (FRM_TYPE) {
+        case FRM_LIST:
+            send_list(FRM_SEQ);
+            break;
+        case FRM_CHECK:
+            check_file();
+            break;
+        case FRM_HEADER:
+            if (FRM_LEN < 7u) {
+                frm_send(FRM_NAK, 0, NULL, 0);
+                break;
+            }
+            r = sync_file(timeout);
+            if (r <= 0) return r;
+            break;
+        case FRM_END:
+            frm_send(FRM_ACK, FRM_SEQ, NULL, 0);    /* end ACK was lost */
+            break;
+        case FRM_BYE:
+            frm_send(FRM_ACK, FRM_SEQ, NULL, 0);
+            return 1;
+        case FRM_CANCEL:
+            return -1;
+        }
+        sprintf(sb, "%u received, %u unchanged", sync_files, sync_same);
+        ClearLine(7, WHITE, BLACK);
+        DrawText(7, 13, sb, DARK_GRAY, BLACK);
+    }
+}
+
 /* ======================================================================
  * Screen helpers
  * ====================================================================== */
@@ -250,15 +719,20 @@ int main(int argc, char **argv)
     clock_t timeout_ticks = (clock_t)(RX_TIMEOUT_SECONDS * TICKS_PER_SEC);
     int     action = 0;
     int     fd_out;
+    int     framed;
     int     auto_mode = (argc >= 1 && strcmp(argv[0], "/auto") == 0);
 
+    rx_sync = (argc >= 1 && strcmp(argv[0], "/sync") == 0);
+
     /* --- switch to Character Mode 1 (8x16) --- */
     cgx_init();
     draw_title();
 
     if (!auto_mode) {
         /* --- interactive: wait for SOT or Esc --- */
-        DrawText(3, 13, "Waiting for incoming data or [Esc] to exit", DARK_GRAY, BLACK);
+        DrawText(3, 13, rx_sync ? "Sync: waiting for ctx.py --sync or [Esc] to exit"
+                                : "Waiting for incoming data or [Esc] to exit",
+                 DARK_GRAY, BLACK);
         for (;;) {
             if (RRX_READY()) {
                 c = RRIA.RX;
@@ -271,18 +745,43 @@ int main(int argc, char **argv)
         DrawText(3, 13, "Receiving...", DARK_GRAY, BLACK);
     }
 
-    /* Signal PC: crx is running and ready to receive header */
+    /* Signal PC: crx is running and ready to receive header.
+     * FRM_CAPABLE tells a new ctx.py that binary frames are understood;
+     * an old one skips it while it waits for the next 0x00. */
     ria_tx_byte('\x00');
-
-    /* --- receive header: SOH + name + EOH + 4B size + STX --- */
-    if (receive_header() < 0) {
+    ria_tx_byte(FRM_CAPABLE);
+
+    /* --- receive header: SOH + name + EOH + 4B size + STX, or 'H' frame --- */
+    framed = receive_header();
+    if (framed == 2 && rx_sync) {
+        frm_reset();
+        action = sync_session(timeout_ticks);
+        goto done_sync;
+    }
+    if (framed == 2) {
+        frm_reset();
+        framed = receive_frame_header(timeout_ticks);
+    } else if (framed > 0) {
+        framed = 0;
+    }
+    if (framed < 0) {
         action = -1;
         goto done_pre;
     }
 
     /* --- open output file BEFORE the receive loop --- */
     build_rx_outpath();
-    fd_out = open(rx_outpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (framed) {
+        crc32_init();
+        resume_offer();
+        fd_out = frame_start(timeout_ticks);
+        if (fd_out == -1) {
+            action = -1;
+            goto done_pre;
+        }
+    } else {
+        fd_out = open(rx_outpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
     if (fd_out < 0) {
         ClearLine(3, WHITE, BLACK);
         ClearLine(4, WHITE, BLACK);
@@ -297,7 +796,8 @@ int main(int argc, char **argv)
         char     sb_crc[12];
         uint8_t  col;
         sprintf(sb, "%lu", rx_filesize);
-        sprintf(sb_crc, "%08lX", rx_checksum_exp);
+        if (framed) strcpy(sb_crc, "in trailer");
+        else sprintf(sb_crc, "%08lX", rx_checksum_exp);
         ClearLine(3, WHITE, BLACK);
         DrawText(3, 13, "Receiving: ",  DARK_GRAY, BLACK);
         DrawText(3, 24, rx_outpath,     WHITE,     BLACK);
@@ -305,11 +805,33 @@ int main(int argc, char **argv)
         DrawText(3, col, "  (", DARK_GRAY, BLACK); col += 3;
         DrawText(3, col, sb,    WHITE,     BLACK);  col += (uint8_t)strlen(sb);
         DrawText(3, col, " B, CRC32: ", DARK_GRAY, BLACK); col += 11;
-        DrawText(3, col, sb_crc, WHITE,  BLACK);    col += 8;
+        DrawText(3, col, sb_crc, WHITE,  BLACK);    col += (uint8_t)strlen(sb_crc);
         DrawText(3, col, ")", DARK_GRAY, BLACK);
     }
 
     DrawBar(5, 12L, (long)rx_filesize);
+    if (framed && rx_resume) {
+        char sb[12];
+        sprintf(sb, "%lu", rx_resume);
+        DrawText(4, 13, "Resuming after ", DARK_GRAY, BLACK);
+        DrawText(4, 28, sb,                WHITE,     BLACK);
+        DrawText(4, (uint8_t)(28 + strlen(sb)), " B already received", DARK_GRAY, BLACK);
+    }
+
+    rx_count         = 0;
+    rx_decoded       = 0;
+    rx_checksum_calc = 0xFFFFFFFFUL;  /* CRC32 initial value */
+
+    if (framed) {
+        rx_decoded = rx_resume;
+        action = receive_windows(fd_out, timeout_ticks);
+        if (action < 0) {
+            close(fd_out);
+            action = -1;
+            goto done_pre;
+        }
+        goto done_rx;
+    }
 
     ria_tx_byte('\x00');  /* READY — file open, ready for data */
 
@@ -319,9 +841,6 @@ int main(int argc, char **argv)
      * ------------------------------------------------------------------ */
     ihx_state        = IHX_WAIT;
     ihx_pos          = 0;
-    rx_count         = 0;
-    rx_decoded       = 0;
-    rx_checksum_calc = 0xFFFFFFFFUL;  /* CRC32 initial value */
     start            = clock();
 
     {
@@ -380,6 +899,7 @@ int main(int argc, char **argv)
         }
     }
 
+done_rx:
     close(fd_out);
     if (!auto_mode) {
         /* --- result screen --- */
@@ -391,7 +911,8 @@ int main(int argc, char **argv)
         case 1:
             {
                 char sb[12];
-                uint32_t crc32_final = rx_checksum_calc ^ 0xFFFFFFFFUL;
+                uint32_t crc32_final = framed ? crc32_get()
+                                              : rx_checksum_calc ^ 0xFFFFFFFFUL;
                 uint8_t ck_ok = (crc32_final == rx_checksum_exp);
                 ClearLine(5, WHITE, BLACK);
                 DrawText(5, 13, "Saved: ", DARK_GRAY, BLACK);
@@ -418,6 +939,28 @@ int main(int argc, char **argv)
     
     return 0;
 
+done_sync:
+    {
+        char    sb[12];
+        uint8_t r;
+        for (r = 3; r < 8u; r++) ClearLine(r, WHITE, BLACK);
+        if (action > 0) {
+            DrawText(3, 13, "Sync complete.", GREEN, BLACK);
+        } else if (action < 0) {
+            DrawText(3, 13, "Cancelled", YELLOW, BLACK);
+        } else {
+            DrawText(3, 13, EXCLAMATION "Sync failed at ", RED, BLACK);
+            DrawText(3, 32, rx_outpath, WHITE, BLACK);
+        }
+        sprintf(sb, "%u", sync_files);
+        DrawText(5, 13, sb, WHITE, BLACK);
+        DrawText(5, (uint8_t)(13 + strlen(sb)), " files received", DARK_GRAY, BLACK);
+        PAUSE(250);
+    }
+    cgx_restore();
+    printf("%u files received, %u unchanged files checked" NEWLINE, sync_files, sync_same);
+    return 0;
+
 done_pre:
 
     ClearLine(3,WHITE,BLACK);
@@ -6,6 +6,9 @@
 #include "commons.h"
 #define _NEED_DRAWBAR
 #include "commons/courier-gfx.h"
+#include "commons/courier-frame.h"
+#define _NEED_DEFLATE
+#include "commons/deflate.h"
 
 #define APPVER "20260509.1523"
 
@@ -13,7 +16,22 @@
 
 #define HEX_LINE_MAX 64  /* :LLAAAATT + 2*16 data + CC + CRLF */
 
+#define PROBE_TICKS  50   /* wait for FRM_CAPABLE after the probe, ~0.5 s */
+#define ACK_TICKS   200   /* wait for a frame ACK before resending, ~2 s */
+
+#define XRAM_WINDOW 0xA000u  /* FRM_WIN_BYTES read per read_xram(), kept for resends */
+#define XRAM_RAW    0xA800u  /* deflate mode: raw window, XRAM_WINDOW gets the stream */
+
+/* "\0RZF1\r\n": the leading 0x00 is an idle frame delimiter, the rest is a
+ * line an old crx.py skips because it has no ':' in it */
+static const char frm_probe_msg[] = "\0RZF1\r\n";
+
 static char     hex_line[HEX_LINE_MAX];
+static uint8_t  blk[44];                /* framed mode: header, start and end payloads */
+static uint16_t win_len[FRM_WINDOW];    /* framed mode: bytes in each window slot */
+static uint16_t win_addr;               /* framed mode: XRAM of slot 0 */
+static uint16_t raw_len;                /* deflate mode: raw bytes in the window */
+static uint16_t raw_left;               /* deflate mode: raw bytes not yet compressed */
 static uint8_t  hex_bytes[16];
 static uint16_t hex_addr = 0;
 
@@ -104,6 +122,256 @@ static void send_header(const char *filepath, long filesize, unsigned long check
     send_hex_record(0x01, 0x0000, NULL, 0);  /* EOF — closes header stream */
 }
 
+/* ======================================================================
+ * Framed mode (see courier-frame.h)
+ * ====================================================================== */
+
+/* Announce framed mode; true when crx.py answered FRM_CAPABLE. */
+static bool frm_probe(void)
+{
+    clock_t t0;
+    uint8_t i;
+    for (i = 0; i < (uint8_t)(sizeof(frm_probe_msg) - 1u); i++)
+        send_char(frm_probe_msg[i]);
+    t0 = clock();
+    while ((clock() - t0) < PROBE_TICKS) {
+        if ((RIA.ready & RIA_READY_RX_BIT) && RIA.rx == FRM_CAPABLE)
+            return true;
+    }
+    return false;
+}
+
+/* Send a frame and wait for its ACK, resending on NAK, a bad frame or
+ * silence. The ACK stays in frm_buf for the caller.
+ * Returns 1 acked, 0 gave up, -1 cancelled by the receiver. */
+static int frm_exchange(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint8_t tries;
+    for (tries = 0; tries < FRM_RETRIES; tries++) {
+        frm_send(type, seq, payload, len);
+        for (;;) {
+            if (frm_recv(ACK_TICKS) != FRM_OK) break;
+            if (FRM_TYPE == FRM_CANCEL) return -1;
+            if (FRM_TYPE == FRM_ACK && FRM_SEQ == seq) return 1;
+            if (FRM_TYPE == FRM_NAK) break;
+            /* stale ACK for an earlier frame, keep waiting */
+        }
+    }
+    return 0;
+}
+
+/* Send window slot as data frame base+slot, straight from XRAM */
+static void send_slot(uint8_t base, uint8_t slot)
+{
+    uint16_t n = win_len[slot];
+    frm_load_xram(win_addr + ((uint16_t)slot << 8), n);
+    frm_send(FRM_DATA, (uint8_t)(base + slot), FRM_PAYLOAD, n);
+}
+
+/* CRC32 of n bytes just read to XRAM at addr */
+static void crc32_window(uint16_t addr, int n)
+{
+    uint16_t len;
+    while (n > 0) {
+        len = (n > (int)FRM_DATA_MAX) ? FRM_DATA_MAX : (uint16_t)n;
+        frm_load_xram(addr, len);
+        crc32_block(FRM_PAYLOAD, len);
+        addr += FRM_DATA_MAX;
+        n    -= (int)len;
+    }
+}
+
+/* ---- deflate mode: XRAM_RAW -> XRAM_WINDOW ------------------------------
+ * Input through portal 1, output through portal 0. The output is dropped
+ * and the compressor stopped as soon as it is no shorter than the input. */
+
+static int raw_in(void)
+{
+    if (!raw_left) return -1;
+    raw_left--;
+    return RIA.rw1;
+}
+
+static void zwin_out(const unsigned char *buf, unsigned int len)
+{
+    if (dfl_stop) return;
+    if (dfl_total >= (unsigned long)raw_len) {  /* dfl_total includes len */
+        dfl_stop = 1;
+        return;
+    }
+    for (; len; len--) RIA.rw0 = *buf++;
+}
+
+/* Returns the deflated size of the n raw bytes, 0 when they do not shrink */
+static uint16_t deflate_window(uint16_t n)
+{
+    raw_len   = n;
+    raw_left  = n;
+    RIA.addr1 = XRAM_RAW;
+    RIA.step1 = 1;
+    RIA.addr0 = XRAM_WINDOW;
+    RIA.step0 = 1;
+    dfl_in    = raw_in;
+    dfl_out   = zwin_out;
+    dfl_deflate();
+    if (dfl_stop || dfl_total >= (unsigned long)n) return 0;
+    return (uint16_t)dfl_total;
+}
+
+/* Poll the receiver for the window at base until every block is acked,
+ * resending only the ones its bitmap reports missing. Gives up after
+ * FRM_RETRIES polls in a row that bring no new block. raw is the size of
+ * a deflated window before compression, 0 for a raw one.
+ * Returns 1 window committed, 0 gave up, -1 cancelled by the receiver. */
+static int finish_window(uint8_t base, uint8_t count, uint16_t raw)
+{
+    uint8_t mask = FRM_MASK(count);
+    uint8_t best = 0;
+    uint8_t tries = 0;
+    uint8_t poll[3];
+    uint8_t have, slot;
+    bool    got;
+
+    poll[0] = count;
+    poll[1] = (uint8_t)raw;
+    poll[2] = (uint8_t)(raw >> 8);
+    while (tries < FRM_RETRIES) {
+        frm_send(FRM_POLL, base, poll, raw ? 3 : 1);
+        got = false;
+        while (frm_recv(ACK_TICKS) == FRM_OK) {
+            if (FRM_TYPE == FRM_CANCEL) return -1;
+            if (FRM_TYPE == FRM_ACK && FRM_SEQ == base && FRM_LEN >= 1u) {
+                got = true;
+                break;
+            }
+        }
+        if (!got) {
+            tries++;
+            continue;
+        }
+        have = FRM_PAYLOAD[0] & mask;
+        if (have == mask) return 1;
+        if ((have | best) != best) tries = 0;   /* progress */
+        else tries++;
+        best |= have;
+        for (slot = 0; slot < count; slot++)
+            if (!(have & (uint8_t)(1u << slot))) send_slot(base, slot);
+    }
+    return 0;
+}
+
+/* Header, resume point, windows of data blocks and the CRC32 trailer.
+ * The file is read once, a whole window per read_xram() call, and the
+ * CRC32 is worked out on the way and sent at the end. When the receiver
+ * accepts FRM_F_DEFLATE each window that shrinks goes out deflated.
+ * Returns 1 done, 0 link error, -1 cancelled by the receiver. */
+static int send_framed(int in_fd, const char *filepath, long filesize)
+{
+    long          done_bytes = 0L;
+    unsigned long off, want;
+    int           prev_pct   = -1;
+    int           cur_pct, n, r;
+    uint8_t       base, count, slot, hlen, j;
+    uint16_t      len, zlen, raw;
+    bool          zip;
+    const char   *name;
+
+    name = filepath;
+    for (j = 0; filepath[j]; j++) {
+        if (filepath[j] == '/' || filepath[j] == ':' || filepath[j] == '\\')
+            name = &filepath[j + 1];
+    }
+    blk[0] = FRM_VERSION;
+    blk[1] = FRM_F_RESUME | FRM_F_DEFLATE;
+    frm_put32(blk + 2, (unsigned long)filesize);
+    hlen = 6;
+    for (j = 0; name[j] && j < HDR_NAME_MAX; j++)
+        blk[hlen++] = (uint8_t)name[j];
+    blk[hlen++] = 0;
+
+    crc32_init();
+    frm_reset();
+    send_char(0);                                   /* resync the receiver */
+    r = frm_exchange(FRM_HEADER, 0, blk, hlen);
+    if (r <= 0) return r;
+
+    zip = (FRM_LEN >= 9u && (FRM_PAYLOAD[8] & FRM_F_DEFLATE));
+
+    /* resume when our first off bytes have the CRC32 the receiver holds */
+    off = 0UL;
+    if (FRM_LEN >= 8u) {
+        off  = frm_get32(FRM_PAYLOAD);
+        want = frm_get32(FRM_PAYLOAD + 4);
+        if (off != 0UL && off <= (unsigned long)filesize) {
+            DrawText(9, 12, "Checking resume point...", DARK_GRAY, BLACK);
+            done_bytes = (long)off;
+            while (done_bytes) {
+                n = read_xram(XRAM_WINDOW, (done_bytes > (long)FRM_WIN_BYTES)
+                                           ? FRM_WIN_BYTES : (unsigned)done_bytes, in_fd);
+                if (n <= 0) break;
+                crc32_window(XRAM_WINDOW, n);
+                done_bytes -= (long)n;
+            }
+            if (done_bytes || crc32_get() != want) {
+                off = 0UL;
+                crc32_val = 0xFFFFFFFFUL;
+                lseek(in_fd, 0L, SEEK_SET);
+            }
+            ClearLine(9, WHITE, BLACK);
+            DrawText(9, 12, off ? "Resuming..." : "Sending...", DARK_GRAY, BLACK);
+        } else {
+            off = 0UL;
+        }
+    }
+    frm_put32(blk, off);
+    r = frm_exchange(FRM_START, 1, blk, 4);
+    if (r <= 0) return r;
+
+    done_bytes = (long)off;
+    base = 0;
+    for (;;) {
+        n = read_xram(zip ? XRAM_RAW : XRAM_WINDOW, FRM_WIN_BYTES, in_fd);
+        if (n < 0) return 0;
+        if (n == 0) break;
+        win_addr = XRAM_WINDOW;
+        zlen     = (uint16_t)n;
+        raw      = 0;
+        if (zip) {
+            crc32_window(XRAM_RAW, n);
+            len = deflate_window((uint16_t)n);
+            if (len) {
+                zlen = len;
+                raw  = (uint16_t)n;
+            } else {
+                win_addr = XRAM_RAW;            /* did not shrink: send it raw */
+            }
+        }
+        count = 0;
+        for (slot = 0; slot < FRM_WINDOW && ((uint16_t)slot << 8) < zlen; slot++) {
+            len = zlen - ((uint16_t)slot << 8);
+            if (len > FRM_DATA_MAX) len = FRM_DATA_MAX;
+            win_len[slot] = len;
+            frm_load_xram(win_addr + ((uint16_t)slot << 8), len);
+            if (!zip) crc32_block(FRM_PAYLOAD, len);
+            frm_send(FRM_DATA, (uint8_t)(base + slot), FRM_PAYLOAD, len);
+            count++;
+        }
+        done_bytes += (long)n;
+        r = finish_window(base, count, raw);
+        if (r <= 0) return r;
+        base += count;
+        cur_pct = (filesize > 0L) ? (int)(done_bytes * 100L / filesize) : 0;
+        if (cur_pct != prev_pct) {
+            prev_pct = cur_pct;
+            DrawBar(7, done_bytes, filesize);
+        }
+        if (n < (int)FRM_WIN_BYTES) break;
+    }
+
+    frm_put32(blk, crc32_get());
+    return frm_exchange(FRM_END, base, blk, 4);
+}
+
 /* ======================================================================
  * Screen helpers
  * ====================================================================== */
@@ -122,14 +390,16 @@ static void draw_title(void)
 
 int main(int argc, char **argv)
 {
+    static f_stat_t st;
     int           in_fd, n;
-    uint8_t       ck;
-    int           pos, i;
+    int           pos, len, i;
     long          filesize      = 0L;
     unsigned long file_checksum = 0UL;
     long          done_bytes    = 0L;
     int           prev_pct      = -1;
     int           cancelled     = 0;
+    int           failed        = 0;
+    bool          framed        = false;
 
     if (argc < 1 || argv[0][0] == 0) {
         printf("Usage: ctx <filename>" NEWLINE NEWLINE);
@@ -146,11 +416,12 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    in_fd = open(argv[0], O_RDONLY);
-    if (in_fd < 0) {
+    /* size from the directory entry, the data is read only while sending */
+    if (f_stat(argv[0], &st) < 0) {
         printf("Cannot open file.\r\n");
         return -1;
     }
+    filesize = (long)st.fsize;
 
     /* --- switch to Character Mode 1 (8x16) --- */
     printf(CSI_RESET CSI_CURSOR_HIDE);
@@ -159,30 +430,13 @@ int main(int argc, char **argv)
 
     {
         char     sb[12];
-        char     ckbuf[9];
         uint8_t  col;
-        unsigned long tmp;
-        uint8_t  ci;
-        static const char hx[] = "0123456789ABCDEF";
         DrawText(3,  12, "Run the receiver script on the PC.", DARK_GRAY, BLACK);
         DrawText(4,  12, "Receiver script  : crx.py",          DARK_GRAY, BLACK);
         DrawText(5,  12, "File to transfer : ",                DARK_GRAY, BLACK);
         DrawText(5,  31, argv[0],                              WHITE    , BLACK);
         DrawText(6,  12, "Checksum (CRC32) : ", DARK_GRAY, BLACK);
-        /* first pass: calculate filesize and checksum */
-        DrawText(6, 18, " calculating ", WHITE, BLACK);
-        while ((n = read(in_fd, hex_bytes, sizeof(hex_bytes))) > 0) {
-            for (i = 0; i < n; i++)
-                file_checksum += (unsigned long)hex_bytes[i];
-            filesize += (long)n;
-        }
-        /* format checksum as 8 hex digits */
-        tmp = file_checksum;
-        for (ci = 0; ci < 8u; ci++) {
-            ckbuf[7u - ci] = hx[tmp & 0x0Fu];
-            tmp >>= 4;
-        }
-        ckbuf[8] = '\0';
+        DrawText(6,  31, "sent after the data", DARK_GRAY, BLACK);
         sprintf(sb, "%ld", filesize);
         col = (uint8_t)(31 + strlen(argv[0]));
         DrawText(5, col, " (size ", DARK_GRAY, BLACK);
@@ -190,9 +444,6 @@ int main(int argc, char **argv)
         DrawText(5, col, sb,  WHITE,     BLACK);
         col += (uint8_t)strlen(sb);
         DrawText(5, col, " B)", DARK_GRAY, BLACK);
-        close(in_fd);
-        DrawText(6, 19,  ckbuf  , WHITE, BLACK);
-        DrawText(6, 27, "      ", WHITE, BLACK);
     }
     DrawText(9,  12, " Y ",                   WHITE, DARK_GREEN);
     DrawText(9,  15, " start transfer ", LIGHT_GRAY, BLACK);
@@ -217,55 +468,61 @@ int main(int argc, char **argv)
     DrawBar(7, 12L, filesize);
     DrawText(9, 12, "Sending...", DARK_GRAY, BLACK);
 
-    in_fd = open(argv[0], O_RDONLY);  /* reopen — guaranteed position 0 */
-
-    /* 1. header stream */
-    send_header(argv[0], filesize, file_checksum);
-
-    /* 2. file data stream */
-    while (true) {
-        n = read(in_fd, hex_bytes, sizeof(hex_bytes));
-        if (n <= 0) break;
-
-        ck  = (uint8_t)n;
-        ck += (uint8_t)(hex_addr >> 8);
-        ck += (uint8_t)(hex_addr & 0xFF);
-        ck += 0x00;  /* type */
-
-        pos = 0;
-        hex_line[pos++] = ':';
-        put_hex(&hex_line[pos], (uint8_t)n);                 pos += 2;
-        put_hex(&hex_line[pos], (uint8_t)(hex_addr >> 8));   pos += 2;
-        put_hex(&hex_line[pos], (uint8_t)(hex_addr & 0xFF)); pos += 2;
-        put_hex(&hex_line[pos], 0x00);                       pos += 2;  /* type */
-
-        for (i = 0; i < n; i++) {
-            put_hex(&hex_line[pos], hex_bytes[i]); pos += 2;
-            ck += hex_bytes[i];
-        }
+    in_fd = open(argv[0], O_RDONLY);
+    if (in_fd < 0) {
+        failed = 1;
+        goto done;
+    }
 
-        ck = (uint8_t)(-((int)ck));
-        put_hex(&hex_line[pos], ck); pos += 2;
-        hex_line[pos++] = '\r';
-        hex_line[pos++] = '\n';
+    /* binary frames when crx.py understands them, Intel HEX otherwise */
+    if (frm_probe()) {
+        framed = true;
+        n = send_framed(in_fd, argv[0], filesize);
+        if (n < 0) cancelled = 1;
+        else if (n == 0) failed = 1;
+        goto sent;
+    }
 
-        for (i = 0; i < pos; i++) send_char(hex_line[i]);
+    /* Intel HEX carries its checksum in the header, so only this fallback
+     * reads the file twice */
+    DrawText(9, 12, "Checksum...", DARK_GRAY, BLACK);
+    while ((n = read_xram(XRAM_WINDOW, FRM_WIN_BYTES, in_fd)) > 0) {
+        RIA.addr1 = XRAM_WINDOW;
+        RIA.step1 = 1;
+        for (i = 0; i < n; i++) file_checksum += (unsigned long)RIA.rw1;
+    }
+    lseek(in_fd, 0L, SEEK_SET);
+    DrawText(9, 12, "Sending...  ", DARK_GRAY, BLACK);
 
-        if (RX_READY && (unsigned char)RIA.rx == 0x1B) {
-            cancelled = 1;
-            break;
-        }
+    /* 1. header stream */
+    send_header(argv[0], filesize, file_checksum);
 
-        hex_addr   += (uint16_t)n;
-        done_bytes += (long)n;
+    /* 2. file data stream, 16-byte records cut from XRAM windows */
+    while (!cancelled && (n = read_xram(XRAM_WINDOW, FRM_WIN_BYTES, in_fd)) > 0) {
+        RIA.addr1 = XRAM_WINDOW;
+        RIA.step1 = 1;
+        for (pos = 0; pos < n; pos += len) {
+            len = n - pos;
+            if (len > (int)sizeof(hex_bytes)) len = (int)sizeof(hex_bytes);
+            for (i = 0; i < len; i++) hex_bytes[i] = RIA.rw1;
+            send_hex_record(0x00, hex_addr, hex_bytes, (uint8_t)len);
+
+            if (RX_READY && (unsigned char)RIA.rx == 0x1B) {
+                cancelled = 1;
+                break;
+            }
 
-        /* update bar only when percentage changes */
-        {
-            int cur_pct = (filesize > 0L)
-                          ? (int)(done_bytes * 100L / filesize) : 0;
-            if (cur_pct != prev_pct) {
-                prev_pct = cur_pct;
-                DrawBar(7, done_bytes, filesize);
+            hex_addr   += (uint16_t)len;
+            done_bytes += (long)len;
+
+            /* update bar only when percentage changes */
+            {
+                int cur_pct = (filesize > 0L)
+                              ? (int)(done_bytes * 100L / filesize) : 0;
+                if (cur_pct != prev_pct) {
+                    prev_pct = cur_pct;
+                    DrawBar(7, done_bytes, filesize);
+                }
             }
         }
     }
@@ -273,8 +530,10 @@ int main(int argc, char **argv)
     if (!cancelled)
         send_hex_record(0x01, 0x0000, NULL, 0);  /* EOF — closes data stream */
 
+sent:
     close(in_fd);
 
+done:
     /* --- completion / cancelled screen --- */
     {
         uint8_t r, col;
@@ -284,6 +543,9 @@ int main(int argc, char **argv)
         if (cancelled) {
             DrawText(3, 12, "Transfer cancelled.", YELLOW, BLACK);
             DrawText(5, 12, "crx.py was interrupted on the PC.", DARK_GRAY, BLACK);
+        } else if (failed) {
+            DrawText(3, 12, EXCLAMATION "Transfer failed.", RED, BLACK);
+            DrawText(5, 12, "crx.py stopped answering.", DARK_GRAY, BLACK);
         } else {
             sprintf(sb, "%ld", filesize);
             DrawText(3, 12, "Sent: ",   DARK_GRAY, BLACK);
@@ -295,6 +557,11 @@ int main(int argc, char **argv)
             col += (uint8_t)strlen(sb);
             DrawText(3, col, " B)", DARK_GRAY, BLACK);
             DrawText(5, 12, "Transfer completed.", GREEN, BLACK);
+            if (framed) {
+                char ck[24];
+                sprintf(ck, " Checksum [%08lX] ", crc32_get());
+                DrawText(6, 12, ck, WHITE, DARK_GREEN);
+            }
         }
     }
 
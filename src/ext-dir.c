@@ -1,4 +1,5 @@
 #include "commons.h"
+#include "commons/shlib.h"
 
 #define APPVER "20260509.1524"
 
@@ -16,7 +17,6 @@ typedef struct {
 
 static char dir_cwd[FNAMELEN];
 static f_stat_t dir_ent;
-static char dir_dt_buf[20];
 
 #ifndef AM_DIR
 #define AM_DIR 0x10
@@ -27,102 +27,6 @@ static char dir_dt_buf[20];
 #define AM_ARC 0x20
 #endif
 
-inline void tx_char(char c) {
-    TX_READY_SPIN;
-    RIA.tx = c;
-    return;
-}
-
-void tx_chars(const char *buf, int ct) {
-    for(; ct; ct--, buf++) tx_char(*buf);
-    return;
-}
-
-void tx_string(const char *buf) {
-    while(*buf) tx_char(*buf++);
-    return;
-}
-
-// Simple wildcard match supporting '*' (0+ chars), '?' (1 char), '!' negation prefix.
-bool match_mask(const char *name, const char *mask) {
-    const char *star;
-    const char *mp;
-    bool negate = (*mask == '!');
-    bool result;
-    if(negate) mask++;
-    star = 0;
-    mp   = 0;
-    while(*name) {
-        if(*mask == '?' || *mask == *name) {
-            mask++;
-            name++;
-            continue;
-        }
-        if(*mask == '*') {
-            star = mask++;
-            mp   = name;
-            continue;
-        }
-        if(star) {
-            mask = star + 1;
-            name = ++mp;
-            continue;
-        }
-        result = false;
-        return negate ? !result : result;
-    }
-    while(*mask == '*') mask++;
-    result = (*mask == 0);
-    return negate ? !result : result;
-}
-
-// Print an unsigned long in decimal.
-void tx_dec32(unsigned long val) {
-    char out[10];
-    int i = 10;
-    if(val == 0) {
-        tx_char('0');
-        return;
-    }
-    while(val && i) {
-        out[--i] = '0' + (val % 10);
-        val /= 10;
-    }
-    tx_chars(&out[i], 10 - i);
-}
-
-// Format FAT date/time into YYYY-MM-DD hh:mm:ss
-const char *format_fat_datetime(unsigned fdate, unsigned ftime) {
-    unsigned year = 1980 + (fdate >> 9);
-    unsigned month = (fdate >> 5) & 0xF;
-    unsigned day = fdate & 0x1F;
-    unsigned hour = ftime >> 11;
-    unsigned min = (ftime >> 5) & 0x3F;
-    unsigned sec = (ftime & 0x1F) * 2;
-
-    dir_dt_buf[0]  = '0' + (year / 1000);
-    dir_dt_buf[1]  = '0' + ((year / 100) % 10);
-    dir_dt_buf[2]  = '0' + ((year / 10) % 10);
-    dir_dt_buf[3]  = '0' + (year % 10);
-    dir_dt_buf[4]  = '-';
-    dir_dt_buf[5]  = '0' + (month / 10);
-    dir_dt_buf[6]  = '0' + (month % 10);
-    dir_dt_buf[7]  = '-';
-    dir_dt_buf[8]  = '0' + (day / 10);
-    dir_dt_buf[9]  = '0' + (day % 10);
-    dir_dt_buf[10] = ' ';
-    dir_dt_buf[11] = '0' + (hour / 10);
-    dir_dt_buf[12] = '0' + (hour % 10);
-    dir_dt_buf[13] = ':';
-    dir_dt_buf[14] = '0' + (min / 10);
-    dir_dt_buf[15] = '0' + (min % 10);
-    dir_dt_buf[16] = ':';
-    dir_dt_buf[17] = '0' + (sec / 10);
-    dir_dt_buf[18] = '0' + (sec % 10);
-    dir_dt_buf[19] = 0;
-    return dir_dt_buf;
-}
-
 int main(int argc, char **argv) {
 
     int i;
@@ -354,6 +258,7 @@ int main(int argc, char **argv) {
 
 cleanup:
     if(dirdes >= 0) f_closedir(dirdes);
+    tx_flush();
 
     return 0;
 }
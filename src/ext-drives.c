@@ -1,41 +1,11 @@
 #include "commons.h"
+#include "commons/shlib.h"
 
 #define APPVER "20260509.1524"
 
 static char dev_label[16];
 static char saved_cwd[128];
 
-inline void tx_char(char c) {
-    TX_READY_SPIN;
-    RIA.tx = c;
-    return;
-}
-
-void tx_chars(const char *buf, int ct) {
-    for(; ct; ct--, buf++) tx_char(*buf);
-    return;
-}
-
-void tx_string(const char *buf) {
-    while(*buf) tx_char(*buf++);
-    return;
-}
-
-// Print an unsigned long in decimal.
-void tx_dec32(unsigned long val) {
-    char out[10];
-    int i = 10;
-    if(val == 0) {
-        tx_char('0');
-        return;
-    }
-    while(val && i) {
-        out[--i] = '0' + (val % 10);
-        val /= 10;
-    }
-    tx_chars(&out[i], 10 - i);
-}
-
 int main(int argc, char **argv) {
 
     int rc;
@@ -20,6 +20,10 @@ static const cmd_t commands[] = {
                 "bsave picture.bin 0000 8192 /x (save 8192 bytes start from XRAM address 0x0000)"},
     { "brun",   "load binary file to RAM and run",
                 "brun hello.bin A300 (load and run binary file hello.bin at address 0xA300)"},
+    { "call",   "run a script file (.rsh)",
+                "call setup.rsh [args ...] (or just: setup.rsh [args ...])" NEWLINE
+                "script lines: # comment, :label, %1..%9 args, %name% variables, %errorlevel%" NEWLINE
+                "MSC0:/SHELL/autoexec.rsh is run at shell start, [Esc] cancels a running script"},
     { "cart",   "launch ROM (name without extension) with optional arguments", 
                 "cart [path]romfilename [args ...]"},
     { "cd",     "change active directory", 
@@ -37,8 +41,17 @@ static const cmd_t commands[] = {
                 "cp <source> <destination> /m (move)"},
     { "drive",  "set active drive", 
                 "drive 0:"},
+    { "echo",   "print a text",
+                "echo Hello %name%"},
     { "exit",   "exit to the monitor", 
                 "exit"},
+    { "goto",   "jump to a :label in a running script",
+                "goto loop" NEWLINE
+                "goto eof (leave the script)"},
+    { "if",     "run a command conditionally",
+                "if errorlevel 1 goto failed (last command failed)" NEWLINE
+                "if not exist MSC0:/SHELL/dir.com echo missing" NEWLINE
+                "if %n%==10 goto done"},
     { "launcher", "register/deregister OS as a launcher", 
                 "launcher /status - status info" NEWLINE
                 "launcher /s      - register" NEWLINE
@@ -59,6 +72,11 @@ static const cmd_t commands[] = {
                 "rm <filename>"},
     { "run",    "run code at address", 
                 "run A000 (run code at 0xA000)"},
+    { "set",    "set, list or remove shell variables",
+                "set              - list variables" NEWLINE
+                "set name=value   - set variable, use as %name%" NEWLINE
+                "set name=        - remove variable" NEWLINE
+                "set /a n=%n%+1   - integer arithmetic (+ and -)"},
     { "stat",   "show file/directory info", 
                 "stat <filename>"},
     { "time",   "show local date and time", 
@@ -100,13 +118,14 @@ static const cmd_t commands_rom[] = {
                     "label          - show label of active drive" NEWLINE
                     "label NEWLABEL - set active drive label to NEWLABEL" },
     { "txt2pdf",    "convert a text file to PDF (A4, Courier or DroidSansMono)",
-                    "txt2pdf <file> [/s N] [/m L R T B] [/n d|p] [/pl]" NEWLINE
+                    "txt2pdf <file> [/s N] [/m L R T B] [/n d|p] [/pl] [/d]" NEWLINE
                     "txt2pdf notes.txt              - default 10pt, 20 mm margins" NEWLINE
                     "txt2pdf notes.txt /s 12        - 12pt base font size" NEWLINE
                     "txt2pdf notes.txt /m 15 15 20 25 - custom L/R/T/B margins in mm" NEWLINE
                     "txt2pdf notes.txt /n d         - page numbers: 'strona N z T'" NEWLINE
                     "txt2pdf notes.txt /n p         - page numbers: '- N -'" NEWLINE
                     "txt2pdf notes.txt /pl          - Polish chars (CP852), embeds DroidSansMono" NEWLINE
+                    "txt2pdf notes.txt /d           - compressed streams, file 3-4x smaller" NEWLINE
                     "Formatting by extension (always on):" NEWLINE
                     "  .asm    : lines starting with ';' in italic" NEWLINE
                     "  .txt/.md: '#'/'##'/... as headings (base + hashes*2 pt)" NEWLINE
@@ -9,6 +9,11 @@
  */
 
 #include "commons.h"
+#include "commons/shlib.h"
+
+#define _NEED_DEFLATE
+#define _NEED_INFLATE
+#include "commons/deflate.h"
 
 #define APPVER "20260509.1524"
 
@@ -29,15 +34,6 @@
 #define ZIP_METHOD_DEFLATE 8u
 #define ZIP_FLAG_DD        0x0008u   /* bit 3: data descriptor present */
 
-/* ---- LZ77 / DEFLATE parameters ----------------------------------------- */
-
-#define LZ_WIN_SIZE    4096u
-#define LZ_WIN_MASK    0x0FFFu
-#define LZ_HASH_SIZE   256u
-#define LZ_MIN_MATCH   3u
-#define LZ_MAX_MATCH   32u           /* cap: keeps lookahead buffer small */
-#define LZ_AHEAD_SIZE  (LZ_MAX_MATCH + 3u) /* 35 bytes */
-
 /* ---- Archive limits ----------------------------------------------------- */
 
 #define PACK_MAX_FILES  64u
@@ -54,17 +50,6 @@
 #define PACK_XRAM_STAGE 0xA000u  /* 128-byte staging window in XRAM        */
 #define CDIR_XRAM_BASE  0xA080u  /* central dir: 72B × 64 = 4608B in XRAM  */
 
-static void tx_char(char c)            { TX_READY_SPIN; RIA.tx = c; }
-static void tx_string(const char *s)   { while (*s) tx_char(*s++); }
-
-static void tx_dec32(unsigned long v) {
-    char buf[10];
-    int  i = 10;
-    if (!v) { tx_char('0'); return; }
-    while (v && i) { buf[--i] = (char)('0' + (v % 10)); v /= 10; }
-    for (; i < 10; i++) tx_char(buf[i]);
-}
-
 /* ---- Central directory entry ------------------------------------------- */
 
 typedef struct {
@@ -110,22 +95,6 @@ static unsigned int   rb_len;
 static unsigned int   rb_pos;
 static int            rb_fd;
 
-/* ---- LZ77 / DEFLATE state ----------------------------------------------- */
-
-static unsigned char  lz_win[LZ_WIN_SIZE];         /* 4096B window */
-static unsigned int   lz_ht[LZ_HASH_SIZE];         /*  512B hash table */
-static unsigned char  lz_ahead[LZ_AHEAD_SIZE];     /*   35B lookahead */
-static unsigned int   lz_ahead_len;
-static unsigned int   lz_wpos;
-static unsigned int   lz_wfill;
-
-static unsigned char  dfl_bits;        /* accumulator */
-static unsigned char  dfl_nbits;       /* bits in accumulator */
-static unsigned char  dfl_obuf[128];   /* output buffer */
-static unsigned char  dfl_opos;
-static int            dfl_fd;
-static unsigned long  dfl_comp_sz;     /* compressed bytes written for current file */
-
 /* ---- CRC-32 (polynomial 0xEDB88320) ------------------------------------- */
 
 static unsigned long crc32_upd(unsigned long crc, unsigned char b)
@@ -256,26 +225,6 @@ static unsigned long read_le32_buf(const unsigned char *p)
          | ((unsigned long)(unsigned char)p[3] << 24);
 }
 
-/* ---- Fixed-Huffman inflate lookup tables -------------------------------- */
-/* Distance codes 0-23 cover distances 1-4096 (matches 4KB LZ77 window)     */
-
-static const unsigned int dist_base[24] = {
-    1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,
-    257,385,513,769,1025,1537,2049,3073
-};
-static const unsigned char dist_xb[24] = {
-    0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10
-};
-
-/* Length symbols 257-285 (index = sym-257); sym 285 → len 258, 0 extra bits */
-static const unsigned int len_base[29] = {
-    3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,
-    35,43,51,59,67,83,99,115,131,163,195,227,258
-};
-static const unsigned char len_xb[29] = {
-    0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
-};
-
 /* ---- STORE mode --------------------------------------------------------- */
 
 static unsigned long pack_store(int fd_out, unsigned long *pcrc)
@@ -296,401 +245,55 @@ static unsigned long pack_store(int fd_out, unsigned long *pcrc)
     return sz;
 }
 
-/* ---- DEFLATE bit I/O ---------------------------------------------------- */
-
-static void dfl_flush_obuf(void)
-{
-    if (dfl_opos > 0) {
-        dfl_comp_sz += (unsigned long)dfl_opos;
-        fw(dfl_fd, dfl_obuf, dfl_opos);   /* fw also updates out_pos */
-        dfl_opos = 0;
-    }
-}
-
-static void dfl_put_bit(unsigned char bit)
-{
-    dfl_bits |= (unsigned char)(bit << dfl_nbits);
-    if (++dfl_nbits == 8u) {
-        dfl_obuf[dfl_opos++] = dfl_bits;
-        dfl_bits = 0; dfl_nbits = 0;
-        if (dfl_opos >= 128u) dfl_flush_obuf();
-    }
-}
+/* ---- DEFLATE glue (commons/deflate.h) ----------------------------------- */
 
-/* Huffman code: MSB first (per RFC 1951 §3.1.1) */
-static void emit_huff(unsigned int code, unsigned char nbits)
-{
-    while (nbits) {
-        nbits--;
-        dfl_put_bit((unsigned char)((code >> nbits) & 1u));
-    }
-}
+static int            pack_out_fd;     /* output fd for dfl_out */
+static unsigned long  pack_crc;        /* CRC-32 of the uncompressed bytes */
+static unsigned long  pack_usz;
 
-/* Extra bits: LSB first */
-static void emit_extra(unsigned int val, unsigned char nbits)
+/* deflate source: file bytes, counted and CRCed on the way in */
+static int pack_in(void)
 {
-    while (nbits--) {
-        dfl_put_bit((unsigned char)(val & 1u));
-        val >>= 1;
+    int b = rb_getbyte();
+    if (b >= 0) {
+        pack_crc = crc32_upd(pack_crc, (unsigned char)b);
+        pack_usz++;
     }
+    return b;
 }
 
-static void dfl_literal(unsigned char b)
-{
-    if (b <= 143u) emit_huff((unsigned int)(0x30u + b), 8u);
-    else           emit_huff((unsigned int)(0x190u + b - 144u), 9u);
-}
-
-static void dfl_eob(void)
-{
-    emit_huff(0u, 7u);   /* symbol 256: code 0000000 */
-}
-
-/* Emit length symbol + extra bits for match length 3-32 */
-static void dfl_length(unsigned int len)
-{
-    unsigned int  sym;   /* 257-285: must be unsigned int, not char */
-    unsigned char xb;
-    unsigned int  xv;
-
-    /* symbols 257-264: lengths 3-10, 0 extra bits */
-    if (len <= 10u) {
-        sym = 254u + len; /* 257..264 */
-        xb = 0u; xv = 0u;
-    } else if (len <= 12u) { sym = 265u; xb = 1u; xv = len - 11u; }
-    else if (len <= 14u)   { sym = 266u; xb = 1u; xv = len - 13u; }
-    else if (len <= 16u)   { sym = 267u; xb = 1u; xv = len - 15u; }
-    else if (len <= 18u)   { sym = 268u; xb = 1u; xv = len - 17u; }
-    else if (len <= 22u)   { sym = 269u; xb = 2u; xv = len - 19u; }
-    else if (len <= 26u)   { sym = 270u; xb = 2u; xv = len - 23u; }
-    else if (len <= 30u)   { sym = 271u; xb = 2u; xv = len - 27u; }
-    else                   { sym = 272u; xb = 2u; xv = len - 31u; } /* 31-34 */
-
-    /* fixed Huffman: sym 257-279 → 7-bit codes (sym-256); 280-287 → 8-bit 0xC0+ */
-    if (sym <= 279u) emit_huff((unsigned int)(sym - 256u), 7u);
-    else             emit_huff((unsigned int)(0xC0u + sym - 280u), 8u);
-    if (xb) emit_extra(xv, xb);
-}
-
-/* Emit distance code + extra bits for distance 1-4096 */
-static void dfl_distance(unsigned int dist)
-{
-    unsigned char xb;
-    unsigned int  xv;
-    unsigned char code;
-
-    dist--;  /* make 0-based */
-    if      (dist <    4u) { code = (unsigned char)dist; xb = 0u; xv = 0u;          }
-    else if (dist <    6u) { code =  4u; xb =  1u; xv = dist -    4u; }
-    else if (dist <    8u) { code =  5u; xb =  1u; xv = dist -    6u; }
-    else if (dist <   12u) { code =  6u; xb =  2u; xv = dist -    8u; }
-    else if (dist <   16u) { code =  7u; xb =  2u; xv = dist -   12u; }
-    else if (dist <   24u) { code =  8u; xb =  3u; xv = dist -   16u; }
-    else if (dist <   32u) { code =  9u; xb =  3u; xv = dist -   24u; }
-    else if (dist <   48u) { code = 10u; xb =  4u; xv = dist -   32u; }
-    else if (dist <   64u) { code = 11u; xb =  4u; xv = dist -   48u; }
-    else if (dist <   96u) { code = 12u; xb =  5u; xv = dist -   64u; }
-    else if (dist <  128u) { code = 13u; xb =  5u; xv = dist -   96u; }
-    else if (dist <  192u) { code = 14u; xb =  6u; xv = dist -  128u; }
-    else if (dist <  256u) { code = 15u; xb =  6u; xv = dist -  192u; }
-    else if (dist <  384u) { code = 16u; xb =  7u; xv = dist -  256u; }
-    else if (dist <  512u) { code = 17u; xb =  7u; xv = dist -  384u; }
-    else if (dist <  768u) { code = 18u; xb =  8u; xv = dist -  512u; }
-    else if (dist < 1024u) { code = 19u; xb =  8u; xv = dist -  768u; }
-    else if (dist < 1536u) { code = 20u; xb =  9u; xv = dist - 1024u; }
-    else if (dist < 2048u) { code = 21u; xb =  9u; xv = dist - 1536u; }
-    else if (dist < 3072u) { code = 22u; xb = 10u; xv = dist - 2048u; }
-    else                   { code = 23u; xb = 10u; xv = dist - 3072u; }
-
-    emit_huff((unsigned int)code, 5u);
-    if (xb) emit_extra(xv, xb);
-}
-
-/* ---- LZ77 helpers ------------------------------------------------------- */
-
-static unsigned char lz_hash3(unsigned char a, unsigned char b, unsigned char c)
-{
-    return (unsigned char)((((unsigned int)a * 5u) + ((unsigned int)b * 3u) + c) & 0xFFu);
-}
-
-/* Add byte to circular window */
-static void lz_push(unsigned char b)
+static void pack_out(const unsigned char *buf, unsigned int len)
 {
-    lz_win[lz_wpos] = b;
-    lz_wpos = (unsigned int)((lz_wpos + 1u) & LZ_WIN_MASK);
-    if (lz_wfill < LZ_WIN_SIZE) lz_wfill++;
-}
-
-/* Find a match at current lookahead position.
- * Returns match length (0 if < LZ_MIN_MATCH), sets *pdist. */
-static unsigned int lz_find_match(unsigned int *pdist)
-{
-    unsigned char  h;
-    unsigned int   cand;
-    unsigned int   dist;
-    unsigned int   max_len;
-    unsigned int   len;
-    unsigned int   wp;
-
-    if (lz_ahead_len < LZ_MIN_MATCH) return 0u;
-
-    h    = lz_hash3(lz_ahead[0], lz_ahead[1], lz_ahead[2]);
-    cand = lz_ht[h];
-    if (cand == 0xFFFFu || lz_wfill == 0u) return 0u;
-
-    /* compute distance (1-based) */
-    if (lz_wpos > cand) dist = lz_wpos - cand;
-    else                dist = LZ_WIN_SIZE - cand + lz_wpos;
-    if (dist == 0u || dist > lz_wfill) return 0u;
-
-    /* cap: respect window, ahead buffer, and max match */
-    max_len = lz_ahead_len;
-    if (max_len > LZ_MAX_MATCH) max_len = LZ_MAX_MATCH;
-    if (max_len > dist)         max_len = dist;   /* no run-length overlap */
-    if (max_len < LZ_MIN_MATCH) return 0u;
-
-    /* compare lookahead with window */
-    len = 0u;
-    wp  = cand;
-    while (len < max_len) {
-        if (lz_win[wp] != lz_ahead[len]) break;
-        len++;
-        wp = (unsigned int)((wp + 1u) & LZ_WIN_MASK);
-    }
-    if (len < LZ_MIN_MATCH) return 0u;
-
-    *pdist = dist;
-    return len;
+    fw(pack_out_fd, buf, len);          /* fw also updates out_pos */
 }
 
 /* ---- DEFLATE compress a file ------------------------------------------- */
 
-static int pack_deflate(int fd_out, unsigned long *pcrc, unsigned long *puncomp)
+static void pack_deflate(int fd_out, unsigned long *pcrc, unsigned long *puncomp)
 {
-    unsigned long  crc = 0xFFFFFFFFUL;
-    unsigned long  usz = 0;
-    unsigned char  h;
-    unsigned int   i;
-    unsigned int   match_len;
-    unsigned int   dist;
-    int            b;
-
-    /* initialise state */
-    lz_wpos = 0u; lz_wfill = 0u; lz_ahead_len = 0u;
-    dfl_bits = 0u; dfl_nbits = 0u; dfl_opos = 0u; dfl_comp_sz = 0UL;
-    dfl_fd = fd_out;
-    for (i = 0u; i < LZ_HASH_SIZE; i++) lz_ht[i] = 0xFFFFu;
-
-    /* fill initial lookahead */
-    while (lz_ahead_len < LZ_AHEAD_SIZE) {
-        b = rb_getbyte();
-        if (b < 0) break;
-        lz_ahead[lz_ahead_len++] = (unsigned char)b;
-    }
-
-    /* DEFLATE block header: BFINAL=1, BTYPE=01 (fixed Huffman), LSB first */
-    dfl_put_bit(1u);  /* BFINAL */
-    dfl_put_bit(1u);  /* BTYPE bit 0 */
-    dfl_put_bit(0u);  /* BTYPE bit 1 */
-
-    while (lz_ahead_len > 0u) {
-        dist      = 0u;
-        match_len = lz_find_match(&dist);
-
-        if (match_len >= LZ_MIN_MATCH) {
-            /* emit back-reference */
-            dfl_length(match_len);
-            dfl_distance(dist);
-
-            /* consume match_len bytes: update window, hash, CRC */
-            for (i = 0u; i < match_len; i++) {
-                crc = crc32_upd(crc, lz_ahead[0]);
-                usz++;
-                if (lz_ahead_len >= LZ_MIN_MATCH) {
-                    h = lz_hash3(lz_ahead[0], lz_ahead[1], lz_ahead[2]);
-                    lz_ht[h] = lz_wpos;
-                }
-                lz_push(lz_ahead[0]);
-                /* shift lookahead left by 1 */
-                lz_ahead_len--;
-                if (lz_ahead_len > 0u)
-                    memmove(lz_ahead, lz_ahead + 1, lz_ahead_len);
-                /* refill 1 byte */
-                b = rb_getbyte();
-                if (b >= 0) lz_ahead[lz_ahead_len++] = (unsigned char)b;
-            }
-        } else {
-            /* emit literal */
-            if (lz_ahead_len >= LZ_MIN_MATCH) {
-                h = lz_hash3(lz_ahead[0], lz_ahead[1], lz_ahead[2]);
-                lz_ht[h] = lz_wpos;
-            }
-            crc = crc32_upd(crc, lz_ahead[0]);
-            usz++;
-            dfl_literal(lz_ahead[0]);
-            lz_push(lz_ahead[0]);
-
-            lz_ahead_len--;
-            if (lz_ahead_len > 0u)
-                memmove(lz_ahead, lz_ahead + 1, lz_ahead_len);
-            b = rb_getbyte();
-            if (b >= 0) lz_ahead[lz_ahead_len++] = (unsigned char)b;
-        }
-    }
-
-    dfl_eob();
-    /* pad to byte boundary */
-    while (dfl_nbits > 0u) dfl_put_bit(0u);
-    dfl_flush_obuf();
-
-    *pcrc    = crc ^ 0xFFFFFFFFUL;
-    *puncomp = usz;
-    return 0;
+    pack_out_fd = fd_out;
+    pack_crc    = 0xFFFFFFFFUL;
+    pack_usz    = 0UL;
+    dfl_in      = pack_in;
+    dfl_out     = pack_out;
+    dfl_deflate();
+    *pcrc    = pack_crc ^ 0xFFFFFFFFUL;
+    *puncomp = pack_usz;
 }
 
 /* ==== UNPACK / INFLATE ==================================================== */
 
-/* ---- Inflate bit reader (reuses dfl_bits / dfl_nbits) ------------------- */
-
-static int infl_bit(void)
-{
-    int b;
-    if (dfl_nbits == 0u) {
-        b = rb_getbyte();
-        if (b < 0) return -1;
-        dfl_bits  = (unsigned char)b;
-        dfl_nbits = 8u;
-    }
-    b = (int)(dfl_bits & 1u);
-    dfl_bits  >>= 1;
-    dfl_nbits--;
-    return b;
-}
-
-/* Read n bits LSB-first (extra bits after Huffman code) */
-static int infl_read_lsb(unsigned char n)
-{
-    unsigned int  v = 0u;
-    unsigned char i;
-    int b;
-    for (i = 0u; i < n; i++) {
-        b = infl_bit();
-        if (b < 0) return -1;
-        v |= (unsigned int)(unsigned char)b << i;
-    }
-    return (int)v;
-}
-
-/* Decode fixed Huffman lit/len symbol: 7/8/9 bits, MSB-accumulated        */
-/* First bit read from stream = MSB of code (as emitted by emit_huff).      */
-static int infl_decode_litlen(void)
-{
-    unsigned int  code = 0u;
-    unsigned char i;
-    int b;
-
-    for (i = 0u; i < 7u; i++) {
-        b = infl_bit();
-        if (b < 0) return -1;
-        code = (code << 1) | (unsigned int)(unsigned char)b;
-    }
-    if (code <= 23u) return (int)(256u + code); /* 7-bit: EOB(256), 257-279 */
-
-    b = infl_bit(); if (b < 0) return -1;
-    code = (code << 1) | (unsigned int)(unsigned char)b;  /* 8 bits */
-    if (code >= 48u  && code <= 191u) return (int)(code - 48u);         /* lit 0-143   */
-    if (code >= 192u && code <= 199u) return (int)(280u + code - 192u); /* sym 280-287 */
-
-    b = infl_bit(); if (b < 0) return -1;
-    code = (code << 1) | (unsigned int)(unsigned char)b;  /* 9 bits */
-    if (code >= 400u && code <= 511u) return (int)(144u + code - 400u); /* lit 144-255 */
-
-    return -2; /* invalid code */
-}
-
-/* Decode 5-bit distance code, MSB-accumulated */
-static int infl_decode_dist(void)
-{
-    unsigned int  code = 0u;
-    unsigned char i;
-    int b;
-    for (i = 0u; i < 5u; i++) {
-        b = infl_bit();
-        if (b < 0) return -1;
-        code = (code << 1) | (unsigned int)(unsigned char)b;
-    }
-    return (int)code;
-}
-
-/* ---- Inflate output helpers (reuse dfl_obuf/dfl_opos, lz_win/lz_wpos) -- */
-
 static int unpack_out_fd; /* output fd set by caller before inflate/store    */
 
-static void unpack_flush_obuf(void)
+/* inflate sink: CRC of the output, then to unpack_out_fd through XRAM */
+static void unpack_out(const unsigned char *buf, unsigned int len)
 {
     unsigned int i;
-    if (dfl_opos > 0u) {
-        RIA.addr0 = PACK_XRAM_STAGE;
-        RIA.step0 = 1;
-        for (i = 0u; i < dfl_opos; i++) RIA.rw0 = dfl_obuf[i];
-        write_xram(PACK_XRAM_STAGE, dfl_opos, unpack_out_fd);
-        dfl_opos = 0u;
-    }
-}
-
-static void unpack_emit(unsigned char b)
-{
-    lz_win[lz_wpos] = b;
-    lz_wpos = (lz_wpos + 1u) & LZ_WIN_MASK;
-    dfl_obuf[dfl_opos++] = b;
-    if (dfl_opos >= 128u) unpack_flush_obuf();
-}
-
-/* ---- Inflate one fixed-Huffman block (BTYPE=01) ------------------------- */
-/* Accumulates into *pcrc (pre-init to 0xFFFFFFFF) and *pusz.                */
-
-static int inflate_fixed_block(unsigned long *pcrc, unsigned long *pusz)
-{
-    int          sym, dc, xb, extra;
-    unsigned int length, dist, src, i;
-    unsigned char bk;
-
-    while (1) {
-        sym = infl_decode_litlen();
-        if (sym < 0) return -1;
-
-        if (sym == 256) return 0; /* end-of-block */
-
-        if (sym < 256) {
-            *pcrc = crc32_upd(*pcrc, (unsigned char)sym);
-            unpack_emit((unsigned char)sym);
-            (*pusz)++;
-        } else {
-            /* length/distance back-reference: sym 257-285 */
-            sym -= 257;
-            if (sym > 28) return -1;
-            xb     = (int)len_xb[(unsigned char)sym];
-            extra  = xb ? infl_read_lsb((unsigned char)xb) : 0;
-            if (extra < 0) return -1;
-            length = len_base[(unsigned char)sym] + (unsigned int)extra;
-
-            dc = infl_decode_dist();
-            if (dc < 0 || dc > 23) return -1;
-            xb    = (int)dist_xb[(unsigned char)dc];
-            extra = xb ? infl_read_lsb((unsigned char)xb) : 0;
-            if (extra < 0) return -1;
-            dist = dist_base[(unsigned char)dc] + (unsigned int)extra;
-            if (dist == 0u || dist > LZ_WIN_SIZE) return -2; /* beyond window */
-
-            src = (unsigned int)((lz_wpos + LZ_WIN_SIZE - dist) & LZ_WIN_MASK);
-            for (i = 0u; i < length; i++) {
-                bk = lz_win[(unsigned int)((src + i) & LZ_WIN_MASK)];
-                *pcrc = crc32_upd(*pcrc, bk);
-                unpack_emit(bk);
-                (*pusz)++;
-            }
-        }
-    }
+    for (i = 0u; i < len; i++) pack_crc = crc32_upd(pack_crc, buf[i]);
+    RIA.addr0 = PACK_XRAM_STAGE;
+    RIA.step0 = 1;
+    for (i = 0u; i < len; i++) RIA.rw0 = buf[i];
+    write_xram(PACK_XRAM_STAGE, len, unpack_out_fd);
 }
 
 /* ---- Inflate a DEFLATE stream from fd_in → unpack_out_fd ---------------- */
@@ -698,48 +301,18 @@ static int inflate_fixed_block(unsigned long *pcrc, unsigned long *pusz)
 
 static int unpack_inflate(int fd_in, unsigned long *pcrc, unsigned long *pusz)
 {
-    int          bfinal, btype, rc, b, i;
-    unsigned int blen;
-
-    *pcrc = 0xFFFFFFFFUL;
-    *pusz = 0UL;
-    dfl_bits  = 0u;
-    dfl_nbits = 0u;
-    dfl_opos  = 0u;
-    lz_wpos   = 0u;
-    rb_init(fd_in);
+    int rc;
 
-    do {
-        bfinal = infl_bit();   if (bfinal < 0) return -1;
-        btype  = infl_read_lsb(2u); if (btype  < 0) return -1;
-
-        if (btype == 0) {
-            /* BTYPE=00: non-compressed block — align, copy LEN bytes */
-            dfl_nbits = 0u; dfl_bits = 0u;
-            b = rb_getbyte(); if (b < 0) return -1;
-            blen  = (unsigned int)(unsigned char)b;
-            b = rb_getbyte(); if (b < 0) return -1;
-            blen |= (unsigned int)(unsigned char)b << 8;
-            rb_getbyte(); rb_getbyte(); /* NLEN — discard */
-            for (i = 0; i < (int)blen; i++) {
-                b = rb_getbyte(); if (b < 0) return -1;
-                *pcrc = crc32_upd(*pcrc, (unsigned char)b);
-                unpack_emit((unsigned char)b);
-                (*pusz)++;
-            }
-        } else if (btype == 1) {
-            /* BTYPE=01: fixed Huffman */
-            rc = inflate_fixed_block(pcrc, pusz);
-            if (rc < 0) return rc;
-        } else {
-            tx_string(EXCLAMATION "Unsupported DEFLATE type" NEWLINE);
-            return -3;
-        }
-    } while (!bfinal);
-
-    unpack_flush_obuf();
-    *pcrc ^= 0xFFFFFFFFUL;
-    return 0;
+    rb_init(fd_in);
+    pack_crc = 0xFFFFFFFFUL;
+    dfl_in   = rb_getbyte;
+    dfl_out  = unpack_out;
+    rc = dfl_inflate();
+    if (rc == DFL_ERR_TYPE)
+        tx_string(EXCLAMATION "Unsupported DEFLATE type" NEWLINE);
+    *pcrc = pack_crc ^ 0xFFFFFFFFUL;
+    *pusz = dfl_total;
+    return rc;
 }
 
 /* ---- Copy raw STORE data from fd_in → unpack_out_fd --------------------- */
@@ -904,6 +477,7 @@ static int do_unpack(const char *arcpath)
         }
 
         tx_string("  < "); tx_string(outpath);
+        tx_flush();   /* show the name while the entry is extracted */
 
         /* seek to Local File Header */
         local_off = cdir_entry.offset;
@@ -1100,6 +674,7 @@ int main(int argc, char **argv)
 
         tx_string("  + ");
         tx_string(arc_name);
+        tx_flush();   /* show the name while the file is packed */
 
         /* record local file header offset */
         local_off = out_pos;
@@ -1113,7 +688,7 @@ int main(int argc, char **argv)
             rb_init(fd_in);
             if (use_deflate) {
                 pack_deflate(fd_out, &crc, &uncomp);
-                comp = dfl_comp_sz;
+                comp = dfl_total;
             } else {
                 uncomp = pack_store(fd_out, &crc);
                 comp   = uncomp;
@@ -30,13 +30,16 @@
 /* --- GFX canvas --- */
 //#define GFX_CANVAS_640x480       0b00000011
 
-/* --- XRAM text buffer: 256 rows x 80 cols x 1 byte = 20480 bytes --- */
+/* --- XRAM text store: gap buffer of lines, see gap_to() --- */
 #define TEXT_BUF_BASE    0x0000u
+#define TEXT_BUF_SIZE    0x8000u   /* 32 KB of text, lines kept without terminators */
+#define LINE_IDX_BASE    0x8000u   /* uint16_t per line: offset of its text in the store */
+#define MAX_LINES        4096u     /* 8 KB of line index */
 #define TEXT_COLS        80u
 #define XRAM_SCRATCH     0xA200u   /* scratch for file write (82 bytes) */
 
-/* --- XRAM clipboard: up to 32 whole lines stored after text buffer --- */
-#define CLIP_BUF_BASE    0x5100u
+/* --- XRAM clipboard: up to 32 whole lines of 80 cols --- */
+#define CLIP_BUF_BASE    0xB000u
 #define CLIP_MAX_LINES   32u
 
 /* --- Terminal dimensions (640x480, 16px font) --- */
@@ -45,6 +48,11 @@
 #define MENU_ROWS        2u    /* fixed menu at bottom */
 #define EDIT_ROWS        (TERM_ROWS - TITLE_ROWS - MENU_ROWS) /* editable area */
 
+/* --- XRAM screen shadow: what the terminal shows, EDIT_ROWS rows + menu row --- */
+#define XRAM_SHADOW      0xE000u
+#define MENU_SHADOW      (XRAM_SHADOW + EDIT_ROWS * TEXT_COLS)
+#define TERM_SCROLL_REGION 1   /* terminal has DECSTBM and IL/DL; 0 repaints shifted rows */
+
 /* --- ANSI escape helpers --- */
 #define ANSI_HOME        "\033[H"
 #define ANSI_HIDE_CUR    "\033[?25l"
@@ -67,14 +75,14 @@ uint8_t keystates[KEYBOARD_BYTES] = {0};
 
 /* --- cursor --- */
 struct Cursor {
-    uint8_t row;
-    uint8_t col;
+    uint16_t row;
+    uint8_t  col;
 };
 static struct Cursor cur;
 
 /* --- scroll / content state --- */
-static uint8_t  scroll_row    = 0u;
-static uint16_t content_rows  = 0u;
+static uint16_t scroll_row    = 0u;
+static uint16_t content_rows  = 0u;   /* lines in the text store */
 
 /* --- file and search state --- */
 static char current_filename[64];
@@ -86,7 +94,7 @@ static uint8_t view_mode   = 0u;   /* 1 = read-only view, editing disabled */
 static uint8_t doc_dirty   = 0u;   /* 1 when document has unsaved changes */
 static uint8_t insert_mode = 1u;
 static uint8_t sel_active  = 0u;
-static uint8_t sel_row     = 0u;
+static uint16_t sel_row    = 0u;
 static uint8_t sel_col     = 0u;   /* anchor column for char-level selection */
 #define SEL_MODE_LINE 0u
 #define SEL_MODE_CHAR 1u
@@ -94,8 +102,399 @@ static uint8_t sel_mode    = SEL_MODE_LINE;
 static uint8_t clip_lines   = 0u;   /* number of whole rows in XRAM clipboard */
 static uint8_t clip_is_char = 0u;   /* 1 = clipboard holds char fragment, not whole rows */
 
-static uint8_t sel_min_row(void);
-static uint8_t sel_max_row(void);
+static uint16_t sel_min_row(void);
+static uint16_t sel_max_row(void);
+
+/* ================================================================
+   Screen shadow: each edit row of the terminal has a slot of
+   TEXT_COLS chars in XRAM_SHADOW holding what it shows, plus the
+   kind of row drawn there. redraw_screen() compares the rows marked
+   dirty with the document and sends only the cells that differ.
+   Rows inserted or deleted in the document become IL/DL inside the
+   edit area scroll region; the slots rotate with them, so the
+   shadow itself is never copied. A shadow cell of 0 is never shown,
+   it marks a cell that must be sent again.
+   ================================================================ */
+#define ROW_TEXT  0u   /* document text or blank */
+#define ROW_SEL   1u   /* whole row selected */
+#define ROW_CSEL  2u   /* row with a char selection */
+#define ROW_EOD   3u   /* end of document marker */
+
+static uint8_t  row_slot[EDIT_ROWS];    /* shadow slot of each screen row */
+static uint8_t  row_kind[EDIT_ROWS];    /* ROW_* drawn there */
+static uint8_t  row_dirty[EDIT_ROWS];   /* document row changed since drawn */
+static uint16_t drawn_scroll;           /* scroll_row the screen was drawn with */
+static uint8_t  csel_from, csel_to;     /* char selection drawn on the ROW_CSEL row */
+static uint8_t  screen_blank;           /* screen cleared, everything to be drawn */
+static uint8_t  title_shown;            /* doc_dirty shown in the title, 0xFF = redraw */
+static uint8_t  menu_rule_shown;        /* horizontal rule above the menu drawn */
+static uint8_t  pend_row;               /* screen row of pending line inserts/deletes */
+static int8_t   pend_n;                 /* > 0 lines inserted there, < 0 deleted */
+
+static uint16_t shadow_addr(uint8_t r)
+{
+    return XRAM_SHADOW + (uint16_t)row_slot[r] * TEXT_COLS;
+}
+
+static void shadow_fill(uint16_t addr, uint8_t n, uint8_t c)
+{
+    RIA.addr0 = addr;
+    RIA.step0 = 1;
+    while (n--) RIA.rw0 = c;
+}
+
+/* Clears the terminal; the shadow becomes all blank and every row dirty. */
+static void screen_clear(void)
+{
+    uint8_t r;
+
+    printf(ANSI_HIDE_CUR ANSI_CLS);
+#if TERM_SCROLL_REGION
+    printf("\033[%d;%dr", (int)(TITLE_ROWS + 1u), (int)(TITLE_ROWS + EDIT_ROWS));
+#endif
+    printf(ANSI_HOME);
+    for (r = 0u; r < EDIT_ROWS; r++) {
+        row_slot[r]  = r;
+        row_kind[r]  = ROW_TEXT;
+        row_dirty[r] = 1u;
+        shadow_fill(shadow_addr(r), TEXT_COLS, ' ');
+    }
+    shadow_fill(MENU_SHADOW, TEXT_COLS, ' ');
+    drawn_scroll    = 0u;
+    pend_n          = 0;
+    screen_blank    = 1u;
+    title_shown     = 0xFFu;
+    menu_rule_shown = 0u;
+}
+
+/* ================================================================
+   screen_shift: inserts (down) or deletes n lines at screen row r,
+   the rows below move within the edit area. The lines that come in
+   are blank on the terminal and dirty.
+   ================================================================ */
+static void screen_shift(uint8_t r, uint8_t n, uint8_t down)
+{
+    uint8_t i, k, slot;
+
+    if (n > (uint8_t)(EDIT_ROWS - r)) n = (uint8_t)(EDIT_ROWS - r);
+#if TERM_SCROLL_REGION
+    printf(ANSI_NORMAL "\033[%d;1H\033[%d%c",
+           (int)(r + 1u + TITLE_ROWS), (int)n, down ? 'L' : 'M');
+    for (k = 0u; k < n; k++) {
+        if (down) {
+            slot = row_slot[EDIT_ROWS - 1u];
+            for (i = EDIT_ROWS - 1u; i > r; i--) {
+                row_slot[i]  = row_slot[i - 1u];
+                row_kind[i]  = row_kind[i - 1u];
+                row_dirty[i] = row_dirty[i - 1u];
+            }
+            i = r;
+        } else {
+            slot = row_slot[r];
+            for (i = r; i < EDIT_ROWS - 1u; i++) {
+                row_slot[i]  = row_slot[i + 1u];
+                row_kind[i]  = row_kind[i + 1u];
+                row_dirty[i] = row_dirty[i + 1u];
+            }
+        }
+        row_slot[i]  = slot;
+        row_kind[i]  = ROW_TEXT;
+        row_dirty[i] = 1u;
+        shadow_fill(shadow_addr(i), TEXT_COLS, ' ');
+    }
+#else
+    /* rows keep what they show, the diff repaints them */
+    (void)k; (void)slot; (void)down; (void)n;
+    for (i = r; i < EDIT_ROWS; i++) row_dirty[i] = 1u;
+#endif
+}
+
+/* Sends the pending line inserts/deletes. */
+static void screen_flush(void)
+{
+    if (pend_n > 0)      screen_shift(pend_row, (uint8_t)pend_n, 1u);
+    else if (pend_n < 0) screen_shift(pend_row, (uint8_t)-pend_n, 0u);
+    pend_n = 0;
+}
+
+/* Document row changed in place. */
+static void screen_mark(uint16_t row)
+{
+    if (screen_blank) return;
+    screen_flush();
+    if (row >= drawn_scroll && row - drawn_scroll < EDIT_ROWS)
+        row_dirty[row - drawn_scroll] = 1u;
+}
+
+/* ================================================================
+   screen_line_inserted / screen_line_deleted: document row inserted
+   or removed. Runs of them (paste, cut) become one IL/DL; rows above
+   the view only move drawn_scroll.
+   ================================================================ */
+static void screen_line_inserted(uint16_t row)
+{
+    uint8_t r;
+
+    if (screen_blank) return;
+    if (row < drawn_scroll) { drawn_scroll++; return; }
+    if (row - drawn_scroll >= EDIT_ROWS) return;
+    r = (uint8_t)(row - drawn_scroll);
+    if (pend_n > 0 && r == (uint8_t)(pend_row + pend_n)) { pend_n++; return; }
+    screen_flush();
+    pend_row = r;
+    pend_n   = 1;
+}
+
+static void screen_line_deleted(uint16_t row)
+{
+    uint8_t r;
+
+    if (screen_blank) return;
+    if (row < drawn_scroll) { drawn_scroll--; return; }
+    if (row - drawn_scroll >= EDIT_ROWS) return;
+    r = (uint8_t)(row - drawn_scroll);
+    if (pend_n < 0 && r == pend_row) {
+        if ((uint8_t)-pend_n < (uint8_t)(EDIT_ROWS - r)) pend_n--;
+        return;
+    }
+    screen_flush();
+    pend_row = r;
+    pend_n   = -1;
+}
+
+/* ================================================================
+   row_diff: brings terminal row ansi_row from its shadow to want
+   (TEXT_COLS chars), sending only the cells that differ. Runs of up
+   to 4 equal cells between changes are sent again, longer ones are
+   skipped with a cursor-forward. sgr, if not NULL, is the colour of
+   the row.
+   ================================================================ */
+static void row_diff(uint8_t ansi_row, uint16_t shadow, const char *want, const char *sgr)
+{
+    char    old[TEXT_COLS];
+    uint8_t j, pos;
+
+    RIA.addr1 = shadow;
+    RIA.step1 = 1;
+    for (j = 0u; j < TEXT_COLS; j++) old[j] = (char)RIA.rw1;
+
+    pos = 0xFFu;   /* terminal column after the last cell sent, none yet */
+    for (j = 0u; j < TEXT_COLS; j++) {
+        if (old[j] == want[j]) continue;
+        if (pos == 0xFFu) {
+            printf("\033[%d;%dH", (int)ansi_row, (int)(j + 1u));
+            if (sgr) printf(sgr);
+        } else if ((uint8_t)(j - pos) <= 4u) {
+            while (pos < j) putchar((uint8_t)want[pos++]);
+        } else {
+            printf("\033[%dC", (int)(j - pos));
+        }
+        putchar((uint8_t)want[j]);
+        pos = (uint8_t)(j + 1u);
+    }
+    if (pos == 0xFFu) return;
+    if (sgr) printf(ANSI_NORMAL);
+
+    RIA.addr0 = shadow;
+    RIA.step0 = 1;
+    for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = (uint8_t)want[j];
+}
+
+/* ================================================================
+   Text store: the document is a gap buffer in XRAM holding the text
+   of each line without padding or terminators. The gap always sits
+   at the start of line gap_line: lines before it are packed from
+   TEXT_BUF_BASE up to gap_start, the rest from gap_end up to
+   TEXT_BUF_SIZE. The line index holds the XRAM offset of every line
+   and has its gap at the same line: entries of lines before the gap
+   from the bottom of LINE_IDX_BASE, the others packed at its top.
+   Editing a line costs its own length; only moving the gap to
+   another line copies the text and index entries in between.
+   ================================================================ */
+static uint16_t gap_start;       /* first free byte */
+static uint16_t gap_end;         /* first byte after the gap */
+static uint16_t gap_line;        /* lines before the gap */
+static uint8_t  store_full = 0u; /* an edit did not fit, reported by the menu bar */
+
+static uint16_t idx_addr(uint16_t row)
+{
+    if (row >= gap_line) row += (uint16_t)(MAX_LINES - content_rows);
+    return LINE_IDX_BASE + row * 2u;
+}
+
+static uint16_t idx_get(uint16_t row)
+{
+    uint16_t v;
+    RIA.addr1 = idx_addr(row);
+    RIA.step1 = 1;
+    v  = RIA.rw1;
+    v |= (uint16_t)RIA.rw1 << 8;
+    return v;
+}
+
+static void idx_set(uint16_t row, uint16_t v)
+{
+    RIA.addr0 = idx_addr(row);
+    RIA.step0 = 1;
+    RIA.rw0   = (uint8_t)v;
+    RIA.rw0   = (uint8_t)(v >> 8);
+}
+
+/* One past the last byte of a line in the store. */
+static uint16_t line_end(uint16_t row)
+{
+    if (row + 1u == gap_line)     return gap_start;
+    if (row + 1u >= content_rows) return TEXT_BUF_SIZE;
+    return idx_get(row + 1u);
+}
+
+/* Moves the gap to the start of row (0..content_rows). */
+static void gap_to(uint16_t row)
+{
+    uint16_t n, i, v, from, gap;
+
+    gap = gap_end - gap_start;
+    if (row < gap_line) {
+        /* text of rows row..gap_line-1 moves up behind the gap, last byte first */
+        from = idx_get(row);
+        n    = gap_start - from;
+        RIA.addr1 = TEXT_BUF_BASE + gap_start - 1u;
+        RIA.step1 = -1;
+        RIA.addr0 = TEXT_BUF_BASE + gap_end - 1u;
+        RIA.step0 = -1;
+        for (i = 0u; i < n; i++) RIA.rw0 = RIA.rw1;
+        gap_start = from;
+        gap_end  -= n;
+        while (gap_line > row) {
+            v = idx_get(gap_line - 1u);
+            gap_line--;                   /* the entry now maps to the top */
+            idx_set(gap_line, v + gap);
+        }
+    } else if (row > gap_line) {
+        /* text of rows gap_line..row-1 moves down in front of the gap */
+        from = (row < content_rows) ? idx_get(row) : TEXT_BUF_SIZE;
+        n    = from - gap_end;
+        RIA.addr1 = TEXT_BUF_BASE + gap_end;
+        RIA.step1 = 1;
+        RIA.addr0 = TEXT_BUF_BASE + gap_start;
+        RIA.step0 = 1;
+        for (i = 0u; i < n; i++) RIA.rw0 = RIA.rw1;
+        gap_start += n;
+        gap_end    = from;
+        while (gap_line < row) {
+            v = idx_get(gap_line);
+            gap_line++;
+            idx_set(gap_line - 1u, v - gap);
+        }
+    }
+}
+
+static void store_clear(void)
+{
+    gap_start    = 0u;
+    gap_end      = TEXT_BUF_SIZE;
+    gap_line     = 0u;
+    content_rows = 0u;
+}
+
+/* Length of buf[0..TEXT_COLS) without trailing spaces. */
+static uint8_t row_trim(const char *buf)
+{
+    uint8_t len = TEXT_COLS;
+    while (len > 0u && buf[len - 1u] == ' ') len--;
+    return len;
+}
+
+/* Writes len bytes of buf in front of the gap. */
+static void gap_put(const char *buf, uint8_t len)
+{
+    uint8_t j;
+    RIA.addr0 = TEXT_BUF_BASE + gap_start;
+    RIA.step0 = 1;
+    for (j = 0u; j < len; j++) RIA.rw0 = (uint8_t)buf[j];
+    gap_start += len;
+}
+
+/* ================================================================
+   line_get: reads a row into buf as TEXT_COLS chars padded with
+   spaces (rows past the end are blank). Returns its text length.
+   ================================================================ */
+static uint8_t line_get(uint16_t row, char *buf)
+{
+    uint8_t  j, len = 0u;
+    uint16_t s;
+
+    if (row < content_rows) {
+        s   = idx_get(row);
+        len = (uint8_t)(line_end(row) - s);
+        RIA.addr1 = TEXT_BUF_BASE + s;
+        RIA.step1 = 1;
+        for (j = 0u; j < len; j++) buf[j] = (char)RIA.rw1;
+    }
+    for (j = len; j < TEXT_COLS; j++) buf[j] = ' ';
+    return len;
+}
+
+/* ================================================================
+   line_insert: inserts a new row before row from buf (TEXT_COLS
+   chars, trailing spaces dropped), or an empty one if buf is NULL.
+   Returns 0 and sets store_full if it does not fit.
+   ================================================================ */
+static uint8_t line_insert(uint16_t row, const char *buf)
+{
+    uint8_t len = buf ? row_trim(buf) : 0u;
+
+    if (content_rows >= MAX_LINES || gap_end - gap_start < len) {
+        store_full = 1u;
+        return 0u;
+    }
+    if (row > content_rows) row = content_rows;
+    gap_to(row);
+    content_rows++;
+    gap_line++;
+    idx_set(row, gap_start);
+    gap_put(buf, len);
+    screen_line_inserted(row);
+    return 1u;
+}
+
+/* Appends empty rows until row exists. */
+static uint8_t line_touch(uint16_t row)
+{
+    while (content_rows <= row)
+        if (!line_insert(content_rows, NULL)) return 0u;
+    return 1u;
+}
+
+/* ================================================================
+   line_put: replaces a row with buf (TEXT_COLS chars, trailing
+   spaces dropped), appending empty rows up to it when needed.
+   ================================================================ */
+static uint8_t line_put(uint16_t row, const char *buf)
+{
+    uint8_t  len = row_trim(buf);
+    uint16_t s;
+
+    if (!line_touch(row)) return 0u;
+    gap_to(row + 1u);
+    s = idx_get(row);
+    if (gap_end - s < len) { store_full = 1u; return 0u; }
+    gap_start = s;
+    gap_put(buf, len);
+    screen_mark(row);
+    return 1u;
+}
+
+/* line_delete: removes a row, the rows below move up by one. */
+static void line_delete(uint16_t row)
+{
+    if (row >= content_rows) return;
+    gap_to(row + 1u);
+    gap_start = idx_get(row);
+    gap_line--;
+    content_rows--;
+    screen_line_deleted(row);
+}
 
 /* ------------------------------------------------------------------ */
 
@@ -159,10 +558,9 @@ static char keycode_to_char(uint8_t code, uint8_t shift, uint8_t caps, uint8_t r
    color_fg / color_bg: ANSI SGR strings (e.g. "37m" / "44m"), or NULL.
    window_text: prints text inside the window at (wx_pos, wy_pos) offset
    from the inner top-left corner (1-based, clipped to inner area).
+   window_close: marks the cells under the window stale in the screen
+   shadow, the next redraw_screen() puts them back.
    ================================================================ */
-/* XRAM backup buffer for window_draw: stores chars under the window */
-#define XRAM_WIN_BUF  0xA300u   /* max window area: 80*30 worst case, but we only need win_w*win_h */
-
 static uint8_t win_x;   /* saved top-left column of last window_draw call */
 static uint8_t win_y;   /* saved top-left row    of last window_draw call */
 static uint8_t win_w;   /* saved outer width */
@@ -182,28 +580,6 @@ static void window_open(uint8_t x_pos, uint8_t y_pos,
     if (width < 2u || height < 2u) return;
     inner_w = (uint8_t)(width - 2u);
 
-    /* save chars under window area to XRAM backup buffer */
-    for (r = 0u; r < height; r++) {
-        printf("\033[%d;%dH", (int)(y_pos + r), (int)x_pos);
-        RIA.addr0 = XRAM_WIN_BUF + (uint16_t)r * width;
-        RIA.step0 = 1;
-        /* read back from XRAM text buffer (terminal content mirrors text buf for edit rows) */
-        {
-            uint16_t xram_row = (uint16_t)((y_pos + r) - 1u);   /* 0-based terminal row */
-            uint8_t  xram_col = (uint8_t)(x_pos - 1u);          /* 0-based terminal col */
-            if (xram_row >= TITLE_ROWS && xram_row < (uint16_t)(TITLE_ROWS + EDIT_ROWS)) {
-                /* edit area: back up from text buffer */
-                uint8_t buf_row = (uint8_t)((xram_row - TITLE_ROWS) + scroll_row);
-                RIA.addr1 = TEXT_BUF_BASE + (uint16_t)buf_row * TEXT_COLS + xram_col;
-                RIA.step1 = 1;
-                for (c = 0u; c < width; c++) RIA.rw0 = RIA.rw1;
-            } else {
-                /* title/menu area: no text buffer — store placeholder spaces */
-                for (c = 0u; c < width; c++) RIA.rw0 = ' ';
-            }
-        }
-    }
-
     /* draw window */
     for (r = 0u; r < height; r++) {
         printf("\033[%d;%dH", (int)(y_pos + r), (int)x_pos);
@@ -228,18 +604,25 @@ static void window_open(uint8_t x_pos, uint8_t y_pos,
 
 static void window_close(void)
 {
-    uint8_t r, c;
-    if (win_w < 2u || win_h < 2u) return;
+    uint8_t r, row, w;
+    if (win_w < 2u || win_h < 2u || win_x > TEXT_COLS) return;
+    /* the shadow rows are TEXT_COLS wide and back to back */
+    w = win_w;
+    if (win_x - 1u + w > TEXT_COLS) w = (uint8_t)(TEXT_COLS - (win_x - 1u));
     for (r = 0u; r < win_h; r++) {
-        printf("\033[%d;%dH" ANSI_NORMAL, (int)(win_y + r), (int)win_x);
-        RIA.addr1 = XRAM_WIN_BUF + (uint16_t)r * win_w;
-        RIA.step1 = 1;
-        for (c = 0u; c < win_w; c++) {
-            uint8_t ch = RIA.rw1;
-            putchar(ch ? ch : ' ');
+        row = (uint8_t)(win_y + r - 1u);   /* 0-based terminal row */
+        if (row < TITLE_ROWS) {
+            title_shown = 0xFFu;
+        } else if (row < TITLE_ROWS + EDIT_ROWS) {
+            row -= TITLE_ROWS;
+            shadow_fill(shadow_addr(row) + win_x - 1u, w, 0u);
+            row_dirty[row] = 1u;
+        } else if (row == TITLE_ROWS + EDIT_ROWS) {
+            menu_rule_shown = 0u;
+        } else {
+            shadow_fill(MENU_SHADOW + win_x - 1u, w, 0u);
         }
     }
-    printf(ANSI_RESET CSI_CURSOR_HIDE);
 }
 
 static void window_text(const char *text,
@@ -276,6 +659,7 @@ static void draw_title_bar(void)
     static const char menu_line1[] = APP_MSG_TITLE;
     uint8_t i, fn_len, line_len;
 
+    title_shown = doc_dirty;
     for (i = 0u; menu_line1[i]; i++) putchar((uint8_t)menu_line1[i]);
 
     printf(CSI "2;1H");
@@ -303,15 +687,6 @@ static void draw_title_bar(void)
 #define MODE_VIEW "[VIEW]"
 #define CLIPBOARD_WITHDATA "[CLIP]"
 
-static void menu_print_row(uint8_t ansi_row, const char *text)
-{
-    uint8_t i;
-    printf("\033[%d;1H", (int)ansi_row);
-    for (i = 0u; text[i] && i < TEXT_COLS; i++) putchar((uint8_t)text[i]);
-    while (i < TEXT_COLS) { putchar(' '); i++; }
-    printf(ANSI_RESET);
-}
-
 static void menu_print_text(uint8_t ansi_row, uint8_t ansi_col, const char *text)
 {
     uint8_t i;
@@ -329,8 +704,12 @@ static void draw_menu_bar(const char *status)
 
     info = status ? status : INFO_READY;
 
-    printf(CSI "s" CSI_CURSOR_HIDE CSI "%d;1H", TITLE_ROWS + EDIT_ROWS + 1u);
-    for (i = 0u; i < 80u; i++) putchar('\xc4');
+    printf(CSI "s" CSI_CURSOR_HIDE);
+    if (!menu_rule_shown) {
+        printf(CSI "%d;1H", TITLE_ROWS + EDIT_ROWS + 1u);
+        for (i = 0u; i < 80u; i++) putchar('\xc4');
+        menu_rule_shown = 1u;
+    }
 
     if (view_mode) {
         sprintf(block, "Ln %d, Col %d [VIEW]", (int)(cur.row + 1), (int)(cur.col + 1));
@@ -344,7 +723,8 @@ static void draw_menu_bar(const char *status)
     }
 
     snprintf(row2, sizeof(row2), "%-*s%s", (int)(80 - (int)strlen(block)), info, block);
-    menu_print_row(TITLE_ROWS + EDIT_ROWS + 2u, row2);
+    for (i = (uint8_t)strlen(row2); i < TEXT_COLS; i++) row2[i] = ' ';
+    row_diff(TITLE_ROWS + EDIT_ROWS + 2u, MENU_SHADOW, row2, NULL);
     if(status != NULL) PAUSE(75);
     printf(CSI "u");
     printf(ANSI_NORMAL CSI_CURSOR_SHOW);
@@ -352,59 +732,86 @@ static void draw_menu_bar(const char *status)
 }
 
 /* ================================================================
-   redraw_screen: redraws EDIT_ROWS visible lines from XRAM + menu.
-   Repositions terminal cursor at cur.row/col.
+   redraw_screen: brings the edit rows, title and menu up to date with
+   the document and repositions the terminal cursor at cur.row/col.
+   Scrolling uses DL/IL in the edit area; rows whose kind changed are
+   painted whole, dirty ones are diffed with the screen shadow.
    ================================================================ */
 static void redraw_screen(void)
 {
-    uint8_t  r, j;
+    static const char eod[] = "- End of document -";
+    uint8_t  r, j, kind, c_from, c_to;
     uint16_t xrow;
 
-    printf(ANSI_HIDE_CUR ANSI_HOME);
-    draw_title_bar();
+    printf(ANSI_HIDE_CUR);
+    if (title_shown != doc_dirty) draw_title_bar();
+
+    screen_flush();
+    if (screen_blank) drawn_scroll = scroll_row;
+    if (scroll_row != drawn_scroll) {
+        if (scroll_row > drawn_scroll && scroll_row - drawn_scroll < EDIT_ROWS)
+            screen_shift(0u, (uint8_t)(scroll_row - drawn_scroll), 0u);
+        else if (scroll_row < drawn_scroll && drawn_scroll - scroll_row < EDIT_ROWS)
+            screen_shift(0u, (uint8_t)(drawn_scroll - scroll_row), 1u);
+        else
+            for (r = 0u; r < EDIT_ROWS; r++) row_dirty[r] = 1u;
+        drawn_scroll = scroll_row;
+    }
+    screen_blank = 0u;
+
+    c_from = (sel_col < cur.col) ? sel_col : cur.col;
+    c_to   = (sel_col > cur.col) ? sel_col : cur.col;
     for (r = 0u; r < EDIT_ROWS; r++) {
-        uint8_t in_sel, in_char_sel;
-        xrow = (uint16_t)scroll_row + r;
-        in_char_sel = sel_active && sel_mode == SEL_MODE_CHAR
-                      && (uint8_t)xrow == sel_row && (uint8_t)xrow == cur.row
-                      && xrow < content_rows;
-        in_sel = sel_active && sel_mode == SEL_MODE_LINE
-                 && (uint8_t)xrow >= sel_min_row()
-                 && (uint8_t)xrow <= sel_max_row()
-                 && xrow < content_rows;
-        printf("\033[%d;1H", (int)(r + 1u + TITLE_ROWS));
-        if (in_sel)          printf(ANSI_SEL_BG);
-        else if (!in_char_sel) printf(ANSI_SEL_BG_OFF);
+        xrow = scroll_row + r;
+        if (xrow > content_rows)       kind = ROW_TEXT;
+        else if (xrow == content_rows) kind = ROW_EOD;
+        else if (sel_active && sel_mode == SEL_MODE_CHAR && xrow == sel_row && xrow == cur.row)
+                                       kind = ROW_CSEL;
+        else if (sel_active && sel_mode == SEL_MODE_LINE
+                 && xrow >= sel_min_row() && xrow <= sel_max_row())
+                                       kind = ROW_SEL;
+        else                           kind = ROW_TEXT;
+
+        if (kind == row_kind[r] && !row_dirty[r] &&
+            (kind != ROW_CSEL || (c_from == csel_from && c_to == csel_to)))
+            continue;
+        row_dirty[r] = 0u;
+
         if (xrow < content_rows) {
-            RIA.addr1 = TEXT_BUF_BASE + xrow * TEXT_COLS;
-            RIA.step1 = 1;
+            line_get(xrow, g_linebuf);
+            for (j = 0u; j < TEXT_COLS; j++) if (!g_linebuf[j]) g_linebuf[j] = ' ';
+        } else {
+            for (j = 0u; j < TEXT_COLS; j++) g_linebuf[j] = ' ';
+            if (kind == ROW_EOD)
+                for (j = 0u; eod[j]; j++) g_linebuf[j] = eod[j];
+        }
+
+        if (kind == row_kind[r] && kind != ROW_CSEL) {
+            row_diff((uint8_t)(r + 1u + TITLE_ROWS), shadow_addr(r), g_linebuf,
+                     kind == ROW_SEL ? ANSI_SEL_BG : kind == ROW_EOD ? ANSI_DARK_GRAY : NULL);
+            continue;
+        }
+
+        /* kind changed: paint the whole row in its colours */
+        printf("\033[%d;1H", (int)(r + 1u + TITLE_ROWS));
+        if (kind == ROW_CSEL) {
+            printf(ANSI_SEL_BG_OFF);
             for (j = 0u; j < TEXT_COLS; j++) {
-                char c = (char)RIA.rw1;
-                g_linebuf[j] = c ? c : ' ';
-            }
-            if (in_char_sel) {
-                uint8_t c_from = (sel_col < cur.col) ? sel_col : cur.col;
-                uint8_t c_to   = (sel_col > cur.col) ? sel_col : cur.col;
-                for (j = 0u; j < TEXT_COLS; j++) {
-                    if (j >= c_from && j < c_to) printf(ANSI_SEL_BG);
-                    else                          printf(ANSI_SEL_BG_OFF);
-                    putchar((uint8_t)g_linebuf[j]);
-                }
-                printf(ANSI_SEL_BG_OFF);
-            } else {
-                for (j = 0u; j < TEXT_COLS; j++) putchar((uint8_t)g_linebuf[j]);
-                if (in_sel) printf(ANSI_SEL_BG_OFF);
+                if (j == c_from) printf(ANSI_SEL_BG);
+                if (j == c_to)   printf(ANSI_SEL_BG_OFF);
+                putchar((uint8_t)g_linebuf[j]);
             }
-        } else if (xrow == content_rows) {
-            /* "- END of document -" centred in dark grey */
-            static const char eod[] = "- End of document -";
-            printf(ANSI_DARK_GRAY);
-            for (j = 0u; eod[j]; j++) putchar((uint8_t)eod[j]);
-            printf(ANSI_NORMAL);
+            csel_from = c_from;
+            csel_to   = c_to;
         } else {
-            /* blank lines beyond END marker */
-            for (j = 0u; j < TEXT_COLS; j++) putchar(' ');
+            printf(kind == ROW_SEL ? ANSI_SEL_BG : kind == ROW_EOD ? ANSI_DARK_GRAY : ANSI_SEL_BG_OFF);
+            for (j = 0u; j < TEXT_COLS; j++) putchar((uint8_t)g_linebuf[j]);
         }
+        printf(ANSI_NORMAL);
+        row_kind[r] = kind;
+        RIA.addr0 = shadow_addr(r);
+        RIA.step0 = 1;
+        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = (uint8_t)g_linebuf[j];
     }
     draw_menu_bar(NULL);
     printf("\033[%d;%dH" ANSI_SHOW_CUR,
@@ -424,6 +831,7 @@ static int menu_confirm(const char *prompt)
     uint8_t input_row = TITLE_ROWS + EDIT_ROWS + 2u;
 
     for (k = 0u; k < KEYBOARD_BYTES; k++) prev_ks[k] = keystates[k];
+    shadow_fill(MENU_SHADOW, TEXT_COLS, 0u);   /* the prompt covers the menu row */
 
     printf("\033[%d;1H" ANSI_SEL_BG_QA, (int)input_row);
     printf("%s", prompt);
@@ -485,6 +893,7 @@ static int menu_input(const char *prompt, char *buf, uint8_t maxlen)
     rep_last  = 0;
 
     for (k = 0u; k < KEYBOARD_BYTES; k++) prev_ks[k] = keystates[k];
+    shadow_fill(MENU_SHADOW, TEXT_COLS, 0u);   /* the prompt covers the menu row */
 
     /* draw prompt + input field in one row */
     printf("\033[%d;1H", (int)input_row);
@@ -594,49 +1003,39 @@ static int menu_input(const char *prompt, char *buf, uint8_t maxlen)
     return result;
 }
 
-/* Returns one past the last non-space byte in the given XRAM row (0..TEXT_COLS). */
-static uint8_t line_text_len(uint8_t row)
+/* Returns the text length of a row (0..TEXT_COLS); the store keeps no trailing spaces. */
+static uint8_t line_text_len(uint16_t row)
 {
-    uint8_t j, last = 0u;
-    RIA.addr1 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS;
-    RIA.step1 = 1;
-    for (j = 0u; j < TEXT_COLS; j++) {
-        if ((char)RIA.rw1 != ' ') last = j + 1u;
-    }
-    return last;
+    if (row >= content_rows) return 0u;
+    return (uint8_t)(line_end(row) - idx_get(row));
 }
 
 /* ================================================================
-   editor_clear: fills XRAM text buffer with spaces and clears
-   the terminal display.
+   editor_clear: empties the text store and clears the terminal
+   display.
    ================================================================ */
 static void editor_clear(void)
 {
-    uint16_t i;
-
-    RIA.addr0 = TEXT_BUF_BASE;
-    RIA.step0 = 1;
-    for (i = 0u; i < 20480u; i++) RIA.rw0 = ' ';
-
-    printf(ANSI_HIDE_CUR ANSI_CLS ANSI_HOME);
+    store_clear();
+    screen_clear();
 
     cur.row      = 0u;
     cur.col      = 0u;
     scroll_row   = 0u;
-    content_rows = 0u;
     sel_active   = 0u;
     doc_dirty    = 0u;
 }
 
 /* ================================================================
-   load_file: reads text file into XRAM text buffer.
+   load_file: reads text file into the text store. Lines are cut at
+   TEXT_COLS; reading stops when the store is full.
    ================================================================ */
 static int load_file(const char *filename)
 {
     int      fd, nbytes;
-    uint16_t row;
-    uint8_t  col, bi, n, need_addr, stop;
+    uint8_t  col, bi, n, stop;
     char     c;
+    char     line[TEXT_COLS];
 
     fd = open(filename, O_RDONLY);
     if (fd < 0) {
@@ -646,22 +1045,22 @@ static int load_file(const char *filename)
         editor_clear();
         strncpy(current_filename, filename, 63u);
         current_filename[63] = 0;
-        content_rows = 0u;
         redraw_screen();
         return 0;
     }
 
     editor_clear();
-    row       = 0u;
-    col       = 0u;
-    need_addr = 1u;
-    stop      = 0u;
+    col  = 0u;
+    stop = 0u;
 
     for (;;) {
         if (stop) break;
         nbytes = read(fd, g_linebuf, 80);
         if (nbytes <= 0) {
-            if (col > 0u) row++;
+            if (col > 0u) {
+                while (col < TEXT_COLS) line[col++] = ' ';
+                line_insert(content_rows, line);
+            }
             break;
         }
         n = (uint8_t)nbytes;
@@ -669,25 +1068,18 @@ static int load_file(const char *filename)
             c = g_linebuf[bi];
             if (c == '\r') continue;
             if (c == '\n') {
-                row++;
-                col       = 0u;
-                need_addr = 1u;
-                if (row >= 256u) stop = 1u;
+                while (col < TEXT_COLS) line[col++] = ' ';
+                if (!line_insert(content_rows, line)) stop = 1u;
+                col = 0u;
             } else if (col < TEXT_COLS) {
-                if (need_addr) {
-                    RIA.addr0 = TEXT_BUF_BASE + row * TEXT_COLS;
-                    RIA.step0 = 1;
-                    need_addr = 0u;
-                }
-                RIA.rw0 = (uint8_t)c;
-                col++;
+                line[col++] = c;
             }
         }
     }
 
     close(fd);
+    store_full = 0u;
 
-    content_rows = row;
     strncpy(current_filename, filename, 63u);
     current_filename[63] = 0;
     cur.row    = 0u;
@@ -699,7 +1091,7 @@ static int load_file(const char *filename)
 }
 
 /* ================================================================
-   save_file: writes XRAM text buffer to file, trimming trailing spaces.
+   save_file: writes the text store to file, one line per row.
    ================================================================ */
 static int save_file(const char *filename)
 {
@@ -711,13 +1103,7 @@ static int save_file(const char *filename)
     if (fd < 0) return -1;
 
     for (row = 0u; row < content_rows; row++) {
-        RIA.addr1 = TEXT_BUF_BASE + row * TEXT_COLS;
-        RIA.step1 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) g_linebuf[j] = (char)RIA.rw1;
-
-        len = TEXT_COLS;
-        while (len > 0u && g_linebuf[len - 1u] == ' ') len--;
-
+        len = line_get(row, g_linebuf);
         g_linebuf[len] = '\n';
         /* copy to XRAM scratch, then write via write_xram (write() is hijacked to UART) */
         RIA.addr0 = XRAM_SCRATCH;
@@ -733,7 +1119,7 @@ static int save_file(const char *filename)
 }
 
 /* ================================================================
-   find_text: searches XRAM buffer for pattern from one position past
+   find_text: searches the text store for pattern from one position past
    cursor. Highlights match with reverse video and scrolls.
    ================================================================ */
 static int find_text(const char *pattern)
@@ -741,7 +1127,6 @@ static int find_text(const char *pattern)
     uint8_t  plen, i, col, match;
     uint16_t row, start_row;
     uint8_t  start_col;
-    uint8_t  disp_row;
 
     plen = (uint8_t)strlen(pattern);
     if (plen == 0u || plen > TEXT_COLS) return 0;
@@ -755,9 +1140,7 @@ static int find_text(const char *pattern)
     }
 
     for (row = start_row; row < content_rows; row++) {
-        RIA.addr1 = TEXT_BUF_BASE + row * TEXT_COLS;
-        RIA.step1 = 1;
-        for (i = 0u; i < TEXT_COLS; i++) g_linebuf[i] = (char)RIA.rw1;
+        line_get(row, g_linebuf);
 
         col = (row == start_row) ? start_col : 0u;
 
@@ -767,21 +1150,20 @@ static int find_text(const char *pattern)
                 if (g_linebuf[(uint8_t)(col + i)] != pattern[i]) { match = 0u; break; }
             }
             if (match) {
-                cur.row = (uint8_t)row;
+                cur.row = row;
                 cur.col = col;
 
                 /* scroll so found line appears near center */
-                if ((uint16_t)row > (uint16_t)(EDIT_ROWS / 2u)) {
-                    scroll_row = (uint8_t)(row - EDIT_ROWS / 2u);
+                if (row > (uint16_t)(EDIT_ROWS / 2u)) {
+                    scroll_row = row - EDIT_ROWS / 2u;
                     if (content_rows > EDIT_ROWS &&
-                        scroll_row > (uint8_t)(content_rows - EDIT_ROWS))
-                        scroll_row = (uint8_t)(content_rows - EDIT_ROWS);
+                        scroll_row > content_rows - EDIT_ROWS)
+                        scroll_row = content_rows - EDIT_ROWS;
                 } else {
                     scroll_row = 0u;
                 }
 
                 redraw_screen();
-                printf("\033[%d;%dH", (int)(disp_row + 1u + TITLE_ROWS), (int)(col + 1u));
                 return 1;
             }
         }
@@ -790,115 +1172,48 @@ static int find_text(const char *pattern)
 }
 
 /* ================================================================
-   line_shift_right: shifts chars at positions col..78 one slot right.
-   ================================================================ */
-static void line_shift_right(uint8_t row, uint8_t col)
-{
-    uint8_t i, n;
-
-    n = (uint8_t)(79u - col);
-    if (n == 0u) return;
-
-    RIA.addr1 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS + col;
-    RIA.step1 = 1;
-    for (i = 0u; i < n; i++) g_linebuf[i] = (char)RIA.rw1;
-
-    RIA.addr0 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS + col + 1u;
-    RIA.step0 = 1;
-    for (i = 0u; i < n; i++) RIA.rw0 = (uint8_t)g_linebuf[i];
-}
-
-/* ================================================================
-   line_shift_left: shifts chars at positions from_col..79 one slot left.
-   ================================================================ */
-static void line_shift_left(uint8_t row, uint8_t from_col)
-{
-    uint8_t i, n;
-
-    if (from_col == 0u) return;
-    n = (uint8_t)(80u - from_col);
-
-    RIA.addr1 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS + from_col;
-    RIA.step1 = 1;
-    for (i = 0u; i < n; i++) g_linebuf[i] = (char)RIA.rw1;
-
-    RIA.addr0 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS + from_col - 1u;
-    RIA.step0 = 1;
-    for (i = 0u; i < n; i++) RIA.rw0 = (uint8_t)g_linebuf[i];
-
-    /* clear last position */
-    RIA.addr0 = TEXT_BUF_BASE + (uint16_t)row * TEXT_COLS + 79u;
-    RIA.step0 = 0;
-    RIA.rw0   = ' ';
-}
-
-/* ================================================================
-   rows_shift_down: moves rows [from_row .. content_rows-1] one slot
-   down in XRAM (row by row, bottom-up), then clears from_row.
-   Caller must have checked content_rows < 255 before calling.
+   line_put_char: writes ch at col of a row; with shift the chars at
+   col..78 first move one slot right. Returns 0 if the store is full.
    ================================================================ */
-static void rows_shift_down(uint8_t from_row)
+static uint8_t line_put_char(uint16_t row, uint8_t col, char ch, uint8_t shift)
 {
-    uint16_t r;
-    uint8_t  j;
-
-    /* copy bottom-up so we don't overwrite source before reading it */
-    for (r = (uint16_t)content_rows; r > (uint16_t)from_row; r--) {
-        RIA.addr1 = TEXT_BUF_BASE + (r - 1u) * TEXT_COLS;
-        RIA.step1 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) g_linebuf[j] = (char)RIA.rw1;
-        RIA.addr0 = TEXT_BUF_BASE + r * TEXT_COLS;
-        RIA.step0 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = (uint8_t)g_linebuf[j];
-    }
+    uint8_t i;
 
-    /* clear the newly freed row */
-    RIA.addr0 = TEXT_BUF_BASE + (uint16_t)from_row * TEXT_COLS;
-    RIA.step0 = 1;
-    for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = ' ';
+    line_get(row, g_linebuf);
+    if (shift)
+        for (i = TEXT_COLS - 1u; i > col; i--) g_linebuf[i] = g_linebuf[i - 1u];
+    g_linebuf[col] = ch;
+    return line_put(row, g_linebuf);
 }
 
 /* ================================================================
-   rows_shift_up: moves rows [from_row+1 .. content_rows-1] one slot
-   up in XRAM, then clears the last row, decrements content_rows.
+   line_remove: removes n chars at col of a row, the rest of the row
+   moves left.
    ================================================================ */
-static void rows_shift_up(uint8_t from_row)
+static void line_remove(uint16_t row, uint8_t col, uint8_t n)
 {
-    uint16_t r;
-    uint8_t  j;
-
-    for (r = (uint16_t)from_row + 1u; r < (uint16_t)content_rows; r++) {
-        RIA.addr1 = TEXT_BUF_BASE + r * TEXT_COLS;
-        RIA.step1 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) g_linebuf[j] = (char)RIA.rw1;
-        RIA.addr0 = TEXT_BUF_BASE + (r - 1u) * TEXT_COLS;
-        RIA.step0 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = (uint8_t)g_linebuf[j];
-    }
+    uint8_t i;
 
-    /* clear the vacated last row */
-    if (content_rows > 0u) {
-        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)(content_rows - 1u) * TEXT_COLS;
-        RIA.step0 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = ' ';
-        content_rows--;
-    }
+    line_get(row, g_linebuf);
+    for (i = col; (uint16_t)i + n < TEXT_COLS; i++) g_linebuf[i] = g_linebuf[i + n];
+    for (; i < TEXT_COLS; i++) g_linebuf[i] = ' ';
+    line_put(row, g_linebuf);
 }
 
 /* ================================================================
    do_backspace_join: join current row onto end of previous row.
    The text of current row is appended (starting at prev row's text
-   length), then current row is removed by shifting rows up.
+   length), then current row is removed from the store.
    Cursor moves to the join point on the previous row.
    ================================================================ */
 static void do_backspace_join(void)
 {
-    uint8_t prev_len, cur_len, j, write_col;
-    char    cur_line[80];
+    uint8_t prev_len, cur_len, j;
+    char    cur_line[TEXT_COLS];
 
     if (cur.row == 0u) return;
 
-    prev_len = line_text_len((uint8_t)(cur.row - 1u));
+    prev_len = line_text_len(cur.row - 1u);
     cur_len  = line_text_len(cur.row);
 
     /* if merged text would exceed one row, only move cursor — don't destroy data */
@@ -911,22 +1226,14 @@ static void do_backspace_join(void)
     }
 
     /* safe to merge: append current row text to previous row */
-    if (cur_len > 0u) {
-        RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-        RIA.step1 = 1;
-        for (j = 0u; j < cur_len; j++) cur_line[j] = (char)RIA.rw1;
-    }
-
-    write_col = prev_len;
-    for (j = 0u; j < cur_len; j++, write_col++) {
-        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)(cur.row - 1u) * TEXT_COLS + write_col;
-        RIA.step0 = 0;
-        RIA.rw0   = (uint8_t)cur_line[j];
-    }
+    line_get(cur.row, cur_line);
+    line_get(cur.row - 1u, g_linebuf);
+    for (j = 0u; j < cur_len; j++) g_linebuf[prev_len + j] = cur_line[j];
 
     cur.row--;
     cur.col = prev_len;
-    rows_shift_up(cur.row + 1u);
+    line_put(cur.row, g_linebuf);
+    line_delete(cur.row + 1u);
     if (cur.row < scroll_row) scroll_row = cur.row;
     redraw_screen();
 }
@@ -934,84 +1241,61 @@ static void do_backspace_join(void)
 /* ================================================================
    do_delete_join: Delete at end of a row — join next row onto current.
    Mirror of do_backspace_join: next row's text is appended to current
-   row starting at cur_len, then next row is removed by shifting up.
+   row starting at cur_len, then next row is removed from the store.
    Cursor stays at cur.col. If combined length > TEXT_COLS, do nothing.
    ================================================================ */
 static void do_delete_join(void)
 {
-    uint8_t cur_len, next_len, j, write_col;
-    char    next_line[80];
+    uint8_t cur_len, next_len, j;
+    char    next_line[TEXT_COLS];
 
     if (cur.row >= content_rows) return;
 
     cur_len  = line_text_len(cur.row);
-    next_len = line_text_len((uint8_t)(cur.row + 1u));
+    next_len = line_text_len(cur.row + 1u);
 
     if ((uint16_t)cur_len + next_len > (uint16_t)TEXT_COLS) return;
 
-    if (next_len > 0u) {
-        RIA.addr1 = TEXT_BUF_BASE + (uint16_t)(cur.row + 1u) * TEXT_COLS;
-        RIA.step1 = 1;
-        for (j = 0u; j < next_len; j++) next_line[j] = (char)RIA.rw1;
-    }
-
-    write_col = cur_len;
-    for (j = 0u; j < next_len; j++, write_col++) {
-        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + write_col;
-        RIA.step0 = 0;
-        RIA.rw0   = (uint8_t)next_line[j];
-    }
+    line_get(cur.row + 1u, next_line);
+    line_get(cur.row, g_linebuf);
+    for (j = 0u; j < next_len; j++) g_linebuf[cur_len + j] = next_line[j];
 
-    rows_shift_up((uint8_t)(cur.row + 1u));
+    line_put(cur.row, g_linebuf);
+    line_delete(cur.row + 1u);
     redraw_screen();
 }
 
 /* ================================================================
    do_enter: split current row at cur.col.
-   Text from cur.col..79 of current row moves to start of next row;
-   all rows below shift down by one.
+   Text from cur.col..79 of current row moves to a new row inserted
+   below it.
    ================================================================ */
 static void do_enter(void)
 {
-    uint8_t tail_len, j;
-    char    tail[80];
+    uint8_t j;
+    char    tail[TEXT_COLS];
 
-    if (cur.row >= 255u) return;
+    if (content_rows >= MAX_LINES) { store_full = 1u; return; }
 
-    /* save tail (text after cursor on this row) */
-    tail_len = 0u;
-    if (cur.col < TEXT_COLS) {
-        RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-        RIA.step1 = 1;
-        for (j = cur.col; j < TEXT_COLS; j++) {
-            char c = (char)RIA.rw1;
-            tail[tail_len++] = c ? c : ' ';
-        }
-        /* trim trailing spaces from tail */
-        while (tail_len > 0u && tail[tail_len - 1u] == ' ') tail_len--;
+    /* split the row: the tail moves out, so the new row always fits */
+    line_get(cur.row, g_linebuf);
+    for (j = 0u; j < TEXT_COLS; j++) tail[j] = ' ';
+    for (j = cur.col; j < TEXT_COLS; j++) {
+        tail[j - cur.col] = g_linebuf[j];
+        g_linebuf[j]      = ' ';
     }
-
-    /* erase tail from current row */
-    RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-    RIA.step0 = 1;
-    for (j = cur.col; j < TEXT_COLS; j++) RIA.rw0 = ' ';
-
-    /* shift all rows below current row down by one */
-    rows_shift_down((uint8_t)(cur.row + 1u));
-    content_rows++;
-
-    /* write tail at start of new row */
-    if (tail_len > 0u) {
-        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)(cur.row + 1u) * TEXT_COLS;
-        RIA.step0 = 1;
-        for (j = 0u; j < tail_len; j++) RIA.rw0 = (uint8_t)tail[j];
+    if (cur.row < content_rows) {
+        line_put(cur.row, g_linebuf);
+        line_insert(cur.row + 1u, tail);
+    } else {
+        line_touch(cur.row);
     }
 
     /* advance cursor */
     cur.row++;
     cur.col = 0u;
-    if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS)
-        scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+    if (cur.row - scroll_row >= EDIT_ROWS)
+        scroll_row = cur.row - EDIT_ROWS + 1u;
 
     redraw_screen();
 }
@@ -1019,8 +1303,8 @@ static void do_enter(void)
 /* ================================================================
    sel_min_row / sel_max_row: first and last selected row (anchor..cursor).
    ================================================================ */
-static uint8_t sel_min_row(void) { return sel_row < cur.row ? sel_row : cur.row; }
-static uint8_t sel_max_row(void) { return sel_row > cur.row ? sel_row : cur.row; }
+static uint16_t sel_min_row(void) { return sel_row < cur.row ? sel_row : cur.row; }
+static uint16_t sel_max_row(void) { return sel_row > cur.row ? sel_row : cur.row; }
 
 /* ================================================================
    do_copy: copies selected rows (or current row) into XRAM clipboard.
@@ -1028,7 +1312,8 @@ static uint8_t sel_max_row(void) { return sel_row > cur.row ? sel_row : cur.row;
    ================================================================ */
 static void do_copy(void)
 {
-    uint8_t r, j, from, to;
+    uint8_t  r, j;
+    uint16_t from, to, n;
 
     if (sel_active && sel_mode == SEL_MODE_CHAR) {
         uint8_t c_from = (sel_col < cur.col) ? sel_col : cur.col;
@@ -1037,14 +1322,10 @@ static void do_copy(void)
         if (len == 0u) { sel_active = 0u; return; }
         clip_lines   = 1u;
         clip_is_char = 1u;
+        line_get(cur.row, g_linebuf);
         RIA.addr0 = CLIP_BUF_BASE; RIA.step0 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = ' ';
-        RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + c_from;
-        RIA.step1 = 1;
-        for (j = 0u; j < len; j++) {
-            RIA.addr0 = CLIP_BUF_BASE + j; RIA.step0 = 0;
-            RIA.rw0   = RIA.rw1;
-        }
+        for (j = 0u; j < TEXT_COLS; j++)
+            RIA.rw0 = (uint8_t)(j < len ? g_linebuf[c_from + j] : ' ');
         sel_active = 0u;
         redraw_screen();
         draw_menu_bar("SELECTED COPIED TO CLIPBOARD");
@@ -1054,20 +1335,17 @@ static void do_copy(void)
     clip_is_char = 0u;
     from = sel_active ? sel_min_row() : cur.row;
     to   = sel_active ? sel_max_row() : cur.row;
-    if (to >= (uint8_t)content_rows) to = (uint8_t)(content_rows > 0u ? content_rows - 1u : 0u);
+    if (to >= content_rows) to = content_rows > 0u ? content_rows - 1u : 0u;
 
-    clip_lines = (uint8_t)(to - from + 1u);
-    if (clip_lines > CLIP_MAX_LINES) clip_lines = (uint8_t)CLIP_MAX_LINES;
+    n = (to >= from) ? to - from + 1u : 0u;
+    if (n > CLIP_MAX_LINES) n = CLIP_MAX_LINES;
+    clip_lines = (uint8_t)n;
 
     for (r = 0u; r < clip_lines; r++) {
-        RIA.addr1 = TEXT_BUF_BASE + (uint16_t)(from + r) * TEXT_COLS;
-        RIA.step1 = 1;
+        line_get(from + r, g_linebuf);
         RIA.addr0 = CLIP_BUF_BASE + (uint16_t)r * TEXT_COLS;
-        RIA.step0 = 0;
-        for (j = 0u; j < TEXT_COLS; j++) {
-            RIA.addr0 = CLIP_BUF_BASE + (uint16_t)r * TEXT_COLS + j;
-            RIA.rw0   = RIA.rw1;
-        }
+        RIA.step0 = 1;
+        for (j = 0u; j < TEXT_COLS; j++) RIA.rw0 = (uint8_t)g_linebuf[j];
     }
 
     sel_active = 0u;
@@ -1080,16 +1358,15 @@ static void do_copy(void)
    ================================================================ */
 static void do_cut(void)
 {
-    uint8_t from, to, n, i;
+    uint16_t from, to, n, i;
 
     if (sel_active && sel_mode == SEL_MODE_CHAR) {
         uint8_t c_from = (sel_col < cur.col) ? sel_col : cur.col;
         uint8_t c_to   = (sel_col > cur.col) ? sel_col : cur.col;
         uint8_t len    = (uint8_t)(c_to - c_from);
-        uint8_t j;
         if (len == 0u) { sel_active = 0u; return; }
         do_copy();   /* clears sel_active */
-        for (j = 0u; j < len; j++) line_shift_left(cur.row, (uint8_t)(c_from + 1u));
+        line_remove(cur.row, c_from, len);
         cur.col = c_from;
         redraw_screen();
         draw_menu_bar("SELECTED CUT TO CLIPBOARD");
@@ -1098,17 +1375,17 @@ static void do_cut(void)
 
     from = sel_active ? sel_min_row() : cur.row;
     to   = sel_active ? sel_max_row() : cur.row;
-    if (to >= (uint8_t)content_rows) to = (uint8_t)(content_rows > 0u ? content_rows - 1u : 0u);
-    n    = (uint8_t)(to - from + 1u);
+    if (to >= content_rows) to = content_rows > 0u ? content_rows - 1u : 0u;
+    n    = (to >= from) ? to - from + 1u : 0u;
 
     do_copy();   /* saves sel_active; clears it after */
 
-    /* shift rows up n times starting from 'from' */
-    for (i = 0u; i < n; i++) rows_shift_up(from);
+    /* remove n rows starting from 'from' */
+    for (i = 0u; i < n; i++) line_delete(from);
 
     cur.row = from;
-    if (cur.row >= (uint8_t)content_rows && content_rows > 0u)
-        cur.row = (uint8_t)(content_rows - 1u);
+    if (cur.row >= content_rows && content_rows > 0u)
+        cur.row = content_rows - 1u;
     cur.col = 0u;
     if (cur.row < scroll_row) scroll_row = cur.row;
 
@@ -1121,34 +1398,28 @@ static void do_cut(void)
    ================================================================ */
 static void do_paste(void)
 {
-    uint8_t r, j, start_row;
+    uint8_t  r, j;
+    uint16_t start_row;
 
     if (clip_lines == 0u) return;
 
     if (clip_is_char) {
-        uint8_t len, cur_len;
-        len = 0u;
-        for (j = 0u; j < TEXT_COLS; j++) {
-            RIA.addr1 = CLIP_BUF_BASE + j; RIA.step1 = 0;
-            if ((char)RIA.rw1 != ' ') len = (uint8_t)(j + 1u);
-        }
+        uint8_t len, cur_len, i;
+        char    clip[TEXT_COLS];
+        RIA.addr1 = CLIP_BUF_BASE; RIA.step1 = 1;
+        for (j = 0u; j < TEXT_COLS; j++) clip[j] = (char)RIA.rw1;
+        len     = row_trim(clip);
         cur_len = line_text_len(cur.row);
+        line_get(cur.row, g_linebuf);
         for (j = 0u; j < len; j++) {
-            if ((uint16_t)cur_len + 1u <= (uint16_t)TEXT_COLS) {
-                line_shift_right(cur.row, cur.col);
-                { uint8_t ch;
-                  RIA.addr1 = CLIP_BUF_BASE + j; RIA.step1 = 0;
-                  ch = RIA.rw1;
-                  RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                  RIA.step0 = 0;
-                  RIA.rw0   = ch;
-                }
+            if (cur_len < TEXT_COLS && cur.col < TEXT_COLS) {
+                for (i = TEXT_COLS - 1u; i > cur.col; i--) g_linebuf[i] = g_linebuf[i - 1u];
+                g_linebuf[cur.col] = clip[j];
                 cur.col++;
                 cur_len++;
             }
         }
-        if ((uint16_t)(cur.row + 1u) > content_rows)
-            content_rows = (uint16_t)(cur.row + 1u);
+        line_put(cur.row, g_linebuf);
         redraw_screen();
         draw_menu_bar("CLIPBOARD PASTED");
         return;
@@ -1156,16 +1427,10 @@ static void do_paste(void)
 
     start_row = cur.row;
     for (r = 0u; r < clip_lines; r++) {
-        if (content_rows >= 255u) break;
-        rows_shift_down((uint8_t)(start_row + r));
-        content_rows++;
-        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)(start_row + r) * TEXT_COLS;
-        RIA.step0 = 1;
-        for (j = 0u; j < TEXT_COLS; j++) {
-            RIA.addr1 = CLIP_BUF_BASE + (uint16_t)r * TEXT_COLS + j;
-            RIA.step1 = 0;
-            RIA.rw0   = RIA.rw1;
-        }
+        RIA.addr1 = CLIP_BUF_BASE + (uint16_t)r * TEXT_COLS;
+        RIA.step1 = 1;
+        for (j = 0u; j < TEXT_COLS; j++) g_linebuf[j] = (char)RIA.rw1;
+        if (!line_insert(start_row + r, g_linebuf)) break;
     }
 
     cur.row = start_row;
@@ -1185,7 +1450,7 @@ int main(int argc, char **argv)
     bool    did_action;
     uint8_t k, j, new_key, new_keys, last_key;
     uint8_t key_capslock, key_shifts, key_ctrl, key_ralt, key_lalt;
-    uint8_t max_scroll;
+    uint16_t max_scroll;
     int     ok;
     char    ch;
     uint8_t repeat_key;
@@ -1197,7 +1462,6 @@ int main(int argc, char **argv)
     cur.col             = 0u;
     current_filename[0] = 0;
     search_pattern[0]   = 0;
-    content_rows        = 0u;
     scroll_row          = 0u;
     last_key            = 0u;
     handled_key         = false;
@@ -1216,6 +1480,8 @@ int main(int argc, char **argv)
     repeat_start        = 0;
     repeat_last         = 0;
     target_col          = 0u;
+    store_clear();
+    screen_clear();
 
     flush_rx();
     xreg_ria_keyboard(XRAM_STRUCT_SYS_KEYBOARD);
@@ -1272,14 +1538,14 @@ int main(int argc, char **argv)
                 /* scroll up */
                 if (scroll_row > 0u) {
                     scroll_row--;
-                    if (cur.row >= (uint8_t)(scroll_row + EDIT_ROWS))
-                        cur.row = (uint8_t)(scroll_row + EDIT_ROWS - 1u);
+                    if (cur.row >= scroll_row + EDIT_ROWS)
+                        cur.row = scroll_row + EDIT_ROWS - 1u;
                     redraw_screen();
                 }
             } else {
                 /* scroll down */
                 max_scroll = (content_rows > (uint16_t)EDIT_ROWS)
-                             ? (uint8_t)(content_rows - EDIT_ROWS) : 0u;
+                             ? content_rows - EDIT_ROWS : 0u;
                 if (scroll_row < max_scroll) {
                     scroll_row++;
                     if (cur.row < scroll_row)
@@ -1475,8 +1741,8 @@ int main(int argc, char **argv)
                               cur.row++;
                               cur.col = 0u;
                               if (cur.row != sel_row) sel_active = 0u;
-                              if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS)
-                                  scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+                              if (cur.row - scroll_row >= EDIT_ROWS)
+                                  scroll_row = cur.row - EDIT_ROWS + 1u;
                           }
                         }
                         target_col = cur.col;
@@ -1490,8 +1756,8 @@ int main(int argc, char **argv)
                           } else if ((uint16_t)cur.row < content_rows) {
                               cur.row++;
                               cur.col = 0u;
-                              if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS) {
-                                  scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+                              if (cur.row - scroll_row >= EDIT_ROWS) {
+                                  scroll_row = cur.row - EDIT_ROWS + 1u;
                                   redraw_screen();
                               }
                           }
@@ -1538,8 +1804,8 @@ int main(int argc, char **argv)
                                             ? line_text_len(cur.row) : 0u;
                               cur.col = (target_col <= lim) ? target_col : lim;
                             }
-                            if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS)
-                                scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+                            if (cur.row - scroll_row >= EDIT_ROWS)
+                                scroll_row = cur.row - EDIT_ROWS + 1u;
                         }
                         redraw_screen();
                     } else {
@@ -1552,8 +1818,8 @@ int main(int argc, char **argv)
                                             ? line_text_len(cur.row) : 0u;
                               cur.col = (target_col <= lim) ? target_col : lim;
                             }
-                            if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS) {
-                                scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+                            if (cur.row - scroll_row >= EDIT_ROWS) {
+                                scroll_row = cur.row - EDIT_ROWS + 1u;
                                 redraw_screen();
                             }
                         }
@@ -1568,10 +1834,10 @@ int main(int argc, char **argv)
 
                 } else if (key_ctrl && key_shifts && key(KEY_END)) {
                     repeat_key = 0u;
-                    cur.row    = (content_rows > 0u) ? (uint8_t)(content_rows - 1u) : 0u;
+                    cur.row    = (content_rows > 0u) ? content_rows - 1u : 0u;
                     cur.col    = line_text_len(cur.row);
                     if (content_rows > (uint16_t)EDIT_ROWS)
-                        scroll_row = (uint8_t)(content_rows - EDIT_ROWS);
+                        scroll_row = content_rows - EDIT_ROWS;
                     else
                         scroll_row = 0u;
                     redraw_screen();
@@ -1585,8 +1851,8 @@ int main(int argc, char **argv)
                     cur.col = line_text_len(cur.row);
 
                 } else if (key(KEY_PAGEUP)) {
-                    if (cur.row >= (uint8_t)EDIT_ROWS) {
-                        cur.row -= (uint8_t)EDIT_ROWS;
+                    if (cur.row >= EDIT_ROWS) {
+                        cur.row -= EDIT_ROWS;
                     } else {
                         cur.row = 0u;
                     }
@@ -1597,12 +1863,12 @@ int main(int argc, char **argv)
 
                 } else if (key(KEY_PAGEDOWN)) {
                     if ((uint16_t)cur.row + (uint16_t)EDIT_ROWS < (uint16_t)content_rows) {
-                        cur.row += (uint8_t)EDIT_ROWS;
+                        cur.row += EDIT_ROWS;
                     } else {
-                        cur.row = (content_rows > 0u) ? (uint8_t)(content_rows - 1u) : 0u;
+                        cur.row = (content_rows > 0u) ? content_rows - 1u : 0u;
                     }
-                    if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS) {
-                        scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
+                    if (cur.row - scroll_row >= EDIT_ROWS) {
+                        scroll_row = cur.row - EDIT_ROWS + 1u;
                         redraw_screen();
                     }
 
@@ -1615,27 +1881,8 @@ int main(int argc, char **argv)
                     if (view_mode) { /* no-op */ } else
                     if (cur.col > 0u) {
                         cur.col--;
-                        if (insert_mode) {
-                            line_shift_left(cur.row, (uint8_t)(cur.col + 1u));
-                        } else {
-                            RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                            RIA.step0 = 0;
-                            RIA.rw0   = ' ';
-                        }
-                        /* redraw current line */
-                        {
-                            uint8_t j2;
-                            RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step1 = 1;
-                            for (j2 = 0u; j2 < TEXT_COLS; j2++) {
-                                char c = (char)RIA.rw1;
-                                g_linebuf[j2] = c ? c : ' ';
-                            }
-                            printf("\033[%d;1H",
-                                   (int)((cur.row - scroll_row) + 1u + TITLE_ROWS));
-                            for (j2 = 0u; j2 < TEXT_COLS; j2++)
-                                putchar((uint8_t)g_linebuf[j2]);
-                        }
+                        if (insert_mode) line_remove(cur.row, cur.col, 1u);
+                        else             line_put_char(cur.row, cur.col, ' ', 0u);
                     } else if (cur.row > 0u) {
                         /* at col 0: join this row onto end of previous row */
                         do_backspace_join();
@@ -1647,22 +1894,8 @@ int main(int argc, char **argv)
                     if (!view_mode) {
                         uint8_t cur_text_len = line_text_len(cur.row);
                         if (cur.col < cur_text_len) {
-                            /* delete char at cursor: shift row left from col+1 */
-                            line_shift_left(cur.row, (uint8_t)(cur.col + 1u));
-                            /* redraw current line */
-                            {
-                                uint8_t j2;
-                                RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                                RIA.step1 = 1;
-                                for (j2 = 0u; j2 < TEXT_COLS; j2++) {
-                                    char c = (char)RIA.rw1;
-                                    g_linebuf[j2] = c ? c : ' ';
-                                }
-                                printf("\033[%d;1H",
-                                       (int)((cur.row - scroll_row) + 1u + TITLE_ROWS));
-                                for (j2 = 0u; j2 < TEXT_COLS; j2++)
-                                    putchar((uint8_t)g_linebuf[j2]);
-                            }
+                            /* delete char at cursor: rest of row moves left */
+                            line_remove(cur.row, cur.col, 1u);
                         } else if (cur.row < content_rows) {
                             /* at end of line: join next row onto current */
                             do_delete_join();
@@ -1708,22 +1941,12 @@ int main(int argc, char **argv)
                                     dt_tm->tm_mday, dt_tm->tm_hour, dt_tm->tm_min);
                             for (di = 0u; dt_buf[di]; di++) {
                                 uint8_t dch = (uint8_t)dt_buf[di];
-                                if (insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u))
-                                    line_shift_right(cur.row, cur.col);
-                                RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                                RIA.step0 = 0;
-                                RIA.rw0   = dch;
-                                printf("\033[%d;%dH%c",
-                                       (int)((cur.row - scroll_row) + 1u + TITLE_ROWS),
-                                       (int)(cur.col + 1u), (char)dch);
-                                if (cur.col < (uint8_t)(TEXT_COLS - 1u)) {
-                                    cur.col++;
-                                    if ((uint16_t)(cur.row + 1u) > content_rows)
-                                        content_rows = (uint16_t)(cur.row + 1u);
-                                }
+                                if (!line_put_char(cur.row, cur.col, (char)dch,
+                                                   insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u)))
+                                    break;
+                                if (cur.col < (uint8_t)(TEXT_COLS - 1u)) cur.col++;
                             }
                             doc_dirty = 1u;
-                            if (insert_mode) redraw_screen();
                         }
                     }
 
@@ -1734,9 +1957,7 @@ int main(int argc, char **argv)
                         uint8_t tlen, pad, i;
                         tlen = line_text_len(cur.row);
                         if (tlen > 0u && tlen <= TEXT_COLS) {
-                            RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step1 = 1;
-                            for (i = 0u; i < TEXT_COLS; i++) g_linebuf[i] = (char)RIA.rw1;
+                            line_get(cur.row, g_linebuf);
                             /* strip leading spaces into g_linebuf[0..tlen-1] */
                             { uint8_t s = 0u;
                               while (s < tlen && g_linebuf[s] == ' ') s++;
@@ -1746,11 +1967,10 @@ int main(int argc, char **argv)
                               }
                             }
                             pad = (uint8_t)((TEXT_COLS - tlen) / 2u);
-                            RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step0 = 1;
-                            for (i = 0u; i < pad; i++)   RIA.rw0 = ' ';
-                            for (i = 0u; i < tlen; i++)  RIA.rw0 = (uint8_t)g_linebuf[i];
-                            for (i = (uint8_t)(pad + tlen); i < TEXT_COLS; i++) RIA.rw0 = ' ';
+                            for (i = tlen; i > 0u; i--)  g_linebuf[pad + i - 1u] = g_linebuf[i - 1u];
+                            for (i = 0u; i < pad; i++)   g_linebuf[i] = ' ';
+                            for (i = (uint8_t)(pad + tlen); i < TEXT_COLS; i++) g_linebuf[i] = ' ';
+                            line_put(cur.row, g_linebuf);
                             doc_dirty = 1u;
                             redraw_screen();
                         }
@@ -1762,9 +1982,7 @@ int main(int argc, char **argv)
                         uint8_t tlen, pad, i;
                         tlen = line_text_len(cur.row);
                         if (tlen > 0u && tlen <= TEXT_COLS) {
-                            RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step1 = 1;
-                            for (i = 0u; i < TEXT_COLS; i++) g_linebuf[i] = (char)RIA.rw1;
+                            line_get(cur.row, g_linebuf);
                             /* strip leading spaces */
                             { uint8_t s = 0u;
                               while (s < tlen && g_linebuf[s] == ' ') s++;
@@ -1774,10 +1992,9 @@ int main(int argc, char **argv)
                               }
                             }
                             pad = (uint8_t)(TEXT_COLS - tlen);
-                            RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step0 = 1;
-                            for (i = 0u; i < pad; i++)  RIA.rw0 = ' ';
-                            for (i = 0u; i < tlen; i++) RIA.rw0 = (uint8_t)g_linebuf[i];
+                            for (i = tlen; i > 0u; i--) g_linebuf[pad + i - 1u] = g_linebuf[i - 1u];
+                            for (i = 0u; i < pad; i++)  g_linebuf[i] = ' ';
+                            line_put(cur.row, g_linebuf);
                             doc_dirty = 1u;
                             redraw_screen();
                         }
@@ -1789,17 +2006,14 @@ int main(int argc, char **argv)
                         uint8_t tlen, s, i;
                         tlen = line_text_len(cur.row);
                         if (tlen > 0u) {
-                            RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                            RIA.step1 = 1;
-                            for (i = 0u; i < TEXT_COLS; i++) g_linebuf[i] = (char)RIA.rw1;
+                            line_get(cur.row, g_linebuf);
                             s = 0u;
                             while (s < tlen && g_linebuf[s] == ' ') s++;
                             if (s > 0u) {
                                 tlen = (uint8_t)(tlen - s);
-                                RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS;
-                                RIA.step0 = 1;
-                                for (i = 0u; i < tlen; i++) RIA.rw0 = (uint8_t)g_linebuf[i + s];
-                                for (i = tlen; i < TEXT_COLS; i++) RIA.rw0 = ' ';
+                                for (i = 0u; i < tlen; i++) g_linebuf[i] = g_linebuf[i + s];
+                                for (i = tlen; i < TEXT_COLS; i++) g_linebuf[i] = ' ';
+                                line_put(cur.row, g_linebuf);
                                 if (cur.col < s) cur.col = 0u;
                                 else cur.col = (uint8_t)(cur.col - s);
                                 doc_dirty = 1u;
@@ -1876,23 +2090,11 @@ int main(int argc, char **argv)
                 /* --- Alt+P: insert paragraph sign § (0x15) --- */
                 } else if (key_lalt && key(KEY_P)) {
                     repeat_key = 0u;
-                    if (!view_mode) {
-                        uint8_t dch = 0x15u;
-                        if (insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u))
-                            line_shift_right(cur.row, cur.col);
-                        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                        RIA.step0 = 0;
-                        RIA.rw0   = dch;
-                        printf("\033[%d;%dH%c",
-                               (int)((cur.row - scroll_row) + 1u + TITLE_ROWS),
-                               (int)(cur.col + 1u), (char)dch);
-                        if (cur.col < (uint8_t)(TEXT_COLS - 1u)) {
-                            cur.col++;
-                            if ((uint16_t)(cur.row + 1u) > content_rows)
-                                content_rows = (uint16_t)(cur.row + 1u);
-                        }
+                    if (!view_mode &&
+                        line_put_char(cur.row, cur.col, (char)0x15u,
+                                      insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u))) {
+                        if (cur.col < (uint8_t)(TEXT_COLS - 1u)) cur.col++;
                         doc_dirty = 1u;
-                        if (insert_mode) redraw_screen();
                     }
 
                 /* --- Generic character input --- */
@@ -1900,60 +2102,33 @@ int main(int argc, char **argv)
                     ch = keycode_to_char(last_key, (uint8_t)(key_shifts && !key_ctrl),
                                          key_capslock, key_ralt);
                     if (!ch) did_action = false;
-                    if (ch && !view_mode) {
-                        if (insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u)) {
-                            line_shift_right(cur.row, cur.col);
-                        }
-                        RIA.addr0 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                        RIA.step0 = 0;
-                        RIA.rw0   = (uint8_t)ch;
+                    if (ch && !view_mode &&
+                        line_put_char(cur.row, cur.col, ch,
+                                      insert_mode && cur.col < (uint8_t)(TEXT_COLS - 1u))) {
                         doc_dirty = 1u;
 
-                        /* print char at terminal position */
-                        printf("\033[%d;%dH%c",
-                               (int)((cur.row - scroll_row) + 1u + TITLE_ROWS),
-                               (int)(cur.col + 1u),
-                               ch);
-
+                        /* the changed cells go out with the redraw below */
                         if (cur.col < (uint8_t)(TEXT_COLS - 1u)) {
                             cur.col++;
-
-                            /* redraw rest of line (insert mode shifts chars) */
-                            if (insert_mode) {
-                                uint8_t j2;
-                                RIA.addr1 = TEXT_BUF_BASE + (uint16_t)cur.row * TEXT_COLS + cur.col;
-                                RIA.step1 = 1;
-                                for (j2 = cur.col; j2 < TEXT_COLS; j2++) {
-                                    char c = (char)RIA.rw1;
-                                    putchar(c ? c : ' ');
-                                }
-                            }
-
-                            /* extend content tracking */
-                            if ((uint16_t)(cur.row + 1u) > content_rows)
-                                content_rows = (uint16_t)(cur.row + 1u);
-
-                        } else if (cur.row < 255u) {
+                        } else if (cur.row + 1u < MAX_LINES) {
                             /* last column reached — wrap to next row */
                             cur.row++;
                             cur.col = 0u;
-                            if ((uint16_t)(cur.row + 1u) > content_rows)
-                                content_rows = (uint16_t)(cur.row + 1u);
-                            if ((uint8_t)(cur.row - scroll_row) >= EDIT_ROWS) {
-                                scroll_row = (uint8_t)(cur.row - EDIT_ROWS + 1u);
-                                redraw_screen();
-                            }
+                            line_touch(cur.row);
+                            if (cur.row - scroll_row >= EDIT_ROWS)
+                                scroll_row = cur.row - EDIT_ROWS + 1u;
                         }
                     }
                 }
 
                 if (did_action) {
-                    /* position cursor after any key action */
-                    printf("\033[%d;%dH",
-                           (int)((cur.row - scroll_row) + 1u + TITLE_ROWS),
-                           (int)(cur.col + 1u));
+                    /* send what the action changed, reposition cursor */
                     handled_key = true;
-                    draw_menu_bar(NULL);
+                    redraw_screen();
+                    if (store_full) {
+                        draw_menu_bar(EXCLAMATION "document full");
+                        store_full = 0u;
+                    }
                 }
 
             }
@@ -1969,7 +2144,7 @@ int main(int argc, char **argv)
 
     xreg_vga_canvas(GFX_CANVAS_640x480);
     xreg(1, 0, 1, 0);
-    printf(CSI_CLS CSI_ECHO_ON CSI_CURSOR_SHOW CSI_CURSOR_HOME);
+    printf(CSI "r" CSI_CLS CSI_ECHO_ON CSI_CURSOR_SHOW CSI_CURSOR_HOME);
     return 0;
 
 }
@@ -4,6 +4,7 @@
 //
 
 #include "commons.h"
+#include "commons/redirect.h"
 
 #define APPVER "20260509.1524"
 
@@ -51,7 +52,7 @@ static bool pg_nl(void)
     char c;
     printf(NEWLINE);
     if (pg_quit) return false;
-    if (++pg_row < PAGE_LINES) return true;
+    if (++pg_row < PAGE_LINES || REDIR_OUT(REDIR)) return true;  /* no paging into a file */
     pg_row = 0;
     while (RX_READY) c = RIA.rx;               /* flush pending input */
     printf(ANSI_DARK_GRAY "--- more --- [q] quit" ANSI_RESET);
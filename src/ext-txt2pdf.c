@@ -1,7 +1,7 @@
 /*
  * ext-txt2pdf.c — plain-text to PDF converter for razemOS / Picocomputer 6502
  *
- * Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/n d|p]
+ * Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/n d|p] [/d]
  *   Formatting is always active based on file extension:
  *           .asm — lines starting with ';' printed in italic (Courier-Oblique)
  *           .txt/.md — lines starting with '#'/'##'/... printed as headings
@@ -9,27 +9,34 @@
  *   /s N  : set base font size in pt (default 10); affects char width, line height,
  *           and heading sizes (heading = base + hashes*2 pt)
  *   All margin arguments are optional; default = 20 mm each.
+ *   /d    : compress the streams (/FlateDecode, commons/deflate.h)
  *   Output: input name with extension replaced by .pdf (or .pdf appended).
  *
  * PDF format: PDF-1.4, A4 page, Courier (Base14 — no embedding needed).
  *
  * write() is hijacked to UART by write_stub.c, so all file output goes through
- * write_xram() with a small XRAM staging window.
+ * write_xram(): the PDF is collected in an 8 KB XRAM accumulator and written
+ * one block at a time. Input lines are served from 4 KB read_xram() blocks by
+ * commons/linereader.h. count_pages() reads the body once and leaves a record
+ * per line in XRAM (offset, heading level, rows, page); the TOC and the page
+ * streams seek straight to the lines they print.
  *
- * Two-pass strategy per page content stream:
- *   Pass A (dry run): measure stream byte length by counting without writing.
- *   Pass B (write):   emit real data with the exact /Length already known.
- * This avoids needing to seek back in the output to patch the length field.
+ * Every stream is generated once. Its /Length is an indirect object written
+ * after "endstream", when the byte count is known (see begin_stream()).
  */
 
 #include "commons.h"
+#include "commons/linereader.h"
+#define _NEED_DEFLATE
+#define DFL_PUSH_ONLY
+#include "commons/deflate.h"
 
 #define APPVER "20260510.2231"
 
 /* ---- compile-time constants ---------------------------------------------- */
 
 #define FNAMELEN      64u
-#define MAX_PAGES     64u
+#define MAX_PAGES     200u    /* page numbers fit the uint8_t page of a line record */
 #define LINE_BUF_LEN  132u    /* max characters per source line kept in RAM */
 
 /* A4 page size in points */
@@ -43,9 +50,17 @@
 /* 1 mm = 2.835 pt, integer approximation */
 #define MM_TO_PT(mm)  ((unsigned)(((unsigned long)(mm) * 2835UL + 500UL) / 1000UL))
 
-/* XRAM staging window for write_xram() calls */
-#define XRAM_STAGE    0xA000u
-#define STAGE_SIZE    128u
+/* XRAM output accumulator, written to the PDF with one write_xram() when full */
+#define XRAM_OUT      0x8000u
+#define OUT_SIZE      0x2000u
+
+/* XRAM line index, see count_pages() */
+#define XRAM_INDEX    0x0000u
+#define LINE_REC      6u      /* [offset 3B LE][kind][rows][page] */
+#define MAX_LINES     (0x8000u / LINE_REC)
+#define LINE_HASHES   0x3Fu   /* kind: heading level (hash count) */
+#define LINE_NP       0x40u   /* kind: '#>' heading, starts a new page */
+#define LINE_ITALIC   0x80u   /* kind: .asm comment line */
 
 /* ---- PDF object numbering -------------------------------------------------
  * obj 1         : Catalog
@@ -54,7 +69,7 @@
  * obj 4         : Font /F2 — Courier-Oblique (italic, used only when /f active)
  * obj 5..5+N-1  : Page objects  (N = actual page count, max MAX_PAGES)
  * obj 5+N..4+2N : Content streams (consecutive after pages)
- * Total max objects: 4 + MAX_PAGES*2 = 132
+ * then          : one /Length object per stream, in the order written
  * Stream object for page i = OBJ_FIRST_PAGE + page_count + i  (runtime)
  * --------------------------------------------------------------------------- */
 #define OBJ_CATALOG      1u
@@ -62,15 +77,15 @@
 #define OBJ_FONT_NORMAL  3u   /* /F1 Courier */
 #define OBJ_FONT_ITALIC  4u   /* /F2 Courier-Oblique */
 #define OBJ_FIRST_PAGE   5u
-#define MAX_OBJS         (4u + 2u + MAX_PAGES * 2u + 2u)  /* +2 title, +2 TOC */
+#define MAX_OBJS         (4u + 2u + MAX_PAGES * 2u + 2u + MAX_PAGES + 2u)  /* +2 title, +2 TOC, lengths */
 
 /* page numbering modes */
 #define PGNUM_NONE  0u   /* no page numbers */
 #define PGNUM_FULL  1u   /* "strona N z T" */
 #define PGNUM_SHORT 2u   /* "- N -" */
 
-/* TOC: max entries = MAX_PAGES (one h==1 heading per page at most) */
-#define TOC_MAX     MAX_PAGES
+/* TOC: max entries, more than one TOC page holds at any font size */
+#define TOC_MAX     128u
 
 /* ---- formatting mode ----------------------------------------------------- */
 
@@ -94,6 +109,8 @@
 
 static int           pdf_fd;
 static unsigned long pdf_pos;            /* running byte offset in output file */
+static unsigned      out_len;            /* bytes waiting at XRAM_OUT */
+static unsigned      next_len_obj;       /* next free object for a stream /Length */
 static unsigned long obj_off[MAX_OBJS + 1u]; /* 1-based: obj_off[n] = file offset */
 
 static char inname[FNAMELEN];
@@ -109,15 +126,20 @@ static unsigned font_h_pt;       /* normal line height: base_size * 12 / 10 */
 
 static uint8_t  fmt_mode;        /* FMT_NONE / FMT_ASM / FMT_MD */
 static uint8_t  page_num_mode;   /* PGNUM_NONE / PGNUM_FULL / PGNUM_SHORT */
+static uint8_t  want_deflate;    /* 1 if /d flag — streams go through dfl_put() */
+static uint8_t  z_on;            /* inside a deflated stream */
+static unsigned long z_s1, z_s2; /* Adler-32 of the stream's plain bytes */
 static uint8_t  want_toc;        /* 1 if @NX header found */
 static uint8_t  toc_depth;       /* how many top levels to include in TOC (1..9) */
 static uint8_t  toc_at_start;    /* 1 = TOC before content, 0 = after */
-static uint8_t  toc_min_h;       /* min hash count to include: max_h - toc_depth + 1 */
-static off_t    file_body_start; /* file offset after @NX line */
+static unsigned long file_body_start; /* file offset after @NX line */
+
+/* line index built by count_pages */
+static unsigned line_count;                  /* records at XRAM_INDEX */
+static uint16_t page_first[MAX_PAGES + 1u];  /* first record of each content page */
 
 /* TOC entries collected during count_pages */
-static uint8_t  toc_page[TOC_MAX];   /* content page number (1-based) for each entry */
-static uint8_t  toc_hashes[TOC_MAX]; /* heading level (hash count) for each entry */
+static uint16_t toc_line[TOC_MAX];   /* line record of each entry */
 static uint8_t  toc_count;           /* number of TOC entries */
 static char     toc_title[LINE_BUF_LEN]; /* optional title after "@NX " on header line */
 
@@ -127,23 +149,38 @@ static char     doc_author[LINE_BUF_LEN]; /* author line (line after '^' line) *
 
 /* ---- XRAM-based file write helpers --------------------------------------- */
 
-static void pdf_write_chunk(const char *buf, unsigned len) {
-    unsigned done = 0u;
-    unsigned chunk, i;
-
-    while (done < len) {
-        chunk = len - done;
-        if (chunk > STAGE_SIZE) chunk = STAGE_SIZE;
+static void pdf_flush(void) {
+    if (out_len) write_xram(XRAM_OUT, out_len, pdf_fd);
+    out_len = 0u;
+}
 
-        RIA.addr0 = XRAM_STAGE;
-        RIA.step0 = 1;
-        for (i = 0u; i < chunk; i++) {
-            RIA.rw0 = (uint8_t)buf[done + i];
+/* Bytes as they go into the file; also the dfl_out of deflated streams */
+static void pdf_emit(const unsigned char *buf, unsigned int len) {
+    pdf_pos += (unsigned long)len;
+    RIA.addr0 = XRAM_OUT + out_len;
+    RIA.step0 = 1;
+    while (len--) {
+        RIA.rw0 = *buf++;
+        if (++out_len == OUT_SIZE) {
+            pdf_flush();
+            RIA.addr0 = XRAM_OUT;
         }
+    }
+}
 
-        write_xram(XRAM_STAGE, chunk, pdf_fd);
-        pdf_pos += (unsigned long)chunk;
-        done    += chunk;
+static void pdf_write_chunk(const char *buf, unsigned len) {
+    uint8_t b;
+    if (!z_on) {
+        pdf_emit((const unsigned char *)buf, len);
+        return;
+    }
+    while (len--) {
+        b = (uint8_t)*buf++;
+        z_s1 += b;
+        if (z_s1 >= 65521UL) z_s1 -= 65521UL;
+        z_s2 += z_s1;
+        if (z_s2 >= 65521UL) z_s2 -= 65521UL;
+        dfl_put(b);
     }
 }
 
@@ -175,120 +212,91 @@ static void end_obj(void) {
     pdf_puts("endobj\n");
 }
 
-/* ---- line reader --------------------------------------------------------- */
-
 /*
- * Read one text line from fd into buf (at most maxlen chars, NUL-terminated).
- * Consumes the line terminator (CR, LF, or CRLF).
- * Returns: number of characters placed in buf (>= 0), or -1 on EOF/error.
- * An empty line returns 0. EOF with no characters returns -1.
+ * Stream /Length is an indirect object written right after the stream, so a
+ * stream is generated once and its length taken from pdf_pos afterwards.
+ * With /d the data is a zlib stream: a 2-byte header, one fixed Huffman
+ * block from dfl_put() and the Adler-32 of the plain bytes.
  */
-static int read_line(int fd, char *buf, unsigned maxlen) {
-    unsigned n = 0u;
-    char c;
-    int  r;
-    uint8_t got_char = 0u;
+static void stream_dict(unsigned n) {
+    begin_obj(n);
+    pdf_puts("<< /Length ");
+    pdf_puti((unsigned long)next_len_obj);
+    pdf_puts(" 0 R");
+    if (want_deflate) pdf_puts(" /Filter /FlateDecode");
+}
 
-    for (;;) {
-        r = read(fd, &c, 1u);
-        if (r <= 0) {
-            if (!got_char) { buf[0] = 0; return -1; }
-            break;
-        }
-        got_char = 1u;
-        if (c == '\r') {
-            r = read(fd, &c, 1u);
-            if (r > 0 && c != '\n') lseek(fd, -1, SEEK_CUR);
-            break;
-        }
-        if (c == '\n') break;
-        if (n < maxlen) buf[n++] = c;
+static unsigned long stream_data(void) {
+    unsigned long start;
+    pdf_puts(" >>\nstream\n");
+    start = pdf_pos;
+    if (want_deflate) {
+        pdf_emit((const unsigned char *)"\x78\x01", 2u);
+        z_s1 = 1UL;
+        z_s2 = 0UL;
+        dfl_start();
+        z_on = 1u;
     }
-    buf[n] = 0;
-    return (int)n;
+    return start;
 }
 
-/* ---- text-op helpers ----------------------------------------------------- */
+static unsigned long begin_stream(unsigned n) {
+    stream_dict(n);
+    return stream_data();
+}
 
-/*
- * Count bytes that "(text) Tj\nT*\n" would emit for src[0..len).
- * Parens and backslash need escaping with '\'.
- * Total = 1('(') + len + escapes + 8(") Tj\nT*\n")
- */
-static unsigned long measure_text_op(const char *src, unsigned len) {
-    unsigned long sz = 9UL;
-    unsigned i;
-    sz += (unsigned long)len;
-    for (i = 0u; i < len; i++) {
-        if (src[i] == '(' || src[i] == ')' || src[i] == '\\') sz++;
+static void end_stream(unsigned long start) {
+    unsigned long len;
+    unsigned char adler[4];
+    if (z_on) {
+        z_on = 0u;
+        dfl_end();
+        adler[0] = (unsigned char)(z_s2 >> 8);
+        adler[1] = (unsigned char)z_s2;
+        adler[2] = (unsigned char)(z_s1 >> 8);
+        adler[3] = (unsigned char)z_s1;
+        pdf_emit(adler, 4u);
     }
-    return sz;
+    len = pdf_pos - start;
+    pdf_puts("endstream\n");
+    end_obj();
+    begin_obj(next_len_obj++);
+    pdf_puti(len);
+    pdf_putc('\n');
+    end_obj();
 }
 
-static void emit_text_op(const char *src, unsigned len) {
-    unsigned i;
-    char esc[2];
-    esc[1] = 0;
-    pdf_putc('(');
+/* "(" + src[0..len) with '(', ')' and '\' escaped, one chunk per line */
+static void pdf_put_string(const char *src, unsigned len) {
+    static char tmp[2u * LINE_BUF_LEN + 1u];
+    unsigned i, n = 0u;
+    tmp[n++] = '(';
     for (i = 0u; i < len; i++) {
         char ch = src[i];
-        if (ch == '(' || ch == ')' || ch == '\\') {
-            esc[0] = '\\'; pdf_write_chunk(esc, 1u);
-        }
-        esc[0] = ch; pdf_write_chunk(esc, 1u);
+        if (ch == '(' || ch == ')' || ch == '\\') tmp[n++] = '\\';
+        tmp[n++] = ch;
     }
+    pdf_write_chunk(tmp, n);
+}
+
+/* ---- text-op helpers ----------------------------------------------------- */
+
+/* "(text) Tj\nT*\n" for src[0..len) */
+static void emit_text_op(const char *src, unsigned len) {
+    pdf_put_string(src, len);
     pdf_puts(") Tj\nT*\n");
 }
 
 /*
- * Measure bytes for a heading line with pre-gap, font change, text, post-advance.
- * Sequence emitted by emit_heading_op:
+ * Heading line with pre-gap, font change, text, post-advance:
  *   "0 -PRE Td\n"  — space before heading
  *   "/F1 SS Tf\n"  — switch font size
  *   "(text) Tj\n"  — text (no T* — manual Td)
  *   "0 -ADV Td\n"  — advance by heading line height
  *   "/F1 10 Tf\n"  — restore normal font size
  */
-static unsigned long measure_td(unsigned v) {
-    /* "0 -V Td\n": "0 -"(3) + digits(V) + " Td\n"(4) = 7 + digits */
-    unsigned long sz = 8UL; /* 7 fixed + 1 base digit */
-    if (v >= 10u)  sz++;
-    if (v >= 100u) sz++;
-    return sz;
-}
-
-static unsigned long measure_heading_op(const char *src, unsigned len,
-                                        unsigned font_size, unsigned adv,
-                                        unsigned pre) {
-    unsigned long sz = 0UL;
-    unsigned i;
-    /* "0 -PRE Td\n" */
-    sz += measure_td(pre);
-    /* "/F1 SS Tf\n": "/F1 "(4) + digits(SS) + " Tf\n"(4) = 8 + digits(SS) */
-    sz += 9UL;                    /* 8 fixed + 1 base digit (SS always >= 1) */
-    if (font_size >= 10u) sz++;
-    if (font_size >= 100u) sz++;
-    /* "(text) Tj\n": '('(1) + len + escapes + ") Tj\n"(5) = 6 + len + escapes */
-    sz += 6UL;
-    sz += (unsigned long)len;
-    for (i = 0u; i < len; i++) {
-        if (src[i] == '(' || src[i] == ')' || src[i] == '\\') sz++;
-    }
-    /* "0 -ADV Td\n" */
-    sz += measure_td(adv);
-    /* "/F1 BS Tf\n": restore base_size — same formula as heading Tf line */
-    sz += 9UL;
-    if (base_size >= 10u) sz++;
-    if (base_size >= 100u) sz++;
-    return sz;
-}
-
 static void emit_heading_op(const char *src, unsigned len,
                             unsigned font_size, unsigned adv, unsigned pre) {
-    unsigned i;
-    char esc[2];
-    esc[1] = 0;
-
     /* space before heading */
     pdf_puts("0 -");
     pdf_puti((unsigned long)pre);
@@ -300,14 +308,7 @@ static void emit_heading_op(const char *src, unsigned len,
     pdf_puts(" Tf\n");
 
     /* emit text (no T* — manual Td advance) */
-    pdf_putc('(');
-    for (i = 0u; i < len; i++) {
-        char ch = src[i];
-        if (ch == '(' || ch == ')' || ch == '\\') {
-            esc[0] = '\\'; pdf_write_chunk(esc, 1u);
-        }
-        esc[0] = ch; pdf_write_chunk(esc, 1u);
-    }
+    pdf_put_string(src, len);
     pdf_puts(") Tj\n");
 
     /* advance by heading line height */
@@ -322,23 +323,11 @@ static void emit_heading_op(const char *src, unsigned len,
 }
 
 /*
- * Measure bytes for italic comment line:
+ * Italic comment line:
  *   "/F2 BS Tf\n"  — switch to italic
  *   "(text) Tj\nT*\n"
  *   "/F1 BS Tf\n"  — restore normal
- * "/FN BS Tf\n": "/FN "(4) + digits(BS) + " Tf\n"(4) = 8 + digits
  */
-static unsigned long measure_font_switch(void) {
-    unsigned long sz = 9UL; /* 8 fixed + 1 base digit */
-    if (base_size >= 10u)  sz++;
-    if (base_size >= 100u) sz++;
-    return sz;
-}
-
-static unsigned long measure_italic_op(const char *src, unsigned len) {
-    return measure_font_switch() + measure_text_op(src, len) + measure_font_switch();
-}
-
 static void emit_italic_op(const char *src, unsigned len) {
     pdf_puts("/F2 ");
     pdf_puti((unsigned long)base_size);
@@ -369,17 +358,47 @@ static unsigned count_hashes(const char *buf, uint8_t *force_np) {
     return n - (unsigned)*force_np; /* return hash count without the '>' */
 }
 
-/* ---- content stream ------------------------------------------------------- */
+/* ---- line index ----------------------------------------------------------- */
+
+typedef struct {
+    unsigned long off;   /* file offset of the line */
+    uint8_t       kind;  /* LINE_HASHES level | LINE_NP | LINE_ITALIC */
+    uint8_t       rows;  /* lines_per_page rows the line takes */
+    uint8_t       page;  /* content page number (1-based) */
+} line_rec_t;
+
+static void put_line_rec(unsigned i, const line_rec_t *r) {
+    RIA.addr1 = XRAM_INDEX + i * LINE_REC;
+    RIA.step1 = 1;
+    RIA.rw1 = (uint8_t)r->off;
+    RIA.rw1 = (uint8_t)(r->off >> 8);
+    RIA.rw1 = (uint8_t)(r->off >> 16);
+    RIA.rw1 = r->kind;
+    RIA.rw1 = r->rows;
+    RIA.rw1 = r->page;
+}
 
-/*
- * EMIT_S / EMIT_I / EMIT_C macros: measure or write depending on measure_only.
- */
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
+static void get_line_rec(unsigned i, line_rec_t *r) {
+    RIA.addr1 = XRAM_INDEX + i * LINE_REC;
+    RIA.step1 = 1;
+    r->off  = RIA.rw1;
+    r->off |= (unsigned)RIA.rw1 << 8;
+    r->off |= (unsigned long)RIA.rw1 << 16;
+    r->kind = RIA.rw1;
+    r->rows = RIA.rw1;
+    r->page = RIA.rw1;
+}
+
+/* Seek to the line of record i and read its text; returns its length. */
+static unsigned read_indexed_line(unsigned i, line_rec_t *r, char *lbuf) {
+    int n;
+    get_line_rec(i, r);
+    lr_seek(r->off);
+    n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+    return n > 0 ? (unsigned)n : 0u;
+}
+
+/* ---- content stream ------------------------------------------------------- */
 
 /*
  * Compute advance in "lines_per_page units" for a heading.
@@ -391,61 +410,35 @@ static unsigned heading_line_units(unsigned adv) {
 }
 
 /*
- * Measure (dry-run) or emit the BT...ET block for one page.
- * Reads lines from current fd position; stops after lines_per_page rows consumed
- * or EOF.  "rows" for a heading = ceil(adv / FONT_H_PT).
- *
- * Returns byte count when measure_only, 0 otherwise.
- * After return, fd is positioned past all lines consumed for this page.
+ * Emit the BT...ET block for content page pg (0-based).
+ * The lines and their layout come from the index; only the text is read.
+ * "rows" for a heading = ceil(adv / FONT_H_PT).
  */
-static unsigned long content_block(int in_fd, uint8_t mo) {
+static void content_block(unsigned pg) {
     char     lbuf[LINE_BUF_LEN];
-    int      n;
-    unsigned cur_line = 0u;   /* rows consumed so far */
-    unsigned long sz  = 0UL;
+    unsigned i;
+    line_rec_t rec;
 
     /* BT header */
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n");
-    EMIT_I(left_pt);
-    EMIT_S(" ");
-    EMIT_I(PAGE_H_PT - top_pt - font_h_pt);
-    EMIT_S(" Td\n0 -");
-    EMIT_I(font_h_pt);
-    EMIT_S(" TD\n");
-
-    while (cur_line < lines_per_page) {
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)left_pt);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)(PAGE_H_PT - top_pt - font_h_pt));
+    pdf_puts(" Td\n0 -");
+    pdf_puti((unsigned long)font_h_pt);
+    pdf_puts(" TD\n");
+
+    for (i = page_first[pg]; i < page_first[pg + 1u]; i++) {
         unsigned offset    = 0u;
-        unsigned remaining;
-        unsigned hashes    = 0u;
-        uint8_t  italic    = 0u;
-        uint8_t  force_np  = 0u;
-        unsigned row_adv   = 1u;   /* how many lines_per_page rows this line uses */
-
-        n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-        if (n < 0) break;
-        if (fmt_mode != FMT_ASM && n > 0 && lbuf[0] == ';') continue;
-
-        remaining = (unsigned)n;
-
-        /* classify the line for formatting */
-        if (fmt_mode == FMT_ASM && remaining > 0u && lbuf[0] == ';') {
-            italic = 1u;
-        } else if ((fmt_mode == FMT_MD || want_toc) && remaining > 0u) {
-            hashes = count_hashes(lbuf, &force_np);
-            if (fmt_mode != FMT_MD) hashes = 0u; /* detect only for force_np */
-        }
-
-        /* force new page: push line back and break to end current page */
-        if (force_np && cur_line > 0u) {
-            lseek(in_fd, -(off_t)(remaining + 1u), SEEK_CUR);
-            break;
-        }
+        unsigned remaining = read_indexed_line(i, &rec, lbuf);
+        unsigned hashes    = (fmt_mode == FMT_MD) ? (unsigned)(rec.kind & LINE_HASHES) : 0u;
+        uint8_t  italic    = (rec.kind & LINE_ITALIC) ? 1u : 0u;
 
         if (hashes > 0u) {
             /* skip "###" + optional ">" + optional " " */
-            unsigned gt   = force_np ? 1u : 0u;
+            unsigned gt   = (rec.kind & LINE_NP) ? 1u : 0u;
             unsigned skip = hashes + gt + (lbuf[hashes + gt] == ' ' ? 1u : 0u);
             const char *text = lbuf + skip;
             unsigned text_len;
@@ -464,126 +457,110 @@ static unsigned long content_block(int in_fd, uint8_t mo) {
             text_len = (unsigned)strlen(text);
             if (text_len > max_cols) text_len = max_cols; /* truncate — no wrap for headings */
 
-            row_adv = heading_line_units(fadv + fpre);
-            if (cur_line + row_adv > lines_per_page) {
-                /* heading doesn't fit on this page — push back and end page */
-                lseek(in_fd, -(off_t)(remaining + 1u), SEEK_CUR);
-                break;
-            }
-
-            if (mo) sz += measure_heading_op(text, text_len, fsize, fadv, fpre);
-            else    emit_heading_op(text, text_len, fsize, fadv, fpre);
-
-            cur_line += row_adv;
+            emit_heading_op(text, text_len, fsize, fadv, fpre);
         } else {
             /* normal or italic line — wrap at chars_per_line */
             while (remaining > chars_per_line) {
                 if (italic) {
-                    if (mo) sz += measure_italic_op(lbuf + offset, chars_per_line);
-                    else    emit_italic_op(lbuf + offset, chars_per_line);
+                    emit_italic_op(lbuf + offset, chars_per_line);
                 } else {
-                    if (mo) sz += measure_text_op(lbuf + offset, chars_per_line);
-                    else    emit_text_op(lbuf + offset, chars_per_line);
+                    emit_text_op(lbuf + offset, chars_per_line);
                 }
                 offset    += chars_per_line;
                 remaining -= chars_per_line;
-                cur_line++;
-                if (cur_line >= lines_per_page) goto page_full;
             }
 
             /* last (or only) segment */
             if (italic) {
-                if (mo) sz += measure_italic_op(lbuf + offset, remaining);
-                else    emit_italic_op(lbuf + offset, remaining);
+                emit_italic_op(lbuf + offset, remaining);
             } else {
-                if (mo) sz += measure_text_op(lbuf + offset, remaining);
-                else    emit_text_op(lbuf + offset, remaining);
+                emit_text_op(lbuf + offset, remaining);
             }
-            cur_line++;
         }
     }
 
-page_full:
-    EMIT_S("ET\n");
-
-#undef EMIT_S
-#undef EMIT_I
+    pdf_puts("ET\n");
 
-    return sz;
 }
 
 /* ---- page counting ------------------------------------------------------- */
 
-static unsigned count_pages(int fd) {
+/*
+ * The only pass over the body: classify every printed line, lay the lines out
+ * on pages and write their records to the index. A line that does not fit in
+ * the rows left on a page starts the next one, so the streams, the TOC and
+ * the page count all agree. The TOC entries are picked from the index after.
+ * Returns the number of content pages, 0 if the index or MAX_PAGES is full.
+ */
+static unsigned count_pages(void) {
     char     lbuf[LINE_BUF_LEN];
     int      n;
     unsigned cur_line = 0u;
     unsigned pages    = 1u;
+    unsigned max_h    = 0u;
+    unsigned i;
+    line_rec_t rec;
 
-    toc_count = 0u;
-    toc_min_h = 1u;
-
-    /* pre-scan: find max hash count so we know which levels are "top" */
-    if (want_toc) {
-        uint8_t max_h = 0u;
-        lseek(fd, file_body_start, SEEK_SET);
-        while ((n = read_line(fd, lbuf, LINE_BUF_LEN - 1u)) >= 0) {
-            if (n > 0 && lbuf[0] != ';') {
-                uint8_t fnp = 0u;
-                unsigned h = count_hashes(lbuf, &fnp);
-                if (h > (unsigned)max_h) max_h = (uint8_t)h;
-            }
-        }
-        if (max_h > 0u) {
-            unsigned min = (max_h >= toc_depth) ? (unsigned)max_h - (unsigned)toc_depth + 1u : 1u;
-            toc_min_h = (uint8_t)min;
-        }
-    }
+    line_count    = 0u;
+    page_first[0] = 0u;
+    toc_count     = 0u;
 
-    lseek(fd, file_body_start, SEEK_SET);
+    lr_seek(file_body_start);
 
-    while ((n = read_line(fd, lbuf, LINE_BUF_LEN - 1u)) >= 0) {
-        unsigned rows = 1u;
-        unsigned h    = 0u;
+    for (;;) {
+        unsigned h = 0u;
+        uint8_t  fnp = 0u;
 
-        if (fmt_mode != FMT_ASM && n > 0 && lbuf[0] == ';') continue;
+        rec.off = lr_tell();
+        n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+        if (n < 0) break;
 
-        if ((fmt_mode == FMT_MD || want_toc) && n > 0) {
-            uint8_t fnp = 0u;
+        rec.kind = 0u;
+        if (n > 0 && lbuf[0] == ';') {
+            if (fmt_mode != FMT_ASM) continue;
+            rec.kind = LINE_ITALIC;
+        } else if ((fmt_mode == FMT_MD || want_toc) && n > 0) {
             h = count_hashes(lbuf, &fnp);
-            if (h > 0u) {
-                if (fmt_mode == FMT_MD) {
-                    unsigned fadv = HEAD_ADV(base_size, h);
-                    unsigned fpre = HEAD_PRE(h);
-                    rows = heading_line_units(fadv + fpre);
-                }
-                /* force new page: flush remaining rows to next page */
-                if (fnp && cur_line > 0u) {
-                    pages++;
-                    cur_line = 0u;
-                }
-            }
+            if (h > LINE_HASHES) h = LINE_HASHES;
+            rec.kind = (uint8_t)h | (fnp ? LINE_NP : 0u);
         }
 
-        /* wrap: each wrapped segment is one additional row */
-        if (h == 0u) {
+        if (h > 0u && fmt_mode == FMT_MD) {
+            rec.rows = (uint8_t)heading_line_units(HEAD_ADV(base_size, h) + HEAD_PRE(h));
+        } else {
+            /* wrap: each wrapped segment is one additional row */
             unsigned col = (unsigned)n;
-            rows = 0u;
-            while (col > chars_per_line) { rows++; col -= chars_per_line; }
-            rows++; /* last segment */
+            rec.rows = 1u;
+            while (col > chars_per_line) { rec.rows++; col -= chars_per_line; }
         }
 
-        /* record TOC entry */
-        if (h >= 1u && want_toc && h >= (unsigned)toc_min_h && toc_count < TOC_MAX) {
-            toc_page[toc_count]   = (uint8_t)pages;
-            toc_hashes[toc_count] = (uint8_t)h;
-            toc_count++;
+        /* force new page, or the line does not fit on this one */
+        if (cur_line > 0u && (fnp || cur_line + rec.rows > lines_per_page)) {
+            if (pages == MAX_PAGES) {
+                printf(EXCLAMATION "too many pages (max %u)" NEWLINE, MAX_PAGES);
+                return 0u;
+            }
+            page_first[pages++] = (uint16_t)line_count;
+            cur_line = 0u;
+        }
+        if (line_count == MAX_LINES) {
+            printf(EXCLAMATION "too many lines (max %u)" NEWLINE, MAX_LINES);
+            return 0u;
         }
 
-        cur_line += rows;
-        while (cur_line >= lines_per_page) {
-            pages++;
-            cur_line -= lines_per_page;
+        rec.page = (uint8_t)pages;
+        put_line_rec(line_count++, &rec);
+        cur_line += rec.rows;
+        if (h > max_h) max_h = h;
+    }
+    page_first[pages] = (uint16_t)line_count;
+
+    /* TOC: headings with at least max_h - toc_depth + 1 hashes */
+    if (want_toc && max_h > 0u) {
+        unsigned min_h = (max_h >= toc_depth) ? max_h - (unsigned)toc_depth + 1u : 1u;
+        for (i = 0u; i < line_count && toc_count < TOC_MAX; i++) {
+            get_line_rec(i, &rec);
+            if ((rec.kind & LINE_HASHES) >= min_h) toc_line[toc_count++] = (uint16_t)i;
         }
     }
     return pages;
@@ -592,24 +569,24 @@ static unsigned count_pages(int fd) {
 /* ---- page number footer --------------------------------------------------- */
 
 /*
- * Measure / emit a page-number footer BT block.
+ * Emit a page-number footer BT block.
  * Positioned at bottom_pt - MM_TO_PT(5), centred horizontally.
  * PGNUM_FULL : "page N of T"
  * PGNUM_SHORT: "- N -"
  * Uses base_size font (/F1).
  */
-static unsigned long measure_pgnum_str(unsigned pgn, unsigned total) {
+static unsigned pgnum_str_len(unsigned pgn, unsigned total) {
     /* count decimal digits */
-    unsigned long sz = 0UL;
+    unsigned sz = 0u;
     unsigned v;
     if (page_num_mode == PGNUM_FULL) {
         /* "strona " + digits(N) + " z " + digits(T) */
-        sz = 7UL + 3UL; /* "page "(7) + " of "(3) */
+        sz = 7u + 3u; /* "page "(7) + " of "(3) */
         v = pgn;  do { sz++; v /= 10u; } while (v);
         v = total; do { sz++; v /= 10u; } while (v);
     } else {
         /* "- " + digits(N) + " -" */
-        sz = 4UL; /* "- "(2) + " -"(2) */
+        sz = 4u; /* "- "(2) + " -"(2) */
         v = pgn; do { sz++; v /= 10u; } while (v);
     }
     return sz;
@@ -628,50 +605,9 @@ static void emit_pgnum_str(unsigned pgn, unsigned total) {
     }
 }
 
-/*
- * Measure bytes of the page-number BT block appended to a content stream.
- * "BT\n/F1 BS Tf\nX Y Td\n(text) Tj\nET\n"
- * X is computed to centre the string; it varies with pgn — we use the
- * widest possible string for measurement so measure and emit always agree.
- * Strategy: measure uses same pgn/total as emit (called twice from
- * write_stream_obj with the same args), so they always match.
- */
-static unsigned long measure_pgnum_block(unsigned pgn, unsigned total) {
-    unsigned long str_len  = measure_pgnum_str(pgn, total);
-    unsigned long x_digits;
-    unsigned x_val;
-    unsigned long sz;
-
-    /* X = (PAGE_W_PT - str_len * font_w_pt) / 2 */
-    x_val = (PAGE_W_PT - (unsigned)(str_len * (unsigned long)font_w_pt)) / 2u;
-
-    /* count digits in x_val */
-    x_digits = 0UL;
-    { unsigned v = x_val; do { x_digits++; v /= 10u; } while (v); }
-
-    /* "BT\n/F1 "(7) + digits(base_size) + " Tf\n"(4) = 11+d(bs) */
-    sz  = 11UL;
-    if (base_size >= 10u) sz++;
-    if (base_size >= 100u) sz++;
-
-    /* X digits + " "(1) + Y digits + " Td\n"(4) */
-    { unsigned y_val = (bottom_pt > MM_TO_PT(2u)) ? bottom_pt - MM_TO_PT(2u) : 0u;
-      unsigned long yd = 0UL;
-      if (y_val == 0u) yd = 1UL; else { unsigned v = y_val; do { yd++; v /= 10u; } while (v); }
-      sz += x_digits + 1UL + yd + 4UL; }
-
-    /* "(text) Tj\n" = 1 + str_len + escapes + 5 */
-    sz += 6UL + str_len; /* no special chars in page number string */
-
-    /* "ET\n" */
-    sz += 3UL;
-
-    return sz;
-}
-
 static void emit_pgnum_block(unsigned pgn, unsigned total) {
-    unsigned long str_len = measure_pgnum_str(pgn, total);
-    unsigned x_val = (PAGE_W_PT - (unsigned)(str_len * (unsigned long)font_w_pt)) / 2u;
+    unsigned str_len = pgnum_str_len(pgn, total);
+    unsigned x_val = (PAGE_W_PT - str_len * font_w_pt) / 2u;
 
     pdf_puts("BT\n/F1 ");
     pdf_puti((unsigned long)base_size);
@@ -687,37 +623,28 @@ static void emit_pgnum_block(unsigned pgn, unsigned total) {
 /* ---- TOC stream ----------------------------------------------------------- */
 
 /*
- * Emit the TOC content stream (measure or write).
+ * Emit the TOC content stream.
  * Reads the input file again, collects h==1 heading lines in order,
  * prints each as: "heading text ......... N" where N = page number.
  * Uses base_size font, normal margins.
  */
-static unsigned long toc_block(int in_fd, uint8_t mo, unsigned content_pages) {
+static void toc_block(unsigned content_pages) {
     char     lbuf[LINE_BUF_LEN];
-    int      n;
     unsigned cur_line = 0u;
     unsigned toc_idx  = 0u;
-    unsigned long sz  = 0UL;
     unsigned usable_w = PAGE_W_PT - left_pt - right_pt;
 
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
-
     (void)content_pages;
 
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n");
-    EMIT_I(left_pt);
-    EMIT_S(" ");
-    EMIT_I(PAGE_H_PT - top_pt - font_h_pt);
-    EMIT_S(" Td\n0 -");
-    EMIT_I(font_h_pt);
-    EMIT_S(" TD\n");
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)left_pt);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)(PAGE_H_PT - top_pt - font_h_pt));
+    pdf_puts(" Td\n0 -");
+    pdf_puti((unsigned long)font_h_pt);
+    pdf_puts(" TD\n");
 
     /* emit title line if present — rendered as H1 heading style */
     if (toc_title[0]) {
@@ -730,36 +657,27 @@ static unsigned long toc_block(int in_fd, uint8_t mo, unsigned content_pages) {
           unsigned fw = (fsize * 6u) / 10u;
           max_cols = fw ? usable / fw : usable; }
         if (tlen > max_cols) tlen = max_cols;
-        if (mo) sz += measure_heading_op(toc_title, tlen, fsize, fadv, fpre);
-        else    emit_heading_op(toc_title, tlen, fsize, fadv, fpre);
+        emit_heading_op(toc_title, tlen, fsize, fadv, fpre);
         cur_line += heading_line_units(fadv + fpre);
     }
 
-    lseek(in_fd, (off_t)file_body_start, SEEK_SET);
-
     while (toc_idx < toc_count && cur_line < lines_per_page) {
         unsigned pgn = 0u, text_start, text_len = 0u, dots = 0u, num_w, i;
+        line_rec_t rec;
+
+        /* heading text from the file, page and level from its line record */
+        (void)read_indexed_line(toc_line[toc_idx], &rec, lbuf);
 
         /* pre-compute num_w from stored content page number (1-based, no offset) */
-        { unsigned tpgn = (unsigned)toc_page[toc_idx];
+        { unsigned tpgn = (unsigned)rec.page;
           num_w = 0u;
           { unsigned v = tpgn; do { num_w++; v /= 10u; } while (v); }
         }
 
-        /* scan for next heading matching toc_hashes[toc_idx] level */
-        { unsigned want_h = (unsigned)toc_hashes[toc_idx];
-          uint8_t  fnp2   = 0u;
-          while ((n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u)) >= 0) {
-              if (n > 0 && lbuf[0] != ';' && count_hashes(lbuf, &fnp2) == want_h) break;
-          }
-        }
-        if (n < 0) break;
-
-        { uint8_t fnp2 = 0u;
-          unsigned hh  = count_hashes(lbuf, &fnp2);
-          unsigned gt  = fnp2 ? 1u : 0u;
+        { unsigned hh  = (unsigned)(rec.kind & LINE_HASHES);
+          unsigned gt  = (rec.kind & LINE_NP) ? 1u : 0u;
           text_start   = hh + gt + (lbuf[hh + gt] == ' ' ? 1u : 0u);
-          pgn          = (unsigned)toc_page[toc_idx];
+          pgn          = (unsigned)rec.page;
           { toc_idx++;
             text_len = (unsigned)strlen(lbuf + text_start);
 
@@ -775,63 +693,31 @@ static unsigned long toc_block(int in_fd, uint8_t mo, unsigned content_pages) {
             }
 
             /* emit: "(" + text */
-            if (mo) {
-                sz += 1UL + (unsigned long)text_len;
-                for (i = 0u; i < text_len; i++)
-                    if (lbuf[text_start + i] == '(' || lbuf[text_start + i] == ')' || lbuf[text_start + i] == '\\') sz++;
-            } else {
-                unsigned ii;
-                char esc[2];
-                esc[1] = 0;
-                pdf_putc('(');
-                for (ii = 0u; ii < text_len; ii++) {
-                    char ch = lbuf[text_start + ii];
-                    if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-                    esc[0] = ch; pdf_write_chunk(esc, 1u);
-                }
-            }
+            pdf_put_string(lbuf + text_start, text_len);
             /* dots */
-            if (mo) sz += (unsigned long)dots;
-            else { unsigned ii; for (ii=0u;ii<dots;ii++) pdf_putc('.'); }
+            for (i = 0u; i < dots; i++) pdf_putc('.');
             /* space + page number */
-            { unsigned tpgn = pgn;
-              if (mo) {
-                  sz += 1UL;
-                  { unsigned v = tpgn; do { sz++; v /= 10u; } while (v); }
-              } else {
-                  pdf_putc(' ');
-                  { unsigned v = tpgn; int pi = 6; char pb[6];
-                    do { pb[--pi] = (char)('0' + v % 10u); v /= 10u; } while (v);
-                    pdf_write_chunk(pb + pi, (unsigned)(6 - pi)); }
-              }
-            }
-            /* ") Tj\nT*\n" = 8 bytes; '(' already counted above */
-            if (mo) sz += 8UL;
-            else pdf_puts(") Tj\nT*\n");
+            pdf_putc(' ');
+            pdf_puti((unsigned long)pgn);
+            pdf_puts(") Tj\nT*\n");
           }
         }
 
         cur_line++;
     }
 
-    EMIT_S("ET\n");
-
-#undef EMIT_S
-#undef EMIT_I
-
-    return sz;
+    pdf_puts("ET\n");
 }
 
 /* ---- title page stream ---------------------------------------------------- */
 
 /*
- * Emit the title page content stream (measure or write).
+ * Emit the title page content stream.
  * Title   at 1/3 of usable height, centred, 3*base_size pt.
  * Author  at 2/3 of usable height, centred, base_size pt.
  * Positions are absolute Td from page origin (PDF Y=0 at bottom).
  */
-static unsigned long title_page_block(uint8_t mo) {
-    unsigned long sz = 0UL;
+static void title_page_block(void) {
     unsigned title_fsize = base_size * 3u;
     unsigned title_fw    = (title_fsize * 6u) / 10u;
     unsigned usable_h    = PAGE_H_PT - top_pt - bottom_pt;
@@ -854,63 +740,31 @@ static unsigned long title_page_block(uint8_t mo) {
     tx = left_pt + (usable_w > tlen * title_fw ? (usable_w - tlen * title_fw) / 2u : 0u);
     ax = left_pt + (usable_w > alen * font_w_pt ? (usable_w - alen * font_w_pt) / 2u : 0u);
 
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
-
     /* title: BT /F1 3*base Tf  TX TY Td (text) Tj ET */
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(title_fsize);
-    EMIT_S(" Tf\n");
-    EMIT_I(tx);
-    EMIT_S(" ");
-    EMIT_I(ty);
-    EMIT_S(" Td\n(");
-    { unsigned i;
-      for (i = 0u; i < tlen; i++) {
-          char ch = doc_title[i];
-          if (mo) { sz++; if (ch=='('||ch==')'||ch=='\\') sz++; }
-          else {
-              char esc[2]; esc[1]=0;
-              if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-              esc[0]=ch; pdf_write_chunk(esc,1u);
-          }
-      }
-    }
-    EMIT_S(") Tj\n");
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)title_fsize);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)tx);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)ty);
+    pdf_puts(" Td\n");
+    pdf_put_string(doc_title, tlen);
+    pdf_puts(") Tj\n");
 
     /* author: /F1 base Tf  1 0 0 1 AX AY Tm (text) Tj — absolute position */
-    EMIT_S("/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n1 0 0 1 ");
-    EMIT_I(ax);
-    EMIT_S(" ");
-    EMIT_I(ay);
-    EMIT_S(" Tm\n(");
-    { unsigned i;
-      for (i = 0u; i < alen; i++) {
-          char ch = doc_author[i];
-          if (mo) { sz++; if (ch=='('||ch==')'||ch=='\\') sz++; }
-          else {
-              char esc[2]; esc[1]=0;
-              if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-              esc[0]=ch; pdf_write_chunk(esc,1u);
-          }
-      }
-    }
-    EMIT_S(") Tj\nET\n");
-
-#undef EMIT_S
-#undef EMIT_I
-
-    return sz;
+    pdf_puts("/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n1 0 0 1 ");
+    pdf_puti((unsigned long)ax);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)ay);
+    pdf_puts(" Tm\n");
+    pdf_put_string(doc_author, alen);
+    pdf_puts(") Tj\nET\n");
 }
 
 static void write_title_page_obj(unsigned page_obj, unsigned stream_obj) {
-    unsigned long stream_len;
+    unsigned long start;
 
     /* page object */
     begin_obj(page_obj);
@@ -932,14 +786,9 @@ static void write_title_page_obj(unsigned page_obj, unsigned stream_obj) {
     end_obj();
 
     /* stream object */
-    stream_len = title_page_block(1u);
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    title_page_block(0u);
-    pdf_puts("endstream\n");
-    end_obj();
+    start = begin_stream(stream_obj);
+    title_page_block();
+    end_stream(start);
 }
 
 /* ---- PDF structure writers ----------------------------------------------- */
@@ -1031,47 +880,24 @@ static void write_page_obj(unsigned page_obj, unsigned stream_obj) {
     end_obj();
 }
 
-static void write_stream_obj(int in_fd, unsigned stream_obj,
+static void write_stream_obj(unsigned stream_obj,
                              unsigned pgn, unsigned total_pages) {
-    unsigned long stream_len;
-    unsigned long before_read;
-
-    before_read = (unsigned long)lseek(in_fd, 0, SEEK_CUR);
+    unsigned long start;
 
-    stream_len = content_block(in_fd, 1u);
-    if (page_num_mode != PGNUM_NONE)
-        stream_len += measure_pgnum_block(pgn, total_pages);
-
-    lseek(in_fd, (off_t)before_read, SEEK_SET);
-
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    content_block(in_fd, 0u);
+    start = begin_stream(stream_obj);
+    content_block(pgn - 1u);
     if (page_num_mode != PGNUM_NONE)
         emit_pgnum_block(pgn, total_pages);
-    pdf_puts("endstream\n");
-    end_obj();
+    end_stream(start);
 }
 
-static void write_toc_stream_obj(int in_fd, unsigned stream_obj,
+static void write_toc_stream_obj(unsigned stream_obj,
                                  unsigned content_pages) {
-    unsigned long stream_len;
-    unsigned long before_read;
-
-    before_read = (unsigned long)lseek(in_fd, 0, SEEK_CUR);
-    stream_len = toc_block(in_fd, 1u, content_pages);
-
-    lseek(in_fd, (off_t)before_read, SEEK_SET);
+    unsigned long start;
 
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    toc_block(in_fd, 0u, content_pages);
-    pdf_puts("endstream\n");
-    end_obj();
+    start = begin_stream(stream_obj);
+    toc_block(content_pages);
+    end_stream(start);
 }
 
 static void write_xref_and_trailer(unsigned total_objs) {
@@ -1135,11 +961,13 @@ int main(int argc, char **argv) {
     unsigned i;
     unsigned slen;
     int      in_fd;
-    unsigned arg_off = 0u;  /* argv index offset past parsed flags */
+    int      arg_off = 0;   /* argv index offset past parsed flags */
 
     if (argc < 1 || !argv[0][0]) {
         printf(NEWLINE
-               "Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/nd|/np]"
+               "Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/nd|/np] [/d]"
+               NEWLINE
+               "  /d  : compress the PDF streams (smaller file, slower)"
                NEWLINE
                "  TOC: start file with '@NL' (N=depth 1-9, L=< start or > end)"
                NEWLINE);
@@ -1157,8 +985,9 @@ int main(int argc, char **argv) {
     /* parse optional flags (order independent) */
     base_size     = DEF_FONT_SIZE;
     page_num_mode = PGNUM_NONE;
+    want_deflate  = 0u;
     want_toc      = 0u;
-    arg_off       = 0u;
+    arg_off       = 0;
     while (argc > 1 + arg_off && argv[1 + arg_off][0] == '/') {
         const char *a = argv[1 + arg_off];
         char flag = a[1];
@@ -1181,6 +1010,9 @@ int main(int argc, char **argv) {
             if (a[2] == 'd' || a[2] == 'D') page_num_mode = PGNUM_FULL;
             else                             page_num_mode = PGNUM_SHORT;
             arg_off++;
+        } else if ((flag == 'd' || flag == 'D') && a[2] == 0) {
+            want_deflate = 1u;
+            arg_off++;
         } else {
             break;
         }
@@ -1236,6 +1068,7 @@ int main(int argc, char **argv) {
         printf(EXCLAMATION "cannot open %s" NEWLINE, inname);
         return -1;
     }
+    lr_open(in_fd);
 
     /* detect @NX and ^ header lines using read_line for correct CRLF handling */
     toc_title[0]   = 0;
@@ -1249,10 +1082,10 @@ int main(int argc, char **argv) {
         /* skip leading comment lines, then peek at the first non-comment line */
         file_body_start = 0;
         {
-            off_t before_line;
+            unsigned long before_line;
             do {
-                before_line = lseek(in_fd, 0, SEEK_CUR);
-                n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
+                before_line = lr_tell();
+                n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
             } while (n >= 0 && n > 0 && lbuf[0] == ';');
             if (n >= 3 && lbuf[0] == '@' &&
                 lbuf[1] >= '1' && lbuf[1] <= '9' &&
@@ -1266,54 +1099,48 @@ int main(int argc, char **argv) {
                     strncpy(toc_title, lbuf + 4, LINE_BUF_LEN - 1u);
                     toc_title[LINE_BUF_LEN - 1u] = 0;
                 }
-                file_body_start = lseek(in_fd, 0, SEEK_CUR);
+                file_body_start = lr_tell();
 
                 /* peek at next line for ^ title page */
-                n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
+                n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
                 if (n >= 1 && lbuf[0] == '^') {
                     strncpy(doc_title, lbuf + 1, LINE_BUF_LEN - 1u);
                     doc_title[LINE_BUF_LEN - 1u] = 0;
                     /* author is the next line */
-                    n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
+                    n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
                     if (n >= 0) {
                         strncpy(doc_author, lbuf, LINE_BUF_LEN - 1u);
                         doc_author[LINE_BUF_LEN - 1u] = 0;
                     }
                     has_title_page = 1u;
-                    file_body_start = lseek(in_fd, 0, SEEK_CUR);
+                    file_body_start = lr_tell();
                 } else {
                     /* no ^ line — rewind to after @NX */
-                    lseek(in_fd, (off_t)file_body_start, SEEK_SET);
+                    lr_seek(file_body_start);
                 }
             } else {
                 /* no @NX — rewind to the non-comment line we just read */
-                lseek(in_fd, before_line, SEEK_SET);
+                lr_seek(before_line);
                 file_body_start = before_line;
 
                 /* still check for ^ title page at this position */
                 if (n >= 1 && lbuf[0] == '^') {
                     strncpy(doc_title, lbuf + 1, LINE_BUF_LEN - 1u);
                     doc_title[LINE_BUF_LEN - 1u] = 0;
-                    n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
+                    n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
                     if (n >= 0) {
                         strncpy(doc_author, lbuf, LINE_BUF_LEN - 1u);
                         doc_author[LINE_BUF_LEN - 1u] = 0;
                     }
                     has_title_page = 1u;
-                    file_body_start = lseek(in_fd, 0, SEEK_CUR);
+                    file_body_start = lr_tell();
                 }
             }
         }
     }
 
-    page_count = count_pages(in_fd);
+    page_count = count_pages();
     if (page_count == 0u) {
-        printf(EXCLAMATION "read error or empty file" NEWLINE);
-        close(in_fd);
-        return -1;
-    }
-    if (page_count > MAX_PAGES) {
-        printf(EXCLAMATION "too many pages (max %u)" NEWLINE, MAX_PAGES);
         close(in_fd);
         return -1;
     }
@@ -1336,15 +1163,17 @@ int main(int argc, char **argv) {
      *   5+T+N..4+T+2N     : Content streams
      *   5+T+2N            : TOC page object            (if want_toc)
      *   6+T+2N            : TOC stream                 (if want_toc)
+     *   then              : /Length of each stream, numbered as written
      */
     { unsigned T = has_title_page ? 2u : 0u;
       unsigned extra = T + (want_toc ? 2u : 0u);
       total_objs = 4u + page_count * 2u + extra;
     }
+    next_len_obj = total_objs + 1u;
+    out_len      = 0u;
+    dfl_out      = pdf_emit;
     memset(obj_off, 0, sizeof(obj_off));
 
-    lseek(in_fd, (off_t)file_body_start, SEEK_SET);
-
     write_header();
     write_catalog();
     write_pages_dict(page_count);
@@ -1362,8 +1191,7 @@ int main(int argc, char **argv) {
       for (i = 0u; i < page_count; i++) {
           write_page_obj(OBJ_FIRST_PAGE + T + i,
                          OBJ_FIRST_PAGE + T + page_count + Wt + i);
-          write_stream_obj(in_fd,
-                           OBJ_FIRST_PAGE + T + page_count + Wt + i,
+          write_stream_obj(OBJ_FIRST_PAGE + T + page_count + Wt + i,
                            i + 1u,
                            page_count);
       }
@@ -1372,11 +1200,12 @@ int main(int argc, char **argv) {
           unsigned toc_page_obj   = OBJ_FIRST_PAGE + T + page_count;
           unsigned toc_stream_obj = OBJ_FIRST_PAGE + T + page_count + 1u + page_count;
           write_page_obj(toc_page_obj, toc_stream_obj);
-          write_toc_stream_obj(in_fd, toc_stream_obj, page_count);
+          write_toc_stream_obj(toc_stream_obj, page_count);
       }
     }
 
-    write_xref_and_trailer(total_objs);
+    write_xref_and_trailer(next_len_obj - 1u);
+    pdf_flush();
 
     close(in_fd);
     close(pdf_fd);
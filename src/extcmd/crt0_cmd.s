@@ -3,9 +3,47 @@
 
 ARGC_LOC = $0200           ; must match shell RUN_ARGS_BASE
 ARGV_LOC = ARGC_LOC + 1    ; pointer table starts immediately after argc
+RUN_STATUS = $0258         ; must match shell.h RUN_STATUS (after redir_t at $0251)
+
+.ifdef SHLIB
+SHLIB_BASE    = $0300      ; must match commons/shlib.h SHLIB_BASE
+SHLIB_VERSION = 1          ; must match commons/shlib.h SHLIB_VERSION
+RIA_READY     = $FFE0
+RIA_TX        = $FFE1
+.endif
 
 .segment "STARTUP"
 __STARTUP__:
+.ifdef SHLIB
+    ; Refuse to run under a shell without the jump table we link against
+    lda SHLIB_BASE         ; magic "RL"
+    cmp #'R'
+    bne @old_shell
+    lda SHLIB_BASE+1
+    cmp #'L'
+    bne @old_shell
+    lda SHLIB_BASE+2       ; version
+    cmp #SHLIB_VERSION
+    bcs @shlib_ok
+@old_shell:
+    ldx #0
+@msg:
+    lda old_shell_msg,x
+    beq @done
+@tx_wait:
+    bit RIA_READY          ; N = bit7 = TX ready
+    bpl @tx_wait
+    sta RIA_TX
+    inx
+    bne @msg
+@done:
+    lda #$FF               ; refused: errorlevel sees a failure
+    sta RUN_STATUS
+    sta RUN_STATUS+1
+    rts
+@shlib_ok:
+.endif
+
     ; Initialize C runtime (zero BSS, run constructors, init sp)
     jsr initlib
 
@@ -24,6 +62,10 @@ __STARTUP__:
     ; tail-call _main: when _main does RTS it returns here (to jsr donelib)
     jsr __call_main
 
+    ; Hand main's return value (A/X) to the shell for errorlevel
+    sta RUN_STATUS
+    stx RUN_STATUS+1
+
     ; Run destructors/flush stdio
     jsr donelib
     ; Return to caller (OS shell should JSR here)
@@ -31,3 +73,9 @@ __STARTUP__:
 
 __call_main:
     jmp _main
+
+.ifdef SHLIB
+.segment "RODATA"
+old_shell_msg:
+    .byte "[!] shell too old for this command", $0D, $0A, 0
+.endif
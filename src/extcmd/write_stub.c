@@ -1,10 +1,39 @@
 #include <rp6502.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "../commons/redirect.h"
+#ifdef SHLIB
+#include "../commons/shlib.h"
+#endif
 
 int __fastcall__ write(int fd, const void* buf, unsigned count) {
+#ifdef SHLIB
+    /* one output stream with the tx_* calls: shell buffer, shell redirect */
+    (void)fd;
+    tx_chars((const char*)buf, (int)count);
+    tx_flush(); /* prompts without '\n' must show before the program waits for a key */
+    return (int)count;
+#else
     const char* p = (const char*)buf;
     unsigned remaining = count;
-    (void)fd; /* stdout/stderr are ignored, everything goes to UART */
+    unsigned chunk;
+    int n;
+    (void)fd; /* stdout/stderr are ignored, everything goes to the console */
 
+    if (REDIR_OUT(REDIR)) {
+        /* shell redirected output (> file, >> file, | next command) */
+        while (remaining--) redir_putc(REDIR, *p++);
+        return (int)count;
+    }
+    /* whole blocks through the RIA stdout, as commons/txout.h does */
+    while (remaining) {
+        chunk = (remaining > 256u) ? 256u : remaining;
+        n = write_xstack(p, chunk, 1);
+        if (n <= 0) break;
+        p += n;
+        remaining -= (unsigned)n;
+    }
     while (remaining--) {
         while (!(RIA.ready & RIA_READY_TX_BIT)) {
             /* spin until TX FIFO has space */
@@ -12,4 +41,22 @@ int __fastcall__ write(int fd, const void* buf, unsigned count) {
         RIA.tx = *p++;
     }
     return (int)count;
+#endif
+}
+
+int __fastcall__ read(int fd, void* buf, unsigned count) {
+    int total = 0;
+    int n;
+    unsigned chunk;
+
+    if (fd == 0 && REDIR_IN(REDIR)) fd = REDIR->in_fd; /* right side of a pipe */
+    while (count) {
+        chunk = (count > 256u) ? 256u : count;
+        n = read_xstack((char*)buf + total, chunk, fd);
+        if (n < 0) return n;
+        total += n;
+        count -= (unsigned)n;
+        if ((unsigned)n < chunk) break;
+    }
+    return total;
 }
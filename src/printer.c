@@ -1,7 +1,7 @@
 /*
  * ext-txt2pdf.c — plain-text to PDF converter for razemOS / Picocomputer 6502
  *
- * Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/n d|p]
+ * Usage: txt2pdf <file.txt|mask|@list> [/s N] [/m L R T B] [/n d|p] [/pl|/pr] [/d] [/o F]
  *   Formatting is always active based on file extension:
  *           .asm — lines starting with ';' printed in italic (Courier-Oblique)
  *           .txt/.md — lines starting with '#'/'##'/... printed as headings
@@ -9,27 +9,53 @@
  *   /s N  : set base font size in pt (default 10); affects char width, line height,
  *           and heading sizes (heading = base + hashes*2 pt)
  *   All margin arguments are optional; default = 20 mm each.
+ *   /pl   : Polish chars (CP852), embeds DroidSansMono from MSC0:/TTF/
+ *   /pr   : as /pl with the proportional DroidSans: lines are wrapped at word
+ *           boundaries by glyph width and the wrapped rows justified
+ *   /d    : compress the streams (/FlateDecode, commons/deflate.h)
+ *   /o F  : write the PDF to F
  *   Output: input name with extension replaced by .pdf (or .pdf appended).
  *
+ * Batch: the input may be a mask ("*.md", sorted by name) or "@list",
+ *   a text file with one input name per line. Each input gets its own PDF,
+ *   or with /o all of them go into F: one set of font objects, every document
+ *   from a new page (its title page first), one TOC over all of them, set up
+ *   by the '@NL' line of the first. The TTF is opened and its table
+ *   directory read once per batch.
+ *
  * PDF format: PDF-1.4, A4 page, Courier (Base14 — no embedding needed).
  *
+ * Proportional text (/pr): the advance widths are read from the font's hmtx
+ * once per run; layout is done on them at each font size, see use_size().
+ *
  * write() is hijacked to UART by write_stub.c, so all file output goes through
- * write_xram() with a small XRAM staging window.
+ * write_xram(): the PDF is collected in an 8 KB XRAM accumulator and written
+ * one block at a time. Input lines are served from 4 KB read_xram() blocks by
+ * commons/linereader.h. count_pages() reads the body once and leaves a record
+ * per line in XRAM (offset, heading level, rows, page); the TOC and the page
+ * streams seek straight to the lines they print.
  *
- * Two-pass strategy per page content stream:
- *   Pass A (dry run): measure stream byte length by counting without writing.
- *   Pass B (write):   emit real data with the exact /Length already known.
- * This avoids needing to seek back in the output to patch the length field.
+ * Every stream is generated once. Its /Length is an indirect object written
+ * after "endstream", when the byte count is known (see begin_stream()).
  */
 
 #include "commons.h"
+#include "commons/linereader.h"
+#define _NEED_DEFLATE
+#define DFL_PUSH_ONLY
+#include "commons/deflate.h"
 
 #define APPVER "20260504.0438"
 
+#ifndef AM_DIR
+#define AM_DIR 0x10
+#endif
+
 /* ---- compile-time constants ---------------------------------------------- */
 
 #define FNAMELEN      64u
-#define MAX_PAGES     64u
+#define MAX_PAGES     200u    /* page numbers fit the uint8_t page of a line record */
+#define MAX_DOCS      32u     /* inputs of one batch */
 #define LINE_BUF_LEN  132u    /* max characters per source line kept in RAM */
 
 /* A4 page size in points */
@@ -43,9 +69,30 @@
 /* 1 mm = 2.835 pt, integer approximation */
 #define MM_TO_PT(mm)  ((unsigned)(((unsigned long)(mm) * 2835UL + 500UL) / 1000UL))
 
-/* XRAM staging window for write_xram() calls */
-#define XRAM_STAGE    0xA000u
-#define STAGE_SIZE    128u
+/* XRAM output accumulator, written to the PDF with one write_xram() when full */
+#define XRAM_OUT      0x8000u
+#define OUT_SIZE      0x2000u
+
+/* XRAM glyph lengths of the /pl font subset, 2 bytes per glyph, see ttf_plan() */
+#define XRAM_GLYPHS     0xA000u
+#define TTF_MAX_GLYPHS  2048u
+
+/* fonts embedded with /pl and /pr */
+#define TTF_MONO      "MSC0:/TTF/DroidSansMono.ttf"
+#define TTF_PROP      "MSC0:/TTF/DroidSans.ttf"
+
+/* XRAM advance widths of the /pr font, see use_size() */
+#define XRAM_WIDTHS   0xE000u   /* uint16_t per CP852 byte, 1/1000 em */
+#define XRAM_WCACHE   0xE200u   /* WC_SLOTS copies of it in 1/64 pt, one font size each */
+#define WC_SLOTS      7u
+
+/* XRAM line index, see count_pages() */
+#define XRAM_INDEX    0x0000u
+#define LINE_REC      6u      /* [offset 3B LE][kind][rows][page] */
+#define MAX_LINES     (0x8000u / LINE_REC)
+#define LINE_HASHES   0x3Fu   /* kind: heading level (hash count) */
+#define LINE_NP       0x40u   /* kind: '#>' heading, starts a new page */
+#define LINE_ITALIC   0x80u   /* kind: .asm comment line */
 
 /* ---- PDF object numbering -------------------------------------------------
  * obj 1         : Catalog
@@ -54,8 +101,10 @@
  * obj 4         : Font /F2 — Courier-Oblique (italic, used only when /f active)
  * obj 5..5+N-1  : Page objects  (N = actual page count, max MAX_PAGES)
  * obj 5+N..4+2N : Content streams (consecutive after pages)
- * Total max objects: 4 + MAX_PAGES*2 = 132
+ * then          : one /Length object per stream, in the order written
  * Stream object for page i = first_page_obj + page_count + i  (runtime)
+ * Several documents in one PDF (/o) share the font objects; their title
+ * pages come first (2 objects each), then the pages of all of them in order.
  * --------------------------------------------------------------------------- */
 #define OBJ_CATALOG      1u
 #define OBJ_PAGES        2u
@@ -67,15 +116,16 @@
 #define OBJ_FONTDESC     6u   /* /FontDescriptor (/pl only) */
 #define OBJ_FONTFILE     7u   /* /FontFile2 TTF stream (/pl only) */
 #define OBJ_TOUNICODE    8u   /* /ToUnicode CMap stream (/pl only) */
-#define MAX_OBJS         (8u + 2u + MAX_PAGES * 2u + 2u)  /* +4 TTF objs, +2 title, +2 TOC */
+#define MAX_OBJS         (8u + MAX_DOCS * 3u + MAX_PAGES * 3u + 2u + 3u)  /* +4 TTF objs, titles, pages, TOC, lengths */
 
 /* page numbering modes */
 #define PGNUM_NONE  0u   /* no page numbers */
 #define PGNUM_FULL  1u   /* "strona N z T" */
 #define PGNUM_SHORT 2u   /* "- N -" */
 
-/* TOC: max entries = MAX_PAGES (one h==1 heading per page at most) */
-#define TOC_MAX     MAX_PAGES
+/* TOC: max entries, more than one TOC page holds at any font size */
+#define TOC_MAX     128u
+#define TOC_INDENT_MAX 16u   /* (9 - 1) * 2 spaces before a level 9 entry */
 
 /* ---- formatting mode ----------------------------------------------------- */
 
@@ -100,7 +150,10 @@
 void *__fastcall__ argv_mem(size_t size) { return malloc(size); }
 
 static int           pdf_fd;
+static int           ttf_fd = -1;       /* TTF_MONO with /pl, TTF_PROP with /pr */
 static unsigned long pdf_pos;            /* running byte offset in output file */
+static unsigned      out_len;            /* bytes waiting at XRAM_OUT */
+static unsigned      next_len_obj;       /* next free object for a stream /Length */
 static unsigned long obj_off[MAX_OBJS + 1u]; /* 1-based: obj_off[n] = file offset */
 
 static char inname[FNAMELEN];
@@ -116,16 +169,24 @@ static unsigned font_h_pt;       /* normal line height: base_size * 12 / 10 */
 
 static uint8_t  fmt_mode;        /* FMT_NONE / FMT_ASM / FMT_MD */
 static uint8_t  page_num_mode;   /* PGNUM_NONE / PGNUM_FULL / PGNUM_SHORT */
-static uint8_t  want_polish;     /* 1 if /pl flag — embed DroidSansMono TTF, remap CP852 */
+static uint8_t  want_deflate;    /* 1 if /d flag — streams go through dfl_put() */
+static uint8_t  z_on;            /* inside a deflated stream */
+static unsigned long z_s1, z_s2; /* Adler-32 of the stream's plain bytes */
+static uint8_t  want_polish;     /* 1 if /pl or /pr flag — embed the TTF, remap CP852 */
+static uint8_t  want_prop;       /* 1 if /pr flag — DroidSans, layout by glyph widths */
+static unsigned line_w;          /* usable width in 1/64 pt (/pr) */
 static unsigned first_page_obj;  /* first page object number (5 without /pl, 8 with /pl) */
 static uint8_t  want_toc;        /* 1 if @NX header found */
 static uint8_t  toc_depth;       /* max heading level for TOC (1..9) */
 static uint8_t  toc_at_start;    /* 1 = TOC before content, 0 = after */
-static off_t    file_body_start; /* file offset after @NX line */
+static unsigned long file_body_start; /* file offset after @NX line */
+
+/* line index built by count_pages */
+static unsigned line_count;                  /* records at XRAM_INDEX */
+static uint16_t page_first[MAX_PAGES + 1u];  /* first record of each content page */
 
 /* TOC entries collected during count_pages */
-static uint8_t  toc_page[TOC_MAX];   /* content page number (1-based) for each entry */
-static uint8_t  toc_hashes[TOC_MAX]; /* heading level (hash count) for each entry */
+static uint16_t toc_line[TOC_MAX];   /* line record of each entry */
 static uint8_t  toc_count;           /* number of TOC entries */
 static char     toc_title[LINE_BUF_LEN]; /* optional title after "@NX " on header line */
 
@@ -133,6 +194,16 @@ static uint8_t  has_title_page;          /* 1 if '^' line found after header */
 static char     doc_title[LINE_BUF_LEN]; /* document title (text after '^') */
 static char     doc_author[LINE_BUF_LEN]; /* author line (line after '^' line) */
 
+/* inputs of the run; doc_lo..doc_hi-1 go into the PDF being written */
+static char     doc_name[MAX_DOCS][FNAMELEN];
+static uint8_t  doc_fmt[MAX_DOCS];           /* fmt_mode of each input */
+static uint8_t  doc_titled[MAX_DOCS];        /* 1 if it has a '^' title page */
+static uint16_t doc_first_page[MAX_DOCS + 1u]; /* content pages before it in its PDF */
+static uint8_t  doc_count;
+static uint8_t  doc_lo, doc_hi;
+static uint8_t  cur_doc;                     /* input open on in_fd */
+static int      in_fd = -1;
+
 /* ---- CP852 → GID mapping for Type0/Identity-H encoding ------------------- */
 /*
  * With /pl: DroidSansMono embedded as Type0 CIDFont with /Encoding /Identity-H.
@@ -149,8 +220,12 @@ static char     doc_author[LINE_BUF_LEN]; /* author line (line after '^' line) *
  *   Ł=0x9D  ł=0x88  Ń=0xC5  ń=0xC6  Ó=0xE0  ó=0xA2
  *   Ś=0x97  ś=0x98  Ź=0x8D  ź=0xAB  Ż=0xBD  ż=0xBE
  *
+ * DroidSans (/pr) has the same GIDs for all of these.
+ *
  * Without /pl: cp852_gid[] is not used — Courier Base14 with byte passthrough.
  */
+#define CP852_GIDS  319u   /* highest GID in cp852_gid[] + 1 */
+
 static const uint16_t cp852_gid[256] = {
  /* 00-1F: control chars — GID 0 (.notdef) */
   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
@@ -226,25 +301,50 @@ static const uint16_t cp852_gid[256] = {
               0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-/* ---- XRAM-based file write helpers --------------------------------------- */
+static uint8_t cp_used[32];   /* CP852 bytes printed with /pl, one bit each */
 
-static void pdf_write_chunk(const char *buf, unsigned len) {
-    unsigned done = 0u;
-    unsigned chunk, i;
+/* Mark the CP852 bytes of s[0..n) as printed. */
+static void mark_chars(const char *s, unsigned n) {
+    while (n--) {
+        uint8_t c = (uint8_t)*s++;
+        cp_used[c >> 3] |= (uint8_t)(1u << (c & 7u));
+    }
+}
+
+/* ---- XRAM-based file write helpers --------------------------------------- */
 
-    while (done < len) {
-        chunk = len - done;
-        if (chunk > STAGE_SIZE) chunk = STAGE_SIZE;
+static void pdf_flush(void) {
+    if (out_len) write_xram(XRAM_OUT, out_len, pdf_fd);
+    out_len = 0u;
+}
 
-        RIA.addr0 = XRAM_STAGE;
-        RIA.step0 = 1;
-        for (i = 0u; i < chunk; i++) {
-            RIA.rw0 = (uint8_t)buf[done + i];
+/* Bytes as they go into the file; also the dfl_out of deflated streams */
+static void pdf_emit(const unsigned char *buf, unsigned int len) {
+    pdf_pos += (unsigned long)len;
+    RIA.addr0 = XRAM_OUT + out_len;
+    RIA.step0 = 1;
+    while (len--) {
+        RIA.rw0 = *buf++;
+        if (++out_len == OUT_SIZE) {
+            pdf_flush();
+            RIA.addr0 = XRAM_OUT;
         }
+    }
+}
 
-        write_xram(XRAM_STAGE, chunk, pdf_fd);
-        pdf_pos += (unsigned long)chunk;
-        done    += chunk;
+static void pdf_write_chunk(const char *buf, unsigned len) {
+    uint8_t b;
+    if (!z_on) {
+        pdf_emit((const unsigned char *)buf, len);
+        return;
+    }
+    while (len--) {
+        b = (uint8_t)*buf++;
+        z_s1 += b;
+        if (z_s1 >= 65521UL) z_s1 -= 65521UL;
+        z_s2 += z_s1;
+        if (z_s2 >= 65521UL) z_s2 -= 65521UL;
+        dfl_put(b);
     }
 }
 
@@ -276,46 +376,73 @@ static void end_obj(void) {
     pdf_puts("endobj\n");
 }
 
-/* ---- line reader --------------------------------------------------------- */
-
 /*
- * Read one text line from fd into buf (at most maxlen chars, NUL-terminated).
- * Consumes the line terminator (CR, LF, or CRLF).
- * Returns: number of characters placed in buf (>= 0), or -1 on EOF/error.
- * An empty line returns 0. EOF with no characters returns -1.
+ * Stream /Length is an indirect object written right after the stream, so a
+ * stream is generated once and its length taken from pdf_pos afterwards.
+ * With /d the data is a zlib stream: a 2-byte header, one fixed Huffman
+ * block from dfl_put() and the Adler-32 of the plain bytes.
  */
-static int read_line(int fd, char *buf, unsigned maxlen) {
-    unsigned n = 0u;
-    char c;
-    int  r;
-    uint8_t got_char = 0u;
+static void stream_dict(unsigned n) {
+    begin_obj(n);
+    pdf_puts("<< /Length ");
+    pdf_puti((unsigned long)next_len_obj);
+    pdf_puts(" 0 R");
+    if (want_deflate) pdf_puts(" /Filter /FlateDecode");
+}
 
-    for (;;) {
-        r = read(fd, &c, 1u);
-        if (r <= 0) {
-            if (!got_char) { buf[0] = 0; return -1; }
-            break;
-        }
-        got_char = 1u;
-        if (c == '\r') {
-            r = read(fd, &c, 1u);
-            if (r > 0 && c != '\n') lseek(fd, -1, SEEK_CUR);
-            break;
-        }
-        if (c == '\n') break;
-        if (n < maxlen) buf[n++] = c;
+static unsigned long stream_data(void) {
+    unsigned long start;
+    pdf_puts(" >>\nstream\n");
+    start = pdf_pos;
+    if (want_deflate) {
+        pdf_emit((const unsigned char *)"\x78\x01", 2u);
+        z_s1 = 1UL;
+        z_s2 = 0UL;
+        dfl_start();
+        z_on = 1u;
     }
-    buf[n] = 0;
-    return (int)n;
+    return start;
 }
 
-/* ---- text-op helpers ----------------------------------------------------- */
+static unsigned long begin_stream(unsigned n) {
+    stream_dict(n);
+    return stream_data();
+}
+
+static void end_stream(unsigned long start) {
+    unsigned long len;
+    unsigned char adler[4];
+    if (z_on) {
+        z_on = 0u;
+        dfl_end();
+        adler[0] = (unsigned char)(z_s2 >> 8);
+        adler[1] = (unsigned char)z_s2;
+        adler[2] = (unsigned char)(z_s1 >> 8);
+        adler[3] = (unsigned char)z_s1;
+        pdf_emit(adler, 4u);
+    }
+    len = pdf_pos - start;
+    pdf_puts("endstream\n");
+    end_obj();
+    begin_obj(next_len_obj++);
+    pdf_puti(len);
+    pdf_putc('\n');
+    end_obj();
+}
+
+/* "(" + src[0..len) with '(', ')' and '\' escaped, one chunk per line */
+static void pdf_put_string(const char *src, unsigned len) {
+    static char tmp[2u * (LINE_BUF_LEN + TOC_INDENT_MAX) + 1u];
+    unsigned i, n = 0u;
+    tmp[n++] = '(';
+    for (i = 0u; i < len; i++) {
+        char ch = src[i];
+        if (ch == '(' || ch == ')' || ch == '\\') tmp[n++] = '\\';
+        tmp[n++] = ch;
+    }
+    pdf_write_chunk(tmp, n);
+}
 
-/*
- * Count bytes that "(text) Tj\nT*\n" would emit for src[0..len).
- * Parens and backslash need escaping with '\'.
- * Total = 1('(') + len + escapes + 8(") Tj\nT*\n")
- */
 /* hex nibble helper */
 static char hex_nibble(unsigned v) {
     v &= 0xFu;
@@ -329,102 +456,212 @@ static void pdf_put_hex_byte(uint8_t b) {
     pdf_write_chunk(buf, 2u);
 }
 
-/*
- * Without /pl: "(text) Tj\nT*\n" — standard ASCII string with escaping.
- * With /pl:   "<XXXX...> Tj\nT*\n" — hex string with 2-byte GIDs (Identity-H).
- *   Length = '<'(1) + 4*len + "> Tj\nT*\n"(8) = 9 + 4*len
- */
-static unsigned long measure_text_op(const char *src, unsigned len) {
-    unsigned long sz;
-    unsigned i;
-    if (want_polish) {
-        sz = 9UL + 4UL * (unsigned long)len;
-    } else {
-        sz = 9UL + (unsigned long)len;
-        for (i = 0u; i < len; i++) {
-            if (src[i] == '(' || src[i] == ')' || src[i] == '\\') sz++;
-        }
+/* "<" + 2-byte GID of each CP852 char in src[0..len) as hex, one chunk per line */
+static void pdf_put_gids(const char *src, unsigned len) {
+    static char tmp[4u * LINE_BUF_LEN + 1u];
+    unsigned i, n = 0u;
+    tmp[n++] = '<';
+    for (i = 0u; i < len; i++) {
+        uint16_t gid = cp852_gid[(uint8_t)src[i]];
+        tmp[n++] = hex_nibble(gid >> 12);
+        tmp[n++] = hex_nibble(gid >> 8);
+        tmp[n++] = hex_nibble(gid >> 4);
+        tmp[n++] = hex_nibble(gid);
     }
-    return sz;
+    pdf_write_chunk(tmp, n);
 }
 
-static void emit_text_op(const char *src, unsigned len) {
-    unsigned i;
+/* GID of c as hex, n times — continues a string from pdf_put_gids() */
+static void pdf_put_gid_run(char c, unsigned n) {
+    uint16_t gid = cp852_gid[(uint8_t)c];
+    char     hex[4];
+    hex[0] = hex_nibble(gid >> 12);
+    hex[1] = hex_nibble(gid >> 8);
+    hex[2] = hex_nibble(gid >> 4);
+    hex[3] = hex_nibble(gid);
+    while (n--) pdf_write_chunk(hex, 4u);
+}
+
+/* The string operand in the encoding of /F1: "(text)", or "<GIDs>" with /pl */
+static void pdf_put_text(const char *src, unsigned len) {
     if (want_polish) {
-        pdf_putc('<');
-        for (i = 0u; i < len; i++) {
-            uint16_t gid = cp852_gid[(uint8_t)src[i]];
-            pdf_put_hex_byte((uint8_t)(gid >> 8));
-            pdf_put_hex_byte((uint8_t)gid);
-        }
-        pdf_puts("> Tj\nT*\n");
+        pdf_put_gids(src, len);
+        pdf_putc('>');
     } else {
-        char esc[2];
-        esc[1] = 0;
-        pdf_putc('(');
-        for (i = 0u; i < len; i++) {
-            char ch = src[i];
-            if (ch == '(' || ch == ')' || ch == '\\') {
-                esc[0] = '\\'; pdf_write_chunk(esc, 1u);
+        pdf_put_string(src, len);
+        pdf_putc(')');
+    }
+}
+
+/* ---- glyph widths (/pr) ---------------------------------------------------- */
+
+/*
+ * ttf_widths() leaves the advance width of every CP852 byte at XRAM_WIDTHS in
+ * 1/1000 em, as the /W array of the font gives them. Layout is done in 1/64 pt
+ * at one font size: use_size() scales the table into wtab[] and keeps the
+ * scaled copy in one of WC_SLOTS XRAM slots, so going back to the body size
+ * after a heading is a copy and not 256 divisions. The scaled widths are
+ * rounded up, so what fits by wtab[] fits on paper. Sums of widths stay within
+ * 16 bits: no more than line_w (at most 595 * 64) is ever added up.
+ */
+static uint16_t wtab[256];           /* widths at wtab_size, 1/64 pt */
+static unsigned wtab_size;           /* 0 = none yet */
+static uint8_t  wc_size[WC_SLOTS];   /* font size of each XRAM slot, 0 = empty */
+static uint8_t  wc_next;             /* slot to fill next */
+
+static void use_size(unsigned size) {
+    unsigned i, s, w;
+
+    if (size == wtab_size) return;
+    wtab_size = size;
+    RIA.step1 = 1;
+    for (s = 0u; s < WC_SLOTS; s++) {
+        if (wc_size[s] == size) {
+            RIA.addr1 = XRAM_WCACHE + s * 512u;
+            for (i = 0u; i < 256u; i++) {
+                w  = RIA.rw1;
+                w |= (unsigned)RIA.rw1 << 8;
+                wtab[i] = w;
             }
-            esc[0] = ch; pdf_write_chunk(esc, 1u);
+            return;
         }
-        pdf_puts(") Tj\nT*\n");
     }
+
+    /* not cached: scale the font's widths into the oldest slot */
+    s = wc_next;
+    wc_next = (uint8_t)((s + 1u) % WC_SLOTS);
+    wc_size[s] = (uint8_t)size;
+    RIA.addr0 = XRAM_WIDTHS;
+    RIA.step0 = 1;
+    RIA.addr1 = XRAM_WCACHE + s * 512u;
+    for (i = 0u; i < 256u; i++) {
+        w  = RIA.rw0;
+        w |= (unsigned)RIA.rw0 << 8;
+        w  = (unsigned)(((unsigned long)w * (size * 64u) + 999UL) / 1000UL);
+        wtab[i] = w;
+        RIA.rw1 = (uint8_t)w;
+        RIA.rw1 = (uint8_t)(w >> 8);
+    }
+}
+
+/* Chars of s[0..n) that fit in max_w at the current size; their width to *w. */
+static unsigned fit_w(const char *s, unsigned n, unsigned max_w, unsigned *w) {
+    unsigned i, sum = 0u, cw;
+    for (i = 0u; i < n; i++) {
+        cw = wtab[(uint8_t)s[i]];
+        if (sum + cw > max_w) break;
+        sum += cw;
+    }
+    *w = sum;
+    return i;
+}
+
+/*
+ * First row of s[0..n) in line_w: up to the last space that fits, or cut
+ * inside a word longer than the row. Returns the chars to print (trailing
+ * spaces dropped), their width to *w and where the next row starts to *next.
+ */
+static unsigned wrap_row(const char *s, unsigned n, unsigned *w, unsigned *next) {
+    unsigned k = fit_w(s, n, line_w, w), j;
+
+    if (k < n) {
+        for (j = k; j > 0u && s[j] != ' '; j--) ;
+        if (j > 0u)       k = j;
+        else if (k == 0u) k = 1u;      /* one glyph wider than the line */
+    }
+    *next = k;
+    while (*next < n && s[*next] == ' ') (*next)++;
+    while (k > 0u && s[k - 1u] == ' ') k--;
+    fit_w(s, k, line_w, w);
+    return k;
+}
+
+/* Rows the body line s[0..n) takes at base_size. */
+static unsigned prop_rows(const char *s, unsigned n) {
+    unsigned rows = 0u, pos = 0u, w, next;
+    use_size(base_size);
+    do {
+        wrap_row(s + pos, n - pos, &w, &next);
+        pos += next;
+        rows++;
+    } while (pos < n);
+    return rows;
+}
+
+/* ---- text-op helpers ----------------------------------------------------- */
+
+/*
+ * Without /pl: "(text) Tj\nT*\n" — standard ASCII string with escaping.
+ * With /pl:   "<XXXX...> Tj\nT*\n" — hex string with 2-byte GIDs (Identity-H).
+ */
+static void emit_text_op(const char *src, unsigned len) {
+    pdf_put_text(src, len);
+    pdf_puts(" Tj\nT*\n");
+}
+
+/*
+ * A wrapped row of a /pr line stretched to the full width: the space left is
+ * shared by its spaces as TJ adjustments in 1/1000 em (Tw does not apply to
+ * 2-byte codes). It is measured on the unscaled widths, as the reader will:
+ *   "[<XXXX...0003> -A <XXXX...>] TJ\nT*\n"
+ */
+static void emit_just_op(const char *src, unsigned len) {
+    unsigned i, start = 0u, gaps = 0u, adj, rem, w;
+    unsigned long extra, sum = 0UL;
+
+    RIA.step1 = 1;
+    for (i = 0u; i < len; i++) {
+        if (src[i] == ' ') gaps++;
+        RIA.addr1 = XRAM_WIDTHS + (unsigned)(uint8_t)src[i] * 2u;
+        w  = RIA.rw1;
+        w |= (unsigned)RIA.rw1 << 8;
+        sum += w;
+    }
+    extra = (unsigned long)line_w * 1000UL / (64UL * base_size);
+    extra = extra > sum ? extra - sum : 0UL;
+    if (gaps == 0u || extra == 0UL) {
+        emit_text_op(src, len);
+        return;
+    }
+    adj = (unsigned)(extra / gaps);
+    rem = (unsigned)(extra % gaps);
+
+    pdf_putc('[');
+    for (i = 0u; i < len; i++) {
+        if (src[i] != ' ') continue;
+        pdf_put_gids(src + start, i + 1u - start);
+        pdf_puts("> -");
+        pdf_puti((unsigned long)(adj + (rem ? 1u : 0u)));
+        pdf_putc(' ');
+        if (rem) rem--;
+        start = i + 1u;
+    }
+    pdf_put_gids(src + start, len - start);
+    pdf_puts(">] TJ\nT*\n");
+}
+
+/* Chars of a heading s[0..len) that fit on a line at font size fsize. */
+static unsigned heading_fit(const char *s, unsigned len, unsigned fsize) {
+    unsigned usable = PAGE_W_PT - left_pt - right_pt;
+    unsigned fw = (fsize * 6u) / 10u, w;
+    if (want_prop) {
+        use_size(fsize);
+        return fit_w(s, len, line_w, &w);
+    }
+    fw = fw ? usable / fw : usable;     /* columns */
+    return len > fw ? fw : len;         /* truncate — no wrap for headings */
 }
 
 /*
- * Measure bytes for a heading line with pre-gap, font change, text, post-advance.
- * Sequence emitted by emit_heading_op:
+ * Heading line with pre-gap, font change, text, post-advance:
  *   "0 -PRE Td\n"  — space before heading
  *   "/F1 SS Tf\n"  — switch font size
  *   "(text) Tj\n"  — text (no T* — manual Td)
  *   "0 -ADV Td\n"  — advance by heading line height
  *   "/F1 10 Tf\n"  — restore normal font size
  */
-static unsigned long measure_td(unsigned v) {
-    /* "0 -V Td\n": "0 -"(3) + digits(V) + " Td\n"(4) = 7 + digits */
-    unsigned long sz = 8UL; /* 7 fixed + 1 base digit */
-    if (v >= 10u)  sz++;
-    if (v >= 100u) sz++;
-    return sz;
-}
-
-static unsigned long measure_heading_op(const char *src, unsigned len,
-                                        unsigned font_size, unsigned adv,
-                                        unsigned pre) {
-    unsigned long sz = 0UL;
-    unsigned i;
-    /* "0 -PRE Td\n" */
-    sz += measure_td(pre);
-    /* "/F1 SS Tf\n": "/F1 "(4) + digits(SS) + " Tf\n"(4) = 8 + digits(SS) */
-    sz += 9UL;
-    if (font_size >= 10u) sz++;
-    if (font_size >= 100u) sz++;
-    /* text string + " Tj\n" */
-    if (want_polish) {
-        /* "<XXXX...> Tj\n": '<'(1) + 4*len + '>'(1) + " Tj\n"(4) = 6 + 4*len */
-        sz += 6UL + 4UL * (unsigned long)len;
-    } else {
-        /* "(text) Tj\n": 1 + len + escapes + 5 = 6 + len + escapes */
-        sz += 6UL + (unsigned long)len;
-        for (i = 0u; i < len; i++) {
-            if (src[i] == '(' || src[i] == ')' || src[i] == '\\') sz++;
-        }
-    }
-    /* "0 -ADV Td\n" */
-    sz += measure_td(adv);
-    /* "/F1 BS Tf\n": restore base_size */
-    sz += 9UL;
-    if (base_size >= 10u) sz++;
-    if (base_size >= 100u) sz++;
-    return sz;
-}
-
 static void emit_heading_op(const char *src, unsigned len,
                             unsigned font_size, unsigned adv, unsigned pre) {
-    unsigned i;
-
     /* space before heading */
     pdf_puts("0 -");
     pdf_puti((unsigned long)pre);
@@ -436,27 +673,8 @@ static void emit_heading_op(const char *src, unsigned len,
     pdf_puts(" Tf\n");
 
     /* emit text (no T* — manual Td advance) */
-    if (want_polish) {
-        pdf_putc('<');
-        for (i = 0u; i < len; i++) {
-            uint16_t gid = cp852_gid[(uint8_t)src[i]];
-            pdf_put_hex_byte((uint8_t)(gid >> 8));
-            pdf_put_hex_byte((uint8_t)gid);
-        }
-        pdf_puts("> Tj\n");
-    } else {
-        char esc[2];
-        esc[1] = 0;
-        pdf_putc('(');
-        for (i = 0u; i < len; i++) {
-            char ch = src[i];
-            if (ch == '(' || ch == ')' || ch == '\\') {
-                esc[0] = '\\'; pdf_write_chunk(esc, 1u);
-            }
-            esc[0] = ch; pdf_write_chunk(esc, 1u);
-        }
-        pdf_puts(") Tj\n");
-    }
+    pdf_put_text(src, len);
+    pdf_puts(" Tj\n");
 
     /* advance by heading line height */
     pdf_puts("0 -");
@@ -470,24 +688,17 @@ static void emit_heading_op(const char *src, unsigned len,
 }
 
 /*
- * Measure bytes for italic comment line:
+ * Italic comment line:
  *   "/F2 BS Tf\n"  — switch to italic
  *   "(text) Tj\nT*\n"
  *   "/F1 BS Tf\n"  — restore normal
- * "/FN BS Tf\n": "/FN "(4) + digits(BS) + " Tf\n"(4) = 8 + digits
+ * With /pl the GIDs mean nothing to Courier-Oblique: the line stays upright.
  */
-static unsigned long measure_font_switch(void) {
-    unsigned long sz = 9UL; /* 8 fixed + 1 base digit */
-    if (base_size >= 10u)  sz++;
-    if (base_size >= 100u) sz++;
-    return sz;
-}
-
-static unsigned long measure_italic_op(const char *src, unsigned len) {
-    return measure_font_switch() + measure_text_op(src, len) + measure_font_switch();
-}
-
 static void emit_italic_op(const char *src, unsigned len) {
+    if (want_polish) {
+        emit_text_op(src, len);
+        return;
+    }
     pdf_puts("/F2 ");
     pdf_puti((unsigned long)base_size);
     pdf_puts(" Tf\n");
@@ -517,17 +728,73 @@ static unsigned count_hashes(const char *buf, uint8_t *force_np) {
     return n - (unsigned)*force_np; /* return hash count without the '>' */
 }
 
-/* ---- content stream ------------------------------------------------------- */
+/* ---- line index ----------------------------------------------------------- */
+
+typedef struct {
+    unsigned long off;   /* file offset of the line */
+    uint8_t       kind;  /* LINE_HASHES level | LINE_NP | LINE_ITALIC */
+    uint8_t       rows;  /* lines_per_page rows the line takes */
+    uint8_t       page;  /* content page number (1-based) */
+} line_rec_t;
+
+static void put_line_rec(unsigned i, const line_rec_t *r) {
+    RIA.addr1 = XRAM_INDEX + i * LINE_REC;
+    RIA.step1 = 1;
+    RIA.rw1 = (uint8_t)r->off;
+    RIA.rw1 = (uint8_t)(r->off >> 8);
+    RIA.rw1 = (uint8_t)(r->off >> 16);
+    RIA.rw1 = r->kind;
+    RIA.rw1 = r->rows;
+    RIA.rw1 = r->page;
+}
 
-/*
- * EMIT_S / EMIT_I / EMIT_C macros: measure or write depending on measure_only.
- */
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
+static void get_line_rec(unsigned i, line_rec_t *r) {
+    RIA.addr1 = XRAM_INDEX + i * LINE_REC;
+    RIA.step1 = 1;
+    r->off  = RIA.rw1;
+    r->off |= (unsigned)RIA.rw1 << 8;
+    r->off |= (unsigned long)RIA.rw1 << 16;
+    r->kind = RIA.rw1;
+    r->rows = RIA.rw1;
+    r->page = RIA.rw1;
+}
+
+/* ---- inputs ---------------------------------------------------------------- */
+
+/* Make input d the one the line reader serves; 0 if it cannot be opened. */
+static uint8_t use_doc(uint8_t d) {
+    if (in_fd >= 0 && d == cur_doc) return 1u;
+    if (in_fd >= 0) close(in_fd);
+    cur_doc  = d;
+    fmt_mode = doc_fmt[d];
+    in_fd    = open(doc_name[d], O_RDONLY);
+    if (in_fd < 0) {
+        printf(EXCLAMATION "cannot open %s" NEWLINE, doc_name[d]);
+        return 0u;
+    }
+    lr_open(in_fd);
+    return 1u;
+}
+
+/* Switch to the input that content page `page` (1-based) comes from. */
+static void use_page_doc(unsigned page) {
+    uint8_t d = cur_doc;
+    if (d < doc_lo || d >= doc_hi || page <= doc_first_page[d]) d = doc_lo;
+    while (d + 1u < doc_hi && page > doc_first_page[d + 1u]) d++;
+    use_doc(d);
+}
+
+/* Seek to the line of record i and read its text; returns its length. */
+static unsigned read_indexed_line(unsigned i, line_rec_t *r, char *lbuf) {
+    int n;
+    get_line_rec(i, r);
+    if (doc_hi > doc_lo + 1u) use_page_doc(r->page);
+    lr_seek(r->off);
+    n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+    return n > 0 ? (unsigned)n : 0u;
+}
+
+/* ---- content stream ------------------------------------------------------- */
 
 /*
  * Compute advance in "lines_per_page units" for a heading.
@@ -539,265 +806,211 @@ static unsigned heading_line_units(unsigned adv) {
 }
 
 /*
- * Measure (dry-run) or emit the BT...ET block for one page.
- * Reads lines from current fd position; stops after lines_per_page rows consumed
- * or EOF.  "rows" for a heading = ceil(adv / FONT_H_PT).
- *
- * Returns byte count when measure_only, 0 otherwise.
- * After return, fd is positioned past all lines consumed for this page.
+ * Emit the BT...ET block for content page pg (0-based).
+ * The lines and their layout come from the index; only the text is read.
+ * "rows" for a heading = ceil(adv / FONT_H_PT).
  */
-static unsigned long content_block(int in_fd, uint8_t mo) {
+static void content_block(unsigned pg) {
     char     lbuf[LINE_BUF_LEN];
-    int      n;
-    unsigned cur_line = 0u;   /* rows consumed so far */
-    unsigned long sz  = 0UL;
+    unsigned i;
+    line_rec_t rec;
 
     /* BT header */
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n");
-    EMIT_I(left_pt);
-    EMIT_S(" ");
-    EMIT_I(PAGE_H_PT - top_pt - font_h_pt);
-    EMIT_S(" Td\n0 -");
-    EMIT_I(font_h_pt);
-    EMIT_S(" TD\n");
-
-    while (cur_line < lines_per_page) {
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)left_pt);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)(PAGE_H_PT - top_pt - font_h_pt));
+    pdf_puts(" Td\n0 -");
+    pdf_puti((unsigned long)font_h_pt);
+    pdf_puts(" TD\n");
+
+    for (i = page_first[pg]; i < page_first[pg + 1u]; i++) {
         unsigned offset    = 0u;
-        unsigned remaining;
-        unsigned hashes    = 0u;
-        uint8_t  italic    = 0u;
-        uint8_t  force_np  = 0u;
-        unsigned row_adv   = 1u;   /* how many lines_per_page rows this line uses */
-
-        n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-        if (n < 0) break;
-
-        remaining = (unsigned)n;
-
-        /* classify the line for formatting */
-        if (fmt_mode == FMT_ASM && remaining > 0u && lbuf[0] == ';') {
-            italic = 1u;
-        } else if ((fmt_mode == FMT_MD || want_toc) && remaining > 0u) {
-            hashes = count_hashes(lbuf, &force_np);
-            if (fmt_mode != FMT_MD) hashes = 0u; /* detect only for force_np */
-        }
-
-        /* force new page: push line back and break to end current page */
-        if (force_np && cur_line > 0u) {
-            lseek(in_fd, -(off_t)(remaining + 1u), SEEK_CUR);
-            break;
-        }
+        unsigned remaining = read_indexed_line(i, &rec, lbuf);
+        unsigned hashes    = (fmt_mode == FMT_MD) ? (unsigned)(rec.kind & LINE_HASHES) : 0u;
+        uint8_t  italic    = (rec.kind & LINE_ITALIC) ? 1u : 0u;
 
         if (hashes > 0u) {
             /* skip "###" + optional ">" + optional " " */
-            unsigned gt   = force_np ? 1u : 0u;
+            unsigned gt   = (rec.kind & LINE_NP) ? 1u : 0u;
             unsigned skip = hashes + gt + (lbuf[hashes + gt] == ' ' ? 1u : 0u);
             const char *text = lbuf + skip;
             unsigned text_len;
-            unsigned fsize, fadv, fpre, fw, max_cols;
+            unsigned fsize, fadv, fpre;
 
             fsize = HEAD_SIZE(base_size, hashes);
             fpre  = HEAD_PRE(hashes);
             fadv  = HEAD_ADV(base_size, hashes);
-            fw    = (fsize * 6u) / 10u;
-
-            /* available width in chars at this heading font size */
-            {
-                unsigned usable_w = PAGE_W_PT - left_pt - right_pt;
-                max_cols = usable_w / fw;
-            }
-            text_len = (unsigned)strlen(text);
-            if (text_len > max_cols) text_len = max_cols; /* truncate — no wrap for headings */
-
-            row_adv = heading_line_units(fadv + fpre);
-            if (cur_line + row_adv > lines_per_page) {
-                /* heading doesn't fit on this page — push back and end page */
-                lseek(in_fd, -(off_t)(remaining + 1u), SEEK_CUR);
-                break;
-            }
-
-            if (mo) sz += measure_heading_op(text, text_len, fsize, fadv, fpre);
-            else    emit_heading_op(text, text_len, fsize, fadv, fpre);
 
-            cur_line += row_adv;
+            text_len = heading_fit(text, (unsigned)strlen(text), fsize);
+
+            emit_heading_op(text, text_len, fsize, fadv, fpre);
+        } else if (want_prop) {
+            /* word wrap by glyph width, every row but the last justified */
+            use_size(base_size);
+            do {
+                unsigned w, next, len = wrap_row(lbuf + offset, remaining, &w, &next);
+                if (next < remaining) emit_just_op(lbuf + offset, len);
+                else                  emit_text_op(lbuf + offset, len);
+                offset    += next;
+                remaining -= next;
+            } while (remaining > 0u);
         } else {
             /* normal or italic line — wrap at chars_per_line */
             while (remaining > chars_per_line) {
                 if (italic) {
-                    if (mo) sz += measure_italic_op(lbuf + offset, chars_per_line);
-                    else    emit_italic_op(lbuf + offset, chars_per_line);
+                    emit_italic_op(lbuf + offset, chars_per_line);
                 } else {
-                    if (mo) sz += measure_text_op(lbuf + offset, chars_per_line);
-                    else    emit_text_op(lbuf + offset, chars_per_line);
+                    emit_text_op(lbuf + offset, chars_per_line);
                 }
                 offset    += chars_per_line;
                 remaining -= chars_per_line;
-                cur_line++;
-                if (cur_line >= lines_per_page) goto page_full;
             }
 
             /* last (or only) segment */
             if (italic) {
-                if (mo) sz += measure_italic_op(lbuf + offset, remaining);
-                else    emit_italic_op(lbuf + offset, remaining);
+                emit_italic_op(lbuf + offset, remaining);
             } else {
-                if (mo) sz += measure_text_op(lbuf + offset, remaining);
-                else    emit_text_op(lbuf + offset, remaining);
+                emit_text_op(lbuf + offset, remaining);
             }
-            cur_line++;
         }
     }
 
-page_full:
-    EMIT_S("ET\n");
+    pdf_puts("ET\n");
 
-#undef EMIT_S
-#undef EMIT_I
-
-    return sz;
 }
 
 /* ---- page counting ------------------------------------------------------- */
 
-static unsigned count_pages(int fd) {
+/*
+ * The only pass over the body: classify every printed line, lay the lines out
+ * on pages and write their records to the index. A line that does not fit in
+ * the rows left on a page starts the next one, so the streams, the TOC and
+ * the page count all agree.
+ * The records of an input follow those of the inputs before it in the PDF,
+ * which have `pages` content pages; it starts on a page of its own.
+ * Returns the number of content pages so far, 0 if the index or MAX_PAGES is full.
+ */
+static unsigned count_pages(unsigned pages) {
     char     lbuf[LINE_BUF_LEN];
     int      n;
     unsigned cur_line = 0u;
-    unsigned pages    = 1u;
+    line_rec_t rec;
+
+    if (pages == MAX_PAGES) {
+        printf(EXCLAMATION "too many pages (max %u)" NEWLINE, MAX_PAGES);
+        return 0u;
+    }
+    page_first[pages++] = (uint16_t)line_count;
 
-    toc_count = 0u;
-    lseek(fd, file_body_start, SEEK_SET);
+    lr_seek(file_body_start);
 
-    while ((n = read_line(fd, lbuf, LINE_BUF_LEN - 1u)) >= 0) {
-        unsigned rows = 1u;
-        unsigned h    = 0u;
+    for (;;) {
+        unsigned h = 0u;
+        uint8_t  fnp = 0u;
+
+        rec.off = lr_tell();
+        n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+        if (n < 0) break;
+        if (want_polish) mark_chars(lbuf, (unsigned)n);
 
-        if ((fmt_mode == FMT_MD || want_toc) && n > 0) {
-            uint8_t fnp = 0u;
+        rec.kind = 0u;
+        if (fmt_mode == FMT_ASM && n > 0 && lbuf[0] == ';') {
+            rec.kind = LINE_ITALIC;
+        } else if ((fmt_mode == FMT_MD || want_toc) && n > 0) {
             h = count_hashes(lbuf, &fnp);
-            if (h > 0u) {
-                if (fmt_mode == FMT_MD) {
-                    unsigned fadv = HEAD_ADV(base_size, h);
-                    unsigned fpre = HEAD_PRE(h);
-                    rows = heading_line_units(fadv + fpre);
-                }
-                /* force new page: flush remaining rows to next page */
-                if (fnp && cur_line > 0u) {
-                    pages++;
-                    cur_line = 0u;
-                }
-            }
+            if (h > LINE_HASHES) h = LINE_HASHES;
+            rec.kind = (uint8_t)h | (fnp ? LINE_NP : 0u);
         }
 
-        /* wrap: each wrapped segment is one additional row */
-        if (h == 0u) {
+        if (h > 0u && fmt_mode == FMT_MD) {
+            rec.rows = (uint8_t)heading_line_units(HEAD_ADV(base_size, h) + HEAD_PRE(h));
+        } else if (want_prop) {
+            rec.rows = (uint8_t)prop_rows(lbuf, (unsigned)n);
+        } else {
+            /* wrap: each wrapped segment is one additional row */
             unsigned col = (unsigned)n;
-            rows = 0u;
-            while (col > chars_per_line) { rows++; col -= chars_per_line; }
-            rows++; /* last segment */
+            rec.rows = 1u;
+            while (col > chars_per_line) { rec.rows++; col -= chars_per_line; }
         }
 
-        /* record TOC entry */
-        if (h >= 1u && want_toc && h <= (unsigned)toc_depth && toc_count < TOC_MAX) {
-            toc_page[toc_count]   = (uint8_t)pages;
-            toc_hashes[toc_count] = (uint8_t)h;
-            toc_count++;
+        /* force new page, or the line does not fit on this one */
+        if (cur_line > 0u && (fnp || cur_line + rec.rows > lines_per_page)) {
+            if (pages == MAX_PAGES) {
+                printf(EXCLAMATION "too many pages (max %u)" NEWLINE, MAX_PAGES);
+                return 0u;
+            }
+            page_first[pages++] = (uint16_t)line_count;
+            cur_line = 0u;
         }
-
-        cur_line += rows;
-        while (cur_line >= lines_per_page) {
-            pages++;
-            cur_line -= lines_per_page;
+        if (line_count == MAX_LINES) {
+            printf(EXCLAMATION "too many lines (max %u)" NEWLINE, MAX_LINES);
+            return 0u;
         }
+
+        /* record TOC entry */
+        if (h >= 1u && want_toc && h <= (unsigned)toc_depth && toc_count < TOC_MAX)
+            toc_line[toc_count++] = (uint16_t)line_count;
+
+        rec.page = (uint8_t)pages;
+        put_line_rec(line_count++, &rec);
+        cur_line += rec.rows;
     }
+    page_first[pages] = (uint16_t)line_count;
     return pages;
 }
 
 /* ---- page number footer --------------------------------------------------- */
 
+/* Decimal digits of v into buf; returns their count. */
+static unsigned put_dec(char *buf, unsigned v) {
+    char     tmp[5];
+    unsigned n = 0u, i = 0u;
+    do { tmp[n++] = (char)('0' + v % 10u); v /= 10u; } while (v);
+    while (n) buf[i++] = tmp[--n];
+    return i;
+}
+
 /*
- * Measure / emit a page-number footer BT block.
+ * Emit a page-number footer BT block.
  * Positioned at bottom_pt - MM_TO_PT(5), centred horizontally.
  * PGNUM_FULL : "page N of T"
  * PGNUM_SHORT: "- N -"
- * Uses base_size font (/F1).
+ * Uses base_size font (/F1); with /pr centred by glyph widths.
+ * pgnum_str() leaves the text in buf (16 chars) and returns its length.
  */
-static unsigned long measure_pgnum_str(unsigned pgn, unsigned total) {
-    /* count decimal digits */
-    unsigned long sz = 0UL;
-    unsigned v;
+static unsigned pgnum_str(char *buf, unsigned pgn, unsigned total) {
+    unsigned n;
     if (page_num_mode == PGNUM_FULL) {
-        /* "strona " + digits(N) + " z " + digits(T) */
-        sz = 7UL + 3UL; /* "page "(7) + " of "(3) */
-        v = pgn;  do { sz++; v /= 10u; } while (v);
-        v = total; do { sz++; v /= 10u; } while (v);
+        memcpy(buf, "strona ", 7u);
+        n  = 7u + put_dec(buf + 7u, pgn);
+        memcpy(buf + n, " z ", 3u);
+        n += 3u;
+        n += put_dec(buf + n, total);
     } else {
-        /* "- " + digits(N) + " -" */
-        sz = 4UL; /* "- "(2) + " -"(2) */
-        v = pgn; do { sz++; v /= 10u; } while (v);
+        buf[0] = '-';
+        buf[1] = ' ';
+        n  = 2u + put_dec(buf + 2u, pgn);
+        buf[n++] = ' ';
+        buf[n++] = '-';
     }
-    return sz;
+    return n;
 }
 
-static void emit_pgnum_str(unsigned pgn, unsigned total) {
-    if (page_num_mode == PGNUM_FULL) {
-        pdf_puts("strona ");
-        pdf_puti((unsigned long)pgn);
-        pdf_puts(" z ");
-        pdf_puti((unsigned long)total);
+static void emit_pgnum_block(unsigned pgn, unsigned total) {
+    char     str[16];
+    unsigned str_len = pgnum_str(str, pgn, total);
+    unsigned x_val, w;
+
+    if (want_prop) {
+        use_size(base_size);
+        fit_w(str, str_len, line_w, &w);
+        x_val = (PAGE_W_PT * 64u - w) / 128u;
     } else {
-        pdf_puts("- ");
-        pdf_puti((unsigned long)pgn);
-        pdf_puts(" -");
+        x_val = (PAGE_W_PT - str_len * font_w_pt) / 2u;
     }
-}
-
-/*
- * Measure bytes of the page-number BT block appended to a content stream.
- * "BT\n/F1 BS Tf\nX Y Td\n(text) Tj\nET\n"
- * X is computed to centre the string; it varies with pgn — we use the
- * widest possible string for measurement so measure and emit always agree.
- * Strategy: measure uses same pgn/total as emit (called twice from
- * write_stream_obj with the same args), so they always match.
- */
-static unsigned long measure_pgnum_block(unsigned pgn, unsigned total) {
-    unsigned long str_len  = measure_pgnum_str(pgn, total);
-    unsigned long x_digits;
-    unsigned x_val;
-    unsigned long sz;
-
-    /* X = (PAGE_W_PT - str_len * font_w_pt) / 2 */
-    x_val = (PAGE_W_PT - (unsigned)(str_len * (unsigned long)font_w_pt)) / 2u;
-
-    /* count digits in x_val */
-    x_digits = 0UL;
-    { unsigned v = x_val; do { x_digits++; v /= 10u; } while (v); }
-
-    /* "BT\n/F1 "(7) + digits(base_size) + " Tf\n"(4) = 11+d(bs) */
-    sz  = 11UL;
-    if (base_size >= 10u) sz++;
-    if (base_size >= 100u) sz++;
-
-    /* X digits + " "(1) + Y digits + " Td\n"(4) */
-    { unsigned y_val = (bottom_pt > MM_TO_PT(2u)) ? bottom_pt - MM_TO_PT(2u) : 0u;
-      unsigned long yd = 0UL;
-      if (y_val == 0u) yd = 1UL; else { unsigned v = y_val; do { yd++; v /= 10u; } while (v); }
-      sz += x_digits + 1UL + yd + 4UL; }
-
-    /* "(text) Tj\n" = 1 + str_len + escapes + 5 */
-    sz += 6UL + str_len; /* no special chars in page number string */
-
-    /* "ET\n" */
-    sz += 3UL;
-
-    return sz;
-}
-
-static void emit_pgnum_block(unsigned pgn, unsigned total) {
-    unsigned long str_len = measure_pgnum_str(pgn, total);
-    unsigned x_val = (PAGE_W_PT - (unsigned)(str_len * (unsigned long)font_w_pt)) / 2u;
 
     pdf_puts("BT\n/F1 ");
     pdf_puti((unsigned long)base_size);
@@ -805,45 +1018,38 @@ static void emit_pgnum_block(unsigned pgn, unsigned total) {
     pdf_puti((unsigned long)x_val);
     pdf_putc(' ');
     pdf_puti((unsigned long)((bottom_pt > MM_TO_PT(2u)) ? bottom_pt - MM_TO_PT(2u) : 0u));
-    pdf_puts(" Td\n(");
-    emit_pgnum_str(pgn, total);
-    pdf_puts(") Tj\nET\n");
+    pdf_puts(" Td\n");
+    pdf_put_text(str, str_len);
+    pdf_puts(" Tj\nET\n");
 }
 
 /* ---- TOC stream ----------------------------------------------------------- */
 
 /*
- * Emit the TOC content stream (measure or write).
+ * Emit the TOC content stream.
  * Reads the input file again, collects h==1 heading lines in order,
  * prints each as: "heading text ......... N" where N = page number.
  * Uses base_size font, normal margins.
  */
-static unsigned long toc_block(int in_fd, uint8_t mo, unsigned content_pages) {
+static void toc_block(unsigned content_pages) {
     char     lbuf[LINE_BUF_LEN];
-    int      n;
+    char     tbuf[LINE_BUF_LEN + TOC_INDENT_MAX];
+    unsigned n;
     unsigned cur_line = 0u;
     unsigned toc_idx  = 0u;
-    unsigned long sz  = 0UL;
     unsigned usable_w = PAGE_W_PT - left_pt - right_pt;
 
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
-
     (void)content_pages;
 
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n");
-    EMIT_I(left_pt);
-    EMIT_S(" ");
-    EMIT_I(PAGE_H_PT - top_pt - font_h_pt);
-    EMIT_S(" Td\n0 -");
-    EMIT_I(font_h_pt);
-    EMIT_S(" TD\n");
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)left_pt);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)(PAGE_H_PT - top_pt - font_h_pt));
+    pdf_puts(" Td\n0 -");
+    pdf_puti((unsigned long)font_h_pt);
+    pdf_puts(" TD\n");
 
     /* emit title line if present — rendered as H1 heading style */
     if (toc_title[0]) {
@@ -851,118 +1057,90 @@ static unsigned long toc_block(int in_fd, uint8_t mo, unsigned content_pages) {
         unsigned fsize = HEAD_SIZE(base_size, 1u);
         unsigned fadv  = HEAD_ADV(base_size, 1u);
         unsigned fpre  = HEAD_PRE(1u);
-        unsigned max_cols;
-        { unsigned usable = PAGE_W_PT - left_pt - right_pt;
-          unsigned fw = (fsize * 6u) / 10u;
-          max_cols = fw ? usable / fw : usable; }
-        if (tlen > max_cols) tlen = max_cols;
-        if (mo) sz += measure_heading_op(toc_title, tlen, fsize, fadv, fpre);
-        else    emit_heading_op(toc_title, tlen, fsize, fadv, fpre);
+        tlen = heading_fit(toc_title, tlen, fsize);
+        emit_heading_op(toc_title, tlen, fsize, fadv, fpre);
         cur_line += heading_line_units(fadv + fpre);
     }
 
-    lseek(in_fd, (off_t)file_body_start, SEEK_SET);
-
+    use_size(base_size);
     while (toc_idx < toc_count && cur_line < lines_per_page) {
-        unsigned pgn = 0u, text_start, text_len = 0u, dots = 0u, num_w, i;
+        unsigned text_start, text_len = 0u, dots = 0u, num_w, i;
+        char     num[6];
+        line_rec_t rec;
 
-        /* pre-compute num_w from stored page number (adjusted for TOC position) */
-        { unsigned tpgn = (unsigned)toc_page[toc_idx] + (toc_at_start ? 1u : 0u);
-          num_w = 0u;
-          { unsigned v = tpgn; do { num_w++; v /= 10u; } while (v); }
-        }
+        /* heading text from the file, page and level from its line record */
+        n = read_indexed_line(toc_line[toc_idx], &rec, lbuf);
 
-        /* scan for next heading matching toc_hashes[toc_idx] level */
-        { unsigned want_h = (unsigned)toc_hashes[toc_idx];
-          uint8_t  fnp2   = 0u;
-          while ((n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u)) >= 0) {
-              if (n > 0 && count_hashes(lbuf, &fnp2) == want_h) break;
-          }
-        }
-        if (n < 0) break;
+        /* " N": stored page number, adjusted for the TOC position */
+        num[0] = ' ';
+        num_w  = put_dec(num + 1, (unsigned)rec.page + (toc_at_start ? 1u : 0u));
 
-        { uint8_t fnp2 = 0u;
-          unsigned hh  = count_hashes(lbuf, &fnp2);
-          unsigned gt  = fnp2 ? 1u : 0u;
+        { unsigned hh  = (unsigned)(rec.kind & LINE_HASHES);
+          unsigned gt  = (rec.kind & LINE_NP) ? 1u : 0u;
           text_start   = hh + gt + (lbuf[hh + gt] == ' ' ? 1u : 0u);
-          pgn          = (unsigned)toc_page[toc_idx];
           /* indent by (h-1)*2 spaces for hierarchy */
-          { unsigned indent = ((unsigned)toc_hashes[toc_idx] - 1u) * 2u;
+          { unsigned indent = (hh - 1u) * 2u;
             toc_idx++;
-            text_len = (unsigned)n > text_start ? (unsigned)n - text_start : 0u;
-
-            /* dots fill accounting for indent */
-            { unsigned total_chars = usable_w / font_w_pt;
-              unsigned used = indent + text_len + 1u + num_w;
-              dots = (used < total_chars) ? (total_chars - used) : 0u;
-              if (indent + text_len + 1u + num_w > total_chars) {
-                  if (text_len > total_chars - indent - 1u - num_w)
-                      text_len = total_chars - indent - 1u - num_w;
-                  dots = 0u;
-              }
-            }
-
-            /* emit: "(" + indent spaces + text */
-            if (mo) {
-                sz += 1UL + (unsigned long)indent;
-                sz += (unsigned long)text_len;
-                for (i = 0u; i < text_len; i++)
-                    if (lbuf[text_start + i] == '(' || lbuf[text_start + i] == ')' || lbuf[text_start + i] == '\\') sz++;
+            text_len = n > text_start ? n - text_start : 0u;
+            for (i = 0u; i < indent; i++) tbuf[i] = ' ';
+
+            if (want_prop) {
+                /* dots fill by glyph widths: indent, text, dots, " N" */
+                unsigned iw, nw, tw, avail;
+                fit_w(tbuf, indent, line_w, &iw);
+                fit_w(num, num_w + 1u, line_w, &nw);
+                avail    = line_w > iw + nw ? line_w - iw - nw : 0u;
+                text_len = fit_w(lbuf + text_start, text_len, avail, &tw);
+                dots     = wtab['.'] ? (avail - tw) / wtab['.'] : 0u;
             } else {
-                unsigned ii;
-                char esc[2];
-                esc[1] = 0;
-                pdf_putc('(');
-                for (ii = 0u; ii < indent; ii++) pdf_putc(' ');
-                for (ii = 0u; ii < text_len; ii++) {
-                    char ch = lbuf[text_start + ii];
-                    if ((uint8_t)ch > 0x7Fu) ch = '?';
-                    if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-                    esc[0] = ch; pdf_write_chunk(esc, 1u);
+                /* dots fill accounting for indent */
+                unsigned total_chars = usable_w / font_w_pt;
+                unsigned used = indent + text_len + 1u + num_w;
+                dots = (used < total_chars) ? (total_chars - used) : 0u;
+                if (indent + text_len + 1u + num_w > total_chars) {
+                    if (text_len > total_chars - indent - 1u - num_w)
+                        text_len = total_chars - indent - 1u - num_w;
+                    dots = 0u;
                 }
             }
-            /* dots */
-            if (mo) sz += (unsigned long)dots;
-            else { unsigned ii; for (ii=0u;ii<dots;ii++) pdf_putc('.'); }
-            /* space + page number */
-            { unsigned tpgn = pgn + (toc_at_start ? 1u : 0u);
-              if (mo) {
-                  sz += 1UL;
-                  { unsigned v = tpgn; do { sz++; v /= 10u; } while (v); }
-              } else {
-                  pdf_putc(' ');
-                  { unsigned v = tpgn; int pi = 6; char pb[6];
-                    do { pb[--pi] = (char)('0' + v % 10u); v /= 10u; } while (v);
-                    pdf_write_chunk(pb + pi, (unsigned)(6 - pi)); }
-              }
+
+            /* emit: "(" + indent spaces + text, or their GIDs with /pl */
+            for (i = 0u; i < text_len; i++) {
+                char ch = lbuf[text_start + i];
+                tbuf[indent + i] = ((uint8_t)ch > 0x7Fu && !want_polish) ? '?' : ch;
+            }
+            if (want_polish) {
+                pdf_put_gids(tbuf, indent + text_len);
+                pdf_put_gid_run('.', dots);
+                for (i = 0u; i <= num_w; i++) pdf_put_gid_run(num[i], 1u);
+                pdf_putc('>');
+            } else {
+                pdf_put_string(tbuf, indent + text_len);
+                /* dots */
+                for (i = 0u; i < dots; i++) pdf_putc('.');
+                /* space + page number */
+                pdf_write_chunk(num, num_w + 1u);
+                pdf_putc(')');
             }
-            /* ") Tj\nT*\n" */
-            if (mo) sz += 9UL;
-            else pdf_puts(") Tj\nT*\n");
+            pdf_puts(" Tj\nT*\n");
           }
         }
 
         cur_line++;
     }
 
-    EMIT_S("ET\n");
-
-#undef EMIT_S
-#undef EMIT_I
-
-    return sz;
+    pdf_puts("ET\n");
 }
 
 /* ---- title page stream ---------------------------------------------------- */
 
 /*
- * Emit the title page content stream (measure or write).
+ * Emit the title page content stream.
  * Title   at 1/3 of usable height, centred, 3*base_size pt.
  * Author  at 2/3 of usable height, centred, base_size pt.
  * Positions are absolute Td from page origin (PDF Y=0 at bottom).
  */
-static unsigned long title_page_block(uint8_t mo) {
-    unsigned long sz = 0UL;
+static void title_page_block(void) {
     unsigned title_fsize = base_size * 3u;
     unsigned title_fw    = (title_fsize * 6u) / 10u;
     unsigned usable_h    = PAGE_H_PT - top_pt - bottom_pt;
@@ -972,100 +1150,52 @@ static unsigned long title_page_block(uint8_t mo) {
     unsigned alen = (unsigned)strlen(doc_author);
     unsigned max_title_cols = title_fw ? usable_w / title_fw : usable_w;
     unsigned max_base_cols  = font_w_pt ? usable_w / font_w_pt : usable_w;
-    unsigned tx, ty, ax, ay;
-
-    if (tlen > max_title_cols) tlen = max_title_cols;
-    if (alen > max_base_cols)  alen = max_base_cols;
+    unsigned tx, ty, ax, ay, tw, aw;
 
     /* Y positions: PDF origin at bottom-left */
     ty = bottom_pt + (usable_h * 2u) / 3u;  /* 1/3 from top = 2/3 from bottom */
     ay = bottom_pt + usable_h / 3u;          /* 2/3 from top = 1/3 from bottom */
 
     /* X: centre each string */
-    tx = left_pt + (usable_w > tlen * title_fw ? (usable_w - tlen * title_fw) / 2u : 0u);
-    ax = left_pt + (usable_w > alen * font_w_pt ? (usable_w - alen * font_w_pt) / 2u : 0u);
-
-#define EMIT_S(s)   do { if (mo) { const char *_p=(s); unsigned _l=0u; while(_p[_l])_l++; sz+=(unsigned long)_l; } else pdf_puts(s); } while(0)
-#define EMIT_I(v)   do { unsigned long _v=(unsigned long)(v); char _t[12]; int _i=12; \
-                         if(!_v){if(mo)sz++;else pdf_putc('0');}           \
-                         else{while(_v&&_i){_t[--_i]=(char)('0'+(_v%10UL));_v/=10UL;} \
-                              if(mo)sz+=(unsigned long)(12-_i);else pdf_write_chunk(_t+_i,(unsigned)(12-_i));} \
-                    } while(0)
-
-    /* title: BT /F1 3*base Tf  TX TY Td <hex> Tj ET */
-    EMIT_S("BT\n/F1 ");
-    EMIT_I(title_fsize);
-    EMIT_S(" Tf\n");
-    EMIT_I(tx);
-    EMIT_S(" ");
-    EMIT_I(ty);
-    if (want_polish) {
-        EMIT_S(" Td\n<");
-        { unsigned i;
-          for (i = 0u; i < tlen; i++) {
-              uint16_t gid = cp852_gid[(uint8_t)doc_title[i]];
-              if (mo) { sz += 4UL; }
-              else { pdf_put_hex_byte((uint8_t)(gid >> 8)); pdf_put_hex_byte((uint8_t)gid); }
-          }
-        }
-        EMIT_S("> Tj\n");
-    } else {
-        EMIT_S(" Td\n(");
-        { unsigned i;
-          for (i = 0u; i < tlen; i++) {
-              char ch = doc_title[i];
-              if (mo) { sz++; if (ch=='('||ch==')'||ch=='\\') sz++; }
-              else {
-                  char esc[2]; esc[1]=0;
-                  if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-                  esc[0]=ch; pdf_write_chunk(esc,1u);
-              }
-          }
-        }
-        EMIT_S(") Tj\n");
-    }
-
-    /* author: /F1 base Tf  1 0 0 1 AX AY Tm <hex> Tj — absolute position */
-    EMIT_S("/F1 ");
-    EMIT_I(base_size);
-    EMIT_S(" Tf\n1 0 0 1 ");
-    EMIT_I(ax);
-    EMIT_S(" ");
-    EMIT_I(ay);
-    if (want_polish) {
-        EMIT_S(" Tm\n<");
-        { unsigned i;
-          for (i = 0u; i < alen; i++) {
-              uint16_t gid = cp852_gid[(uint8_t)doc_author[i]];
-              if (mo) { sz += 4UL; }
-              else { pdf_put_hex_byte((uint8_t)(gid >> 8)); pdf_put_hex_byte((uint8_t)gid); }
-          }
-        }
-        EMIT_S("> Tj\nET\n");
+    if (want_prop) {
+        use_size(title_fsize);
+        tlen = fit_w(doc_title, tlen, line_w, &tw);
+        use_size(base_size);
+        alen = fit_w(doc_author, alen, line_w, &aw);
+        tx = left_pt + (line_w - tw) / 128u;
+        ax = left_pt + (line_w - aw) / 128u;
     } else {
-        EMIT_S(" Tm\n(");
-        { unsigned i;
-          for (i = 0u; i < alen; i++) {
-              char ch = doc_author[i];
-              if (mo) { sz++; if (ch=='('||ch==')'||ch=='\\') sz++; }
-              else {
-                  char esc[2]; esc[1]=0;
-                  if (ch=='('||ch==')'||ch=='\\') { esc[0]='\\'; pdf_write_chunk(esc,1u); }
-                  esc[0]=ch; pdf_write_chunk(esc,1u);
-              }
-          }
-        }
-        EMIT_S(") Tj\nET\n");
+        if (tlen > max_title_cols) tlen = max_title_cols;
+        if (alen > max_base_cols)  alen = max_base_cols;
+        tx = left_pt + (usable_w > tlen * title_fw ? (usable_w - tlen * title_fw) / 2u : 0u);
+        ax = left_pt + (usable_w > alen * font_w_pt ? (usable_w - alen * font_w_pt) / 2u : 0u);
     }
 
-#undef EMIT_S
-#undef EMIT_I
+    /* title: BT /F1 3*base Tf  TX TY Td <hex> Tj ET */
+    pdf_puts("BT\n/F1 ");
+    pdf_puti((unsigned long)title_fsize);
+    pdf_puts(" Tf\n");
+    pdf_puti((unsigned long)tx);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)ty);
+    pdf_puts(" Td\n");
+    pdf_put_text(doc_title, tlen);
+    pdf_puts(" Tj\n");
 
-    return sz;
+    /* author: /F1 base Tf  1 0 0 1 AX AY Tm <hex> Tj — absolute position */
+    pdf_puts("/F1 ");
+    pdf_puti((unsigned long)base_size);
+    pdf_puts(" Tf\n1 0 0 1 ");
+    pdf_puti((unsigned long)ax);
+    pdf_puts(" ");
+    pdf_puti((unsigned long)ay);
+    pdf_puts(" Tm\n");
+    pdf_put_text(doc_author, alen);
+    pdf_puts(" Tj\nET\n");
 }
 
 static void write_title_page_obj(unsigned page_obj, unsigned stream_obj) {
-    unsigned long stream_len;
+    unsigned long start;
 
     /* page object */
     begin_obj(page_obj);
@@ -1087,14 +1217,9 @@ static void write_title_page_obj(unsigned page_obj, unsigned stream_obj) {
     end_obj();
 
     /* stream object */
-    stream_len = title_page_block(1u);
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    title_page_block(0u);
-    pdf_puts("endstream\n");
-    end_obj();
+    start = begin_stream(stream_obj);
+    title_page_block();
+    end_stream(start);
 }
 
 /* ---- PDF structure writers ----------------------------------------------- */
@@ -1111,69 +1236,350 @@ static void write_catalog(void) {
     end_obj();
 }
 
+static void put_kid(unsigned obj, uint8_t *sep) {
+    if (*sep) pdf_putc(' ');
+    pdf_puti((unsigned long)obj);
+    pdf_puts(" 0 R");
+    *sep = 1u;
+}
+
+/*
+ * Kids in reading order: each input's title page, then its content pages;
+ * the TOC after the first title page, or last.
+ */
 static void write_pages_dict(unsigned content_pages) {
     unsigned i;
-    /* T: object offset for title page (2 objects: page+stream) */
-    unsigned T = has_title_page ? 2u : 0u;
-    unsigned total_pages = content_pages + (want_toc ? 1u : 0u) + (has_title_page ? 1u : 0u);
-    /* content page objects start at first_page_obj + T */
-    unsigned first_content = first_page_obj + T;
+    unsigned titles = 0u;
+    uint8_t  d, sep = 0u;
+    unsigned first_content, toc_pobj;
+
+    for (d = doc_lo; d < doc_hi; d++) titles += doc_titled[d];
+    /* title pages: 2 objects each (page+stream), content page objects after them */
+    first_content = first_page_obj + titles * 2u;
     /* TOC page object: after all content page objects */
-    unsigned toc_pobj = first_content + content_pages;
+    toc_pobj = first_content + content_pages;
 
     begin_obj(OBJ_PAGES);
     pdf_puts("<< /Type /Pages /Count ");
-    pdf_puti((unsigned long)total_pages);
+    pdf_puti((unsigned long)(content_pages + (want_toc ? 1u : 0u) + titles));
     pdf_puts("\n   /Kids [");
 
-    /* title page always first */
-    if (has_title_page) {
-        pdf_puti((unsigned long)first_page_obj);
-        pdf_puts(" 0 R ");
-    }
-
-    if (want_toc && toc_at_start) {
-        pdf_puti((unsigned long)toc_pobj);
-        pdf_puts(" 0 R");
-        if (content_pages > 0u) pdf_putc(' ');
-    }
-    for (i = 0u; i < content_pages; i++) {
-        pdf_puti((unsigned long)(first_content + i));
-        pdf_puts(" 0 R");
-        if (i + 1u < content_pages || (want_toc && !toc_at_start)) pdf_putc(' ');
-    }
-    if (want_toc && !toc_at_start) {
-        pdf_puti((unsigned long)toc_pobj);
-        pdf_puts(" 0 R");
+    titles = 0u;
+    for (d = doc_lo; d < doc_hi; d++) {
+        if (doc_titled[d]) put_kid(first_page_obj + 2u * titles++, &sep);
+        if (d == doc_lo && want_toc && toc_at_start) put_kid(toc_pobj, &sep);
+        for (i = doc_first_page[d]; i < doc_first_page[d + 1u]; i++)
+            put_kid(first_content + i, &sep);
     }
+    if (want_toc && !toc_at_start) put_kid(toc_pobj, &sep);
     pdf_puts("]\n>>\n");
     end_obj();
 }
 
-/* Stream entire file src_fd (len bytes) into the PDF output. */
-static void stream_file(int src_fd, unsigned long len) {
-    char buf[STAGE_SIZE];
-    unsigned long remaining = len;
+/*
+ * Copy len bytes of src_fd from offset off into the PDF output. The bytes
+ * are read with read_xram() straight into the accumulator, never into RAM;
+ * in a deflated stream they go through a RAM buffer to dfl_put().
+ */
+static void copy_file(int src_fd, unsigned long off, unsigned long len) {
+    static char buf[128];
     unsigned chunk;
-    while (remaining > 0u) {
-        chunk = (remaining > (unsigned long)STAGE_SIZE) ? STAGE_SIZE : (unsigned)remaining;
-        read(src_fd, buf, chunk);
-        pdf_write_chunk(buf, chunk);
-        remaining -= (unsigned long)chunk;
+    lseek(src_fd, (off_t)off, SEEK_SET);
+    if (z_on) {
+        while (len > 0UL) {
+            chunk = (len > (unsigned long)sizeof(buf)) ? (unsigned)sizeof(buf) : (unsigned)len;
+            if (read(src_fd, buf, chunk) != (int)chunk) memset(buf, 0, chunk);
+            pdf_write_chunk(buf, chunk);
+            len -= (unsigned long)chunk;
+        }
+        return;
+    }
+    pdf_pos += len;
+    while (len > 0UL) {
+        if (out_len == OUT_SIZE) pdf_flush();
+        chunk = OUT_SIZE - out_len;
+        if ((unsigned long)chunk > len) chunk = (unsigned)len;
+        read_xram(XRAM_OUT + out_len, chunk, src_fd);
+        out_len += chunk;
+        len     -= (unsigned long)chunk;
     }
 }
 
-/* GID→Unicode mapping for ToUnicode CMap (18 Polish chars) */
-static const uint16_t tounicode_gid[18] = {
-    198,199,200,201,218,219,259,260,261,262,149,181,284,285,315,316,317,318
-};
-static const uint16_t tounicode_uni[18] = {
+/* ---- TTF subset (/pl) ----------------------------------------------------- */
+
+/*
+ * The FontFile2 stream carries only the glyphs the document prints. Glyph IDs
+ * stay as they are, so cp852_gid[] and the ToUnicode CMap need no change:
+ * loca keeps an entry for every glyph and unused glyphs become empty. The
+ * components of composite glyphs (accented letters) are kept too. Of other
+ * tables only those a PDF reader rasterises with are copied; cmap, name, post
+ * and OS/2 are left out. Checksums of glyf and loca are written as 0, PDF
+ * readers do not check them. Any surprise in the file embeds it whole.
+ */
+#define TTF_KEEP      9u
+#define TT_GLYF       2u
+#define TT_HEAD       3u
+#define TT_HHEA       4u
+#define TT_HMTX       5u
+#define TT_LOCA       6u
+#define TT_MAXP       7u
+
+static const char ttf_keep_tag[TTF_KEEP][5] = {   /* sorted, as the directory */
+    "cvt ", "fpgm", "glyf", "head", "hhea", "hmtx", "loca", "maxp", "prep"
+};
+
+static unsigned long ttf_off[TTF_KEEP];   /* 0 = table not in the file */
+static unsigned long ttf_len[TTF_KEEP];   /* length in the subset */
+static unsigned long ttf_sum[TTF_KEEP];
+static unsigned      ttf_glyphs;          /* numGlyphs from maxp */
+static uint8_t       ttf_long_loca;       /* head.indexToLocFormat */
+static uint8_t       ttf_ok;              /* ttf_load() succeeded, a subset can be made */
+static uint8_t       ttf_used[TTF_MAX_GLYPHS / 8u];
+static uint8_t       ttf_buf[16];
+
+#define TTF_U16(p)    ((unsigned)(p)[0] << 8 | (unsigned)(p)[1])
+#define TTF_USED(g)   (ttf_used[(g) >> 3] & (uint8_t)(1u << ((g) & 7u)))
+
+static unsigned long ttf_u32(const uint8_t *p) {
+    return (unsigned long)TTF_U16(p) << 16 | (unsigned long)TTF_U16(p + 2);
+}
+
+static uint8_t ttf_read_at(int fd, unsigned long off, unsigned n) {
+    lseek(fd, (off_t)off, SEEK_SET);
+    return read(fd, ttf_buf, n) == (int)n;
+}
+
+/* glyf offset and length of glyph g from the file's loca */
+static uint8_t ttf_glyph_loc(int fd, unsigned g,
+                             unsigned long *off, unsigned long *len) {
+    unsigned long end;
+    if (ttf_long_loca) {
+        if (!ttf_read_at(fd, ttf_off[TT_LOCA] + (unsigned long)g * 4UL, 8u)) return 0u;
+        *off = ttf_u32(ttf_buf);
+        end  = ttf_u32(ttf_buf + 4);
+    } else {
+        if (!ttf_read_at(fd, ttf_off[TT_LOCA] + (unsigned long)g * 2UL, 4u)) return 0u;
+        *off = (unsigned long)TTF_U16(ttf_buf) * 2UL;
+        end  = (unsigned long)TTF_U16(ttf_buf + 2) * 2UL;
+    }
+    if (end < *off) return 0u;
+    *len = end - *off;
+    return 1u;
+}
+
+/* Mark the glyph; 1 if it was not marked before. */
+static uint8_t ttf_mark(unsigned g) {
+    uint8_t bit = (uint8_t)(1u << (g & 7u));
+    if (g >= ttf_glyphs || (ttf_used[g >> 3] & bit)) return 0u;
+    ttf_used[g >> 3] |= bit;
+    return 1u;
+}
+
+/*
+ * Read the table directory, numGlyphs and the loca format. Once per batch;
+ * 0 if the font has to go whole.
+ */
+static uint8_t ttf_load(int fd) {
+    unsigned nt, i, k;
+
+    memset(ttf_off, 0, sizeof(ttf_off));
+    if (!ttf_read_at(fd, 0UL, 12u)) return 0u;
+    nt = TTF_U16(ttf_buf + 4);
+    for (i = 0u; i < nt; i++) {
+        if (!ttf_read_at(fd, 12UL + (unsigned long)i * 16UL, 16u)) return 0u;
+        for (k = 0u; k < TTF_KEEP; k++) {
+            if (memcmp(ttf_buf, ttf_keep_tag[k], 4u) == 0) {
+                ttf_sum[k] = ttf_u32(ttf_buf + 4);
+                ttf_off[k] = ttf_u32(ttf_buf + 8);
+                ttf_len[k] = ttf_u32(ttf_buf + 12);
+            }
+        }
+    }
+    if (!ttf_off[TT_GLYF] || !ttf_off[TT_HEAD] || !ttf_off[TT_LOCA] || !ttf_off[TT_MAXP])
+        return 0u;
+
+    if (!ttf_read_at(fd, ttf_off[TT_MAXP], 6u)) return 0u;
+    ttf_glyphs = TTF_U16(ttf_buf + 4);
+    if (ttf_glyphs == 0u || ttf_glyphs > TTF_MAX_GLYPHS) return 0u;
+    if (!ttf_read_at(fd, ttf_off[TT_HEAD] + 50UL, 2u)) return 0u;
+    ttf_long_loca = TTF_U16(ttf_buf) ? 1u : 0u;
+    return 1u;
+}
+
+/*
+ * Advance widths for /pr, see use_size(): the hmtx entries of glyphs below
+ * CP852_GIDS come in one read_xram() to XRAM_GLYPHS, which ttf_plan() fills
+ * later, and the one of each CP852 byte goes to XRAM_WIDTHS in 1/1000 em.
+ * Glyphs past numberOfHMetrics have the last advance. After ttf_load().
+ */
+static uint8_t ttf_widths(int fd) {
+    unsigned upm, n, i, g;
+    unsigned long aw;
+
+    if (!ttf_off[TT_HEAD] || !ttf_off[TT_HHEA] || !ttf_off[TT_HMTX]) return 0u;
+    if (!ttf_read_at(fd, ttf_off[TT_HEAD] + 18UL, 2u)) return 0u;
+    upm = TTF_U16(ttf_buf);
+    if (!ttf_read_at(fd, ttf_off[TT_HHEA] + 34UL, 2u)) return 0u;
+    n = TTF_U16(ttf_buf);                       /* numberOfHMetrics */
+    if (upm == 0u || n == 0u) return 0u;
+    if (n > CP852_GIDS) n = CP852_GIDS;
+    lseek(fd, (off_t)ttf_off[TT_HMTX], SEEK_SET);
+    if (read_xram(XRAM_GLYPHS, n * 4u, fd) != (int)(n * 4u)) return 0u;
+
+    RIA.addr0 = XRAM_WIDTHS;
+    RIA.step0 = 1;
+    RIA.step1 = 1;
+    for (i = 0u; i < 256u; i++) {
+        g = cp852_gid[i];
+        if (g >= n) g = n - 1u;
+        RIA.addr1 = XRAM_GLYPHS + g * 4u;
+        aw  = (unsigned long)RIA.rw1 << 8;
+        aw |= RIA.rw1;
+        aw  = (aw * 1000UL + upm / 2u) / upm;
+        RIA.rw0 = (uint8_t)aw;
+        RIA.rw0 = (uint8_t)(aw >> 8);
+    }
+    return 1u;
+}
+
+/*
+ * Mark the printed glyphs and the glyphs their composites use, and leave the
+ * kept length of every glyph at XRAM_GLYPHS.
+ * Returns the size of the subset font, 0 if the font has to go whole.
+ */
+static unsigned long ttf_plan(int fd) {
+    unsigned i, k, g;
+    unsigned long off, len, glyf_len, total;
+    uint8_t  again;
+
+    if (!ttf_ok) return 0UL;
+
+    /* printed characters (see mark_chars()), plus .notdef */
+    memset(ttf_used, 0, sizeof(ttf_used));
+    ttf_mark(0u);
+    for (i = 0u; i < 256u; i++)
+        if (cp_used[i >> 3] & (uint8_t)(1u << (i & 7u))) ttf_mark(cp852_gid[i]);
+
+    /* components of composites; a component below its composite needs one more pass */
+    do {
+        again    = 0u;
+        glyf_len = 0UL;
+        RIA.step1 = 1;
+        for (g = 0u; g < ttf_glyphs; g++) {
+            len = 0UL;
+            if (TTF_USED(g)) {
+                if (!ttf_glyph_loc(fd, g, &off, &len) || len > 0xFFFFUL) return 0UL;
+                if (len >= 10UL) {
+                    off += ttf_off[TT_GLYF];
+                    if (!ttf_read_at(fd, off, 2u)) return 0UL;
+                    if (ttf_buf[0] & 0x80u) {          /* numberOfContours < 0 */
+                        unsigned long pos = off + 10UL;
+                        unsigned flags;
+                        do {
+                            if (!ttf_read_at(fd, pos, 4u)) return 0UL;
+                            flags = TTF_U16(ttf_buf);
+                            k     = TTF_U16(ttf_buf + 2);
+                            if (ttf_mark(k) && k < g) again = 1u;
+                            pos += (flags & 0x0001u) ? 8UL : 6UL;    /* ARG_1_AND_2_ARE_WORDS */
+                            if (flags & 0x0008u)      pos += 2UL;    /* WE_HAVE_A_SCALE */
+                            else if (flags & 0x0040u) pos += 4UL;    /* X_AND_Y_SCALE */
+                            else if (flags & 0x0080u) pos += 8UL;    /* TWO_BY_TWO */
+                        } while ((flags & 0x0020u) && pos < off + len);  /* MORE_COMPONENTS */
+                    }
+                }
+            }
+            RIA.addr1 = XRAM_GLYPHS + g * 2u;
+            RIA.rw1 = (uint8_t)len;
+            RIA.rw1 = (uint8_t)(len >> 8);
+            glyf_len += len;
+        }
+    } while (again);
+
+    ttf_len[TT_GLYF] = glyf_len;
+    ttf_len[TT_LOCA] = (unsigned long)(ttf_glyphs + 1u) * (ttf_long_loca ? 4UL : 2UL);
+    ttf_sum[TT_GLYF] = 0UL;
+    ttf_sum[TT_LOCA] = 0UL;
+
+    total = 12UL;
+    for (k = 0u; k < TTF_KEEP; k++)
+        if (ttf_off[k]) total += 16UL + ((ttf_len[k] + 3UL) & ~3UL);
+    return total;
+}
+
+static void pdf_put_u16(unsigned v) {
+    char b[2];
+    b[0] = (char)(v >> 8);
+    b[1] = (char)v;
+    pdf_write_chunk(b, 2u);
+}
+
+static void pdf_put_u32(unsigned long v) {
+    pdf_put_u16((unsigned)(v >> 16));
+    pdf_put_u16((unsigned)v);
+}
+
+/* Write the subset font planned by ttf_plan(). */
+static void ttf_write(int fd) {
+    unsigned nt = 0u, sr = 1u, es = 0u, k, g;
+    unsigned long pos, off, len, glyf_pos = 0UL;
+
+    for (k = 0u; k < TTF_KEEP; k++) if (ttf_off[k]) nt++;
+    while (sr * 2u <= nt) { sr *= 2u; es++; }
+
+    /* offset table and directory */
+    pdf_put_u32(0x00010000UL);
+    pdf_put_u16(nt);
+    pdf_put_u16(sr * 16u);
+    pdf_put_u16(es);
+    pdf_put_u16(nt * 16u - sr * 16u);
+    pos = 12UL + (unsigned long)nt * 16UL;
+    for (k = 0u; k < TTF_KEEP; k++) {
+        if (!ttf_off[k]) continue;
+        pdf_write_chunk(ttf_keep_tag[k], 4u);
+        pdf_put_u32(ttf_sum[k]);
+        pdf_put_u32(pos);
+        pdf_put_u32(ttf_len[k]);
+        pos += (ttf_len[k] + 3UL) & ~3UL;
+    }
+
+    /* tables, each padded to 4 bytes */
+    for (k = 0u; k < TTF_KEEP; k++) {
+        if (!ttf_off[k]) continue;
+        if (k == TT_GLYF) {
+            for (g = 0u; g < ttf_glyphs; g++) {
+                if (TTF_USED(g) && ttf_glyph_loc(fd, g, &off, &len) && len)
+                    copy_file(fd, ttf_off[TT_GLYF] + off, len);
+            }
+        } else if (k == TT_LOCA) {
+            for (g = 0u; g <= ttf_glyphs; g++) {
+                if (ttf_long_loca) pdf_put_u32(glyf_pos);
+                else               pdf_put_u16((unsigned)(glyf_pos >> 1));
+                if (g < ttf_glyphs) {
+                    RIA.addr1 = XRAM_GLYPHS + g * 2u;
+                    RIA.step1 = 1;
+                    len  = RIA.rw1;
+                    len |= (unsigned long)RIA.rw1 << 8;
+                    glyf_pos += len;
+                }
+            }
+        } else {
+            copy_file(fd, ttf_off[k], ttf_len[k]);
+        }
+        for (len = ttf_len[k]; len & 3UL; len++) pdf_putc(0);
+    }
+}
+
+/* GID→Unicode mapping for ToUnicode CMap (18 Polish chars) */
+static const uint16_t tounicode_gid[18] = {
+    198,199,200,201,218,219,259,260,261,262,149,181,284,285,315,316,317,318
+};
+static const uint16_t tounicode_uni[18] = {
     0x0104,0x0105,0x0106,0x0107,0x0118,0x0119,
     0x0141,0x0142,0x0143,0x0144,0x00D3,0x00F3,
     0x015A,0x015B,0x0179,0x017A,0x017B,0x017C
 };
 
-/* CMap header: fixed string — length computed at call time */
+/* CMap header: fixed string */
 static const char tounicode_hdr[] =
     "/CIDInit /ProcSet findresource begin\n"
     "12 dict begin\n"
@@ -1194,18 +1600,10 @@ static const char tounicode_ftr[] =
     "end\n";
 
 static void write_tounicode_obj(void) {
-    unsigned long cmap_len;
+    unsigned long start;
     unsigned k;
-    /* header + 18 * "<XXXX> <YYYY>\n"(15 bytes) + footer */
-    { unsigned hlen = 0u; unsigned flen = 0u; const char *p;
-      p = tounicode_hdr; while (*p) { hlen++; p++; }
-      p = tounicode_ftr; while (*p) { flen++; p++; }
-      cmap_len = (unsigned long)hlen + 18UL * 15UL + (unsigned long)flen;
-    }
-    begin_obj(OBJ_TOUNICODE);
-    pdf_puts("<< /Length ");
-    pdf_puti(cmap_len);
-    pdf_puts(" >>\nstream\n");
+
+    start = begin_stream(OBJ_TOUNICODE);
     pdf_puts(tounicode_hdr);
     for (k = 0u; k < 18u; k++) {
         pdf_putc('<');
@@ -1217,16 +1615,51 @@ static void write_tounicode_obj(void) {
         pdf_puts(">\n");
     }
     pdf_puts(tounicode_ftr);
-    pdf_puts("endstream\n");
-    end_obj();
+    end_stream(start);
 }
 
 /*
- * Write four PDF objects for DroidSansMono TTF embedding (/pl mode):
+ * "/W [g [w w ...] ...]": the widths of the printed glyphs, in runs of
+ * consecutive GIDs, from XRAM_WIDTHS (/pr). .notdef is /DW.
+ */
+static void write_widths(void) {
+    unsigned c, g, w, prev = 0u;
+
+    RIA.addr1 = XRAM_WIDTHS;
+    RIA.step1 = 1;
+    w  = RIA.rw1;
+    w |= (unsigned)RIA.rw1 << 8;
+    pdf_puts("   /DW ");
+    pdf_puti((unsigned long)w);
+    pdf_puts("\n   /W [");
+    for (c = 0u; c < 256u; c++) {
+        g = cp852_gid[c];
+        if (g == 0u || !(cp_used[c >> 3] & (uint8_t)(1u << (c & 7u)))) continue;
+        RIA.addr1 = XRAM_WIDTHS + c * 2u;
+        w  = RIA.rw1;
+        w |= (unsigned)RIA.rw1 << 8;
+        if (prev == 0u || g != prev + 1u) {
+            if (prev) pdf_puts("] ");
+            pdf_puti((unsigned long)g);
+            pdf_puts(" [");
+        } else {
+            pdf_putc(' ');
+        }
+        pdf_puti((unsigned long)w);
+        prev = g;
+    }
+    if (prev) pdf_putc(']');
+    pdf_puts("]\n");
+}
+
+/*
+ * Write four PDF objects for DroidSansMono TTF embedding (/pl mode),
+ * DroidSans with /pr:
  *   OBJ_FONT_NORMAL : /Type0 composite font with /Encoding /Identity-H
- *   OBJ_CIDFONT     : /CIDFontType2 — DroidSansMono with /DW 600
+ *   OBJ_CIDFONT     : /CIDFontType2 — DroidSansMono with /DW 600,
+ *                     DroidSans with the /W of write_widths()
  *   OBJ_FONTDESC    : /FontDescriptor with metrics from head/hhea/OS2 tables
- *   OBJ_FONTFILE    : /FontFile2 stream — entire TTF streamed from disk
+ *   OBJ_FONTFILE    : /FontFile2 stream — the glyphs in use, see ttf_plan()
  *   OBJ_TOUNICODE   : ToUnicode CMap for 18 Polish chars (GID→Unicode)
  *
  * Strings in content streams use hex notation <XXXX> with 2-byte GIDs.
@@ -1235,16 +1668,18 @@ static void write_tounicode_obj(void) {
  * DroidSansMono cmap (3,1) verified: ASCII U+0020..U+007E → GID=codepoint-29.
  * Polish chars in Segment 1 (U+00A0..U+017F) via glyphIdArray.
  * unitsPerEm=2048, monospace aw=1229 → width=600 in 1000-unit scale.
+ * DroidSans: the same GIDs, FontDescriptor values from head, hhea and OS/2.
  */
 static void write_ttf_font_objs(int ttf_fd) {
-    unsigned long ttf_len;
+    unsigned long font_len, start;
+    uint8_t subset;
 
     /* obj OBJ_FONT_NORMAL — Type0 composite font */
     begin_obj(OBJ_FONT_NORMAL);
     pdf_puts("<< /Type /Font\n"
-             "   /Subtype /Type0\n"
-             "   /BaseFont /DroidSansMono\n"
-             "   /Encoding /Identity-H\n"
+             "   /Subtype /Type0\n");
+    pdf_puts(want_prop ? "   /BaseFont /DroidSans\n" : "   /BaseFont /DroidSansMono\n");
+    pdf_puts("   /Encoding /Identity-H\n"
              "   /DescendantFonts [");
     pdf_puti((unsigned long)OBJ_CIDFONT);
     pdf_puts(" 0 R]\n"
@@ -1256,44 +1691,57 @@ static void write_ttf_font_objs(int ttf_fd) {
     /* obj OBJ_CIDFONT — CIDFontType2 */
     begin_obj(OBJ_CIDFONT);
     pdf_puts("<< /Type /Font\n"
-             "   /Subtype /CIDFontType2\n"
-             "   /BaseFont /DroidSansMono\n"
-             "   /CIDSystemInfo << /Registry (Adobe) /Ordering (Identity) /Supplement 0 >>\n"
+             "   /Subtype /CIDFontType2\n");
+    pdf_puts(want_prop ? "   /BaseFont /DroidSans\n" : "   /BaseFont /DroidSansMono\n");
+    pdf_puts("   /CIDSystemInfo << /Registry (Adobe) /Ordering (Identity) /Supplement 0 >>\n"
              "   /FontDescriptor ");
     pdf_puti((unsigned long)OBJ_FONTDESC);
-    pdf_puts(" 0 R\n"
-             "   /DW 600\n"
-             ">>\n");
+    pdf_puts(" 0 R\n");
+    if (want_prop) write_widths();
+    else           pdf_puts("   /DW 600\n");
+    pdf_puts(">>\n");
     end_obj();
 
     /* obj OBJ_FONTDESC — FontDescriptor */
     begin_obj(OBJ_FONTDESC);
-    pdf_puts("<< /Type /FontDescriptor\n"
-             "   /FontName /DroidSansMono\n"
-             "   /Flags 33\n"
-             "   /FontBBox [-97 -240 600 928]\n"
-             "   /ItalicAngle 0\n"
-             "   /Ascent 928\n"
-             "   /Descent -240\n"
-             "   /CapHeight 716\n"
-             "   /StemV 80\n"
-             "   /FontFile2 ");
+    if (want_prop)
+        pdf_puts("<< /Type /FontDescriptor\n"
+                 "   /FontName /DroidSans\n"
+                 "   /Flags 32\n"
+                 "   /FontBBox [-558 -271 1169 1048]\n"
+                 "   /ItalicAngle 0\n"
+                 "   /Ascent 928\n"
+                 "   /Descent -236\n"
+                 "   /CapHeight 714\n"
+                 "   /StemV 80\n"
+                 "   /FontFile2 ");
+    else
+        pdf_puts("<< /Type /FontDescriptor\n"
+                 "   /FontName /DroidSansMono\n"
+                 "   /Flags 33\n"
+                 "   /FontBBox [-97 -240 600 928]\n"
+                 "   /ItalicAngle 0\n"
+                 "   /Ascent 928\n"
+                 "   /Descent -240\n"
+                 "   /CapHeight 716\n"
+                 "   /StemV 80\n"
+                 "   /FontFile2 ");
     pdf_puti((unsigned long)OBJ_FONTFILE);
     pdf_puts(" 0 R\n>>\n");
     end_obj();
 
-    /* obj OBJ_FONTFILE — FontFile2 stream (entire TTF) */
-    ttf_len = (unsigned long)lseek(ttf_fd, 0, SEEK_END);
-    lseek(ttf_fd, 0, SEEK_SET);
-    begin_obj(OBJ_FONTFILE);
-    pdf_puts("<< /Length ");
-    pdf_puti(ttf_len);
-    pdf_puts("\n   /Length1 ");
-    pdf_puti(ttf_len);
-    pdf_puts("\n>>\nstream\n");
-    stream_file(ttf_fd, ttf_len);
-    pdf_puts("\nendstream\n");
-    end_obj();
+    /* obj OBJ_FONTFILE — FontFile2 stream (subset, or the entire TTF) */
+    font_len = ttf_plan(ttf_fd);
+    subset   = font_len != 0UL;
+    if (!subset)
+        font_len = (unsigned long)lseek(ttf_fd, 0, SEEK_END);
+    stream_dict(OBJ_FONTFILE);
+    pdf_puts(" /Length1 ");
+    pdf_puti(font_len);
+    start = stream_data();
+    if (subset) ttf_write(ttf_fd);
+    else        copy_file(ttf_fd, 0UL, font_len);
+    end_stream(start);
 
     /* obj OBJ_TOUNICODE — ToUnicode CMap for 18 Polish chars */
     write_tounicode_obj();
@@ -1341,51 +1789,26 @@ static void write_page_obj(unsigned page_obj, unsigned stream_obj) {
     end_obj();
 }
 
-static void write_stream_obj(int in_fd, unsigned stream_obj,
+static void write_stream_obj(unsigned stream_obj,
                              unsigned pgn, unsigned total_pages) {
-    unsigned long stream_len;
-    unsigned long before_read;
+    unsigned long start;
 
-    before_read = (unsigned long)lseek(in_fd, 0, SEEK_CUR);
-
-    stream_len = content_block(in_fd, 1u);
-    if (page_num_mode != PGNUM_NONE)
-        stream_len += measure_pgnum_block(pgn, total_pages);
-
-    lseek(in_fd, (off_t)before_read, SEEK_SET);
-
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    content_block(in_fd, 0u);
+    start = begin_stream(stream_obj);
+    content_block(pgn - 1u);
     if (page_num_mode != PGNUM_NONE)
         emit_pgnum_block(pgn, total_pages);
-    pdf_puts("endstream\n");
-    end_obj();
+    end_stream(start);
 }
 
-static void write_toc_stream_obj(int in_fd, unsigned stream_obj,
+static void write_toc_stream_obj(unsigned stream_obj,
                                  unsigned content_pages) {
-    unsigned long stream_len;
-    unsigned long before_read;
+    unsigned long start;
 
-    before_read = (unsigned long)lseek(in_fd, 0, SEEK_CUR);
-    stream_len = toc_block(in_fd, 1u, content_pages);
-    if (page_num_mode != PGNUM_NONE)
-        stream_len += measure_pgnum_block(content_pages + 1u, content_pages + 1u);
-
-    lseek(in_fd, (off_t)before_read, SEEK_SET);
-
-    begin_obj(stream_obj);
-    pdf_puts("<< /Length ");
-    pdf_puti(stream_len);
-    pdf_puts(" >>\nstream\n");
-    toc_block(in_fd, 0u, content_pages);
+    start = begin_stream(stream_obj);
+    toc_block(content_pages);
     if (page_num_mode != PGNUM_NONE)
         emit_pgnum_block(content_pages + 1u, content_pages + 1u);
-    pdf_puts("endstream\n");
-    end_obj();
+    end_stream(start);
 }
 
 static void write_xref_and_trailer(unsigned total_objs) {
@@ -1421,7 +1844,7 @@ static void write_xref_and_trailer(unsigned total_objs) {
     pdf_puts("\n%%EOF\n");
 }
 
-/* ---- main ----------------------------------------------------------------- */
+/* ---- inputs and the PDF of each ------------------------------------------ */
 
 /* case-insensitive strcmp for short strings */
 static uint8_t ext_eq(const char *name, const char *ext) {
@@ -1439,24 +1862,301 @@ static uint8_t ext_eq(const char *name, const char *ext) {
     return 1u;
 }
 
+/* Wildcard match, '*' (0+ chars) and '?' (1 char), case-insensitive. */
+static uint8_t name_match(const char *name, const char *mask) {
+    const char *star = 0;
+    const char *mp   = 0;
+    while (*name) {
+        char a = *name, b = *mask;
+        if (a >= 'A' && a <= 'Z') a += 32;
+        if (b >= 'A' && b <= 'Z') b += 32;
+        if (b == '?' || b == a) { mask++; name++; continue; }
+        if (b == '*') { star = mask++; mp = name; continue; }
+        if (star) { mask = star + 1; name = ++mp; continue; }
+        return 0u;
+    }
+    while (*mask == '*') mask++;
+    return *mask == 0;
+}
+
+/* Add an input; the formatting mode follows from its extension. */
+static uint8_t add_doc(const char *name) {
+    if (doc_count == MAX_DOCS) {
+        printf(EXCLAMATION "too many files (max %u)" NEWLINE, MAX_DOCS);
+        return 0u;
+    }
+    strncpy(doc_name[doc_count], name, FNAMELEN - 1u);
+    doc_name[doc_count][FNAMELEN - 1u] = 0;
+    if      (ext_eq(name, ".asm"))                         doc_fmt[doc_count] = FMT_ASM;
+    else if (ext_eq(name, ".txt") || ext_eq(name, ".md")) doc_fmt[doc_count] = FMT_MD;
+    else                                                   doc_fmt[doc_count] = FMT_NONE;
+    doc_count++;
+    return 1u;
+}
+
+/*
+ * Inputs named by the first argument: "@list" (a name per line, in that
+ * order), a mask with '*' or '?' (files of its directory, sorted by name), or
+ * a single file. Returns the number of inputs, 0 after an error message.
+ */
+static uint8_t collect_docs(const char *arg) {
+    static f_stat_t ent;
+    char     path[FNAMELEN];
+    unsigned plen = 0u, k;
+    int      fd, n;
+    uint8_t  fmt;
+
+    doc_count = 0u;
+    if (arg[0] == '@') {
+        fd = open(arg + 1, O_RDONLY);
+        if (fd < 0) {
+            printf(EXCLAMATION "cannot open %s" NEWLINE, arg + 1);
+            return 0u;
+        }
+        lr_open(fd);
+        while ((n = lr_read_line(path, FNAMELEN - 1u)) >= 0) {
+            while (n > 0 && (path[n - 1] == ' ' || path[n - 1] == '\t')) path[--n] = 0;
+            if (n > 0 && !add_doc(path)) break;
+        }
+        close(fd);
+    } else if (strchr(arg, '*') || strchr(arg, '?')) {
+        /* directory part, up to and with the last '/' or ':' */
+        for (k = 0u; arg[k]; k++)
+            if (arg[k] == '/' || arg[k] == ':') plen = k + 1u;
+        if (plen >= FNAMELEN) plen = FNAMELEN - 1u;
+        memcpy(path, arg, plen);
+        path[plen] = 0;
+        /* "docs/" is opened as "docs"; "/" and "MSC0:/" stay as they are */
+        if (plen > 1u && path[plen - 1u] == '/' && path[plen - 2u] != ':') path[plen - 1u] = 0;
+        fd = f_opendir(plen ? path : ".");
+        if (fd < 0) {
+            printf(EXCLAMATION "cannot open %s" NEWLINE, plen ? path : ".");
+            return 0u;
+        }
+        memcpy(path, arg, plen);    /* names keep the directory as typed */
+        while (f_readdir(&ent, fd) >= 0 && ent.fname[0]) {
+            if (ent.fattrib & AM_DIR) continue;
+            if (!name_match(ent.fname, arg + plen)) continue;
+            strncpy(path + plen, ent.fname, FNAMELEN - 1u - plen);
+            path[FNAMELEN - 1u] = 0;
+            if (!add_doc(path)) break;
+            /* keep the list sorted; the shift overwrites the new entry */
+            fmt = doc_fmt[doc_count - 1u];
+            for (k = doc_count - 1u; k > 0u && strcmp(doc_name[k - 1u], path) > 0; k--) {
+                strcpy(doc_name[k], doc_name[k - 1u]);
+                doc_fmt[k] = doc_fmt[k - 1u];
+            }
+            strcpy(doc_name[k], path);
+            doc_fmt[k] = fmt;
+        }
+        f_closedir(fd);
+    } else {
+        add_doc(arg);
+    }
+    if (doc_count == 0u)
+        printf(EXCLAMATION "no files match %s" NEWLINE, arg);
+    return doc_count;
+}
+
+/* outname: the input name with its extension replaced by .pdf */
+static void make_outname(const char *in) {
+    unsigned slen;
+    int dot = -1;
+    unsigned k;
+
+    strncpy(outname, in, FNAMELEN - 5u);
+    outname[FNAMELEN - 5u] = 0;
+    slen = (unsigned)strlen(outname);
+    /* find last dot */
+    for (k = 0u; k < slen; k++) {
+        if (outname[k] == '.') dot = (int)k;
+        else if (outname[k] == '/') dot = -1;
+    }
+    if (dot >= 0) outname[dot] = 0;
+    strcat(outname, ".pdf");
+}
+
+/*
+ * Read the '@NL' and '^' header lines of the current input: the title page
+ * and file_body_start, and the TOC set-up when toc is 1 (first input of a PDF).
+ */
+static void read_header(uint8_t toc) {
+    char lbuf[LINE_BUF_LEN];
+    int  n;
+
+    has_title_page  = 0u;
+    doc_title[0]    = 0;
+    doc_author[0]   = 0;
+    file_body_start = 0;
+
+    lr_seek(0UL);
+    n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+    if (n >= 3 && lbuf[0] == '@' &&
+        lbuf[1] >= '1' && lbuf[1] <= '9' &&
+        (lbuf[2] == '<' || lbuf[2] == '>') &&
+        (lbuf[3] == ' ' || lbuf[3] == 0)) {
+        /* @NX line found */
+        if (toc) {
+            want_toc     = 1u;
+            toc_depth    = (uint8_t)(lbuf[1] - '0');
+            toc_at_start = (lbuf[2] == '<') ? 1u : 0u;
+            if (lbuf[3] == ' ') {
+                strncpy(toc_title, lbuf + 4, LINE_BUF_LEN - 1u);
+                toc_title[LINE_BUF_LEN - 1u] = 0;
+            }
+        }
+        file_body_start = lr_tell();
+        /* next line may be the ^ title */
+        n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+    }
+    if (n >= 1 && lbuf[0] == '^') {
+        strncpy(doc_title, lbuf + 1, LINE_BUF_LEN - 1u);
+        doc_title[LINE_BUF_LEN - 1u] = 0;
+        /* author is the next line */
+        n = lr_read_line(lbuf, LINE_BUF_LEN - 1u);
+        if (n >= 0) {
+            strncpy(doc_author, lbuf, LINE_BUF_LEN - 1u);
+            doc_author[LINE_BUF_LEN - 1u] = 0;
+        }
+        has_title_page  = 1u;
+        file_body_start = lr_tell();
+    }
+
+    if (want_polish) {
+        mark_chars(doc_title, (unsigned)strlen(doc_title));
+        mark_chars(doc_author, (unsigned)strlen(doc_author));
+        mark_chars(toc_title, (unsigned)strlen(toc_title));
+    }
+}
+
+/*
+ * Write inputs doc_lo..doc_hi-1 into outname.
+ * Returns 0, or -1 after an error message.
+ */
+static int write_pdf(void) {
+    unsigned page_count = 0u, total_objs, titles = 0u, T, Wt, i;
+    uint8_t  d;
+
+    if (doc_hi - doc_lo == 1u) printf(NEWLINE "%s -> %s" NEWLINE, doc_name[doc_lo], outname);
+    else                       printf(NEWLINE "%u files -> %s" NEWLINE, doc_hi - doc_lo, outname);
+
+    /* headers, line index and TOC entries of all inputs first: the page tree needs the totals */
+    want_toc     = 0u;
+    toc_depth    = 1u;
+    toc_at_start = 0u;
+    toc_title[0] = 0;
+    line_count   = 0u;
+    toc_count    = 0u;
+    memset(cp_used, 0, sizeof(cp_used));
+    for (d = doc_lo; d < doc_hi; d++) {
+        if (!use_doc(d)) return -1;
+        read_header(d == doc_lo);
+        doc_titled[d]     = has_title_page;
+        titles           += has_title_page;
+        doc_first_page[d] = (uint16_t)page_count;
+        page_count = count_pages(page_count);
+        if (page_count == 0u) return -1;
+    }
+    doc_first_page[doc_hi] = (uint16_t)page_count;
+    if (want_polish && (want_toc || page_num_mode != PGNUM_NONE))
+        mark_chars(" -.0123456789anorstz", 20u);   /* TOC dots, page numbers */
+
+    printf("Pages: %u" NEWLINE, page_count);
+
+    pdf_fd = open(outname, O_WRONLY | O_CREAT | O_TRUNC);
+    if (pdf_fd < 0) {
+        printf(EXCLAMATION "cannot create %s" NEWLINE, outname);
+        return -1;
+    }
+
+    pdf_pos    = 0UL;
+    /*
+     * Object layout:
+     *   Without /pl (want_polish=0):
+     *     1=Catalog 2=Pages 3=F1/Courier 4=F2/Courier-Oblique
+     *     5..   : title pages (T=2 each), content pages+streams, TOC
+     *   With /pl (want_polish=1):
+     *     1=Catalog 2=Pages 3=F1/Type0 4=F2/Courier-Oblique
+     *     5=CIDFont 6=FontDescriptor 7=FontFile2 8=ToUnicode
+     *     9..   : title pages (T=2 each), content pages+streams, TOC
+     *   then: /Length of each generated stream, numbered as written
+     */
+    first_page_obj = want_polish ? 9u : 5u;
+    T  = titles * 2u;
+    Wt = want_toc ? 1u : 0u;
+    { unsigned font_extra = want_polish ? 4u : 0u; /* cidfont+fontdesc+fontfile+tounicode */
+      total_objs = 4u + font_extra + page_count * 2u + T + Wt * 2u;
+    }
+    next_len_obj = total_objs + 1u;
+    out_len      = 0u;
+    dfl_out      = pdf_emit;
+    memset(obj_off, 0, sizeof(obj_off));
+
+    write_header();
+    write_catalog();
+    write_pages_dict(page_count);
+
+    if (want_polish) write_ttf_font_objs(ttf_fd);
+
+    write_fonts();
+
+    /* content page obj i = first_page_obj + T + i
+       content stream i   = first_page_obj + T + page_count + Wt + i */
+    titles = 0u;
+    for (d = doc_lo; d < doc_hi; d++) {
+        if (doc_titled[d]) {
+            /* title strings of this input */
+            use_doc(d);
+            read_header(0u);
+            write_title_page_obj(first_page_obj + titles, first_page_obj + titles + 1u);
+            titles += 2u;
+        }
+        for (i = doc_first_page[d]; i < doc_first_page[d + 1u]; i++) {
+            write_page_obj(first_page_obj + T + i,
+                           first_page_obj + T + page_count + Wt + i);
+            write_stream_obj(first_page_obj + T + page_count + Wt + i,
+                             i + 1u,
+                             page_count);
+        }
+    }
+
+    if (want_toc) {
+        unsigned toc_page_obj   = first_page_obj + T + page_count;
+        unsigned toc_stream_obj = first_page_obj + T + page_count + 1u + page_count;
+        write_page_obj(toc_page_obj, toc_stream_obj);
+        write_toc_stream_obj(toc_stream_obj, page_count);
+    }
+
+    write_xref_and_trailer(next_len_obj - 1u);
+    pdf_flush();
+    close(pdf_fd);
+    return 0;
+}
+
+/* ---- main ----------------------------------------------------------------- */
+
 int main(int argc, char **argv) {
     unsigned left_mm  = DEF_MARGIN;
     unsigned right_mm = DEF_MARGIN;
     unsigned top_mm   = DEF_MARGIN;
     unsigned bot_mm   = DEF_MARGIN;
     unsigned usable_w, usable_h;
-    unsigned page_count, total_objs;
-    unsigned i;
-    unsigned slen;
-    int      in_fd;
-    unsigned arg_off = 0u;  /* argv index offset past parsed flags */
+    uint8_t  d;
+    int      rc = 0;
+    int      arg_off = 0;   /* argv index offset past parsed flags */
 
     if (argc < 1 || !argv[0][0]) {
         printf(NEWLINE
-               "Usage: txt2pdf <file.txt> [/s N] [/m L R T B] [/n d|p] [/pl]"
+               "Usage: txt2pdf <file.txt|mask|@list> [/s N] [/m L R T B] [/n d|p] [/pl|/pr] [/d] [/o F]"
                NEWLINE
                "  /pl : Polish chars (CP852), embeds DroidSansMono from MSC0:/TTF/"
                NEWLINE
+               "  /pr : as /pl in proportional DroidSans, justified"
+               NEWLINE
+               "  /d  : compress the PDF streams (smaller file, slower)"
+               NEWLINE
+               "  /o F: output file; with a mask or @list all inputs go into F"
+               NEWLINE
                "  TOC: start file with '@NL' (N=depth 1-9, L=< start or > end)"
                NEWLINE);
         return 1;
@@ -1465,17 +2165,15 @@ int main(int argc, char **argv) {
     strncpy(inname, argv[0], FNAMELEN - 1u);
     inname[FNAMELEN - 1u] = 0;
 
-    /* formatting mode set automatically from extension */
-    if      (ext_eq(inname, ".asm"))                           fmt_mode = FMT_ASM;
-    else if (ext_eq(inname, ".txt") || ext_eq(inname, ".md")) fmt_mode = FMT_MD;
-    else                                                       fmt_mode = FMT_NONE;
-
     /* parse optional flags (order independent) */
     base_size     = DEF_FONT_SIZE;
     page_num_mode = PGNUM_NONE;
+    want_deflate  = 0u;
     want_toc      = 0u;
     want_polish   = 0u;
-    arg_off       = 0u;
+    want_prop     = 0u;
+    outname[0]    = 0;
+    arg_off       = 0;
     while (argc > 1 + arg_off && argv[1 + arg_off][0] == '/') {
         const char *a = argv[1 + arg_off];
         char flag = a[1];
@@ -1504,6 +2202,21 @@ int main(int argc, char **argv) {
                    (a[2] == 'l' || a[2] == 'L') && a[3] == 0) {
             want_polish = 1u;
             arg_off++;
+        } else if ((flag == 'p' || flag == 'P') &&
+                   (a[2] == 'r' || a[2] == 'R') && a[3] == 0) {
+            want_polish = 1u;
+            want_prop   = 1u;
+            arg_off++;
+        } else if ((flag == 'd' || flag == 'D') && a[2] == 0) {
+            want_deflate = 1u;
+            arg_off++;
+        } else if ((flag == 'o' || flag == 'O') && a[2] == 0) {
+            arg_off++;
+            if (argc > 1 + arg_off) {
+                strncpy(outname, argv[1 + arg_off], FNAMELEN - 1u);
+                outname[FNAMELEN - 1u] = 0;
+                arg_off++;
+            }
         } else {
             break;
         }
@@ -1530,190 +2243,48 @@ int main(int argc, char **argv) {
 
     chars_per_line = usable_w / font_w_pt;
     lines_per_page = usable_h / font_h_pt;
+    line_w         = usable_w * 64u;
 
-    /* build output filename: strip extension, append .pdf */
-    strncpy(outname, inname, FNAMELEN - 5u);
-    outname[FNAMELEN - 5u] = 0;
-    slen = (unsigned)strlen(outname);
-    /* find last dot */
-    {
-        int dot = -1;
-        unsigned k;
-        for (k = 0u; k < slen; k++) if (outname[k] == '.') dot = (int)k;
-        if (dot >= 0) outname[dot] = 0;
-    }
-    strcat(outname, ".pdf");
+    if (!collect_docs(inname)) return -1;
 
-    printf(NEWLINE "%s -> %s" NEWLINE, inname, outname);
-    printf("Font: %upt, margins L=%u R=%u T=%u B=%u mm" NEWLINE,
+    printf(NEWLINE "Font: %upt, margins L=%u R=%u T=%u B=%u mm" NEWLINE,
            base_size, left_mm, right_mm, top_mm, bot_mm);
-    printf("Layout: %u cols, %u rows/page" NEWLINE,
-           chars_per_line, lines_per_page);
-    want_toc      = 0u;
-    toc_depth     = 1u;
-    toc_at_start  = 0u;
-    file_body_start = 0;
-
-    in_fd = open(inname, O_RDONLY);
-    if (in_fd < 0) {
-        printf(EXCLAMATION "cannot open %s" NEWLINE, inname);
-        return -1;
-    }
-
-    /* detect @NX and ^ header lines using read_line for correct CRLF handling */
-    toc_title[0]   = 0;
-    has_title_page = 0u;
-    doc_title[0]   = 0;
-    doc_author[0]  = 0;
-    {
-        char lbuf[LINE_BUF_LEN];
-        int  n;
-
-        /* peek at first line */
-        file_body_start = 0;
-        n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-        if (n >= 3 && lbuf[0] == '@' &&
-            lbuf[1] >= '1' && lbuf[1] <= '9' &&
-            (lbuf[2] == '<' || lbuf[2] == '>') &&
-            (lbuf[3] == ' ' || lbuf[3] == 0)) {
-            /* @NX line found */
-            want_toc     = 1u;
-            toc_depth    = (uint8_t)(lbuf[1] - '0');
-            toc_at_start = (lbuf[2] == '<') ? 1u : 0u;
-            if (lbuf[3] == ' ') {
-                strncpy(toc_title, lbuf + 4, LINE_BUF_LEN - 1u);
-                toc_title[LINE_BUF_LEN - 1u] = 0;
-            }
-            file_body_start = lseek(in_fd, 0, SEEK_CUR);
-
-            /* peek at next line for ^ title page */
-            n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-            if (n >= 1 && lbuf[0] == '^') {
-                strncpy(doc_title, lbuf + 1, LINE_BUF_LEN - 1u);
-                doc_title[LINE_BUF_LEN - 1u] = 0;
-                /* author is the next line */
-                n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-                if (n >= 0) {
-                    strncpy(doc_author, lbuf, LINE_BUF_LEN - 1u);
-                    doc_author[LINE_BUF_LEN - 1u] = 0;
-                }
-                has_title_page = 1u;
-                file_body_start = lseek(in_fd, 0, SEEK_CUR);
-            } else {
-                /* no ^ line — rewind to after @NX */
-                lseek(in_fd, (off_t)file_body_start, SEEK_SET);
-            }
-        } else {
-            /* no @NX — rewind to start */
-            lseek(in_fd, 0, SEEK_SET);
-            file_body_start = 0;
-
-            /* still check for ^ at file start */
-            if (n >= 1 && lbuf[0] == '^') {
-                strncpy(doc_title, lbuf + 1, LINE_BUF_LEN - 1u);
-                doc_title[LINE_BUF_LEN - 1u] = 0;
-                n = read_line(in_fd, lbuf, LINE_BUF_LEN - 1u);
-                if (n >= 0) {
-                    strncpy(doc_author, lbuf, LINE_BUF_LEN - 1u);
-                    doc_author[LINE_BUF_LEN - 1u] = 0;
-                }
-                has_title_page = 1u;
-                file_body_start = lseek(in_fd, 0, SEEK_CUR);
-            }
-        }
-    }
-
-    page_count = count_pages(in_fd);
-    if (page_count == 0u) {
-        printf(EXCLAMATION "read error or empty file" NEWLINE);
-        close(in_fd);
-        return -1;
-    }
-    if (page_count > MAX_PAGES) {
-        printf(EXCLAMATION "too many pages (max %u)" NEWLINE, MAX_PAGES);
-        close(in_fd);
-        return -1;
-    }
-
-    printf("Pages: %u" NEWLINE, page_count);
-
-    pdf_fd = open(outname, O_WRONLY | O_CREAT | O_TRUNC);
-    if (pdf_fd < 0) {
-        printf(EXCLAMATION "cannot create %s" NEWLINE, outname);
-        close(in_fd);
-        return -1;
-    }
-
-    pdf_pos    = 0UL;
-    /*
-     * Object layout:
-     *   Without /pl (want_polish=0):
-     *     1=Catalog 2=Pages 3=F1/Courier 4=F2/Courier-Oblique
-     *     5..   : title page (T=2 if present), content pages+streams, TOC
-     *   With /pl (want_polish=1):
-     *     1=Catalog 2=Pages 3=F1/Type0 4=F2/Courier-Oblique
-     *     5=CIDFont 6=FontDescriptor 7=FontFile2 8=ToUnicode
-     *     9..   : title page (T=2 if present), content pages+streams, TOC
-     */
-    first_page_obj = want_polish ? 9u : 5u;
-    { unsigned T = has_title_page ? 2u : 0u;
-      unsigned extra = T + (want_toc ? 2u : 0u);
-      unsigned font_extra = want_polish ? 4u : 0u; /* cidfont+fontdesc+fontfile+tounicode */
-      total_objs = 4u + font_extra + page_count * 2u + extra;
-    }
-    memset(obj_off, 0, sizeof(obj_off));
-
-    lseek(in_fd, (off_t)file_body_start, SEEK_SET);
-
-    write_header();
-    write_catalog();
-    write_pages_dict(page_count);
+    if (want_prop) printf("Layout: %u pt lines, %u rows/page" NEWLINE, usable_w, lines_per_page);
+    else           printf("Layout: %u cols, %u rows/page" NEWLINE, chars_per_line, lines_per_page);
 
+    /* the font is opened and its directory and widths read once for all PDFs */
     if (want_polish) {
-        int ttf_fd = open("MSC0:/TTF/DroidSansMono.ttf", O_RDONLY);
+        const char *font = want_prop ? TTF_PROP : TTF_MONO;
+        ttf_fd = open(font, O_RDONLY);
         if (ttf_fd < 0) {
-            printf(EXCLAMATION "MSC0:/TTF/DroidSansMono.ttf not found" NEWLINE);
-            close(in_fd);
-            close(pdf_fd);
+            printf(EXCLAMATION "%s not found" NEWLINE, font);
+            return -1;
+        }
+        ttf_ok = ttf_load(ttf_fd);
+        if (want_prop && !ttf_widths(ttf_fd)) {
+            printf(EXCLAMATION "no glyph widths in %s" NEWLINE, font);
+            close(ttf_fd);
             return -1;
         }
-        write_ttf_font_objs(ttf_fd);
-        close(ttf_fd);
-    }
-
-    write_fonts();
-
-    /* title page (always obj 5 and 6 when present) */
-    if (has_title_page) {
-        write_title_page_obj(first_page_obj, first_page_obj + 1u);
     }
 
-    { unsigned T  = has_title_page ? 2u : 0u;
-      unsigned Wt = want_toc ? 1u : 0u;
-      /* content page obj i = first_page_obj + T + i
-         content stream i   = first_page_obj + T + page_count + Wt + i */
-      for (i = 0u; i < page_count; i++) {
-          write_page_obj(first_page_obj + T + i,
-                         first_page_obj + T + page_count + Wt + i);
-          write_stream_obj(in_fd,
-                           first_page_obj + T + page_count + Wt + i,
-                           i + 1u,
-                           page_count);
-      }
-
-      if (want_toc) {
-          unsigned toc_page_obj   = first_page_obj + T + page_count;
-          unsigned toc_stream_obj = first_page_obj + T + page_count + 1u + page_count;
-          write_page_obj(toc_page_obj, toc_stream_obj);
-          write_toc_stream_obj(in_fd, toc_stream_obj, page_count);
-      }
+    if (outname[0]) {
+        /* one PDF: a single input under another name, or the whole batch */
+        doc_lo = 0u;
+        doc_hi = doc_count;
+        rc = write_pdf();
+    } else {
+        for (d = 0u; d < doc_count; d++) {
+            doc_lo = d;
+            doc_hi = d + 1u;
+            make_outname(doc_name[d]);
+            if (write_pdf() < 0) rc = -1;
+        }
     }
 
-    write_xref_and_trailer(total_objs);
-
-    close(in_fd);
-    close(pdf_fd);
+    if (in_fd >= 0) close(in_fd);
+    if (want_polish) close(ttf_fd);
 
-    printf("Done." NEWLINE);
-    return 0;
+    if (rc == 0) printf("Done." NEWLINE);
+    return rc;
 }
@@ -155,74 +155,114 @@ static int startstage_boot(){
 /* Command history                                                      */
 /* ------------------------------------------------------------------ */
 
-#define HIST_MAX  20
-#define HIST_FILE "MSC0:/SHELL/.history"
+#define HIST_MAX     20
+#define HIST_COMPACT (HIST_MAX * 4)  /* log lines tolerated before compaction at startup */
+#define HIST_FILE    "MSC0:/SHELL/.history"
+
+/*
+ * HIST_FILE is an append-only log: every accepted command costs one
+ * O_APPEND write of a single line. The log is rewritten (compacted to the
+ * last HIST_MAX entries) only by hist_load() at shell start, and only when
+ * it has grown past HIST_COMPACT lines.
+ */
 
 static char hist_buf[HIST_MAX][CMD_BUF_MAX + 1];
+static char hist_line[CMD_BUF_MAX + 2];  /* line + '\n' */
 static int  hist_count = 0;
 static int  hist_head  = 0;  /* next write slot */
+static int  hist_file_lines = 0;  /* lines currently stored in HIST_FILE */
 
 /* hist_get(0)=newest, hist_get(hist_count-1)=oldest */
 static const char *hist_get(int i) {
     return hist_buf[(hist_head - 1 - i + HIST_MAX * 2) % HIST_MAX];
 }
 
-static void hist_save(void) {
+static void hist_push(const char *cmd) {
+    int slot;
+    slot = hist_head % HIST_MAX;
+    strncpy(hist_buf[slot], cmd, CMD_BUF_MAX);
+    hist_buf[slot][CMD_BUF_MAX] = 0;
+    hist_head = (hist_head + 1) % HIST_MAX;
+    if (hist_count < HIST_MAX) hist_count++;
+}
+
+static void hist_compact(void) {  /* rewrite the log with in-memory entries, block writes via bload_buf */
     int fd, i;
-    char nl = '\n';
+    unsigned n, len;
     const char *p;
-    int n;
     fd = open(HIST_FILE, O_WRONLY | O_CREAT | O_TRUNC);
     if (fd < 0) return;
+    n = 0;
     for (i = hist_count - 1; i >= 0; i--) {  /* oldest first */
         p = hist_get(i);
-        n = (int)strlen(p);
-        write(fd, p, n);
-        write(fd, &nl, 1);
+        len = (unsigned)strlen(p);
+        if (n + len + 1 > sizeof(bload_buf)) {
+            write(fd, bload_buf, n);
+            n = 0;
+        }
+        memcpy(bload_buf + n, p, len);
+        n += len;
+        bload_buf[n++] = '\n';
     }
+    if (n) write(fd, bload_buf, n);
+    close(fd);
+    hist_file_lines = hist_count;
+}
+
+static void hist_append(const char *cmd) {  /* one open + one write per command */
+    int fd;
+    unsigned len;
+    len = (unsigned)strlen(cmd);
+    if (len > CMD_BUF_MAX) len = CMD_BUF_MAX;
+    fd = open(HIST_FILE, O_WRONLY | O_CREAT | O_APPEND);
+    if (fd < 0) return;
+    memcpy(hist_line, cmd, len);
+    hist_line[len] = '\n';
+    if (write(fd, hist_line, len + 1) == (int)(len + 1)) hist_file_lines++;
     close(fd);
 }
 
 static void hist_load(void) {
     int fd;
+    int n, i;
     char c;
-    static char line[CMD_BUF_MAX + 1];
     int lp = 0;
-    int slot;
     hist_count = 0;
     hist_head  = 0;
+    hist_file_lines = 0;
     fd = open(HIST_FILE, O_RDONLY);
     if (fd < 0) return;
-    while (read(fd, &c, 1) == 1) {
-        if (c == '\n' || c == '\r') {
-            if (lp > 0) {
-                line[lp] = 0;
-                slot = hist_head % HIST_MAX;
-                strncpy(hist_buf[slot], line, CMD_BUF_MAX);
-                hist_buf[slot][CMD_BUF_MAX] = 0;
-                hist_head = (hist_head + 1) % HIST_MAX;
-                if (hist_count < HIST_MAX) hist_count++;
-                lp = 0;
+    while ((n = read(fd, bload_buf, sizeof(bload_buf))) > 0) {
+        for (i = 0; i < n; i++) {
+            c = (char)bload_buf[i];
+            if (c == '\n' || c == '\r') {
+                if (lp > 0) {
+                    hist_line[lp] = 0;
+                    hist_push(hist_line);
+                    hist_file_lines++;
+                    lp = 0;
+                }
+            } else if (lp < CMD_BUF_MAX) {
+                hist_line[lp++] = c;
             }
-        } else if (lp < CMD_BUF_MAX) {
-            line[lp++] = c;
         }
     }
     close(fd);
+    if (lp > 0) {  /* last line without terminator */
+        hist_line[lp] = 0;
+        hist_push(hist_line);
+        hist_file_lines++;
+    }
+    if (hist_file_lines > HIST_COMPACT) hist_compact();
 }
 
 static void hist_add(const char *cmd) {
-    int slot;
     if (!cmd[0]) return;
     if (hist_count > 0 &&
         strcmp(hist_buf[(hist_head - 1 + HIST_MAX) % HIST_MAX], cmd) == 0)
         return;  /* skip duplicate */
-    slot = hist_head % HIST_MAX;
-    strncpy(hist_buf[slot], cmd, CMD_BUF_MAX);
-    hist_buf[slot][CMD_BUF_MAX] = 0;
-    hist_head = (hist_head + 1) % HIST_MAX;
-    if (hist_count < HIST_MAX) hist_count++;
-    hist_save();
+    hist_push(cmd);
+    hist_append(cmd);
 }
 
 /* ------------------------------------------------------------------ */
@@ -295,8 +335,19 @@ static int startstage_shell(){
 
     hist_load();
 
+    if((i = open(SCRIPT_AUTOEXEC, O_RDONLY)) >= 0) {
+        close(i);
+        tx_string(NEWLINE);
+        execute_cmd(&cmdline, "call " SCRIPT_AUTOEXEC);
+        cmdline.bytes = 0;
+        cmdline.buffer[0] = 0;
+        tx_string(NEWLINE);
+        prompt(PROMPT);
+    }
+
     while (1)
     {
+        if(tx_len) tx_flush(); // show echo and prompt before waiting for a key
 
         if(RX_READY) {
             char rx = (char)RIA.rx;
@@ -530,7 +581,7 @@ static int startstage_shell(){
                     tx_string(NEWLINE);
                     hist_add(cmdline.buffer);
                     hist_pos = -1;
-                    execute(&cmdline);
+                    execute_line(cmdline.buffer);
                     // while(!RX_READY) {(void)RIA.rx;}
                     cmdline.bytes = 0;
                     cmdline.buffer[0] = 0;
@@ -547,56 +598,7 @@ static int startstage_shell(){
 }
 
 // things related to : console command processor operations
-
-inline void tx_char(char c) {
-    TX_READY_SPIN;
-    RIA.tx = c;
-    return;
-}
-
-void tx_chars(const char *buf, int ct) {
-    for(; ct; ct--, buf++) tx_char(*buf);
-    return;
-}
-
-void tx_string(const char *buf) {
-    while(*buf) tx_char(*buf++);
-    return;
-}
-
-void tx_hex32(unsigned long val) { // Print a 32-bit value as 8 hex digits.
-    char out[8];
-    int i;
-    for(i = 7; i >= 0; i--) {
-        out[i] = hexdigits[val & 0xF];
-        val >>= 4;
-    }
-    tx_chars(out, sizeof(out));
-}
-
-void tx_hex16(uint16_t val) { // Print 16-bit value as 4 hex digits
-    char out[4];
-    int i;
-    for(i = 3; i >= 0; i--) {
-        out[i] = hexdigits[val & 0xF];
-        val >>= 4;
-    }
-    tx_chars(out, sizeof(out));
-}
-
-void tx_dec32(unsigned long val) { // Print an unsigned long in decimal.
-    char out[10];
-    int i = 10;
-    if(val == 0) {
-        tx_char('0');
-        return;
-    }
-    while(val && i) {
-        out[--i] = '0' + (val % 10);
-        val /= 10;
-    }
-    tx_chars(&out[i], 10 - i);
-}
+// tx_char, tx_string, tx_dec32, tx_hex16/32 and tx_flush live in commons/txout.h
 
 // things related to : disk operations
 
@@ -726,6 +728,88 @@ void xram_writer(const uint8_t *buf, uint16_t addr, uint16_t size) {
     for(; size; size--) RIA.rw0 = *buf++;
 }
 
+int hexstr(char *str, uint8_t val) { // Assumes str points to at least two bytes.
+    str[0] = hexdigits[val >> 4];
+    str[1] = hexdigits[val & 0xF];
+    return 2;
+}
+
+void hexdump(uint16_t addr, uint16_t bytes, char_stream_func_t streamer, read_data_func_t reader) { // 16 bytes per line: address, hex, ASCII
+    int i;
+    uint8_t data[HEXDUMP_LINE_SIZE];
+    char string[HEXDUMP_LINE_SIZE * 3 + 32];
+
+    while(bytes) {
+        char *str = string;
+        int rd = bytes > sizeof(data) ? sizeof(data) : bytes;
+        str += hexstr(str, addr >> 8);
+        str += hexstr(str, addr & 0xFF);
+        *str++ = ' ';
+        *str++ = ' ';
+        reader(data, addr, rd);
+        for(i = 0; i < rd; i++) {
+            if (i == 8) *str++ = ' ';
+            *str++ = ' ';
+            str += hexstr(str, data[i]);
+        }
+        if(rd < HEXDUMP_LINE_SIZE){
+            int missing = HEXDUMP_LINE_SIZE - rd;
+            for(i = 0; i < missing; i++){
+                if (i == 8) *str++ = ' ';
+                *str++ = ' ';
+                *str++ = ' ';
+                *str++ = ' ';
+            }
+        }
+        *str++ = ' ';
+        *str++ = ' ';
+        *str++ = 0xB3;
+        for(i = 0; i < rd; i++) {
+            char b = (data[i] >= 32 && data[i] <= 126) ? data[i] : '.';
+            *str++ = b;
+        }
+        *str++ = 0xB3;
+        *str++ = CHAR_CR;
+        *str++ = CHAR_LF;
+        streamer(string, str - string);
+        bytes -= rd;
+        addr += rd;
+    }
+    return;
+}
+
+// things related to : helpers exported to .com commands, see commons/shlib.h
+// Order must follow the SHLIB_* enum; only ever append.
+
+#pragma rodata-name (push, "JUMPTAB")
+const shlib_table_t shlib_table = {
+    SHLIB_MAGIC, SHLIB_VERSION, SHLIB_COUNT,
+    {
+        { SHLIB_JMP, (shlib_fn_t)tx_char },
+        { SHLIB_JMP, (shlib_fn_t)tx_chars },
+        { SHLIB_JMP, (shlib_fn_t)tx_string },
+        { SHLIB_JMP, (shlib_fn_t)tx_dec32 },
+        { SHLIB_JMP, (shlib_fn_t)tx_hex16 },
+        { SHLIB_JMP, (shlib_fn_t)tx_hex32 },
+        { SHLIB_JMP, (shlib_fn_t)tx_flush },
+        { SHLIB_JMP, (shlib_fn_t)hexdump },
+        { SHLIB_JMP, (shlib_fn_t)ram_reader },
+        { SHLIB_JMP, (shlib_fn_t)xram_reader },
+        { SHLIB_JMP, (shlib_fn_t)match_mask },
+        { SHLIB_JMP, (shlib_fn_t)format_fat_datetime },
+        { SHLIB_JMP, (shlib_fn_t)memcpy },
+        { SHLIB_JMP, (shlib_fn_t)memset },
+        { SHLIB_JMP, (shlib_fn_t)strlen },
+        { SHLIB_JMP, (shlib_fn_t)strcpy },
+        { SHLIB_JMP, (shlib_fn_t)strncpy },
+        { SHLIB_JMP, (shlib_fn_t)strcmp },
+        { SHLIB_JMP, (shlib_fn_t)stricmp },
+        { SHLIB_JMP, (shlib_fn_t)strchr },
+        { SHLIB_JMP, (shlib_fn_t)strtoul },
+    }
+};
+#pragma rodata-name (pop)
+
 // things related to memory
 
 uint16_t mem_lo(void) { // Lowest usable address for other programs as shell base adress + shell size
@@ -876,16 +960,148 @@ static int tokenize(char *buf, int maxBuf, char **tokenList, int maxTokens) {
     return tokens;
 }
 
+static char *find_operator(char *buf, char op) { // first op outside quotes and escapes, same rules as tokenize()
+    bool escape = false;
+    char quote = 0;
+    for(; *buf; buf++) {
+        if(escape) escape = false;
+        else if(*buf == '\\') escape = true;
+        else if(quote) { if(*buf == quote) quote = 0; }
+        else if(*buf == '\'' || *buf == '"') quote = *buf;
+        else if(*buf == op) return buf;
+    }
+    return NULL;
+}
+
+static int redirect_open(char *gt) { // "> file" or ">> file" at gt, cut it out of the command line
+    static char target[FNAMELEN];
+    char *name = gt + 1;
+    char *end;
+    unsigned len;
+    int fd;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if(*name == '>') {
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+        name++;
+    }
+    while(*name == ' ') name++;
+    end = name;
+    while(*end && *end != ' ') end++;
+    len = (unsigned)(end - name);
+    if(!len) {
+        tx_string(EXCLAMATION "missing redirection target" NEWLINE);
+        return -1;
+    }
+    if(len >= sizeof(target)) {
+        tx_string(EXCLAMATION "can't open redirection target" NEWLINE);
+        return -1;
+    }
+    memcpy(target, name, len);
+    target[len] = 0;
+    memmove(gt, end, strlen(end) + 1); // tokens after the target stay with the command: dir > out.txt /w
+    fd = open(target, flags);
+    if(fd < 0) {
+        tx_string(EXCLAMATION "can't open redirection target" NEWLINE);
+        return -1;
+    }
+    redir_state.out_fd = (int8_t)fd;
+    redir_state.out_len = 0;
+    redir_state.error = 0;
+    return 0;
+}
+
+static int redirect_close(const redir_t *saved) { // flush staged output, close the file, back to previous output
+    int rc;
+    redir_flush(&redir_state);
+    close(redir_state.out_fd);
+    rc = redir_state.error ? -1 : 0;
+    redir_state = *saved;
+    if(rc < 0) tx_string(EXCLAMATION "redirection writing error" NEWLINE);
+    return rc;
+}
+
+static void pipe_drop(void) { // leave the innermost pipe, remove its file
+    pipe_depth--;
+    pipe_path[sizeof(pipe_path) - 2] = (char)('0' + pipe_depth);
+    unlink(pipe_path);
+}
+
+static int execute_pipe(cmdline_t *cl, char *bar) { // left side output to a pipe file, which is the right side stdin
+    redir_t saved = redir_state;
+    char *rest;
+    int rc;
+    int fd;
+    if(pipe_depth >= PIPE_DEPTH_MAX) {
+        tx_string(EXCLAMATION "too many pipes" NEWLINE);
+        return -1;
+    }
+    rest = pipe_rest[pipe_depth];
+    str_copy_checked(rest, CMD_BUF_MAX + 1, bar + 1); // the left side may reuse cl->buffer (scripts)
+    *bar = 0;
+    cl->bytes = (int)(bar - cl->buffer);
+    pipe_path[sizeof(pipe_path) - 2] = (char)('0' + pipe_depth);
+    fd = open(pipe_path, O_WRONLY | O_CREAT | O_TRUNC);
+    if(fd < 0) {
+        tx_string(EXCLAMATION "can't create pipe file" NEWLINE);
+        return -1;
+    }
+    pipe_depth++;
+    redir_state.out_fd = (int8_t)fd;
+    redir_state.out_len = 0;
+    redir_state.error = 0;
+    rc = execute(cl);
+    if(redirect_close(&saved) < 0) rc = -1; // short pipe file: the right side would see truncated input
+    if(rc != 0) {
+        pipe_drop();
+        return (rc < 0) ? -1 : rc; // the right side does not run after a failed left side
+    }
+
+    pipe_path[sizeof(pipe_path) - 2] = (char)('0' + pipe_depth - 1);
+    fd = open(pipe_path, O_RDONLY);
+    if(fd < 0) {
+        tx_string(EXCLAMATION "can't open pipe file" NEWLINE);
+        pipe_drop();
+        return -1;
+    }
+    redir_state.in_fd = (int8_t)fd;
+    cl->bytes = (int)strlen(rest);
+    memcpy(cl->buffer, rest, cl->bytes + 1);
+    rc = execute(cl);
+    close(fd);
+    redir_state = saved;
+    pipe_drop();
+    return rc;
+}
+
 static int execute(cmdline_t *cl) {
-    int i;
     char *tokenList[CMD_TOKEN_MAX + 1]; /* +1 for NULL sentinel required by ria_execv */
     int tokens = 0;
+    int rc;
+    char *op;
+    redir_t saved;
+    op = find_operator(cl->buffer, '|');
+    if(op) return execute_pipe(cl, op);
+    op = find_operator(cl->buffer, '>');
+    if(op) {
+        saved = redir_state;
+        if(redirect_open(op) < 0) return -1;
+        cl->bytes = (int)strlen(cl->buffer);
+    }
     tokens = tokenize(cl->buffer, cl->bytes, tokenList, CMD_TOKEN_MAX);
     if(tokens >= 0) tokenList[tokens] = NULL;
     if(tokens <= 0) {
         if(tokens < 0) tx_string(EXCLAMATION "unterminated quote/escape" NEWLINE);
-        return 0;
+        rc = 0;
+    } else {
+        rc = execute_tokens(tokens, tokenList);
     }
+    if(op && redirect_close(&saved) < 0 && rc >= 0) rc = -1;
+    errorlevel = (rc < 0) ? -rc : rc;
+    return rc;
+}
+
+static int execute_tokens(int tokens, char **tokenList) { // dispatch an already tokenized command line
+    int i;
     // Allow selecting drive by typing e.g. "0:" directly
     if(tokens == 1 &&
         tokenList[0][0] >= '0' && tokenList[0][0] <= '7' &&
@@ -899,6 +1115,13 @@ static int execute(cmdline_t *cl) {
             return commands[i].func(tokens, tokenList);
         }
     }
+    // Try implicit script execution: <name>.rsh [args...]
+    {
+        unsigned name_len = (unsigned)strlen(tokenList[0]);
+        if(name_len > 4 && !strcmp(tokenList[0] + name_len - 4, SCRIPT_EXT)) {
+            return script_call(tokens, tokenList);
+        }
+    }
     // Try implicit .exe execution: load address from file trailer
     {
         unsigned name_len = (unsigned)strlen(tokenList[0]);
@@ -968,6 +1191,199 @@ static int execute_cmd(cmdline_t *cl, const char *cmd) {
     return execute(cl);
 }
 
+// things related to : script files (.rsh)
+
+static int script_getline(script_t *sc, char *buf, int maxlen) { // next line from block buffer, -1 at end of file
+    int len = 0;
+    bool got = false;
+    char c;
+    while(1) {
+        if(sc->rpos >= sc->rlen) {
+            sc->rpos = 0;
+            sc->rlen = read(sc->fd, sc->rbuf, SCRIPT_RBUF);
+            if(sc->rlen <= 0) {
+                sc->rlen = 0;
+                break;
+            }
+        }
+        c = (char)sc->rbuf[sc->rpos++];
+        got = true;
+        if(c == '\n') break;
+        if(c == '\r') continue;
+        if(c == '\t') c = ' ';
+        if(len < maxlen) buf[len++] = c;
+    }
+    buf[len] = 0;
+    return got ? len : -1;
+}
+
+static int script_seek_label(script_t *sc, const char *label) { // rewind and stop after the ":label" line
+    unsigned len = (unsigned)strlen(label);
+    char *p;
+    if(lseek(sc->fd, 0, SEEK_SET) < 0) return -1;
+    sc->rlen = 0;
+    sc->rpos = 0;
+    while(script_getline(sc, script_line, CMD_BUF_MAX) >= 0) {
+        p = script_line;
+        while(*p == ' ') p++;
+        if(*p++ != ':') continue;
+        if(!strnicmp(p, label, len) && (p[len] == 0 || p[len] == ' ')) return 0;
+    }
+    return -1;
+}
+
+static shvar_t *shvar_find(const char *name) {
+    int i;
+    for(i = 0; i < SHVAR_MAX; i++) {
+        if(shvars[i].name[0] && !stricmp(shvars[i].name, name)) return &shvars[i];
+    }
+    return NULL;
+}
+
+static const char *shvar_get(const char *name) { // value of %name%, "" when undefined
+    static char num[7];
+    shvar_t *v;
+    if(!stricmp(name, "errorlevel")) {
+        itoa(errorlevel, num, 10);
+        return num;
+    }
+    v = shvar_find(name);
+    return v ? v->value : "";
+}
+
+static int shvar_set(const char *name, const char *value) { // empty value removes the variable
+    int i;
+    shvar_t *v = shvar_find(name);
+    if(!v) {
+        if(!*value) return 0;
+        for(i = 0; i < SHVAR_MAX && !v; i++) {
+            if(!shvars[i].name[0]) v = &shvars[i];
+        }
+        if(!v) return -1;
+        if(str_copy_checked(v->name, sizeof(v->name), name) < 0) return -1;
+    }
+    if(!*value) {
+        v->name[0] = 0;
+        return 0;
+    }
+    strncpy(v->value, value, SHVAR_VALUE_MAX);
+    v->value[SHVAR_VALUE_MAX] = 0;
+    return 0;
+}
+
+static void script_expand(const char *src, char *dst, unsigned dst_size) { // substitute %1..%9, %name%, %%
+    script_t *sc = script_depth ? &scripts[script_depth - 1] : NULL;
+    char name[SHVAR_NAME_MAX + 1];
+    const char *val;
+    const char *end;
+    unsigned o = 0;
+    unsigned n;
+    while(*src && o + 1 < dst_size) {
+        val = NULL;
+        if(*src == '%') {
+            if(src[1] == '%') {
+                dst[o++] = '%';
+                src += 2;
+                continue;
+            }
+            if(sc && src[1] >= '0' && src[1] <= '9') {
+                n = (unsigned)(src[1] - '0');
+                val = (n < (unsigned)sc->argc) ? sc->argv[n] : "";
+                src += 2;
+            } else {
+                end = strchr(src + 1, '%');
+                n = end ? (unsigned)(end - src - 1) : 0;
+                if(n && n <= SHVAR_NAME_MAX) {
+                    memcpy(name, src + 1, n);
+                    name[n] = 0;
+                    val = shvar_get(name);
+                    src = end + 1;
+                }
+            }
+        }
+        if(val) {
+            while(*val && o + 1 < dst_size) dst[o++] = *val++;
+            continue;
+        }
+        dst[o++] = *src++;
+    }
+    dst[o] = 0;
+}
+
+static int execute_line(const char *line) { // expand variables, then tokenize and execute
+    script_expand(line, expand_cl.buffer, sizeof(expand_cl.buffer));
+    expand_cl.bytes = (int)strlen(expand_cl.buffer);
+    return execute(&expand_cl);
+}
+
+static int script_run(script_t *sc) {
+    int rc = 0;
+    char *p;
+    script_goto[0] = 0;
+    while(script_getline(sc, script_line, CMD_BUF_MAX) >= 0) {
+        if(RX_READY && (char)RIA.rx == CHAR_ESC) {
+            tx_string(EXCLAMATION "script cancelled" NEWLINE);
+            rc = -1;
+            break;
+        }
+        p = script_line;
+        while(*p == ' ') p++;
+        if(!*p || *p == '#' || *p == ':') continue; // empty line, comment, label
+        rc = execute_line(p);
+        if(script_goto[0]) {
+            if(!stricmp(script_goto, "eof")) break;
+            if(script_seek_label(sc, script_goto) < 0) {
+                tx_string(EXCLAMATION "label not found: ");
+                tx_string(script_goto);
+                tx_string(NEWLINE);
+                rc = -1;
+                break;
+            }
+            script_goto[0] = 0;
+        }
+    }
+    script_goto[0] = 0;
+    return rc;
+}
+
+static int script_call(int argc, char **argv) { // argv[0] = script path, argv[1..] = %1..%9
+    script_t *sc;
+    unsigned used = 0;
+    unsigned len;
+    int i;
+    int rc;
+    if(script_depth >= SCRIPT_DEPTH_MAX) {
+        tx_string(EXCLAMATION "script nesting too deep" NEWLINE);
+        return -1;
+    }
+    sc = &scripts[script_depth];
+    sc->argc = 0;
+    for(i = 0; i < argc && sc->argc <= SCRIPT_ARGS_MAX; i++) {
+        len = (unsigned)strlen(argv[i]);
+        if(used + len + 1 > sizeof(sc->args)) break;
+        memcpy(sc->args + used, argv[i], len + 1);
+        sc->argv[sc->argc++] = sc->args + used;
+        used += len + 1;
+    }
+    if(!sc->argc) return -1;
+    sc->fd = open(sc->argv[0], O_RDONLY);
+    if(sc->fd < 0 && !strchr(sc->argv[0], ':') && !strchr(sc->argv[0], '/') &&
+       path_join_checked(script_path, sizeof(script_path), SHELLDRIVEDIRDEFAULT, sc->argv[0]) == 0) {
+        sc->fd = open(script_path, O_RDONLY);
+    }
+    if(sc->fd < 0) {
+        tx_string(EXCLAMATION "can't open script" NEWLINE);
+        return -1;
+    }
+    sc->rlen = 0;
+    sc->rpos = 0;
+    script_depth++;
+    rc = script_run(sc);
+    script_depth--;
+    close(sc->fd);
+    return rc;
+}
+
 static void build_run_args(int user_argc, char **user_argv) {
     uint8_t *base = (uint8_t *)RUN_ARGS_BASE;
     uint16_t *ptrs = (uint16_t *)(RUN_ARGS_BASE + 1);
@@ -975,6 +1391,8 @@ static void build_run_args(int user_argc, char **user_argv) {
     uint8_t *end = strp + RUN_ARGS_BUF;
     int i;
 
+    tx_flush(); // our pending console bytes go out before the program's own
+
     if(user_argc > RUN_ARGS_MAX) user_argc = RUN_ARGS_MAX;
     if(user_argc < 0) user_argc = 0;
     base[0] = (uint8_t)user_argc;
@@ -990,6 +1408,20 @@ static void build_run_args(int user_argc, char **user_argv) {
         memcpy(strp, s, len + 1);
         strp += len + 1;
     }
+    memcpy(REDIR, &redir_state, sizeof(redir_t));
+    *RUN_STATUS = 0; // programs not started by crt0_cmd.s leave it, so they succeed
+    redir_cur = REDIR; // the program's tx calls through the jump table share its block
+}
+
+static int end_run_args(void) { // take back redirect state from the program, restore the argc/argv area
+    int status;
+    tx_flush(); // last partial line written through the jump table
+    redir_cur = &redir_state;
+    redir_state.out_len = REDIR->out_len;
+    redir_state.error |= REDIR->error;
+    status = *RUN_STATUS;
+    memcpy((void *)RUN_ARGS_BASE, run_args_backup, RUN_BLOCK_SIZE);
+    return status; // what main() returned
 }
 
 static void refresh_current_drive(void) { // helper for cmd_com & cmd_run
@@ -1007,6 +1439,7 @@ int cmd_cls(int, char **) { // clear screen
 
 int cmd_exit(int status, char **) { // exit to rp6502 monitor
     tx_string(APP_MSG_EXIT OSC_ST);
+    tx_flush(); // the terminal reset must leave before the shell does
     exit(status);
     return 0;
 }
@@ -1070,16 +1503,21 @@ int cmd_list(int argc, char **argv) {
     int lines = 0;
     int lineno = 1;
     int at_line_start = 1;
+    bool paged = (redir_state.out_fd < 0); // no banners and no -- MORE -- when output is redirected
     if(argc < 2) {
-        tx_string("Usage: list <filename>" NEWLINE);
-        return 0;
+        if(redir_state.in_fd < 0) {
+            tx_string("Usage: list <filename>" NEWLINE);
+            return 0;
+        }
+        fd = redir_state.in_fd; // right side of a pipe
+    } else {
+        fd = open(argv[1], O_RDONLY);
     }
-    fd = open(argv[1], O_RDONLY);
     if(fd < 0) {
         tx_string(ANSI_RED EXCLAMATION "can't open file" ANSI_RESET NEWLINE);
         return -1;
     }
-    tx_string(NEWLINE ANSI_DARK_GRAY "-- START --" ANSI_RESET NEWLINE);
+    if(paged) tx_string(NEWLINE ANSI_DARK_GRAY "-- START --" ANSI_RESET NEWLINE);
     while((n = read(fd, buf, sizeof(buf))) > 0) {
         int idx;
         for(idx = 0; idx < n; idx++) {
@@ -1097,14 +1535,15 @@ int cmd_list(int argc, char **argv) {
                 lines++;
                 lineno++;
                 at_line_start = 1;
-                if(lines >= 28) {
+                if(paged && lines >= 28) {
                     char ans;
                     tx_string(NEWLINE ANSI_DARK_GRAY "-- MORE -- (q to quit)" ANSI_RESET);
+                    tx_flush();
                     RX_READY_SPIN;
                     ans = (char)RIA.rx;
                     tx_string("\x1b[2K\x0d\x1b[1A"); // clear prompt line
                     if(ans == 'q' || ans == 'Q' || ans == CHAR_ESC) {
-                        close(fd);
+                        if(fd != redir_state.in_fd) close(fd);
                         tx_string(NEWLINE ANSI_DARK_GRAY "--- END ---" ANSI_RESET NEWLINE);
                         return 0;
                     }
@@ -1115,12 +1554,12 @@ int cmd_list(int argc, char **argv) {
             }
         }
     }
-    close(fd);
+    if(fd != redir_state.in_fd) close(fd);
     if(n < 0) {
         tx_string(EXCLAMATION "reading error" NEWLINE);
         return -1;
     }
-    tx_string(NEWLINE "--- END ---" NEWLINE);
+    if(paged) tx_string(NEWLINE "--- END ---" NEWLINE);
     return 0;
 }
 
@@ -1386,6 +1825,7 @@ int cmd_exe(int argc, char **argv) { // run binary with load address stored in l
     uint16_t addr;
     void (*fn)(void);
     int user_argc;
+    int rc;
     char **user_argv;
 
     if(argc < 2) {
@@ -1448,7 +1888,7 @@ int cmd_exe(int argc, char **argv) { // run binary with load address stored in l
     }
     close(fd);
 
-    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_ARGS_BLOCK_SIZE);
+    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_BLOCK_SIZE);
     user_argc = argc - 2;
     if(user_argc < 0) user_argc = 0;
     user_argv = argv + 2;
@@ -1456,9 +1896,9 @@ int cmd_exe(int argc, char **argv) { // run binary with load address stored in l
 
     fn = (void (*)(void))load_addr;
     fn();
-    memcpy((void *)RUN_ARGS_BASE, run_args_backup, RUN_ARGS_BLOCK_SIZE);
+    rc = end_run_args();
     refresh_current_drive();
-    return 0;
+    return rc;
 }
 
 int cmd_com(int argc, char **argv) { // run external command
@@ -1467,6 +1907,7 @@ int cmd_com(int argc, char **argv) { // run external command
     uint16_t addr = com_load_addr;
     void (*fn)(void);
     int user_argc;
+    int rc;
     char **user_argv;
     static char path_buf[FNAMELEN];
     const char *resolved;
@@ -1541,7 +1982,7 @@ int cmd_com(int argc, char **argv) { // run external command
     }
 
     /* Save and overwrite argc/argv block */
-    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_ARGS_BLOCK_SIZE);
+    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_BLOCK_SIZE);
     user_argc = argc - 2;
     if(user_argc < 0) user_argc = 0;
     user_argv = argv + 2;
@@ -1549,15 +1990,16 @@ int cmd_com(int argc, char **argv) { // run external command
 
     fn = (void (*)(void))com_load_addr;
     fn();
-    memcpy((void *)RUN_ARGS_BASE, run_args_backup, RUN_ARGS_BLOCK_SIZE);
+    rc = end_run_args();
     refresh_current_drive();
-    return 0;
+    return rc;
 }
 
 int cmd_run(int argc, char **argv) { // run at address with optional args
     void (*fn)(void);
     uint16_t addr;
     int user_argc;
+    int rc;
     char **user_argv;
 
     if(argc ==  2 && strcmp(argv[1],"/?") == 0) {
@@ -1569,16 +2011,16 @@ int cmd_run(int argc, char **argv) { // run at address with optional args
     } else {
         addr = (uint16_t)strtoul(argv[1], NULL, 16);
     }
-    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_ARGS_BLOCK_SIZE);
+    memcpy(run_args_backup, (void *)RUN_ARGS_BASE, RUN_BLOCK_SIZE);
     user_argc = argc - 2;
     if(user_argc < 0) user_argc = 0;
     user_argv = argv + 2;
     build_run_args(user_argc, user_argv);
     fn = (void (*)(void))addr;
     fn();
-    memcpy((void *)RUN_ARGS_BASE, run_args_backup, RUN_ARGS_BLOCK_SIZE);
+    rc = end_run_args();
     refresh_current_drive();
-    return 0;
+    return rc;
 }
 
 int cmd_copy(int argc, char **argv) {
@@ -1756,6 +2198,132 @@ int cmd_cp(int argc, char **argv) {
     return (rc < 0) ? -1 : 0;
 }
 
+int cmd_call(int argc, char **argv) { // run script file
+    if(argc < 2) {
+        tx_string("Usage: call <script" SCRIPT_EXT "> [args...]" NEWLINE);
+        return 0;
+    }
+    return script_call(argc - 1, argv + 1);
+}
+
+static char *join_args(int argc, char **argv) { // join argv[0..argc-1] with single spaces
+    unsigned o = 0;
+    unsigned len;
+    int i;
+    for(i = 0; i < argc; i++) {
+        if(i && o < sizeof(shvar_text) - 1) shvar_text[o++] = ' ';
+        len = (unsigned)strlen(argv[i]);
+        if(len > sizeof(shvar_text) - 1 - o) len = sizeof(shvar_text) - 1 - o;
+        memcpy(shvar_text + o, argv[i], len);
+        o += len;
+    }
+    shvar_text[o] = 0;
+    return shvar_text;
+}
+
+int cmd_echo(int argc, char **argv) {
+    tx_string(join_args(argc - 1, argv + 1));
+    tx_string(NEWLINE);
+    return 0;
+}
+
+int cmd_goto(int argc, char **argv) { // jump is performed by script_run() after this line returns
+    const char *label;
+    if(!script_depth) {
+        tx_string(EXCLAMATION "goto outside of a script" NEWLINE);
+        return -1;
+    }
+    if(argc < 2) {
+        tx_string("Usage: goto <label>|eof" NEWLINE);
+        return -1;
+    }
+    label = argv[1];
+    if(*label == ':') label++;
+    strncpy(script_goto, label, SCRIPT_LABEL_MAX);
+    script_goto[SCRIPT_LABEL_MAX] = 0;
+    return 0;
+}
+
+int cmd_if(int argc, char **argv) { // if [not] errorlevel N | exist <path> | <a>==<b>  <command...>
+    int i = 1;
+    bool negate = false;
+    bool cond;
+    int fd;
+    char *eq;
+    if(i < argc && !stricmp(argv[i], "not")) {
+        negate = true;
+        i++;
+    }
+    if(i + 2 < argc && !stricmp(argv[i], "errorlevel")) {
+        cond = errorlevel >= atoi(argv[i + 1]);
+        i += 2;
+    } else if(i + 2 < argc && !stricmp(argv[i], "exist")) {
+        fd = open(argv[i + 1], O_RDONLY);
+        cond = (fd >= 0);
+        if(fd >= 0) close(fd);
+        i += 2;
+    } else if(i + 1 < argc && (eq = strstr(argv[i], "==")) != NULL) {
+        *eq = 0;
+        cond = !strcmp(argv[i], eq + 2);
+        i += 1;
+    } else {
+        tx_string("Usage: if [not] errorlevel <n>|exist <path>|<a>==<b> <command>" NEWLINE);
+        return -1;
+    }
+    if(cond == negate) return 0;
+    return execute_tokens(argc - i, argv + i);
+}
+
+int cmd_set(int argc, char **argv) { // set [/a] [name=value]
+    shvar_t *v;
+    char *text;
+    char *eq;
+    int i;
+    bool arith = false;
+    if(argc < 2) {
+        for(i = 0; i < SHVAR_MAX; i++) {
+            v = &shvars[i];
+            if(!v->name[0]) continue;
+            tx_string(v->name);
+            tx_char('=');
+            tx_string(v->value);
+            tx_string(NEWLINE);
+        }
+        return 0;
+    }
+    i = 1;
+    if(!stricmp(argv[1], "/a")) {
+        arith = true;
+        i++;
+    }
+    text = join_args(argc - i, argv + i);
+    eq = strchr(text, '=');
+    if(!eq || eq == text) {
+        tx_string("Usage: set [/a] <name>=<value>" NEWLINE);
+        return -1;
+    }
+    *eq++ = 0;
+    if(arith) { // left to right sum of signed decimal terms, e.g. 3+1-2
+        static char num[7];
+        int acc = 0;
+        int sign = 1;
+        while(*eq) {
+            if(*eq == '+') { sign = 1; eq++; continue; }
+            if(*eq == '-') { sign = -1; eq++; continue; }
+            if(*eq < '0' || *eq > '9') { eq++; continue; }
+            acc += sign * atoi(eq);
+            while(*eq >= '0' && *eq <= '9') eq++;
+        }
+        itoa(acc, num, 10);
+        eq = num;
+    }
+    if(shvar_set(text, eq) < 0) {
+        tx_string(EXCLAMATION "no room for variable" NEWLINE);
+        return -1;
+    }
+    return 0;
+}
+
 int cmd_time(int argc, char **argv) {
     (void)argc; (void)argv;
     show_time();
@@ -12,6 +12,9 @@
 // https://picocomputer.github.io/index.html
 
 #include "commons.h"
+#include "./commons/redirect.h"
+#define SHLIB_EXPORT
+#include "./commons/shlib.h"
 
 extern struct _timezone _tz;
 
@@ -40,7 +43,8 @@ static uint16_t com_load_addr = COM_LOAD_ADDR;
 #define RUN_ARGS_MAX 8
 #define RUN_ARGS_BUF 64
 #define RUN_ARGS_BLOCK_SIZE (1 + RUN_ARGS_MAX*2 + RUN_ARGS_BUF)
-#define HEXDUMP_LINE_SIZE 16
+#define RUN_STATUS ((int *)(REDIR_BLOCK + sizeof(redir_t)))  // main() result, stored by extcmd/crt0_cmd.s
+#define RUN_BLOCK_SIZE (RUN_ARGS_BLOCK_SIZE + sizeof(redir_t) + sizeof(int))  // argc/argv + redir_t + status
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 
@@ -65,6 +69,22 @@ static uint16_t com_load_addr = COM_LOAD_ADDR;
 #define RMBUFFLEN 96
 #define DIR_LIST_MAX 40
 
+// script files (.rsh)
+#define SCRIPT_EXT       ".rsh"
+#define SCRIPT_AUTOEXEC  SHELLDRIVEDIRDEFAULT "autoexec" SCRIPT_EXT
+#define SCRIPT_DEPTH_MAX 2       // nested "call" levels
+#define SCRIPT_RBUF      128     // block read buffer per running script
+#define SCRIPT_ARGS_MAX  9       // %1 .. %9 (%0 is the script path)
+#define SCRIPT_ARGS_BUF  96
+#define SCRIPT_LABEL_MAX 12
+#define SHVAR_MAX        8
+#define SHVAR_NAME_MAX   12
+#define SHVAR_VALUE_MAX  32
+
+// output redirection and pipes
+#define PIPE_DEPTH_MAX   2       // "a | b | c"
+#define PIPE_FILE        SHELLDRIVEDIRDEFAULT ".pipe0"
+
 #define APPFLAG_RTC 0b00000001
 unsigned char appflags = 0b00000000;
 
@@ -72,8 +92,6 @@ static const char default_shelldir[] = SHELLDIRDEFAULT;
 char shelldir[64];
 char *filename[20] = {"                    "};
 
-static const char hexdigits[] = "0123456789ABCDEF";
-
 typedef struct {
     int bytes;
     char buffer[CMD_BUF_MAX+1];
@@ -86,6 +104,21 @@ typedef struct {
     int (*func)(int argc, char **argv);
 } cmd_t;
 
+typedef struct {
+    int fd;
+    int rlen;
+    int rpos;
+    int argc;
+    char *argv[SCRIPT_ARGS_MAX + 1];
+    char args[SCRIPT_ARGS_BUF];
+    unsigned char rbuf[SCRIPT_RBUF];
+} script_t;
+
+typedef struct {
+    char name[SHVAR_NAME_MAX + 1];
+    char value[SHVAR_VALUE_MAX + 1];
+} shvar_t;
+
 typedef struct {
     char name[FNAMELEN];
     unsigned long fsize;
@@ -112,16 +145,36 @@ static unsigned char bload_buf[128];
 static char com_fname[FNAMELEN];
 static char *com_argv[CMD_TOKEN_MAX+1];
 static char *exe_argv[CMD_TOKEN_MAX+1];
-static unsigned char run_args_backup[RUN_ARGS_BLOCK_SIZE];
+static unsigned char run_args_backup[RUN_BLOCK_SIZE];
 static char drv_args_buf[4] = {0};
 static char *drv_args[2] = { (char *)"drive", drv_args_buf };
+static script_t scripts[SCRIPT_DEPTH_MAX];
+static int script_depth = 0;
+static char script_line[CMD_BUF_MAX + 1];
+static char script_goto[SCRIPT_LABEL_MAX + 1];
+static char script_path[FNAMELEN];
+static cmdline_t expand_cl;
+static shvar_t shvars[SHVAR_MAX];
+static char shvar_text[CMD_BUF_MAX + 1];
+static int errorlevel = 0;
+static redir_t redir_state = { REDIR_MAGIC, -1, -1, 0, 0 };
+static redir_t *redir_cur = &redir_state;  // REDIR while a program runs, shared with its tx calls
+static char pipe_rest[PIPE_DEPTH_MAX][CMD_BUF_MAX + 1];
+static char pipe_path[] = PIPE_FILE;
+static int pipe_depth = 0;
+
+#define _NEED_TX_HEX
+#define TX_REDIR redir_cur
+#include "./commons/txout.h"
 
 static void refresh_current_drive(void);
 static void build_run_args(int user_argc, char **user_argv);
+static int end_run_args(void);
 
 int cmd_bload(int, char **);
 int cmd_brun(int, char **);
 int cmd_bsave(int, char **);
+int cmd_call(int, char **);
 int cmd_cd(int, char **);
 int cmd_chmod(int, char **);
 int cmd_cls(int, char **);
@@ -131,13 +184,17 @@ int cmd_copy(int, char **);
 int cmd_cp(int, char **);
 int cmd_ls(int, char **);
 int cmd_drive(int, char **);
+int cmd_echo(int, char **);
 int cmd_exit(int, char **);
+int cmd_goto(int, char **);
+int cmd_if(int, char **);
 int cmd_list(int, char **);
 int cmd_mem(int, char **);
 int cmd_mkdir(int, char **);
 int cmd_rename(int, char **);
 int cmd_rm(int, char **);
 int cmd_run(int, char **);
+int cmd_set(int, char **);
 int cmd_stat(int, char **);
 int cmd_time(int, char **);
 int cmd_phi2(int, char **);
@@ -148,6 +205,7 @@ static const cmd_t commands[] = {
     { "bload",  "", "", cmd_bload},
     { "brun",   "", "", cmd_brun},
     { "bsave",  "", "", cmd_bsave},
+    { "call",   "", "", cmd_call},
     { "cd",     "", "", cmd_cd},
     { "chmod",  "", "", cmd_chmod},
     { "cls",    "", "", cmd_cls },
@@ -157,13 +215,17 @@ static const cmd_t commands[] = {
     { "exe",    "", "", cmd_exe},
     { "ls",     "", "", cmd_ls},
     { "drive",  "", "", cmd_drive},
+    { "echo",   "", "", cmd_echo},
     { "exit",   "", "", cmd_exit},
+    { "goto",   "", "", cmd_goto},
+    { "if",     "", "", cmd_if},
     { "list",   "", "", cmd_list},
     { "mem",    "", "", cmd_mem},
     { "mkdir",  "", "", cmd_mkdir},
     { "rename", "", "", cmd_rename},
     { "rm",     "", "", cmd_rm},
     { "run",    "", "", cmd_run},
+    { "set",    "", "", cmd_set},
     { "stat",   "", "", cmd_stat},
     { "time",   "", "", cmd_time },
     { "phi2",   "", "", cmd_phi2},
@@ -175,12 +237,6 @@ static const cmd_t commands[] = {
 // static void load_setup(void);
 static int startstage_boot();
 static int startstage_shell();
-inline void tx_char(char c);
-void tx_chars(const char *buf, int ct);
-void tx_string(const char *buf);
-void tx_hex32(unsigned long val);
-void tx_hex16(uint16_t val);
-void tx_dec32(unsigned long val);
 static void tx_print_existing(const char *buf, unsigned len);
 static int read_line_editor(char *buf, int maxlen);
 bool match_mask(const char *name, const char *mask);
@@ -195,10 +251,14 @@ uint16_t mem_free(void);
 struct tm *get_time(void);
 void show_time(void);
 int hexstr(char *str, uint8_t val);
+void hexdump(uint16_t addr, uint16_t bytes, char_stream_func_t streamer, read_data_func_t reader);
 void cls();
 void prompt(uint8_t mode);
 static int tokenize(char *buf, int maxBuf, char **tokenList, int maxTokens);
 static int execute(cmdline_t *cl);
+static int execute_tokens(int tokens, char **tokenList);
+static int execute_line(const char *line);
+static int script_call(int argc, char **argv);
 static int execute_cmd(cmdline_t *cl, const char *cmd);
 static void build_run_args(int user_argc, char **user_argv);
 
@@ -206,6 +266,7 @@ static void build_run_args(int user_argc, char **user_argv);
 int cmd_bload(int argc, char **argv);
 int cmd_brun(int argc, char **argv);
 int cmd_bsave(int argc, char **argv);
+int cmd_call(int argc, char **argv);
 int cmd_cd(int argc, char **argv);
 int cmd_chmod(int argc, char **argv);
 int cmd_cls(int, char **);
@@ -215,13 +276,17 @@ int cmd_copy(int argc, char **argv);
 int cmd_cp(int argc, char **argv);
 int cmd_ls(int argc, char **argv);
 int cmd_drive(int argc, char **argv);
+int cmd_echo(int argc, char **argv);
 int cmd_exit(int status, char **);
+int cmd_goto(int argc, char **argv);
+int cmd_if(int argc, char **argv);
 int cmd_list(int argc, char **argv);
 int cmd_mem(int argc, char **argv);
 int cmd_mkdir(int argc, char **argv);
 int cmd_rename(int argc, char **argv);
 int cmd_rm(int argc, char **argv);
 int cmd_run(int argc, char **argv);
+int cmd_set(int argc, char **argv);
 int cmd_stat(int argc, char **argv);
 int cmd_time(int argc, char **argv);
 int cmd_phi2(int argc, char **argv);
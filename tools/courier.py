@@ -0,0 +1,222 @@
+# Courier binary framing shared by ctx.py and crx.py
+# mirrors src/commons/courier-frame.h on the Picocomputer side
+#
+# Copyright (c) 2026 WojciechGw
+#
+# Frame on the wire: COBS(type, seq, len16 LE, payload, crc16 LE) + 0x00
+# crc16 is CRC-16/XMODEM over type..payload (binascii.crc_hqx(data, 0)).
+#
+# Transfer (sender ->, receiver <-):
+#   H [ver][flags][size][name]   <- A 0 [offset][crc32 of the first offset bytes][flags]
+#   S 1 [offset]                 <- A 1          offset = resume point or 0
+#   D seq.. (up to WINDOW), P base [count]
+#                                <- A base [bitmap]  all bits = written to disk
+#   P base [count][raw 2B LE]    the same for a deflated window: its blocks are
+#                                one raw DEFLATE stream of raw file bytes
+#   E [crc32 of the whole file]  <- A
+# Only missing blocks are resent. The receiver writes complete windows only,
+# so a partial file can be continued by the next transfer.
+# Deflate is used only when the receiver echoes F_DEFLATE in its offer. Each
+# window is a stream of its own (fixed Huffman, 4 KB window, which is all
+# src/commons/deflate.h inflates); a window that does not shrink goes raw.
+#
+# Sync session with "crx /sync": transfers as above, plus
+#   L page                       <- A page [size][fdate][ftime][name\0]...  empty = end
+#   K [crc32][fdate][ftime][name\0]  <- A [1] same file, now with this date / [0]
+#   B                            <- A   session over
+# With F_DATE the header has [fdate][ftime] after the name and the file is
+# dated with them, so next time size and date alone show it is unchanged.
+
+import binascii
+import struct
+import time
+import zlib
+from typing import List, Optional, Tuple
+
+DATA_MAX = 256          # payload bytes per data frame
+
+HEADER = ord('H')       # [ver][flags][size 4B LE][name\0]
+DATA   = ord('D')       # file bytes
+END    = ord('E')       # [crc32 4B LE] of the whole file
+ACK    = ord('A')       # seq received and committed
+NAK    = ord('N')       # seq bad or missing, send it again
+CANCEL = ord('C')       # either side gives up
+POLL   = ord('P')       # [count] or [count][raw 2B LE] blocks sent in the window at seq
+START  = ord('S')       # [offset 4B LE] first byte of the data
+LIST   = ord('L')       # page of the receiver's directory listing
+CHECK  = ord('K')       # [crc32 4B LE][fdate][ftime][name\0] compare and date
+BYE    = ord('B')       # sync session over
+
+VERSION = 1
+CAPABLE = b'F'          # "frames understood" reply to the probe
+PROBE   = b'\x00RZF1\r\n'  # sent by ctx on the Picocomputer before framed mode
+RETRIES = 8
+WINDOW  = 8             # data frames per window (bitmap is one byte)
+F_RESUME = 0x01         # header flag: receiver may offer a resume
+F_DEFLATE = 0x02        # header flag: windows may be deflated
+F_DATE   = 0x04         # header flag: [fdate][ftime] follow the name
+WIN_BYTES = WINDOW * DATA_MAX
+RAW_MAX  = 2 * WIN_BYTES  # most raw bytes in one deflated window
+
+
+def rate_line(nbytes: int, started: float, baud: int) -> str:
+    """Throughput of a transfer begun at started (time.monotonic()),
+    also as a share of what the UART carries at baud with 10 bits a byte."""
+    elapsed = max(time.monotonic() - started, 0.001)
+    rate = nbytes / elapsed
+    return (f"\u2588 {nbytes} B in {elapsed:.1f} s ({rate:.0f} B/s, "
+            f"{100.0 * rate * 10.0 / baud:.0f}% of {baud} baud)")
+
+
+def window_mask(count: int) -> int:
+    return (1 << count) - 1
+
+
+def deflate_window(raw: bytes) -> bytes:
+    """Raw DEFLATE that the Picocomputer inflates: fixed Huffman, 4 KB window."""
+    c = zlib.compressobj(9, zlib.DEFLATED, -12, 9, zlib.Z_FIXED)
+    return c.compress(raw) + c.flush()
+
+
+def inflate_window(stream: bytes, raw_len: int) -> Optional[bytes]:
+    """Raw bytes of a deflated window, None unless exactly raw_len of them."""
+    try:
+        raw = zlib.decompress(stream, -15)
+    except zlib.error:
+        return None
+    return raw if len(raw) == raw_len else None
+
+
+def crc16(data: bytes) -> int:
+    return binascii.crc_hqx(data, 0)
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray()
+    code_pos = len(out)
+    out.append(0)
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> Optional[bytes]:
+    out = bytearray()
+    i = 0
+    prev = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        if prev and prev != 0xFF:
+            out.append(0)
+        out.extend(data[i + 1:i + code])
+        i += code
+        prev = code
+    return bytes(out)
+
+
+def build_frame(ftype: int, seq: int, payload: bytes = b"") -> bytes:
+    body = struct.pack("<BBH", ftype, seq & 0xFF, len(payload)) + payload
+    body += struct.pack("<H", crc16(body))
+    return cobs_encode(body) + b"\x00"
+
+
+def parse_frame(raw: bytes) -> Optional[Tuple[int, int, bytes]]:
+    """Decode one delimited frame (without the 0x00). None if corrupt."""
+    body = cobs_decode(raw)
+    if body is None or len(body) < 6:
+        return None
+    ftype, seq, length = struct.unpack_from("<BBH", body)
+    if length != len(body) - 6:
+        return None
+    if struct.unpack_from("<H", body, len(body) - 2)[0] != crc16(body[:-2]):
+        return None
+    return ftype, seq, body[4:-2]
+
+
+class FrameReader:
+    """Collects bytes from a serial port and returns whole frames."""
+
+    BAD = (-1, -1, b"")
+
+    def __init__(self, ser):
+        self.ser = ser
+        self.buf = bytearray()
+
+    def read(self, timeout: float) -> Optional[Tuple[int, int, bytes]]:
+        """Next frame, FrameReader.BAD for a corrupt one, None on timeout."""
+        deadline = time.monotonic() + timeout
+        while True:
+            pos = self.buf.find(0)
+            if pos >= 0:
+                raw = bytes(self.buf[:pos])
+                del self.buf[:pos + 1]
+                if not raw:
+                    continue            # idle delimiter
+                frame = parse_frame(raw)
+                return frame if frame is not None else self.BAD
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            # bound the blocking read by what is left of our own timeout
+            old = self.ser.timeout
+            self.ser.timeout = min(left, 0.1)
+            try:
+                chunk = self.ser.read(max(1, self.ser.in_waiting))
+            finally:
+                self.ser.timeout = old
+            if chunk:
+                self.buf.extend(chunk)
+
+
+def header_payload(name: str, size: int, flags: int = 0,
+                   date: Optional[Tuple[int, int]] = None) -> bytes:
+    """date is a FAT (fdate, ftime) pair; it sets F_DATE."""
+    if date is not None:
+        flags |= F_DATE
+    payload = struct.pack("<BBI", VERSION, flags, size) + name.encode("ascii", "replace")[:31] + b"\x00"
+    return payload + struct.pack("<HH", *date) if date is not None else payload
+
+
+def fat_datetime(mtime: float) -> Tuple[int, int]:
+    """FAT (fdate, ftime) of a local time stamp, 2 s resolution."""
+    t = time.localtime(mtime)
+    fdate = max(0, t.tm_year - 1980) << 9 | t.tm_mon << 5 | t.tm_mday
+    ftime = t.tm_hour << 11 | t.tm_min << 5 | t.tm_sec // 2
+    return fdate, ftime
+
+
+def parse_list_payload(payload: bytes) -> List[Tuple[str, int, int, int]]:
+    """Entries of an L page as (name, size, fdate, ftime)."""
+    entries = []
+    pos = 0
+    while pos + 9 <= len(payload):
+        size, fdate, ftime = struct.unpack_from("<IHH", payload, pos)
+        end = payload.find(b"\x00", pos + 8)
+        if end < 0:
+            break
+        entries.append((payload[pos + 8:end].decode("ascii", "replace"), size, fdate, ftime))
+        pos = end + 1
+    return entries
+
+
+def parse_header_payload(payload: bytes) -> Tuple[int, int, str]:
+    """Returns (flags, size, name)."""
+    _ver, flags, size = struct.unpack_from("<BBI", payload)
+    name = payload[6:].split(b"\x00", 1)[0].decode("ascii", "replace")
+    return flags, size, name
@@ -5,9 +5,15 @@
 #
 
 import argparse
+import os
+import struct
 import sys
+import time
+import zlib
 from typing import Optional, Tuple
 
+import courier
+
 try:
     import serial  # pyserial
 except ImportError:
@@ -75,8 +81,12 @@ def parse_hex_line(line: str) -> Optional[Tuple[int, bytes]]:
     return rec_type, data
 
 
-def receive_stream(ser: "serial.Serial", check_cancel=None) -> Optional[bytes]:
-    """Receive one complete Intel HEX stream until EOF record. Returns accumulated data bytes, or None if cancelled."""
+FRAMED = object()   # receive_stream() result: ctx.com sent the framed-mode probe
+
+
+def receive_stream(ser: "serial.Serial", check_cancel=None, probe: bool = False):
+    """Receive one complete Intel HEX stream until EOF record. Returns accumulated data bytes, or None if cancelled.
+    With probe=True a framed-mode probe line answers FRAMED instead."""
     buf = bytearray()
     while True:
         if check_cancel and check_cancel():
@@ -84,6 +94,8 @@ def receive_stream(ser: "serial.Serial", check_cancel=None) -> Optional[bytes]:
         line_bytes = ser.readline()
         if not line_bytes:
             continue
+        if probe and not buf and line_bytes.strip(b"\x00\r\n") == courier.PROBE.strip(b"\x00\r\n"):
+            return FRAMED
         try:
             line = line_bytes.decode("ascii").strip()
         except UnicodeDecodeError:
@@ -114,6 +126,159 @@ def parse_header(data: bytes) -> Tuple[str, int, Optional[int]]:
     checksum = int.from_bytes(ck_bytes, "little") if len(ck_bytes) == 4 else None
     return name, filesize, checksum
 
+def resume_offer(path: str, filesize: int, flags: int) -> Tuple[int, int]:
+    """(size, crc32) of a partial file an interrupted transfer left at path, or (0, 0)."""
+    if not flags & courier.F_RESUME or not os.path.isfile(path):
+        return 0, 0
+    have = os.path.getsize(path)
+    if have == 0 or have > filesize:
+        return 0, 0
+    with open(path, "rb") as f:
+        return have, zlib.crc32(f.read()) & 0xFFFFFFFF
+
+
+def receive_framed(ser: "serial.Serial", outfile_arg: Optional[str], idle_timeout: float) -> None:
+    """Binary framed transfer (see courier.py): answer the probe, offer a resume,
+    then collect windows of blocks and write each complete window to disk."""
+    ser.write(courier.CAPABLE)
+    ser.flush()
+    reader = courier.FrameReader(ser)
+
+    def reply(ftype: int, seq: int, payload: bytes = b"") -> None:
+        ser.write(courier.build_frame(ftype, seq, payload))
+        ser.flush()
+
+    def next_frame(what: str):
+        """Next good frame; None after Esc (CANCEL sent) or idle_timeout."""
+        deadline = time.monotonic() + idle_timeout
+        while True:
+            if _esc_pressed():
+                reply(courier.CANCEL, 0)
+                print("\n\u2588 Cancelled.")
+                return None
+            frame = reader.read(0.1)
+            if frame is None:
+                if time.monotonic() > deadline:
+                    print(f"\n\u2588 ERROR: timeout waiting for {what}", file=sys.stderr)
+                    return None
+                continue
+            if frame is courier.FrameReader.BAD:
+                continue                    # the sender resends or polls again
+            return frame
+
+    # header
+    while True:
+        frame = next_frame("header frame")
+        if frame is None:
+            return
+        if frame[0] == courier.HEADER:
+            break
+    flags, filesize, filename = courier.parse_header_payload(frame[2])
+    outfile = outfile_arg if outfile_arg else filename
+    print(f"\u2588 Filename  : {filename}  (binary frames)")
+    print(f"\u2588 File size : {filesize} B")
+    print(f"\u2588 Saving to : {outfile}")
+
+    # resume offer, then the sender's choice of offset
+    have, have_crc = resume_offer(outfile, filesize, flags)
+    offer = struct.pack("<IIB", have, have_crc, flags & (courier.F_RESUME | courier.F_DEFLATE))
+    reply(courier.ACK, 0, offer)
+    while True:
+        frame = next_frame("start frame")
+        if frame is None:
+            return
+        ftype, _, payload = frame
+        if ftype == courier.START and len(payload) >= 4:
+            break
+        if ftype == courier.HEADER:
+            reply(courier.ACK, 0, offer)
+        elif ftype == courier.CANCEL:
+            print("\u2588 Cancelled by ctx.")
+            return
+    offset = struct.unpack_from("<I", payload)[0]
+    if offset and offset == have:
+        out = open(outfile, "r+b")
+        out.seek(offset)
+        out.truncate()
+        crc = have_crc
+        print(f"\u2588 Resuming  : {offset} B kept from an earlier transfer")
+    else:
+        offset = 0
+        out = open(outfile, "wb")
+        crc = 0
+    reply(courier.ACK, 1)
+
+    started = time.monotonic()
+    done = offset
+    base = 0
+    slots = {}
+    prev_base, prev_mask = None, 0
+    hdr_checksum = None
+    draw_progress(done, filesize)
+    with out:
+        while True:
+            frame = next_frame("data")
+            if frame is None:
+                print(f"\u2588 {done} B kept in {outfile}; run again to resume.")
+                return
+            ftype, fseq, payload = frame
+            if ftype == courier.DATA:
+                slot = (fseq - base) & 0xFF
+                if slot < courier.WINDOW:
+                    slots[slot] = payload
+            elif ftype == courier.POLL and payload:
+                if fseq == prev_base and prev_mask:
+                    reply(courier.ACK, prev_base, bytes([prev_mask]))    # full ACK was lost
+                    continue
+                if fseq != base:
+                    continue
+                count = min(payload[0], courier.WINDOW)
+                mask = courier.window_mask(count)
+                held = sum(1 << s for s in slots if s < count)
+                if held != mask:
+                    reply(courier.ACK, base, bytes([held]))
+                    continue
+                block = b"".join(slots[s] for s in range(count))
+                if len(payload) >= 3:
+                    block = courier.inflate_window(block, struct.unpack_from("<H", payload, 1)[0])
+                    if block is None:
+                        reply(courier.CANCEL, base)
+                        print(f"\n\u2588 ERROR: bad deflated window. {done} B kept in {outfile}; run again to resume.",
+                              file=sys.stderr)
+                        return
+                out.write(block)
+                out.flush()
+                crc = zlib.crc32(block, crc)
+                done += len(block)
+                prev_base, prev_mask = base, mask
+                base = (base + count) & 0xFF
+                slots = {}
+                reply(courier.ACK, prev_base, bytes([mask]))
+                draw_progress(done, filesize)
+            elif ftype == courier.START:
+                reply(courier.ACK, 1)               # start ACK was lost
+            elif ftype == courier.END:
+                if len(payload) >= 4:
+                    hdr_checksum = struct.unpack_from("<I", payload)[0]
+                reply(courier.ACK, fseq)
+                break
+            elif ftype == courier.CANCEL:
+                print(f"\n\u2588 Cancelled by ctx. {done} B kept in {outfile}; run again to resume.")
+                return
+
+    draw_progress(done, filesize)
+    print()
+    print(f"\u2588 Done. {done} B written to {outfile}.")
+    print(courier.rate_line(done - offset, started, ser.baudrate))
+    if hdr_checksum is not None:
+        calc = crc & 0xFFFFFFFF
+        if calc == hdr_checksum:
+            print(f"\u2588 Checksum OK  : {calc:08X}")
+        else:
+            print(f"\u2588 Checksum FAIL: expected {hdr_checksum:08X}, got {calc:08X}")
+    print()
+
+
 BAR_WIDTH = 47
 def draw_progress(done: int, total: int) -> None:
     if total > 0:
@@ -146,10 +311,13 @@ def main() -> None:
         print(f"\u2588 Waiting for transmission header")
         print(f"\u2588 on {args.port} @ {args.baud} ... (Esc to cancel)")
         ser.timeout = 0.1
-        hdr_data = receive_stream(ser, check_cancel=_esc_pressed)
+        hdr_data = receive_stream(ser, check_cancel=_esc_pressed, probe=True)
         if hdr_data is None:
             print("\u2588 Cancelled.")
             return
+        if hdr_data is FRAMED:
+            receive_framed(ser, args.outfile, max(args.timeout, 10.0))
+            return
         ser.timeout = args.timeout
         filename, filesize, hdr_checksum = parse_header(hdr_data)
         outfile = args.outfile if args.outfile else filename
@@ -163,6 +331,7 @@ def main() -> None:
         buf = bytearray()
         cancelled = False
         draw_progress(0, filesize)
+        started = time.monotonic()
         ser.timeout = 0.1
         while True:
             if _esc_pressed():
@@ -199,6 +368,7 @@ def main() -> None:
         with open(outfile, "wb") as f:
             f.write(buf)
         print(f"\u2588 Done. {len(buf)} B written to {outfile}.")
+        print(courier.rate_line(len(buf), started, args.baud))
         if hdr_checksum is not None:
             calc = sum(buf) & 0xFFFFFFFF
             if calc == hdr_checksum:
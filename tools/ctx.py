@@ -1,5 +1,7 @@
 # File sender from PC to Picocomputer 6502
 # run "python ctx.py filename_to_send" on PC to send file
+# run "python ctx.py --sync directory" with "crx /sync" on the Picocomputer
+# to send the new and changed files of a directory in one session
 #
 # Copyright (c) 2026 WojciechGw
 #
@@ -8,8 +10,11 @@ import argparse
 import os
 import sys
 import time
+import struct
 import zlib
-from typing import Iterable
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import courier
 
 try:
     import serial  # pyserial
@@ -41,6 +46,217 @@ def wait_for(ser, marker: bytes, timeout: float, label: str) -> bool:
             return True
 
 
+def wait_capable(ser, timeout: float = 0.3) -> bool:
+    """crx.com sends 'F' right after its ready byte when it understands frames."""
+    old = ser.timeout
+    ser.timeout = timeout
+    try:
+        return ser.read(1) == courier.CAPABLE
+    finally:
+        ser.timeout = old
+
+
+def exchange(ser, reader: "courier.FrameReader", ftype: int, seq: int,
+             payload: bytes, timeout: float) -> Tuple[int, bytes]:
+    """Send one frame and wait for its ACK; resend on NAK, bad frame or silence.
+    Returns (1, ack payload) acked, (0, b"") gave up, (-1, b"") cancelled by crx."""
+    frame = courier.build_frame(ftype, seq, payload)
+    for _ in range(courier.RETRIES):
+        ser.write(frame)
+        ser.flush()
+        while True:
+            reply = reader.read(timeout)
+            if reply is None or reply is courier.FrameReader.BAD:
+                break
+            rtype, rseq, rpayload = reply
+            if rtype == courier.CANCEL:
+                return -1, b""
+            if rtype == courier.ACK and rseq == (seq & 0xFF):
+                return 1, rpayload
+            if rtype == courier.NAK:
+                break
+    return 0, b""
+
+
+def next_window(data: bytes, pos: int, deflate: bool) -> Tuple[bytes, int]:
+    """Bytes of the window at pos and its raw size if deflated, else 0.
+    Tries RAW_MAX raw bytes first, then one window's worth."""
+    if deflate:
+        for size in (courier.RAW_MAX, courier.WIN_BYTES):
+            raw = data[pos:pos + size]
+            stream = courier.deflate_window(raw)
+            if len(stream) < len(raw) and len(stream) <= courier.WIN_BYTES:
+                return stream, len(raw)
+            if len(raw) <= courier.WIN_BYTES:
+                break
+    return data[pos:pos + courier.WIN_BYTES], 0
+
+
+def finish_window(ser, reader: "courier.FrameReader", base: int,
+                  blocks: List[bytes], raw: int, timeout: float) -> int:
+    """Poll for the window at base; resend only the blocks crx reports missing.
+    raw is the inflated size of a deflated window, 0 for a raw one.
+    Gives up after RETRIES polls in a row without a new block.
+    Returns 1 committed, 0 gave up, -1 cancelled by crx."""
+    count = len(blocks)
+    mask = courier.window_mask(count)
+    best = 0
+    tries = 0
+    poll = courier.build_frame(courier.POLL, base,
+                               struct.pack("<BH", count, raw) if raw else bytes([count]))
+    while tries < courier.RETRIES:
+        ser.write(poll)
+        ser.flush()
+        have = None
+        while True:
+            reply = reader.read(timeout)
+            if reply is None or reply is courier.FrameReader.BAD:
+                break
+            rtype, rseq, rpayload = reply
+            if rtype == courier.CANCEL:
+                return -1
+            if rtype == courier.ACK and rseq == base and rpayload:
+                have = rpayload[0] & mask
+                break
+        if have is None:
+            tries += 1
+            continue
+        if have == mask:
+            return 1
+        tries = 0 if have | best != best else tries + 1
+        best |= have
+        for slot, block in enumerate(blocks):
+            if not have & (1 << slot):
+                ser.write(courier.build_frame(courier.DATA, (base + slot) & 0xFF, block))
+    return 0
+
+
+def send_framed(ser, filename: str, data: bytes, ack_timeout: float,
+                resume: bool = True, deflate: bool = True,
+                reader: "courier.FrameReader" = None, date: Tuple[int, int] = None) -> bool:
+    """Header, resume point, windows of 256 byte blocks and a CRC32 trailer (see courier.py).
+    date is the FAT (fdate, ftime) crx gives the file."""
+    total = len(data)
+    reader = reader or courier.FrameReader(ser)
+    ser.write(b"\x00")                   # resync crx's frame decoder
+    flags = (courier.F_RESUME if resume else 0) | (courier.F_DEFLATE if deflate else 0)
+    r, offer = exchange(ser, reader, courier.HEADER, 0,
+                        courier.header_payload(filename, total, flags, date), ack_timeout)
+    if r <= 0:
+        print("\nERROR: crx cancelled" if r < 0 else "\nERROR: no header ACK", file=sys.stderr)
+        return False
+
+    offset = 0
+    if resume and len(offer) >= 8:
+        have, have_crc = struct.unpack_from("<II", offer)
+        if 0 < have <= total and zlib.crc32(data[:have]) & 0xFFFFFFFF == have_crc:
+            offset = have
+            print(f"\u2588 resuming after {offset} B already on the Picocomputer")
+    deflate = deflate and len(offer) >= 9 and bool(offer[8] & courier.F_DEFLATE)
+    r, _ = exchange(ser, reader, courier.START, 1, struct.pack("<I", offset), ack_timeout)
+    if r <= 0:
+        print("\nERROR: crx cancelled" if r < 0 else "\nERROR: no start ACK", file=sys.stderr)
+        return False
+
+    base = 0
+    pos = offset
+    wire = 0
+    draw_progress(pos, total)
+    while pos < total:
+        window, raw = next_window(data, pos, deflate)
+        blocks = [window[i:i + courier.DATA_MAX]
+                  for i in range(0, len(window), courier.DATA_MAX)]
+        for slot, block in enumerate(blocks):
+            ser.write(courier.build_frame(courier.DATA, (base + slot) & 0xFF, block))
+        ser.flush()
+        pos += raw if raw else len(window)
+        wire += len(window)
+        r = finish_window(ser, reader, base, blocks, raw, ack_timeout)
+        if r <= 0:
+            print("\nERROR: crx cancelled" if r < 0 else f"\nERROR: no ACK at offset {pos}", file=sys.stderr)
+            return False
+        base = (base + len(blocks)) & 0xFF
+        draw_progress(pos, total)
+
+    crc = zlib.crc32(data) & 0xFFFFFFFF
+    r, _ = exchange(ser, reader, courier.END, base, struct.pack("<I", crc), ack_timeout)
+    if r <= 0:
+        print("\nERROR: CRC32 differs on the Picocomputer" if r < 0 else
+              "\nERROR: no ACK for end of file", file=sys.stderr)
+        return False
+    if deflate and total > offset:
+        print(f"\n\u2588 deflate : {wire} B sent for {total - offset} B", end="")
+    return True
+
+
+def device_listing(ser, reader: "courier.FrameReader",
+                   timeout: float) -> Optional[Dict[str, Tuple[int, int, int]]]:
+    """crx /sync's directory as {lower case name: (size, fdate, ftime)}, None on failure."""
+    listing = {}
+    page = 0
+    while True:
+        r, payload = exchange(ser, reader, courier.LIST, page, b"", timeout)
+        if r <= 0:
+            return None
+        if not payload:
+            return listing
+        for name, size, fdate, ftime in courier.parse_list_payload(payload):
+            listing[name.lower()] = (size, fdate, ftime)
+        page = (page + 1) & 0xFF
+
+
+def send_sync(ser, dirpath: str, ack_timeout: float,
+              resume: bool = True, deflate: bool = True) -> bool:
+    """Send the files of dirpath that crx /sync does not hold: missing ones,
+    ones of another size, and ones of the same size and another date whose
+    CRC32 differs. A file of the same CRC32 just takes the local date."""
+    reader = courier.FrameReader(ser)
+    ser.write(b"\x00")
+    listing = device_listing(ser, reader, ack_timeout)
+    if listing is None:
+        print("\nERROR: no directory listing, is crx running as 'crx /sync'?", file=sys.stderr)
+        return False
+
+    names = sorted(n for n in os.listdir(dirpath)
+                   if os.path.isfile(os.path.join(dirpath, n)))
+    sent = same = checked = 0
+    for name in names:
+        path = os.path.join(dirpath, name)
+        if len(name.encode("ascii", "replace")) > 31:
+            print(f"\u2588 skipped {name}: name longer than 31 characters")
+            continue
+        size = os.path.getsize(path)
+        date = courier.fat_datetime(os.path.getmtime(path))
+        have = listing.get(name.lower())
+        if have == (size,) + date:
+            same += 1
+            continue
+        with open(path, "rb") as f:
+            data = f.read()
+        if have is not None and have[0] == size:
+            check = struct.pack("<IHH", zlib.crc32(data) & 0xFFFFFFFF, *date)
+            r, reply = exchange(ser, reader, courier.CHECK, 0,
+                                check + name.encode("ascii", "replace") + b"\x00", ack_timeout)
+            if r <= 0:
+                print(f"\nERROR: no answer checking {name}", file=sys.stderr)
+                return False
+            if reply[:1] == b"\x01":
+                checked += 1
+                continue
+        print(f"\u2588 {name} ({size} B)")
+        draw_progress(0, size)
+        if not send_framed(ser, name, data, ack_timeout, resume, deflate, reader, date):
+            return False
+        print()
+        sent += 1
+
+    if exchange(ser, reader, courier.BYE, 0, b"", ack_timeout)[0] <= 0:
+        print("\nERROR: no ACK for the end of the session", file=sys.stderr)
+        return False
+    print(f"\u2588 {sent} sent, {same} unchanged, {checked} unchanged by CRC32")
+    return True
+
+
 def intel_hex_records(data: bytes, chunk_size: int = 16) -> Iterable[str]:
     addr = 0
     prev_ela = -1
@@ -76,7 +292,8 @@ def draw_progress(done: int, total: int) -> None:
     print(f"\r\u2588 [{bar}] {pct:3d}%", end="", flush=True)
 
 def send_intel_hex(port: str, baud: int, filepath: str, chunk_size: int = 16,
-                   ack_timeout: float = 30.0) -> None:
+                   ack_timeout: float = 30.0, force_hex: bool = False,
+                   resume: bool = True, deflate: bool = True) -> None:
     filename = os.path.basename(filepath)
     with open(filepath, "rb") as f:
         data = f.read()
@@ -101,6 +318,19 @@ def send_intel_hex(port: str, baud: int, filepath: str, chunk_size: int = 16,
         if not wait_for(ser, ACK, ack_timeout, "crx ready"):
             return
 
+        # --- binary frames when crx.com offers them ---
+        if not force_hex and wait_capable(ser):
+            print("\u2588 mode : binary frames")
+            draw_progress(0, total)
+            started = time.monotonic()
+            ok = send_framed(ser, filename, data, min(ack_timeout, 2.0), resume, deflate)
+            print()
+            if ok:
+                print(courier.rate_line(total, started, baud))
+                print("\u2588 Done.\r\n")
+            return
+
+        print("\u2588 mode : Intel HEX")
         ser.write(SOH)
         ser.write(filename.encode("ascii"))
         ser.write(EOH)
@@ -117,6 +347,7 @@ def send_intel_hex(port: str, baud: int, filepath: str, chunk_size: int = 16,
 
         # --- dane IntelHEX z ACK flow control ---
         # Stream generator directly — do NOT call list() to avoid large memory allocation
+        started = time.monotonic()
         sent = 0
         data_record_idx = 0
         for line in intel_hex_records(data, chunk_size):
@@ -139,18 +370,47 @@ def send_intel_hex(port: str, baud: int, filepath: str, chunk_size: int = 16,
         ser.write(ETX)
         ser.write(EOT)
         ser.flush()
+        print(courier.rate_line(total, started, baud))
         print("\u2588 Done.\r\n")
 
 
+def sync_directory(port: str, baud: int, dirpath: str, ack_timeout: float = 30.0,
+                   resume: bool = True, deflate: bool = True) -> None:
+    with serial.Serial(port, baudrate=baud, bytesize=serial.EIGHTBITS,
+                       parity=serial.PARITY_NONE, stopbits=serial.STOPBITS_ONE,
+                       timeout=ack_timeout) as ser:
+        print(f"\u2588 Courier TX \u2014 sync '{dirpath}' to {port} @ {baud} baud")
+        ser.write(SOT)
+        ser.flush()
+        if not wait_for(ser, ACK, ack_timeout, "crx ready"):
+            return
+        if not wait_capable(ser):
+            print("ERROR: crx does not understand binary frames, update crx.com", file=sys.stderr)
+            return
+        started = time.monotonic()
+        if send_sync(ser, dirpath, min(ack_timeout, 2.0), resume, deflate):
+            print(f"\u2588 {time.monotonic() - started:.1f} s")
+            print("\u2588 Done.\r\n")
+
+
 def main() -> None:
-    ap = argparse.ArgumentParser(description="Send file as Intel HEX over serial (ACK flow control).")
-    ap.add_argument("filepath", help="Input file to send")
+    ap = argparse.ArgumentParser(description="Send file over serial as binary frames or Intel HEX (ACK flow control).")
+    ap.add_argument("filepath", help="Input file to send, or the directory with --sync")
     ap.add_argument("--port",    default="COM4",  help="Serial port (default COM4)")
     ap.add_argument("--baud",    type=int, default=115200, help="Baud rate (default 115200)")
     ap.add_argument("--chunk",   type=int, default=16, help="Bytes per record (default 16)")
     ap.add_argument("--timeout", type=float, default=30.0, help="ACK timeout seconds (default 30.0)")
+    ap.add_argument("--hex",     action="store_true", help="Force Intel HEX even if crx offers binary frames")
+    ap.add_argument("--fresh",   action="store_true", help="Do not resume a partial file left by an interrupted transfer")
+    ap.add_argument("--raw",     action="store_true", help="Do not deflate the data even if crx can inflate it")
+    ap.add_argument("--sync",    action="store_true", help="Send the new and changed files of a directory to 'crx /sync'")
     args = ap.parse_args()
-    send_intel_hex(args.port, args.baud, args.filepath, args.chunk, args.timeout)
+    if args.sync:
+        sync_directory(args.port, args.baud, args.filepath, args.timeout,
+                       not args.fresh, not args.raw)
+        return
+    send_intel_hex(args.port, args.baud, args.filepath, args.chunk, args.timeout, args.hex,
+                   not args.fresh, not args.raw)
 
 
 if __name__ == "__main__":
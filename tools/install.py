@@ -4,6 +4,7 @@ import pathlib
 import subprocess
 import sys
 import time
+from concurrent.futures import ThreadPoolExecutor
 from contextlib import contextmanager
 
 import serial  # pip install pyserial
@@ -26,6 +27,7 @@ def serial_port(name: str, baud: int = 115200):
     try:
         port.dtr = True
         port.rts = True
+        port.reset_input_buffer()  # an old prompt must not answer for a new line
         yield port
     finally:
         port.close()
@@ -34,9 +36,9 @@ def serial_port(name: str, baud: int = 115200):
 def wait_for_prompt(port: serial.Serial, prompt: str, timeout_ms: int) -> bool:
     deadline = time.time() + timeout_ms / 1000
     while time.time() < deadline:
-        ch = port.read(1)
-        if ch:
-            if ch.decode(errors="ignore") == prompt:
+        data = port.read(max(1, port.in_waiting))
+        if data:
+            if prompt in data.decode(errors="ignore"):
                 return True
         else:
             continue  # timeout on read; keep looping
@@ -73,60 +75,66 @@ def send_line(port: serial.Serial, text: str, delay_ms: int = 400):
             raise exc
 
 
-def main():
-    parser = argparse.ArgumentParser(description="Install rp6502 shell extension over COM port")
-    parser.add_argument("--port", default="COM4", help="Serial port name (default: COM4)")
-    parser.add_argument("--shellextcmdname", default="shell", help="Extension command name")
-    parser.add_argument("--shellreboot", choices=["Y", "N"], default="Y", help="Reboot after install?")
-    args = parser.parse_args()
-
-    project_root = pathlib.Path(__file__).resolve().parent
-    build_path = project_root.parent / "build" / f"{args.shellextcmdname}.rp6502"
-    config_path = project_root.parent / ".rp6502"
-
+def install(name: str, args, build_path: pathlib.Path, config_path: pathlib.Path,
+            fan_out: bool) -> bool:
+    """Upload and install the extension on the board at port name.
+    fan_out: several boards, so rp6502.py is pointed at the port, not the config."""
     # Initial cleanup on device
     try:
-        with serial_port(args.port) as port:
-            time.sleep(0.8)
+        with serial_port(name) as port:
             send_line_and_wait(port, "exit", "exit", "]", 500)
-            time.sleep(0.4)
             send_line_and_wait(port, "0:", "0:", "]", 400)
-            time.sleep(0.4)
             send_line_and_wait(port, "cd /", "cd /", "]", 400)
-            time.sleep(0.4)
     except Exception as exc:
-        sys.stderr.write(f"Warning: {args.port} is not available ({exc})\n")
+        sys.stderr.write(f"Warning: {name} is not available ({exc})\n")
 
     # Upload binary
-    upload_script = project_root / "rp6502.py"
-    upload_cmd = ["python3", str(upload_script), "-c", config_path, "upload", str(build_path)]
+    upload_script = pathlib.Path(__file__).resolve().parent / "rp6502.py"
+    target = ["-d", name] if fan_out else ["-c", config_path]
+    upload_cmd = ["python3", str(upload_script), *target, "upload", str(build_path)]
     try:
         subprocess.run(upload_cmd, check=True)
     except FileNotFoundError:
         sys.stderr.write(f"Upload failed: rp6502.py not found at {upload_script}\n")
-        return
+        return False
     except subprocess.CalledProcessError as exc:
-        sys.stderr.write(f"Upload failed with exit code {exc.returncode}\n")
-        return
+        sys.stderr.write(f"Upload to {name} failed with exit code {exc.returncode}\n")
+        return False
 
     # Install on device
     try:
-        with serial_port(args.port) as port:
-            time.sleep(0.4)
+        with serial_port(name) as port:
             send_line_and_wait(port, "set boot -", "set boot -", "]", 400)
-            time.sleep(0.4)
             send_line_and_wait(port, f"remove {args.shellextcmdname}", f"remove {args.shellextcmdname}", "]", 400)
-            time.sleep(0.4)
             send_line_and_wait(port, f"install {args.shellextcmdname}.rp6502", f"install {args.shellextcmdname}", "]", 400)
-            time.sleep(0.4)
             send_line_and_wait(port, f"set boot {args.shellextcmdname}", f"set boot {args.shellextcmdname}", "]", 400)
-            time.sleep(0.4)
             if args.shellreboot != "Y":
                 send_line_and_wait(port, "shell", "shell", ">", 400)
             else:
                 send_line(port, "reboot")
     except Exception as exc:
-        sys.stderr.write(f"Warning: {args.port} is not available ({exc})\n")
+        sys.stderr.write(f"Warning: {name} is not available ({exc})\n")
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Install rp6502 shell extension over COM port")
+    parser.add_argument("--port", default="COM4",
+                        help="Serial port name, or a comma separated list to install on several boards at once (default: COM4)")
+    parser.add_argument("--shellextcmdname", default="shell", help="Extension command name")
+    parser.add_argument("--shellreboot", choices=["Y", "N"], default="Y", help="Reboot after install?")
+    args = parser.parse_args()
+
+    project_root = pathlib.Path(__file__).resolve().parent
+    build_path = project_root.parent / "build" / f"{args.shellextcmdname}.rp6502"
+    config_path = project_root.parent / ".rp6502"
+
+    ports = [p.strip() for p in args.port.split(",") if p.strip()]
+    with ThreadPoolExecutor(max_workers=len(ports)) as pool:
+        jobs = [pool.submit(install, p, args, build_path, config_path, len(ports) > 1)
+                for p in ports]
+        if not all(job.result() for job in jobs):
+            sys.exit(1)
 
 
 if __name__ == "__main__":
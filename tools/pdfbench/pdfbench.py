@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+
+# pdfbench.py
+# Golden-output and cost benchmark for txt2pdf and printer, run on the PC
+#
+# Copyright (c) 2026 WojciechGw
+#
+# Usage examples:
+#   pdfbench.py                           build both, run corpus/cases.txt, compare
+#   pdfbench.py --update                  write the current output as the golden PDFs
+#   pdfbench.py --font assets/TTF         also run the /pl and /pr cases
+#   pdfbench.py --only manual             only cases whose document matches
+#   pdfbench.py --save before.json        keep the counters of this run
+#   pdfbench.py --compare before.json     show the counters against a saved run
+#
+# src/ext-txt2pdf.c and src/printer.c are built with the host C++ compiler
+# around ria_host.cpp, which stands in for the RIA: XRAM, the auto-increment
+# portals and read_xram()/write_xram() on host files. Each case runs in a
+# scratch directory of its own, the PDF is compared byte for byte with its
+# golden copy, and the cost counters the program left are reported:
+#   os   OS calls (open, close, read, write, lseek, read_xram, write_xram, f_*dir);
+#        each one is a round trip to the RIA firmware on the Picocomputer
+#   in/out  bytes moved by those calls
+#   rw   RIA.rw0 + RIA.rw1 accesses, one 65C02 load or store each
+# These depend on the code only, not on the PC, so they are stable between
+# runs and machines. They stand in for cycle counts, which are not measured:
+# sim65 is not used, as it has no RIA and no XRAM and its paravirtual hooks
+# sit inside the RIA register block. rw is a count of accesses, not cycles.
+#
+# char is unsigned as in cc65 and warnings are shown, but int stays 32-bit on
+# the PC: an overflow of a 16-bit int on the device does not show up here, so
+# keep intermediate sums in long or unsigned long.
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import re
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+HERE = Path(__file__).resolve().parent
+REPO = HERE.parent.parent
+PROGRAMS = {
+    "txt2pdf": REPO / "src" / "ext-txt2pdf.c",
+    "printer": REPO / "src" / "printer.c",
+}
+FONT_DIR = Path("MSC0:") / "TTF"                   # as opened by printer /pl and /pr
+FONTS = {"/pl": "DroidSansMono.ttf", "/pr": "DroidSans.ttf"}
+
+
+# ---------------------------------------------------------------------------
+# Build
+# ---------------------------------------------------------------------------
+
+def build(cxx: str, build_dir: Path) -> dict[str, Path]:
+    exes = {}
+    for name, src in PROGRAMS.items():
+        exe = build_dir / name
+        rel = os.path.relpath(src, HERE)
+        cmd = [cxx, "-O1", "-Wall", "-funsigned-char", "-I", str(HERE), "-I", str(src.parent),
+               f'-DPDFBENCH_SRC="{rel}"', str(HERE / "ria_host.cpp"), "-o", str(exe)]
+        r = subprocess.run(cmd, capture_output=True, text=True)
+        sys.stderr.write(r.stderr)
+        if r.returncode != 0:
+            raise SystemExit(f"[!] build of {name} failed")
+        exes[name] = exe
+    return exes
+
+
+# ---------------------------------------------------------------------------
+# Corpus
+# ---------------------------------------------------------------------------
+
+def golden_name(doc: str, program: str, opts: list[str]) -> str:
+    tag = "_".join(re.sub(r"[^0-9A-Za-z]", "", o) for o in opts)
+    stem = re.sub(r"[^0-9A-Za-z_-]", "", Path(doc).stem) or "all"
+    return f"{stem}.{program}{'.' + tag if tag else ''}.pdf"
+
+
+def output_name(doc: str, opts: list[str]) -> str:
+    """The PDF the program writes: /o F, else the input with .pdf."""
+    lower = [o.lower() for o in opts]
+    if "/o" in lower and lower.index("/o") + 1 < len(opts):
+        return opts[lower.index("/o") + 1]
+    return Path(doc).stem + ".pdf"
+
+
+def load_cases(corpus: Path) -> list[tuple[str, str, list[str]]]:
+    cases = []
+    for no, line in enumerate((corpus / "cases.txt").read_text().splitlines(), 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        fields = shlex.split(line)
+        if len(fields) < 2 or fields[1] not in PROGRAMS:
+            raise SystemExit(f"[!] cases.txt:{no}: <document> <txt2pdf|printer> [options]")
+        cases.append((fields[0], fields[1], fields[2:]))
+    return cases
+
+
+def case_fonts(opts: list[str]) -> list[str]:
+    """The TTF files a case opens."""
+    return [FONTS[o.lower()] for o in opts if o.lower() in FONTS]
+
+
+def run_case(exe: Path, corpus: Path, doc: str, opts: list[str],
+             font: Path | None, work: Path) -> tuple[bytes | None, dict, str]:
+    """Output PDF (None if missing), counters and console output of one case."""
+    work.mkdir(parents=True)
+    for f in corpus.iterdir():          # all documents: masks and @lists name several
+        if f.is_file() and f.name != "cases.txt":
+            shutil.copyfile(f, work / f.name)
+    if font is not None:
+        (work / FONT_DIR).mkdir(parents=True)
+        for ttf in case_fonts(opts):
+            shutil.copyfile(font / ttf, work / FONT_DIR / ttf)
+    t0 = time.perf_counter()
+    r = subprocess.run([str(exe), doc, *opts], cwd=work, capture_output=True)
+    stats: dict = {"host_ms": round((time.perf_counter() - t0) * 1000.0, 1)}
+    for line in r.stderr.decode("latin-1").splitlines():
+        if line.startswith("pdfbench:"):
+            for kv in line.split()[1:]:
+                k, v = kv.split("=")
+                stats[k] = int(v)
+    pdf = work / output_name(doc, opts)
+    out = pdf.read_bytes() if pdf.exists() and r.returncode == 0 else None
+    return out, stats, r.stdout.decode("latin-1")
+
+
+def first_difference(a: bytes, b: bytes) -> int:
+    n = min(len(a), len(b))
+    for i in range(n):
+        if a[i] != b[i]:
+            return i
+    return n
+
+
+# ---------------------------------------------------------------------------
+# Report
+# ---------------------------------------------------------------------------
+
+def cost(stats: dict) -> str:
+    return (f"os {stats.get('os_calls', 0):>5}  in {stats.get('bytes_in', 0):>7}"
+            f"  out {stats.get('bytes_out', 0):>7}"
+            f"  rw {stats.get('rw0', 0) + stats.get('rw1', 0):>8}")
+
+
+def delta(stats: dict, base: dict | None) -> str:
+    if not base:
+        return ""
+    parts = []
+    for key in ("os_calls", "bytes_out"):
+        if base.get(key):
+            parts.append(f"{key.split('_')[-1]} {100.0 * (stats.get(key, 0) - base[key]) / base[key]:+.1f}%")
+    rw, rw_base = stats.get("rw0", 0) + stats.get("rw1", 0), base.get("rw0", 0) + base.get("rw1", 0)
+    if rw_base:
+        parts.append(f"rw {100.0 * (rw - rw_base) / rw_base:+.1f}%")
+    return "  (" + ", ".join(parts) + ")"
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description="Golden-output benchmark for txt2pdf and printer")
+    ap.add_argument("--corpus", type=Path, default=HERE / "corpus", help="corpus directory with cases.txt")
+    ap.add_argument("--update", action="store_true", help="write the output as the new golden PDFs")
+    ap.add_argument("--font", type=Path, help="directory with the TTF fonts of the /pl and /pr cases")
+    ap.add_argument("--only", help="run only cases whose document name contains this text")
+    ap.add_argument("--save", type=Path, help="save the counters of this run to a JSON file")
+    ap.add_argument("--compare", type=Path, help="JSON file of a previous --save to compare with")
+    ap.add_argument("--keep", type=Path, help="keep the build and the outputs in this directory")
+    ap.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="host C++ compiler")
+    ap.add_argument("-v", "--verbose", action="store_true", help="show the console output of failing cases")
+    args = ap.parse_args()
+
+    corpus = args.corpus.resolve()
+    golden = corpus / "golden"
+    cases = load_cases(corpus)
+    base = json.loads(args.compare.read_text()) if args.compare else {}
+
+    scratch = args.keep.resolve() if args.keep else Path(tempfile.mkdtemp(prefix="pdfbench-"))
+    if args.keep and scratch.exists():
+        shutil.rmtree(scratch)
+    scratch.mkdir(parents=True, exist_ok=True)
+    try:
+        exes = build(args.cxx, scratch)
+        results: dict[str, dict] = {}
+        failed = skipped = 0
+        for doc, program, opts in cases:
+            if args.only and args.only not in doc:
+                continue
+            name = golden_name(doc, program, opts)
+            if case_fonts(opts) and args.font is None:
+                print(f"  skip  {name}  (needs --font)")
+                skipped += 1
+                continue
+            out, stats, console = run_case(exes[program], corpus, doc, opts,
+                                           args.font, scratch / "run" / name)
+            results[name] = stats
+            gold = golden / name
+            if out is None:
+                status = "FAIL"
+                note = f"exit {stats.get('exit', '?')}, no PDF"
+            elif args.update:
+                golden.mkdir(exist_ok=True)
+                status = "same" if gold.exists() and gold.read_bytes() == out else "NEW"
+                gold.write_bytes(out)
+                note = f"{len(out)} B"
+            elif not gold.exists():
+                status = "FAIL"
+                note = "no golden PDF (--update writes it)"
+            elif gold.read_bytes() != out:
+                ref = gold.read_bytes()
+                status = "FAIL"
+                note = f"differs at byte {first_difference(ref, out)} ({len(out)} B, golden {len(ref)} B)"
+            else:
+                status = "ok"
+                note = f"{len(out)} B"
+            if status == "FAIL":
+                failed += 1
+                if args.verbose:
+                    sys.stdout.write(console)
+            print(f"  {status:<4}  {name:<40} {cost(stats)}{delta(stats, base.get(name))}  {note}")
+        if args.save:
+            args.save.write_text(json.dumps(results, indent=1, sort_keys=True) + "\n")
+        print(f"{len(results)} run, {failed} failed, {skipped} skipped")
+        return 1 if failed else 0
+    finally:
+        if not args.keep:
+            shutil.rmtree(scratch, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
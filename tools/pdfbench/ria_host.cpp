@@ -0,0 +1,180 @@
+/*
+ * ria_host.cpp — host build of txt2pdf / printer for tools/pdfbench.py
+ *
+ * Build (pdfbench.py does this):
+ *   c++ -Wall -funsigned-char -I tools/pdfbench -DPDFBENCH_SRC='"../../src/printer.c"' \
+ *       tools/pdfbench/ria_host.cpp -o printer-host
+ *
+ * The program source is included here with its main() renamed, so the file
+ * calls it makes (open, close, read, lseek) can be counted on the way to the
+ * host. read_xram()/write_xram() move bytes between the host file and the
+ * XRAM array, with the 0x7FFF per call limit of the RIA.
+ *
+ * The host main() takes the same arguments as the shell passes (no program
+ * name) and prints one "pdfbench" line with the counters to stderr.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "rp6502.h"
+
+struct bench_counters bench;
+uint8_t xram[0x10000];
+Ria RIA;
+
+static int host_open(const char *path, int flags)
+{
+    bench.open++;
+    return open(path, flags, 0644);
+}
+
+static int host_close(int fd)
+{
+    bench.close++;
+    return close(fd);
+}
+
+[[maybe_unused]] static ssize_t host_read(int fd, void *buf, size_t count)
+{
+    ssize_t r;
+
+    bench.read++;
+    r = read(fd, buf, count);
+    if (r > 0) bench.bytes_in += (unsigned long)r;
+    return r;
+}
+
+[[maybe_unused]] static ssize_t host_write(int fd, const void *buf, size_t count)
+{
+    bench.write++;
+    return write(fd, buf, count);
+}
+
+static off_t host_lseek(int fd, off_t off, int whence)
+{
+    bench.lseek++;
+    return lseek(fd, off, whence);
+}
+
+int read_xram(unsigned buf, unsigned count, int fildes)
+{
+    ssize_t r;
+
+    bench.read_xram++;
+    if (count > 0x7FFFu || buf + count > sizeof xram) { errno = EINVAL; return -1; }
+    r = read(fildes, xram + buf, count);
+    if (r > 0) bench.bytes_in += (unsigned long)r;
+    return (int)r;
+}
+
+int write_xram(unsigned buf, unsigned count, int fildes)
+{
+    ssize_t r;
+
+    bench.write_xram++;
+    if (count > 0x7FFFu || buf + count > sizeof xram) { errno = EINVAL; return -1; }
+    r = write(fildes, xram + buf, count);
+    if (r > 0) bench.bytes_out += (unsigned long)r;
+    return (int)r;
+}
+
+/*
+ * directories: the handle is an index into dirs[]. Entries come in reverse
+ * name order whatever the host file system keeps, so a mask always makes
+ * printer sort its list, as the creation order of a FAT directory may.
+ */
+static struct dirent **dirs[4];
+static int             dir_len[4], dir_pos[4];
+static char            dir_path[4][256];
+
+static int no_dot(const struct dirent *e)
+{
+    return e->d_name[0] != '.';
+}
+
+static int name_desc(const struct dirent **a, const struct dirent **b)
+{
+    return strcmp((*b)->d_name, (*a)->d_name);
+}
+
+int f_opendir(const char *name)
+{
+    int i;
+
+    bench.dir++;
+    for (i = 0; i < 4 && dirs[i]; i++) {}
+    if (i == 4) return -1;
+    dir_len[i] = scandir(name, &dirs[i], no_dot, name_desc);
+    if (dir_len[i] < 0) { dirs[i] = 0; return -1; }
+    dir_pos[i] = 0;
+    snprintf(dir_path[i], sizeof dir_path[i], "%s", name);
+    return i;
+}
+
+int f_readdir(f_stat_t *dirent, int dirdes)
+{
+    struct dirent *e;
+    struct stat    st;
+    char           path[512];
+
+    bench.dir++;
+    memset(dirent, 0, sizeof *dirent);
+    if (dirdes < 0 || dirdes >= 4 || !dirs[dirdes]) return -1;
+    if (dir_pos[dirdes] == dir_len[dirdes]) return 0;   /* fname[0] == 0: end of directory */
+    e = dirs[dirdes][dir_pos[dirdes]++];
+    snprintf(dirent->fname, sizeof dirent->fname, "%s", e->d_name);
+    snprintf(path, sizeof path, "%s/%s", dir_path[dirdes], e->d_name);
+    if (stat(path, &st) == 0) {
+        dirent->fsize   = (unsigned long)st.st_size;
+        dirent->fattrib = S_ISDIR(st.st_mode) ? 0x10 : 0;
+    }
+    return 0;
+}
+
+int f_closedir(int dirdes)
+{
+    int k;
+
+    bench.dir++;
+    if (dirdes < 0 || dirdes >= 4 || !dirs[dirdes]) return -1;
+    for (k = 0; k < dir_len[dirdes]; k++) free(dirs[dirdes][k]);
+    free(dirs[dirdes]);
+    dirs[dirdes] = 0;
+    return 0;
+}
+
+int xreg(char, char, unsigned char, ...)
+{
+    return 0;
+}
+
+#define open(p, f)     host_open(p, f)
+#define close(fd)      host_close(fd)
+#define read(fd, b, n) host_read(fd, b, n)
+#define write(fd, b, n) host_write(fd, b, n)
+#define lseek(fd, o, w) host_lseek(fd, o, w)
+#define main           prog_main
+#include PDFBENCH_SRC
+#undef main
+
+int main(int argc, char **argv)
+{
+    int r = prog_main(argc - 1, argv + 1);
+
+    fprintf(stderr,
+            "pdfbench: exit=%d os_calls=%lu open=%lu close=%lu read=%lu write=%lu lseek=%lu"
+            " read_xram=%lu write_xram=%lu dir=%lu bytes_in=%lu bytes_out=%lu rw0=%lu rw1=%lu\n",
+            r,
+            bench.open + bench.close + bench.read + bench.write + bench.lseek
+                + bench.read_xram + bench.write_xram + bench.dir,
+            bench.open, bench.close, bench.read, bench.write, bench.lseek,
+            bench.read_xram, bench.write_xram, bench.dir, bench.bytes_in, bench.bytes_out,
+            bench.rw0, bench.rw1);
+    return r < 0 ? 1 : 0;
+}
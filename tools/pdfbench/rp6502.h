@@ -0,0 +1,74 @@
+/*
+ * rp6502.h — host stand-in for cc65's <rp6502.h>, used by tools/pdfbench
+ *
+ * Just enough of the RIA for src/ext-txt2pdf.c and src/printer.c to build
+ * with a host C++ compiler: 64 KB of XRAM, the two XRAM portals with their
+ * auto-increment step, read_xram()/write_xram() and the f_*dir() calls
+ * backed by host files.
+ * RIA.rw0/rw1 are C++ objects so that every portal access moves the address
+ * by the step, exactly as on the Picocomputer, and is counted.
+ * See ria_host.cpp for the counters and the entry point.
+ */
+
+#ifndef PDFBENCH_RP6502_H
+#define PDFBENCH_RP6502_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define __fastcall__
+
+extern uint8_t xram[0x10000];
+
+struct bench_counters {
+    unsigned long open, close, read, lseek, write;
+    unsigned long read_xram, write_xram, dir;
+    unsigned long bytes_in, bytes_out;
+    unsigned long rw0, rw1;
+};
+extern struct bench_counters bench;
+
+struct Ria {
+    struct Ready { operator uint8_t() const { return 0x80; } } ready;
+    struct Tx { Tx &operator=(uint8_t) { return *this; } } tx;
+    struct Rx { operator uint8_t() const { return 0; } } rx;
+    struct Rw {
+        uint16_t *addr; int8_t *step; unsigned long *count;
+        Rw &operator=(uint8_t b) { xram[*addr] = b; *addr += *step; ++*count; return *this; }
+        operator uint8_t() { uint8_t b = xram[*addr]; *addr += *step; ++*count; return b; }
+    };
+    uint16_t addr0, addr1;
+    int8_t   step0, step1;
+    Rw       rw0, rw1;
+    Ria() : addr0(0), addr1(0), step0(1), step1(1)
+    {
+        rw0.addr = &addr0; rw0.step = &step0; rw0.count = &bench.rw0;
+        rw1.addr = &addr1; rw1.step = &step1; rw1.count = &bench.rw1;
+    }
+};
+extern Ria RIA;
+
+#define RIA_READY_TX_BIT 0x80
+#define RIA_READY_RX_BIT 0x40
+
+typedef struct {
+    unsigned long fsize;
+    unsigned      fdate;
+    unsigned      ftime;
+    unsigned      crdate;
+    unsigned      crtime;
+    unsigned char fattrib;
+    char          altname[12 + 1];
+    char          fname[255 + 1];
+} f_stat_t;
+
+int f_opendir(const char *name);
+int f_readdir(f_stat_t *dirent, int dirdes);
+int f_closedir(int dirdes);
+
+int read_xram(unsigned buf, unsigned count, int fildes);
+int write_xram(unsigned buf, unsigned count, int fildes);
+int xreg(char device, char channel, unsigned char address, ...);
+
+#endif /* PDFBENCH_RP6502_H */
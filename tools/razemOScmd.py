@@ -19,14 +19,23 @@
 #   razemOScmd.py --all --clean                clean artefacts, then build all
 #   razemOScmd.py --all --upload               build all + upload via rp6502.py
 #   razemOScmd.py --all --upload --uploader ctx  build all + upload each via ctx.py
+#   razemOScmd.py --all --upload --port COM4,COM5  upload to two boards at once
+#   razemOScmd.py --all --force                rebuild even what is up to date
+#
+# Builds are incremental: build/manifest.json keeps a hash of everything a
+# .com is made from and of the .com itself, per board the .com uploaded there.
 
 from __future__ import annotations
 
 import argparse
+import hashlib
+import json
+import os
 import re
 import subprocess
 import sys
 import time
+from concurrent.futures import ThreadPoolExecutor
 from datetime import datetime
 from pathlib import Path
 
@@ -38,6 +47,10 @@ except ImportError:
     SerialException = OSError
 
 PROMPT_TIMEOUT_MS = 5000
+MANIFEST = "manifest.json"   # in src/extcmd/build
+
+# Shared by every command, besides the ext-*.c source and its cfg
+RUNTIME_FILES = ("Makefile", "crt0_cmd.s", "ria_api.s", "initmainargs.s", "write_stub.c")
 
 # ---------------------------------------------------------------------------
 # Serial helpers
@@ -67,7 +80,7 @@ def _wait_for_prompt(port, timeout_ms: int, prompt: str) -> bool:
     prompt_bytes = prompt.encode("ascii", errors="ignore")
     while time.monotonic() < deadline:
         try:
-            if port.read(1) == prompt_bytes:
+            if prompt_bytes in port.read(max(1, port.in_waiting)):
                 return True
         except Exception:
             pass
@@ -126,7 +139,7 @@ def _update_appver(src: Path, appver: str) -> None:
 
 def _clean_artefacts(extcmd_dir: Path) -> None:
     removed = 0
-    for pattern in ("build/*.com", "map/*.map"):
+    for pattern in ("build/*.com", "build/*.o", f"build/{MANIFEST}", "map/*.map"):
         for f in extcmd_dir.glob(pattern):
             if f.is_file():
                 f.unlink()
@@ -135,11 +148,103 @@ def _clean_artefacts(extcmd_dir: Path) -> None:
         print(f"  Cleaned {removed} artefact(s).")
 
 
-def _build_one(cmd: str, start: str, extcmd_dir: Path, src_dir: Path, make_exe: str) -> int:
+# ---------------------------------------------------------------------------
+# Build manifest
+# ---------------------------------------------------------------------------
+
+def _hash_source(path: Path, h, seen: set[Path]) -> None:
+    """Feed path and the headers it includes with "..." into h, each once.
+    The APPVER define is left out: it is stamped at build time."""
+    path = path.resolve()
+    if path in seen or not path.is_file():
+        return
+    seen.add(path)
+    text = path.read_bytes()
+    h.update(path.name.encode() + b"\0")
+    h.update(re.sub(rb'#define APPVER "[^"]*"', b"", text))
+    for inc in re.findall(rb'^[ \t]*#[ \t]*include[ \t]+"([^"]+)"', text, re.M):
+        _hash_source(path.parent / inc.decode(), h, seen)
+
+
+def _input_hash(cmd: str, start: str, extcmd_dir: Path, src_dir: Path) -> str:
+    """Hash of everything cmd.com is built from."""
+    h = hashlib.sha256(f"START={start}\0".encode())
+    seen: set[Path] = set()
+    _hash_source(src_dir / f"ext-{cmd}.c", h, seen)
+    _hash_source(extcmd_dir / "cfg" / f"ext0x{start}.cfg", h, seen)
+    for name in RUNTIME_FILES:
+        _hash_source(extcmd_dir / name, h, seen)
+    return h.hexdigest()
+
+
+def _file_hash(path: Path) -> str | None:
+    return hashlib.sha256(path.read_bytes()).hexdigest() if path.is_file() else None
+
+
+def _load_manifest(extcmd_dir: Path) -> dict:
+    try:
+        return json.loads((extcmd_dir / "build" / MANIFEST).read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return {}
+
+
+def _save_manifest(extcmd_dir: Path, manifest: dict) -> None:
+    path = extcmd_dir / "build" / MANIFEST
+    tmp = path.with_suffix(".tmp")
+    tmp.write_text(json.dumps(manifest, indent=1, sort_keys=True), encoding="utf-8")
+    os.replace(tmp, path)
+
+
+def _build_one(cmd: str, start: str, extcmd_dir: Path, src_dir: Path, make_exe: str) -> tuple[int, str]:
     appver = datetime.now().strftime("%Y%m%d.%H%M")
     _update_appver(src_dir / f"ext-{cmd}.c", appver)
-    print(f"Building: {cmd}  (START={start})")
-    return _run([make_exe, f"CMD={cmd}", f"START={start}"], cwd=extcmd_dir)
+    r = subprocess.run(
+        [make_exe, f"CMD={cmd}", f"START={start}"],
+        cwd=str(extcmd_dir),
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        text=True,
+    )
+    return r.returncode, r.stdout
+
+
+def _build_all(cmds: list[str], start: str, extcmd_dir: Path, src_dir: Path,
+               make_exe: str, jobs: int, manifest: dict, force: bool) -> list[str]:
+    """Build the cmds whose inputs changed since the manifest entry, with up
+    to jobs makes at a time. Each command's make output is printed in one
+    piece when it finishes. Returns the commands that failed."""
+    stale = {}
+    for cmd in cmds:
+        entry = manifest.get(cmd, {})
+        inputs = _input_hash(cmd, start, extcmd_dir, src_dir)
+        com = _file_hash(extcmd_dir / "build" / f"{cmd}.com")
+        if force or entry.get("inputs") != inputs or com is None or entry.get("com") != com:
+            stale[cmd] = inputs
+    fresh = [cmd for cmd in cmds if cmd not in stale]
+    if fresh:
+        print(f"Up to date: {', '.join(fresh)}")
+    if not stale:
+        return []
+    if _run([make_exe, "runtime"], cwd=extcmd_dir) != 0:
+        return list(stale)
+    failed = []
+    with ThreadPoolExecutor(max_workers=max(1, jobs)) as pool:
+        builds = [(cmd, pool.submit(_build_one, cmd, start, extcmd_dir, src_dir, make_exe))
+                  for cmd in stale]
+        for cmd, build in builds:
+            rc, output = build.result()
+            print(f"Building: {cmd}  (START={start})")
+            sys.stdout.write(output)
+            if rc != 0:
+                failed.append(cmd)
+                manifest.pop(cmd, None)
+                continue
+            manifest[cmd] = {
+                "inputs": stale[cmd],
+                "com": _file_hash(extcmd_dir / "build" / f"{cmd}.com"),
+                "uploaded": {},     # a new .com is on no board yet
+            }
+    return failed
 
 # ---------------------------------------------------------------------------
 # Upload helpers
@@ -158,16 +263,19 @@ def _upload_ctx(
         port = _open_serial(port_name, baudrate)
         try:
             serial_ok = True
-            time.sleep(0.2)
+            port.reset_input_buffer()   # an old prompt must not answer for the new one
             _send_and_wait(port, "0:", "0:", ">")
-            time.sleep(0.2)
             _send_and_wait(port, f"cd {shell_path}", f"cd {shell_path}", ">")
         finally:
             port.close()
     except (SerialException, OSError, RuntimeError) as exc:
         print(f"  Warning: serial unavailable ({exc})", file=sys.stderr)
 
-    rc = _run([sys.executable, str(ctx_py), str(com_file)], cwd=ctx_py.parent)
+    rc = _run(
+        [sys.executable, str(ctx_py), str(com_file), "--port", port_name,
+         "--baud", str(baudrate)],
+        cwd=ctx_py.parent,
+    )
     if rc != 0:
         return False
 
@@ -175,7 +283,7 @@ def _upload_ctx(
         try:
             port = _open_serial(port_name, baudrate)
             try:
-                time.sleep(0.2)
+                port.reset_input_buffer()
                 _send_and_wait(port, "cd MSC0:/", "cd MSC0:/", ">")
             finally:
                 port.close()
@@ -186,18 +294,41 @@ def _upload_ctx(
 
 
 def _upload_rp6502(
-    com_file: Path,
+    com_files: list[Path],
     rp6502_py: Path,
+    device: str | None,
     rp6502_cfg: Path,
     cwd: Path,
 ) -> bool:
-    """Upload via rp6502.py."""
+    """Upload via rp6502.py, all files in one session. device None uses the
+    device from the rp6502.py config file."""
+    target = ["-d", device] if device else ["-c", str(rp6502_cfg)]
     rc = _run(
-        [sys.executable, str(rp6502_py), "-c", str(rp6502_cfg), "upload", str(com_file)],
+        [sys.executable, str(rp6502_py), *target, "upload", *map(str, com_files)],
         cwd=cwd,
     )
     return rc == 0
 
+
+def _upload_port(
+    port_name: str,
+    com_files: list[Path],
+    uploader: str,
+    args: argparse.Namespace,
+    paths: dict[str, Path],
+    fan_out: bool,
+) -> bool:
+    """Upload every .com to one board."""
+    if uploader == "rp6502":
+        return _upload_rp6502(com_files, paths["rp6502_py"],
+                              port_name if fan_out else None,
+                              paths["rp6502_cfg"], paths["script_root"])
+    for com_file in com_files:
+        print(f"Uploading: {com_file.name}  (via ctx to {port_name})")
+        if not _upload_ctx(com_file, args.shell, port_name, args.baud, paths["ctx_py"]):
+            return False
+    return True
+
 # ---------------------------------------------------------------------------
 # Main
 # ---------------------------------------------------------------------------
@@ -245,12 +376,21 @@ examples:
     )
     parser.add_argument(
         "--port", default="COM4",
-        help="serial port for ctx.py upload (default: COM4)",
+        help="serial port for upload, or a comma separated list of ports "
+             "to upload to all of them at once (default: COM4)",
     )
     parser.add_argument(
         "--baud", type=int, default=115200,
         help="baud rate (default: 115200)",
     )
+    parser.add_argument(
+        "--jobs", "-j", type=int, default=os.cpu_count() or 1,
+        help="commands built at the same time (default: number of CPUs)",
+    )
+    parser.add_argument(
+        "--force", action="store_true",
+        help="build and upload even the commands that are up to date",
+    )
     parser.add_argument(
         "--clean", action="store_true",
         help="remove all .com and .map artefacts (can be used standalone)",
@@ -288,25 +428,60 @@ examples:
     # Default upload method
     uploader = args.uploader or ("rp6502" if args.all else "ctx")
 
-    # Build (and optionally upload) each command
-    for cmd in cmds:
-        rc = _build_one(cmd, args.start, extcmd_dir, src_dir, make_exe)
-        if rc != 0:
-            print(f"ERROR: build failed for '{cmd}'", file=sys.stderr)
-            return rc
-
-        if args.upload:
-            com_file = extcmd_dir / "build" / f"{cmd}.com"
-            print(f"Uploading: {com_file.name}  (via {uploader})")
-            if uploader == "ctx":
-                ok = _upload_ctx(com_file, args.shell, args.port, args.baud, ctx_py)
-            else:
-                ok = _upload_rp6502(com_file, rp6502_py, rp6502_cfg, script_root)
-            if not ok:
-                print(f"ERROR: upload failed for '{cmd}'", file=sys.stderr)
-                return 1
-
-    return 0
+    # Build the commands that changed, several at a time
+    manifest = _load_manifest(extcmd_dir)
+    failed = _build_all(cmds, args.start, extcmd_dir, src_dir, make_exe, args.jobs,
+                        manifest, args.force)
+    _save_manifest(extcmd_dir, manifest)
+    for cmd in failed:
+        print(f"ERROR: build failed for '{cmd}'", file=sys.stderr)
+    if failed:
+        return 1
+
+    if not args.upload:
+        return 0
+
+    # Upload to every board at once, the files one after another on each.
+    # A board is named by its port, or by the rp6502.py config it is reached by.
+    ports = [p.strip() for p in args.port.split(",") if p.strip()]
+    fan_out = len(ports) > 1
+    paths = {"ctx_py": ctx_py, "rp6502_py": rp6502_py,
+             "rp6502_cfg": rp6502_cfg, "script_root": script_root}
+
+    def board(port_name: str) -> str:
+        return port_name if fan_out or uploader == "ctx" else str(rp6502_cfg)
+
+    def pending(port_name: str) -> list[str]:
+        return [cmd for cmd in cmds if args.force
+                or manifest[cmd].get("uploaded", {}).get(board(port_name)) != manifest[cmd]["com"]]
+
+    todo = {p: pending(p) for p in ports}
+    for port_name, names in todo.items():
+        current = [cmd for cmd in cmds if cmd not in names]
+        if current:
+            print(f"Already on {port_name}: {', '.join(current)}")
+    todo = {p: names for p, names in todo.items() if names}
+    if not todo:
+        return 0
+    print(f"Uploading: {', '.join(f'{len(n)} file(s) to {p}' for p, n in todo.items())}"
+          f"  (via {uploader})")
+    with ThreadPoolExecutor(max_workers=len(todo)) as pool:
+        uploads = [(p, names, pool.submit(
+                        _upload_port, p,
+                        [extcmd_dir / "build" / f"{cmd}.com" for cmd in names],
+                        uploader, args, paths, fan_out))
+                   for p, names in todo.items()]
+        bad = []
+        for port_name, names, up in uploads:
+            if not up.result():
+                bad.append(port_name)
+                continue
+            for cmd in names:
+                manifest[cmd].setdefault("uploaded", {})[board(port_name)] = manifest[cmd]["com"]
+    _save_manifest(extcmd_dir, manifest)
+    for port_name in bad:
+        print(f"ERROR: upload failed on {port_name}", file=sys.stderr)
+    return 1 if bad else 0
 
 
 if __name__ == "__main__":
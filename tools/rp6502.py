@@ -45,6 +45,79 @@ SCRIPT_NAME = os.path.splitext(SCRIPT_FILE)[0].upper()
 # so short that it becomes suspect.
 RESPONSE_TIMEOUT = 2.0
 
+# Delta uploads check RAM with a small 6502 program (see crc_program).
+# It needs these bytes and clobbers them, so blocks touching them are
+# always sent: zero page pointers, the stack and the CPU vectors.
+CRC_SCRATCH = ((0x00F0, 0x00F4), (0x0100, 0x0200), (0xFFFA, 0x10000))
+CRC_PROGRAM_SIZE = 0x300  # tables, code and variables before the block list
+DELTA_BLOCK = 0x100       # granularity of RAM checks and resends
+
+# UPLOAD sends 1k chunks, each answered by a "}" prompt once it is written.
+# USB CDC and telnet are flow controlled, so the next chunks can follow
+# before that prompt arrives. Use --depth 1 for a UART without flow control.
+UPLOAD_CHUNK = 1024
+UPLOAD_DEPTH = 4
+
+
+def crc_program(base: int, blocks) -> bytes:
+    """6502 program at base that prints the CRC-16/XMODEM of each (addr, length)
+    block in RAM as "#" + four hex digits per block + CR LF. Entry at base+$200."""
+    lo, hi = bytearray(256), bytearray(256)
+    for i in range(256):
+        crc = i << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+        lo[i], hi[i] = crc & 0xFF, crc >> 8
+
+    def w(addr):
+        return [addr & 0xFF, addr >> 8]
+
+    table = base + CRC_PROGRAM_SIZE
+    cnt_lo, cnt_hi = w(base + 0x2F0), w(base + 0x2F1)
+    crc_lo, crc_hi = w(base + 0x2F2), w(base + 0x2F3)
+    code = base + 0x200
+    # fmt: off
+    program = [
+        0x78, 0xD8, 0xA2, 0xFF, 0x9A,                   # SEI CLD LDX #$FF TXS
+        0xA9, table & 0xFF, 0x85, 0xF2,                 # block list -> ($F2)
+        0xA9, table >> 8, 0x85, 0xF3,
+        0xA9, 0x23, 0x20, *w(code + 0x9E),              # JSR out '#'
+        # next ($12): ($F0) = addr, count = length, 0 ends the list
+        0xA0, 0x00, 0xB1, 0xF2, 0x85, 0xF0,
+        0xC8, 0xB1, 0xF2, 0x85, 0xF1,
+        0xC8, 0xB1, 0xF2, 0x8D, *cnt_lo,
+        0xC8, 0xB1, 0xF2, 0x8D, *cnt_hi,
+        0x0D, *cnt_lo, 0xF0, 0x50,                      # BEQ done
+        0x18, 0xA5, 0xF2, 0x69, 0x04, 0x85, 0xF2,       # ($F2) += 4
+        0x90, 0x02, 0xE6, 0xF3,
+        0xA9, 0x00, 0x8D, *crc_lo, 0x8D, *crc_hi, 0xA8,
+        # byte ($42): crc = crc << 8 ^ table[crc >> 8 ^ b]
+        0xB1, 0xF0, 0x4D, *crc_hi, 0xAA,
+        0xAD, *crc_lo, 0x5D, *w(base + 0x100), 0x8D, *crc_hi,
+        0xBD, *w(base), 0x8D, *crc_lo,
+        0xC8, 0xD0, 0x02, 0xE6, 0xF1,                   # INY, carry into ($F0)
+        0xAD, *cnt_lo, 0xD0, 0x03, 0xCE, *cnt_hi, 0xCE, *cnt_lo,
+        0xAD, *cnt_lo, 0x0D, *cnt_hi, 0xD0, 0xD3,       # BNE byte
+        0xAD, *crc_hi, 0x20, *w(code + 0x8B),           # JSR hex
+        0xAD, *crc_lo, 0x20, *w(code + 0x8B),
+        0x4C, *w(code + 0x12),                          # JMP next
+        # done ($7E): CR LF and wait for the break
+        0xA9, 0x0D, 0x20, *w(code + 0x9E),
+        0xA9, 0x0A, 0x20, *w(code + 0x9E),
+        0x4C, *w(code + 0x88),
+        # hex ($8B), nibble ($96), out ($9E) to the RIA UART
+        0x48, 0x4A, 0x4A, 0x4A, 0x4A, 0x20, *w(code + 0x96), 0x68, 0x29, 0x0F,
+        0xC9, 0x0A, 0x90, 0x02, 0x69, 0x06, 0x69, 0x30,
+        0x2C, 0xE0, 0xFF, 0x10, 0xFB, 0x8D, 0xE1, 0xFF, 0x60,
+    ]
+    # fmt: on
+    out = bytearray(CRC_PROGRAM_SIZE)
+    out[0:256], out[256:512] = lo, hi
+    out[0x200 : 0x200 + len(program)] = bytes(program)
+    for addr, length in blocks:
+        out += bytes(w(addr) + w(length))
+    return bytes(out + b"\0\0\0\0")
+
 
 class SerialDevice:
     """Cross-platform serial port implementation."""
@@ -223,6 +296,23 @@ class SerialDevice:
                 time.sleep(0.001)
         return data
 
+    def read_some(self, size: int = 4096, timeout: float = RESPONSE_TIMEOUT) -> bytes:
+        """Read whatever has arrived, up to size bytes. Waits up to timeout
+        for the first byte only."""
+        if self._is_posix:
+            ready, _, _ = select.select([self._fd], [], [], timeout)
+            if not ready:
+                return b""
+            try:
+                return os.read(self._fd, size)
+            except BlockingIOError:
+                return b""
+        deadline = time.monotonic() + timeout
+        while True:
+            data = self._read_windows(size)  # returns within ~1ms
+            if data or time.monotonic() >= deadline:
+                return data
+
     def _read_windows(self, size: int) -> bytes:
         """Read with timeout on Windows."""
         buffer = ctypes.create_string_buffer(size)
@@ -506,6 +596,27 @@ class TelnetDevice:
         self._read_buf = self._read_buf[size:]
         return result
 
+    def read_some(self, size: int = 4096, timeout: float = RESPONSE_TIMEOUT) -> bytes:
+        """Read whatever has arrived, up to size bytes. Waits up to timeout
+        for the first byte only."""
+        deadline = time.monotonic() + timeout
+        while not self._read_buf:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            try:
+                chunk = self._sock.recv(size)
+                if not chunk:
+                    break  # peer closed
+                self._read_buf += self._strip_iac(chunk)
+            except BlockingIOError:
+                select.select([self._sock], [], [], remaining)
+            except OSError:
+                break
+        result = self._read_buf[:size]
+        self._read_buf = self._read_buf[size:]
+        return result
+
     def read_until(self, delimiter: bytes = b"\n") -> bytes:
         """Read until delimiter is found or timeout occurs."""
         start = time.monotonic()
@@ -547,6 +658,60 @@ class TelnetDevice:
             self._sock = None
 
 
+class PromptScanner:
+    """Picks monitor prompts and "?" error lines out of replies read in bulk."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buf = b""
+        self.line_start = True
+        self.error = None  # "?" line being collected
+        self.waited = 0.0  # seconds spent waiting for replies
+
+    def expect(self, prompt: str, timeout: float = RESPONSE_TIMEOUT):
+        """Consume replies up to and including the next prompt character."""
+        target = ord(prompt)
+        deadline = time.monotonic() + timeout
+        while True:
+            for i, b in enumerate(self.buf):
+                if self.error is not None:
+                    if b in b"\r\n":
+                        raise RuntimeError(self.error.decode("ascii", "replace"))
+                    self.error.append(b)
+                elif self.line_start and b == ord("?"):
+                    self.error = bytearray(b"?")
+                elif b == target:
+                    self.buf = self.buf[i + 1 :]
+                    self.line_start = False
+                    return
+                else:
+                    self.line_start = b in b"\r\n"
+            self.buf = b""
+            start = time.monotonic()
+            if start >= deadline:
+                raise TimeoutError("Timeout: console did not respond")
+            self.buf = self.port.read_some(4096, min(deadline - start, 0.1))
+            self.waited += time.monotonic() - start
+
+
+def join_blocks(blocks, size: int = 1024) -> list:
+    """Merge adjacent (addr, data) blocks into chunks of up to size bytes,
+    never crossing a 64k page."""
+    joined = []
+    for addr, data in blocks:
+        if joined:
+            last, prev = joined[-1]
+            if (
+                last + len(prev) == addr
+                and len(prev) + len(data) <= size
+                and addr & 0xFFFF
+            ):
+                joined[-1] = (last, prev + data)
+                continue
+        joined.append((addr, data))
+    return joined
+
+
 class Console:
     """Manages the RIA console over a serial connection."""
 
@@ -810,21 +975,41 @@ class Console:
         self.serial.write(data)
         self.wait_for_prompt("]")
 
-    def upload(self, file, name: str):
-        """Upload readable file to remote file "name"."""
+    def upload(self, file, name: str, depth: int = UPLOAD_DEPTH) -> dict:
+        """Upload readable file to remote file "name". Up to depth chunks
+        are sent ahead of their "}" prompts. Returns transfer statistics."""
         self.serial.write(bytes(f"UPLOAD {json.dumps(name)}\r", "ascii"))
         self.wait_for_prompt("}")
         file.seek(0)
+        replies = PromptScanner(self.serial)
+        total = chunks = pending = 0
+        more = True
         while True:
-            chunk = file.read(1024)
-            if len(chunk) == 0:
+            while more and pending < max(1, depth):
+                chunk = file.read(UPLOAD_CHUNK)
+                if len(chunk) == 0:
+                    more = False
+                    break
+                command = f"${len(chunk):03X} ${binascii.crc32(chunk):08X}\r"
+                self.serial.write(bytes(command, "ascii") + chunk)
+                total += len(chunk)
+                chunks += 1
+                pending += 1
+            if not pending:
                 break
-            command = f"${len(chunk):03X} ${binascii.crc32(chunk):08X}\r"
-            self.serial.write(bytes(command, "ascii"))
-            self.serial.write(chunk)
-            self.wait_for_prompt("}")
+            try:
+                replies.expect("}")
+            except (RuntimeError, TimeoutError):
+                if pending > 1:
+                    # the chunks behind the failed one reached the monitor
+                    # prompt, answer whatever they caused and start clean
+                    time.sleep(0.1)
+                    self.send_break()
+                raise
+            pending -= 1
         self.serial.write(b"END\r")
-        self.wait_for_prompt("]")
+        replies.expect("]")
+        return {"bytes": total, "chunks": chunks, "waited": replies.waited}
 
     def load(self, name: str):
         """Load a previously uploaded ROM file."""
@@ -836,13 +1021,61 @@ class Console:
         self.serial.write(b"RESET\r")
         self.serial.read_until()
 
-    def send_rom(self, rom):
-        """Send rom."""
-        addr, data = rom.next_rom_data(0)
-        while data is not None:
+    def send_rom(self, rom, cache=None) -> int:
+        """Send rom. With the DeltaCache of an earlier send to this device,
+        only blocks that differ from the device's RAM are sent. Returns bytes sent."""
+        if cache is not None and cache.blocks:
+            send = self.delta_blocks(rom, rom.rom_blocks(DELTA_BLOCK), cache)
+        else:
+            send = rom.rom_blocks()
+        for addr, data in join_blocks(send):
             self.binary(addr, data)
-            addr += len(data)
-            addr, data = rom.next_rom_data(addr)
+        return sum(len(d) for _, d in send)
+
+    def delta_blocks(self, rom, blocks, cache) -> list:
+        """The blocks the device does not hold. Those unchanged since the cached
+        send are checked against the CRCs of the device's RAM; XRAM blocks and
+        blocks in CRC_SCRATCH are always sent."""
+        if not (rom.alloc.get(0xFFFC) and rom.alloc.get(0xFFFD)):
+            return blocks                   # RESET must not find our program again
+        check = []
+        for addr, data in blocks:
+            end = addr + len(data)
+            if end > 0x10000 or any(addr < e and s < end for s, e in CRC_SCRATCH):
+                continue
+            if cache.blocks.get(f"{addr:06X}") == binascii.crc_hqx(data, 0):
+                check.append((addr, data))
+        if not check:
+            return blocks
+        base = rom.free_ram(CRC_PROGRAM_SIZE + 4 * len(check) + 4)
+        crcs = self.ram_crc(base, [(a, len(d)) for a, d in check])
+        held = {a for (a, d), crc in zip(check, crcs) if crc == binascii.crc_hqx(d, 0)}
+        end = base + CRC_PROGRAM_SIZE + 4 * len(check) + 4
+        return [
+            (a, d) for a, d in blocks
+            if a not in held or (a < end and base < a + len(d))
+        ]
+
+    def ram_crc(self, base: int, blocks) -> list:
+        """CRC-16/XMODEM of (addr, length) RAM blocks, worked out by the 6502
+        running crc_program at base. Leaves the monitor prompt."""
+        program = crc_program(base, blocks)
+        for i in range(0, len(program), 1024):
+            self.binary(base + i, program[i : i + 1024])
+        entry = base + 0x200
+        self.binary(0xFFFC, bytes([entry & 0xFF, entry >> 8]))
+        self.serial.write(b"RESET\r")
+        start = time.monotonic()
+        line = b""
+        while not line.startswith(b"#"):
+            line = self.serial.read_until().strip()
+            if not line and time.monotonic() - start > RESPONSE_TIMEOUT:
+                raise TimeoutError("Timeout: RAM CRC did not respond")
+        self.send_break()
+        digits = line[1:].decode("ascii")
+        if len(digits) != 4 * len(blocks):
+            raise RuntimeError(f"RAM CRC reply garbled: {line!r}")
+        return [int(digits[i : i + 4], 16) for i in range(0, len(digits), 4)]
 
     def wait_for_prompt(self, prompt: str, timeout: float = RESPONSE_TIMEOUT):
         """Wait for a specific prompt from the device."""
@@ -1041,6 +1274,47 @@ class ROM:
         """Returns true if $FFFC and $FFFD have been set."""
         return bool(self.alloc[0xFFFC] and self.alloc[0xFFFD])
 
+    def rom_blocks(self, size: int = 1024) -> list:
+        """All (addr, data) chunks of up to size bytes, never crossing a 64k page.
+        The default size splits as next_rom_data does."""
+        blocks = []
+        start = length = None
+
+        def chunk():
+            return start, bytes(self.data[start + i] for i in range(length))
+
+        for addr in sorted(self.alloc):
+            if (
+                start is not None
+                and addr == start + length
+                and length < size
+                and addr & 0xFFFF
+            ):
+                length += 1
+                continue
+            if start is not None:
+                blocks.append(chunk())
+            start, length = addr, 1
+        if start is not None:
+            blocks.append(chunk())
+        return blocks
+
+    def free_ram(self, length: int) -> int:
+        """First page aligned RAM range of length not used by the ROM,
+        or $0200 when there is none (the blocks it covers are sent again)."""
+        for base in range(0x0200, 0xFF00 - length, 0x100):
+            if not any(self.alloc.get(base + i) for i in range(length)):
+                return base
+        return 0x0200
+
+    def assets_crc(self) -> int:
+        """CRC32 over asset names and contents."""
+        crc = 0
+        for name, data in self.assets:
+            crc = binascii.crc32(name.encode("utf-8") + b"\0", crc)
+            crc = binascii.crc32(data, crc)
+        return crc
+
     def next_rom_data(self, addr: int):
         """Find next up-to-1k chunk starting at addr, never crossing 64k page."""
         for addr in range(addr, 0x1000000):
@@ -1055,6 +1329,43 @@ class ROM:
         return None, None
 
 
+class DeltaCache:
+    """Block CRCs of the ROM last sent to one device, kept on the host."""
+
+    def __init__(self, device: str):
+        name = re.sub(r"[^\w.-]+", "_", device).strip("_") or "device"
+        self.path = os.path.join(
+            os.path.expanduser("~"), ".cache", SCRIPT_NAME.lower(), f"{name}.json"
+        )
+        self.rom = None
+        self.assets = None
+        self.blocks = {}
+        try:
+            with open(self.path, "r") as f:
+                state = json.load(f)
+            self.rom = state["rom"]
+            self.assets = state["assets"]
+            self.blocks = state["blocks"]
+        except (OSError, ValueError, KeyError):
+            pass
+
+    def remember(self, name: str, rom):
+        """Record rom, sent as file name, as what the device now holds."""
+        self.rom = name
+        self.assets = rom.assets_crc()
+        self.blocks = {
+            f"{a:06X}": binascii.crc_hqx(d, 0) for a, d in rom.rom_blocks(DELTA_BLOCK)
+        }
+        self.save()
+
+    def save(self):
+        os.makedirs(os.path.dirname(self.path), exist_ok=True)
+        with open(self.path, "w") as f:
+            json.dump(
+                {"rom": self.rom, "assets": self.assets, "blocks": self.blocks}, f
+            )
+
+
 def exec_args():
     # Standard library argument parser
     class CustomFormatter(argparse.HelpFormatter):
@@ -1162,6 +1473,20 @@ def exec_args():
         default="True",
         help=f"Attach to console terminal on run.",
     )
+    parser.add_argument(
+        "--delta",
+        dest="delta",
+        action="store_true",
+        help="On run, send only the RAM blocks that changed since the last run.",
+    )
+    parser.add_argument(
+        "--depth",
+        dest="depth",
+        metavar="n",
+        type=int,
+        default=UPLOAD_DEPTH,
+        help=f"Upload chunks sent ahead of the monitor's reply. Default={UPLOAD_DEPTH}",
+    )
     args = parser.parse_args()
 
     # Standard library configuration parser
@@ -1214,16 +1539,15 @@ def exec_args():
 
     def timed_upload(console, file, name):
         """Upload with timing and throughput logging."""
-        file.seek(0)
-        total_bytes = file.seek(0, 2)
-        file.seek(0)
         start = time.monotonic()
-        console.upload(file, name)
+        stats = console.upload(file, name, args.depth)
         elapsed = time.monotonic() - start
         if elapsed > 0:
-            rate = total_bytes / elapsed
+            rate = stats["bytes"] / elapsed
             print(
-                f"[{SCRIPT_FILE}] {total_bytes} bytes in {elapsed:.2f}s ({rate:.0f} bytes/s)"
+                f"[{SCRIPT_FILE}] {stats['bytes']} bytes in {elapsed:.2f}s "
+                f"({rate:.0f} bytes/s), {stats['chunks']} chunks, depth {args.depth}, "
+                f"{stats['waited'] / elapsed:.0%} waiting on the monitor"
             )
 
     # Open console and extend error with a hint about the config file
@@ -1257,11 +1581,35 @@ def exec_args():
         print(f"[{SCRIPT_FILE}] Reading ROM {args.filename[0]}")
         rom = ROM()
         rom.add_rom_file(args.filename[0])
-        print(f"[{SCRIPT_FILE}] Uploading ROM")
-        with open(args.filename[0], "rb") as f:
-            timed_upload(console, f, os.path.basename(args.filename[0]))
-        print(f"[{SCRIPT_FILE}] Loading ROM")
-        console.load(os.path.basename(args.filename[0]))
+        name = os.path.basename(args.filename[0])
+        cache = DeltaCache(args.device) if args.delta else None
+        if (
+            cache
+            and cache.blocks
+            and cache.rom == name
+            and cache.assets == rom.assets_crc()
+        ):
+            print(f"[{SCRIPT_FILE}] Sending ROM changes")
+            start = time.monotonic()
+            sent = console.send_rom(rom, cache)
+            total = sum(len(d) for _, d in rom.rom_blocks())
+            elapsed = time.monotonic() - start
+            print(f"[{SCRIPT_FILE}] {sent} of {total} bytes in {elapsed:.2f}s")
+            if rom.assets:
+                print(
+                    f"[{SCRIPT_FILE}] Stored {name} not updated, "
+                    "run without --delta to store it"
+                )
+            cache.remember(name, rom)
+            console.reset()
+        else:
+            print(f"[{SCRIPT_FILE}] Uploading ROM")
+            with open(args.filename[0], "rb") as f:
+                timed_upload(console, f, name)
+            print(f"[{SCRIPT_FILE}] Loading ROM")
+            console.load(name)
+            if cache is not None:
+                cache.remember(name, rom)
         if args.term:
             console.terminal(code_page)
 